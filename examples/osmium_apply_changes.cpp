@@ -0,0 +1,96 @@
+/*
+
+  Apply one or more OSM change files to an OSM file and write the
+  updated file.
+
+  Only the changes are kept in memory, the OSM file is read and the
+  result is written in one sequential pass. The OSM file must be sorted
+  by object type, id, and version (see osmium_sort) and may contain only
+  one version of each object.
+
+  The code in this example file is released into the Public Domain.
+
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <getopt.h>
+
+#define OSMIUM_WITH_PBF_INPUT
+#define OSMIUM_WITH_XML_INPUT
+#define OSMIUM_WITH_O5M_INPUT
+#define OSMIUM_WITH_OPL_INPUT
+#define OSMIUM_WITH_DUMP_INPUT
+#include <osmium.hpp>
+#include <osmium/output/xml.hpp>
+#include <osmium/output/pbf.hpp>
+#include <osmium/output/o5m.hpp>
+#include <osmium/output/opl.hpp>
+#include <osmium/output/dump.hpp>
+#include <osmium/storage/changestore.hpp>
+
+void print_help() {
+    std::cout << "osmium_apply_changes [OPTIONS] INFILE CHANGEFILE... OUTFILE\n\n" \
+              << "File format is given as suffix in format .TYPE[.ENCODING], see osmium_convert.\n" \
+              << "\nOptions:\n" \
+              << "  -h, --help       This help message\n" \
+              << "  -v, --verbose    Print number of changed objects\n";
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"help",    no_argument, 0, 'h'},
+        {"verbose", no_argument, 0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    bool verbose = false;
+
+    while (true) {
+        int c = getopt_long(argc, argv, "hv", long_options, 0);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+            case 'h':
+                print_help();
+                exit(0);
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                exit(1);
+        }
+    }
+
+    if (argc - optind < 3) {
+        print_help();
+        exit(1);
+    }
+
+    Osmium::OSMFile infile(argv[optind]);
+    Osmium::OSMFile outfile(argv[argc-1]);
+
+    Osmium::Storage::ChangeStore changes;
+    try {
+        for (int i = optind + 1; i < argc - 1; ++i) {
+            Osmium::Input::read(Osmium::OSMFile(argv[i]), changes);
+        }
+        changes.sort();
+        if (verbose) {
+            std::cerr << "changed objects: " << changes.size() << std::endl;
+        }
+
+        Osmium::Output::Handler out(outfile);
+        out.set_generator("osmium_apply_changes");
+
+        Osmium::Storage::ChangeStore::ApplyHandler<Osmium::Output::Handler> apply(changes, out);
+        Osmium::Input::read(infile, apply);
+    } catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+}
@@ -11,10 +11,21 @@
 
 #define OSMIUM_WITH_PBF_INPUT
 #define OSMIUM_WITH_XML_INPUT
+#define OSMIUM_WITH_O5M_INPUT
+#define OSMIUM_WITH_OPL_INPUT
+#define OSMIUM_WITH_DUMP_INPUT
 #include <osmium.hpp>
 #include <osmium/output/xml.hpp>
 #include <osmium/output/pbf.hpp>
+#include <osmium/output/o5m.hpp>
+#include <osmium/output/opl.hpp>
+#include <osmium/output/dump.hpp>
 #include <osmium/handler/progress.hpp>
+#include <osmium/handler/coordinates_for_ways.hpp>
+#include <osmium/storage/byid/mmap_file.hpp>
+
+typedef Osmium::Storage::ById::MmapFile<Osmium::OSM::Position> storage_mmap_t;
+typedef Osmium::Handler::CoordinatesForWays<storage_mmap_t, storage_mmap_t> cfw_handler_t;
 
 void print_help() {
     std::cout << "osmium_convert [OPTIONS] [INFILE [OUTFILE]]\n\n" \
@@ -29,11 +40,17 @@ void print_help() {
               << "  gz      XML encoding compressed with gzip\n" \
               << "  bz2     XML encoding compressed with bzip2\n" \
               << "  pbf     binary PBF encoding\n" \
+              << "  o5m     binary o5m encoding (.o5m and .o5c files)\n" \
+              << "  opl     text encoding with one object per line\n" \
+              << "  dump    Osmium dump format for intermediate files\n" \
               << "\nOptions:\n" \
               << "  -h, --help                This help message\n" \
               << "  -d, --debug               Enable debugging output\n" \
               << "  -f, --from-format=FORMAT  Input format\n" \
-              << "  -t, --to-format=FORMAT    Output format\n";
+              << "  -t, --to-format=FORMAT    Output format\n" \
+              << "  -c, --compression=CODEC   Compression of PBF blobs (none, zlib, lzma, zstd, lz4,\n" \
+              << "                            optionally with level, for instance zlib:9)\n" \
+              << "  -l, --locations-on-ways   Add node locations to ways (PBF output only)\n";
 }
 
 int main(int argc, char* argv[]) {
@@ -42,6 +59,8 @@ int main(int argc, char* argv[]) {
         {"help",        no_argument, 0, 'h'},
         {"from-format", required_argument, 0, 'f'},
         {"to-format",   required_argument, 0, 't'},
+        {"compression", required_argument, 0, 'c'},
+        {"locations-on-ways", no_argument, 0, 'l'},
         {0, 0, 0, 0}
     };
 
@@ -49,9 +68,11 @@ int main(int argc, char* argv[]) {
 
     std::string input_format;
     std::string output_format;
+    std::string compression;
+    bool locations_on_ways = false;
 
     while (true) {
-        int c = getopt_long(argc, argv, "dhf:t:", long_options, 0);
+        int c = getopt_long(argc, argv, "dhf:t:c:l", long_options, 0);
         if (c == -1) {
             break;
         }
@@ -69,6 +90,12 @@ int main(int argc, char* argv[]) {
             case 't':
                 output_format = optarg;
                 break;
+            case 'c':
+                compression = optarg;
+                break;
+            case 'l':
+                locations_on_ways = true;
+                break;
             default:
                 exit(1);
         }
@@ -119,12 +146,44 @@ int main(int argc, char* argv[]) {
     out.set_debug_level(debug ? 1 : 0);
     out.set_generator("osmium_convert");
 
+    if (!compression.empty()) {
+        Osmium::Output::PBF* pbf = dynamic_cast<Osmium::Output::PBF*>(&out.output());
+        if (!pbf) {
+            std::cerr << "Compression can only be set for PBF output" << std::endl;
+            exit(1);
+        }
+        try {
+            pbf->compression(Osmium::Compression::BlobCodec::parse(compression));
+        } catch (std::invalid_argument& e) {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+    }
+
     Osmium::Handler::Progress progress_handler;
 
     typedef Osmium::Handler::Sequence<Osmium::Output::Handler, Osmium::Handler::Progress> sequence_handler_t;
     sequence_handler_t sequence_handler(out, progress_handler);
 
-    Osmium::Input::read(infile, sequence_handler);
+    if (locations_on_ways) {
+        Osmium::Output::PBF* pbf = dynamic_cast<Osmium::Output::PBF*>(&out.output());
+        if (!pbf) {
+            std::cerr << "Locations on ways can only be added to PBF output" << std::endl;
+            exit(1);
+        }
+        pbf->locations_on_ways(true);
+
+        storage_mmap_t store_pos;
+        storage_mmap_t store_neg;
+        cfw_handler_t handler_cfw(store_pos, store_neg);
+
+        typedef Osmium::Handler::Sequence<cfw_handler_t, sequence_handler_t> cfw_sequence_handler_t;
+        cfw_sequence_handler_t cfw_sequence_handler(handler_cfw, sequence_handler);
+
+        Osmium::Input::read(infile, cfw_sequence_handler);
+    } else {
+        Osmium::Input::read(infile, sequence_handler);
+    }
 
     google::protobuf::ShutdownProtobufLibrary();
 }
@@ -0,0 +1,300 @@
+/*
+
+  This is a small tool to compare the speed of the PBF decoder in Osmium with
+  the code protoc generated for libosmpbf.
+
+  All data blocks of the file are read and inflated first. Then both decoders
+  are timed on the same blocks: libosmpbf parses each block into a
+  PrimitiveBlock object, Osmium decodes it lazily with PBFPrimitiveBlock and
+  Osmium::Protobuf::Message. Both then visit every ID, node reference,
+  member, and tag. A checksum over these is printed for both to make sure
+  they see the same data.
+
+  The time for Osmium includes copying each block into a writable buffer,
+  which is needed because the strings are NUL-terminated in place.
+
+  The code in this example file is released into the Public Domain.
+
+*/
+
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include <osmpbf/osmpbf.h>
+
+#include <osmium/input/pbf_primitive_block.hpp>
+#include <osmium/utils/protobuf.hpp>
+
+typedef std::vector<std::string> blocks_t;
+
+int convert_from_network_byte_order(const unsigned char data[4]) {
+    return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+/**
+ * Read all OSMData blocks from the file and inflate them.
+ */
+void read_blocks(const char* filename, blocks_t& blocks) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Can't open file " << filename << std::endl;
+        exit(1);
+    }
+
+    unsigned char size_buffer[4];
+    while (file.read(reinterpret_cast<char*>(size_buffer), 4)) {
+        std::string buffer(convert_from_network_byte_order(size_buffer), '\0');
+        OSMPBF::BlobHeader blob_header;
+        if (!file.read(&buffer[0], buffer.size()) || !blob_header.ParseFromString(buffer)) {
+            std::cerr << "Can't read BlobHeader" << std::endl;
+            exit(1);
+        }
+
+        buffer.resize(blob_header.datasize());
+        OSMPBF::Blob blob;
+        if (!file.read(&buffer[0], buffer.size()) || !blob.ParseFromString(buffer)) {
+            std::cerr << "Can't read Blob" << std::endl;
+            exit(1);
+        }
+
+        if (blob_header.type() != "OSMData") {
+            continue;
+        }
+
+        if (blob.has_raw()) {
+            blocks.push_back(blob.raw());
+        } else if (blob.has_zlib_data()) {
+            std::string block(blob.raw_size(), '\0');
+            unsigned long size = block.size();
+            if (uncompress(reinterpret_cast<unsigned char*>(&block[0]), &size, reinterpret_cast<const unsigned char*>(blob.zlib_data().data()), blob.zlib_data().size()) != Z_OK) {
+                std::cerr << "zlib error" << std::endl;
+                exit(1);
+            }
+            blocks.push_back(block);
+        } else {
+            std::cerr << "Unsupported blob compression" << std::endl;
+            exit(1);
+        }
+    }
+}
+
+/* ================================================== */
+
+template <class T>
+int64_t checksum_tags(const T& object, const OSMPBF::StringTable& stringtable) {
+    int64_t sum = 0;
+    for (int i=0; i < object.keys_size(); ++i) {
+        sum += stringtable.s(object.keys(i)).size() + stringtable.s(object.vals(i)).size();
+    }
+    return sum;
+}
+
+int64_t checksum_libosmpbf(const std::string& data) {
+    OSMPBF::PrimitiveBlock block;
+    if (!block.ParseFromString(data)) {
+        std::cerr << "libosmpbf can't parse block" << std::endl;
+        exit(1);
+    }
+    const OSMPBF::StringTable& stringtable = block.stringtable();
+
+    int64_t sum = 0;
+    for (int g=0; g < block.primitivegroup_size(); ++g) {
+        const OSMPBF::PrimitiveGroup& group = block.primitivegroup(g);
+        for (int i=0; i < group.nodes_size(); ++i) {
+            sum += group.nodes(i).id() + checksum_tags(group.nodes(i), stringtable);
+        }
+        if (group.has_dense()) {
+            const OSMPBF::DenseNodes& dense = group.dense();
+            int64_t id = 0;
+            for (int i=0; i < dense.id_size(); ++i) {
+                id += dense.id(i);
+                sum += id;
+            }
+            for (int i=0; i < dense.keys_vals_size(); ++i) {
+                if (dense.keys_vals(i) != 0) {
+                    sum += stringtable.s(dense.keys_vals(i)).size();
+                }
+            }
+        }
+        for (int i=0; i < group.ways_size(); ++i) {
+            const OSMPBF::Way& way = group.ways(i);
+            sum += way.id() + checksum_tags(way, stringtable);
+            int64_t ref = 0;
+            for (int j=0; j < way.refs_size(); ++j) {
+                ref += way.refs(j);
+                sum += ref;
+            }
+        }
+        for (int i=0; i < group.relations_size(); ++i) {
+            const OSMPBF::Relation& relation = group.relations(i);
+            sum += relation.id() + checksum_tags(relation, stringtable);
+            int64_t ref = 0;
+            for (int j=0; j < relation.memids_size(); ++j) {
+                ref += relation.memids(j);
+                sum += ref + relation.types(j) + stringtable.s(relation.roles_sid(j)).size();
+            }
+        }
+    }
+    return sum;
+}
+
+/* ================================================== */
+
+/**
+ * Checksum for an encoded Node (field 1 in a PrimitiveGroup), Way (3), or
+ * Relation (4).
+ */
+int64_t checksum_object(Osmium::Protobuf::Message object, const Osmium::Input::PBFPrimitiveBlock& block, uint32_t group_field) {
+    Osmium::Protobuf::PackedVarints keys;
+    Osmium::Protobuf::PackedVarints vals;
+    Osmium::Protobuf::PackedVarints refs;
+    Osmium::Protobuf::PackedVarints roles_sid;
+    Osmium::Protobuf::PackedVarints types;
+
+    int64_t sum = 0;
+    while (object.next()) {
+        switch (object.tag()) {
+            case 1:
+                sum += group_field == 1 ? object.get_sint64() : object.get_int64();
+                break;
+            case 2:
+                keys = object.get_packed();
+                break;
+            case 3:
+                vals = object.get_packed();
+                break;
+            case 8:
+                if (group_field == 3) {
+                    refs = object.get_packed();
+                } else if (group_field == 4) {
+                    roles_sid = object.get_packed();
+                } else {
+                    object.skip();
+                }
+                break;
+            case 9:
+                if (group_field == 4) {
+                    refs = object.get_packed();
+                } else {
+                    object.skip();
+                }
+                break;
+            case 10:
+                if (group_field == 4) {
+                    types = object.get_packed();
+                } else {
+                    object.skip();
+                }
+                break;
+            default:
+                object.skip();
+        }
+    }
+
+    while (!keys.empty()) {
+        sum += block.string(keys.next_uint32()).second + block.string(vals.next_uint32()).second;
+    }
+
+    int64_t ref = 0;
+    while (!refs.empty()) {
+        ref += refs.next_sint64();
+        sum += ref;
+        if (group_field == 4) {
+            sum += types.next_int32() + block.string(roles_sid.next_uint32()).second;
+        }
+    }
+    return sum;
+}
+
+int64_t checksum_osmium(const std::string& data, std::string& buffer) {
+    buffer.assign(data);
+    buffer.push_back('\0');
+
+    Osmium::Input::PBFPrimitiveBlock block;
+    block.decode(&buffer[0], data.size());
+    block.decode_stringtable();
+
+    int64_t sum = 0;
+    for (std::vector<Osmium::Input::PBFPrimitiveBlock::data_t>::const_iterator it = block.groups().begin(); it != block.groups().end(); ++it) {
+        Osmium::Protobuf::Message group(it->first, it->second);
+        while (group.next()) {
+            switch (group.tag()) {
+                case 1:
+                case 3:
+                case 4:
+                    sum += checksum_object(group.get_message(), block, group.tag());
+                    break;
+                case 2: {
+                    Osmium::Protobuf::Message dense = group.get_message();
+                    while (dense.next()) {
+                        if (dense.tag() == 1) {
+                            Osmium::Protobuf::PackedVarints ids = dense.get_packed();
+                            int64_t id = 0;
+                            while (!ids.empty()) {
+                                id += ids.next_sint64();
+                                sum += id;
+                            }
+                        } else if (dense.tag() == 10) {
+                            Osmium::Protobuf::PackedVarints keys_vals = dense.get_packed();
+                            while (!keys_vals.empty()) {
+                                const uint32_t index = keys_vals.next_uint32();
+                                if (index != 0) {
+                                    sum += block.string(index).second;
+                                }
+                            }
+                        } else {
+                            dense.skip();
+                        }
+                    }
+                    break;
+                }
+                default:
+                    group.skip();
+            }
+        }
+    }
+    return sum;
+}
+
+/* ================================================== */
+
+int main(int argc, char* argv[]) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " OSMFILE.pbf [PASSES]" << std::endl;
+        exit(1);
+    }
+    const int passes = argc == 3 ? atoi(argv[2]) : 3;
+
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    blocks_t blocks;
+    read_blocks(argv[1], blocks);
+    std::cout << "blocks: " << blocks.size() << "  passes: " << passes << std::endl;
+
+    int64_t sum = 0;
+    clock_t t0 = clock();
+    for (int pass=0; pass < passes; ++pass) {
+        sum = 0;
+        for (blocks_t::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+            sum += checksum_libosmpbf(*it);
+        }
+    }
+    std::cout << "libosmpbf: " << (static_cast<double>(clock() - t0) / CLOCKS_PER_SEC) << "s  checksum: " << sum << std::endl;
+
+    std::string buffer;
+    t0 = clock();
+    for (int pass=0; pass < passes; ++pass) {
+        sum = 0;
+        for (blocks_t::const_iterator it = blocks.begin(); it != blocks.end(); ++it) {
+            sum += checksum_osmium(*it, buffer);
+        }
+    }
+    std::cout << "osmium:    " << (static_cast<double>(clock() - t0) / CLOCKS_PER_SEC) << "s  checksum: " << sum << std::endl;
+
+    google::protobuf::ShutdownProtobufLibrary();
+}
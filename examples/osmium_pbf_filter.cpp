@@ -0,0 +1,195 @@
+/*
+
+  Copy objects of some types and/or an ID range from one PBF file into
+  another. Without options the file is copied.
+
+  Blobs that contain only objects to be copied are written to the output
+  file as they are and blobs that contain none of them are dropped. Only
+  the other blobs are decoded and their objects encoded again. So this is
+  much faster than osmium_convert for splitting a file by ID or type.
+
+  The code in this example file is released into the Public Domain.
+
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <getopt.h>
+
+#define OSMIUM_WITH_PBF_INPUT
+#include <osmium.hpp>
+#include <osmium/output/pbf.hpp>
+
+class FilterHandler : public Osmium::Handler::Base {
+
+    Osmium::Output::PBF& m_output;
+    uint32_t m_types;
+    osm_object_id_t m_min_id;
+    osm_object_id_t m_max_id;
+
+    bool wanted(const Osmium::OSM::Object& object) const {
+        return object.id() >= m_min_id && object.id() <= m_max_id;
+    }
+
+public:
+
+    int raw_blobs;
+    int dropped_blobs;
+    int decoded_blobs;
+
+    FilterHandler(Osmium::Output::PBF& output, uint32_t types, osm_object_id_t min_id, osm_object_id_t max_id) :
+        m_output(output),
+        m_types(types),
+        m_min_id(min_id),
+        m_max_id(max_id),
+        raw_blobs(0),
+        dropped_blobs(0),
+        decoded_blobs(0) {
+    }
+
+    uint32_t object_types() const {
+        return m_types;
+    }
+
+    void init(Osmium::OSM::Meta& meta) {
+        // keep the node locations of the ways in decoded blobs, too
+        m_output.locations_on_ways(meta.has_locations_on_ways());
+        m_output.init(meta);
+    }
+
+    bool raw_blob(const Osmium::Input::PBFBlob& blob) {
+        const Osmium::Input::PBFIndex::Entry entry = blob.summary();
+        if (!(entry.types & m_types) || entry.max_id < m_min_id || entry.min_id > m_max_id) {
+            ++dropped_blobs;
+            return true;
+        }
+        if (!(entry.types & ~m_types) && entry.min_id >= m_min_id && entry.max_id <= m_max_id) {
+            ++raw_blobs;
+            m_output.write_raw_blob(blob.raw_data().first, blob.raw_data().second);
+            return true;
+        }
+        ++decoded_blobs;
+        return false;
+    }
+
+    void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+        if (wanted(*node)) {
+            m_output.node(node);
+        }
+    }
+
+    void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+        if (wanted(*way)) {
+            m_output.way(way);
+        }
+    }
+
+    void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+        if (wanted(*relation)) {
+            m_output.relation(relation);
+        }
+    }
+
+    void final() {
+        m_output.final();
+    }
+
+};
+
+/* ================================================== */
+
+void print_help() {
+    std::cout << "osmium_pbf_filter [OPTIONS] INFILE OUTFILE\n\n" \
+              << "Both files must be PBF files.\n" \
+              << "\nOptions:\n" \
+              << "  -h, --help            This help message\n" \
+              << "  -t, --types=TYPES     Object types to copy (any of n, w, r, default all)\n" \
+              << "  -i, --ids=MIN-MAX     Range of IDs to copy\n" \
+              << "  -v, --verbose         Print how many blobs were copied, dropped, and decoded\n";
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"help",    no_argument, 0, 'h'},
+        {"types",   required_argument, 0, 't'},
+        {"ids",     required_argument, 0, 'i'},
+        {"verbose", no_argument, 0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    uint32_t types = ALL_OBJECTS_MASK;
+    osm_object_id_t min_id = std::numeric_limits<osm_object_id_t>::min();
+    osm_object_id_t max_id = std::numeric_limits<osm_object_id_t>::max();
+    bool verbose = false;
+
+    while (true) {
+        int c = getopt_long(argc, argv, "ht:i:v", long_options, 0);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+            case 'h':
+                print_help();
+                exit(0);
+            case 't':
+                types = 0;
+                for (const char* t = optarg; *t; ++t) {
+                    switch (*t) {
+                        case 'n': types |= NODE_MASK; break;
+                        case 'w': types |= WAY_MASK; break;
+                        case 'r': types |= RELATION_MASK; break;
+                        default:
+                            std::cerr << "Unknown object type: " << *t << std::endl;
+                            exit(1);
+                    }
+                }
+                break;
+            case 'i': {
+                char* end;
+                min_id = strtoll(optarg, &end, 10);
+                if (*end != '-') {
+                    std::cerr << "ID range must be given as MIN-MAX" << std::endl;
+                    exit(1);
+                }
+                max_id = strtoll(end + 1, &end, 10);
+                if (*end != '\0') {
+                    std::cerr << "ID range must be given as MIN-MAX" << std::endl;
+                    exit(1);
+                }
+                break;
+            }
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                exit(1);
+        }
+    }
+
+    if (optind != argc - 2) {
+        print_help();
+        exit(1);
+    }
+
+    Osmium::OSMFile infile(argv[optind]);
+    Osmium::OSMFile outfile(argv[optind+1]);
+    if (!infile.encoding()->is_pbf() || !outfile.encoding()->is_pbf()) {
+        std::cerr << "Input and output must be PBF files." << std::endl;
+        exit(1);
+    }
+    outfile.type(infile.type());
+
+    Osmium::Output::PBF output(outfile);
+    FilterHandler handler(output, types, min_id, max_id);
+    Osmium::Input::read(infile, handler);
+
+    if (verbose) {
+        std::cerr << "blobs copied: " << handler.raw_blobs
+                  << " dropped: " << handler.dropped_blobs
+                  << " decoded: " << handler.decoded_blobs << std::endl;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+}
@@ -0,0 +1,85 @@
+/*
+
+  This is a small tool to build the blob index for a PBF file. The index is
+  written to a file next to the PBF file with the suffix ".idx" added. It
+  allows programs only interested in some types of objects (for instance
+  the first pass of the multipolygon assembler, which only needs relations)
+  to skip over the other blobs.
+
+  Call with option -v to print the index entries.
+
+  The code in this example file is released into the Public Domain.
+
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#define OSMIUM_WITH_PBF_INPUT
+
+#include <osmium.hpp>
+
+/* ================================================== */
+
+int main(int argc, char* argv[]) {
+    bool verbose = false;
+    if (argc == 3 && !strcmp(argv[1], "-v")) {
+        verbose = true;
+        ++argv;
+        --argc;
+    }
+
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " [-v] OSMFILE.pbf" << std::endl;
+        exit(1);
+    }
+
+    Osmium::OSMFile infile(argv[1]);
+    if (!infile.encoding()->is_pbf() || infile.filename() == "") {
+        std::cerr << "Input must be a PBF file." << std::endl;
+        exit(1);
+    }
+
+    Osmium::Handler::Base handler;
+    Osmium::Input::PBF<Osmium::Handler::Base> input(infile, handler);
+    input.use_index(false).build_index(true);
+    input.parse();
+
+    Osmium::Input::PBFIndex index;
+    if (!index.load(infile.filename())) {
+        std::cerr << "Can't read index file back." << std::endl;
+        exit(1);
+    }
+
+    int count[3] = { 0, 0, 0 };
+    for (Osmium::Input::PBFIndex::entries_t::const_iterator it = index.entries().begin(); it != index.entries().end(); ++it) {
+        if (verbose) {
+            std::cout << "offset=" << it->offset
+                      << " length=" << it->length;
+            if (it->is_header()) {
+                std::cout << " header\n";
+            } else {
+                std::cout << " types="
+                          << (it->types & NODE_MASK     ? "n" : "")
+                          << (it->types & WAY_MASK      ? "w" : "")
+                          << (it->types & RELATION_MASK ? "r" : "")
+                          << " ids=" << it->min_id << "-" << it->max_id << "\n";
+            }
+        }
+        for (int type = NODE; type <= RELATION; ++type) {
+            if (it->types & (1 << type)) {
+                ++count[type];
+            }
+        }
+    }
+
+    std::cout << "Index written to " << Osmium::Input::PBFIndex::index_filename(infile.filename())
+              << ": " << index.entries().size() << " blobs ("
+              << count[NODE] << " with nodes, "
+              << count[WAY] << " with ways, "
+              << count[RELATION] << " with relations)" << std::endl;
+
+    google::protobuf::ShutdownProtobufLibrary();
+}
+
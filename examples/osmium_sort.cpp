@@ -0,0 +1,120 @@
+/*
+
+  Sort an OSM file by object type, id, and version.
+
+  The input can be larger than the main memory: Objects are collected up
+  to a memory limit, sorted, and written to temporary files which are
+  merged at the end (see Osmium::Handler::Sort).
+
+  The code in this example file is released into the Public Domain.
+
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <getopt.h>
+
+#define OSMIUM_WITH_PBF_INPUT
+#define OSMIUM_WITH_XML_INPUT
+#define OSMIUM_WITH_O5M_INPUT
+#define OSMIUM_WITH_OPL_INPUT
+#define OSMIUM_WITH_DUMP_INPUT
+#include <osmium.hpp>
+#include <osmium/output/xml.hpp>
+#include <osmium/output/pbf.hpp>
+#include <osmium/output/o5m.hpp>
+#include <osmium/output/opl.hpp>
+#include <osmium/output/dump.hpp>
+#include <osmium/handler/sort.hpp>
+
+void print_help() {
+    std::cout << "osmium_sort [OPTIONS] INFILE OUTFILE\n\n" \
+              << "File format is given as suffix in format .TYPE[.ENCODING], see osmium_convert.\n" \
+              << "\nOptions:\n" \
+              << "  -h, --help                This help message\n" \
+              << "  -m, --memory=MB           Memory used for buffering objects (default 512)\n" \
+              << "  -w, --workers=NUM         Number of threads sorting and writing temporary files\n" \
+              << "                            (default number of CPUs, 0 for none)\n" \
+              << "  -T, --temp-directory=DIR  Directory for temporary files (default $TMPDIR or /tmp)\n" \
+              << "  -v, --verbose             Print number of temporary files\n";
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"help",           no_argument, 0, 'h'},
+        {"memory",         required_argument, 0, 'm'},
+        {"workers",        required_argument, 0, 'w'},
+        {"temp-directory", required_argument, 0, 'T'},
+        {"verbose",        no_argument, 0, 'v'},
+        {0, 0, 0, 0}
+    };
+
+    size_t memory = 512;
+    int workers = -1;
+    std::string temp_directory;
+    bool verbose = false;
+
+    while (true) {
+        int c = getopt_long(argc, argv, "hm:w:T:v", long_options, 0);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+            case 'h':
+                print_help();
+                exit(0);
+            case 'm':
+                memory = atoi(optarg);
+                if (memory == 0) {
+                    std::cerr << "Memory must be given in MB" << std::endl;
+                    exit(1);
+                }
+                break;
+            case 'w':
+                workers = atoi(optarg);
+                break;
+            case 'T':
+                temp_directory = optarg;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            default:
+                exit(1);
+        }
+    }
+
+    if (optind != argc - 2) {
+        print_help();
+        exit(1);
+    }
+
+    Osmium::OSMFile infile(argv[optind]);
+    Osmium::OSMFile outfile(argv[optind+1]);
+
+    Osmium::Output::Handler out(outfile);
+    out.set_generator("osmium_sort");
+
+    Osmium::Handler::Sort<Osmium::Output::Handler> sort(out);
+    sort.memory_budget(memory * 1024 * 1024);
+    if (workers >= 0) {
+        sort.num_workers(workers);
+    }
+    if (!temp_directory.empty()) {
+        sort.temp_directory(temp_directory);
+    }
+
+    try {
+        Osmium::Input::read(infile, sort);
+    } catch (std::runtime_error& e) {
+        std::cerr << e.what() << std::endl;
+        exit(1);
+    }
+
+    if (verbose) {
+        std::cerr << "temporary files: " << sort.num_runs() << std::endl;
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+}
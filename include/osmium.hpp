@@ -30,6 +30,18 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 # include <osmium/input/xml.hpp>
 #endif
 
+#ifdef OSMIUM_WITH_O5M_INPUT
+# include <osmium/input/o5m.hpp>
+#endif
+
+#ifdef OSMIUM_WITH_OPL_INPUT
+# include <osmium/input/opl.hpp>
+#endif
+
+#ifdef OSMIUM_WITH_DUMP_INPUT
+# include <osmium/input/dump.hpp>
+#endif
+
 /**
  * @mainpage
  *
@@ -49,7 +61,7 @@ You should have received a copy of the Licenses along with Osmium. If not, see
  */
 namespace Osmium {
 
-#if defined(OSMIUM_WITH_PBF_INPUT) || defined(OSMIUM_WITH_XML_INPUT)
+#if defined(OSMIUM_WITH_PBF_INPUT) || defined(OSMIUM_WITH_XML_INPUT) || defined(OSMIUM_WITH_O5M_INPUT) || defined(OSMIUM_WITH_OPL_INPUT) || defined(OSMIUM_WITH_DUMP_INPUT)
     namespace Input {
 
         template <class T>
@@ -62,6 +74,24 @@ namespace Osmium {
 #else
                 throw Osmium::OSMFile::FileEncodingNotSupported();
 #endif // OSMIUM_WITH_PBF_INPUT
+            } else if (file.encoding() == Osmium::OSMFile::FileEncoding::O5M()) {
+#ifdef OSMIUM_WITH_O5M_INPUT
+                input = static_cast<Osmium::Input::Base<T>*>(new Osmium::Input::O5M<T>(file, handler));
+#else
+                throw Osmium::OSMFile::FileEncodingNotSupported();
+#endif // OSMIUM_WITH_O5M_INPUT
+            } else if (file.encoding() == Osmium::OSMFile::FileEncoding::OPL()) {
+#ifdef OSMIUM_WITH_OPL_INPUT
+                input = static_cast<Osmium::Input::Base<T>*>(new Osmium::Input::OPL<T>(file, handler));
+#else
+                throw Osmium::OSMFile::FileEncodingNotSupported();
+#endif // OSMIUM_WITH_OPL_INPUT
+            } else if (file.encoding() == Osmium::OSMFile::FileEncoding::Dump()) {
+#ifdef OSMIUM_WITH_DUMP_INPUT
+                input = static_cast<Osmium::Input::Base<T>*>(new Osmium::Input::Dump<T>(file, handler));
+#else
+                throw Osmium::OSMFile::FileEncodingNotSupported();
+#endif // OSMIUM_WITH_DUMP_INPUT
             } else {
 #ifdef OSMIUM_WITH_XML_INPUT
                 input = static_cast<Osmium::Input::Base<T>*>(new Osmium::Input::XML<T>(file, handler));
@@ -70,7 +100,12 @@ namespace Osmium {
 #endif // OSMIUM_WITH_XML_INPUT
             }
 
-            input->parse();
+            try {
+                input->parse();
+            } catch (...) {
+                delete input;
+                throw;
+            }
             delete input;
         }
 
@@ -0,0 +1,362 @@
+#ifndef OSMIUM_COMPRESSION_BLOB_CODEC_HPP
+#define OSMIUM_COMPRESSION_BLOB_CODEC_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstddef>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+#ifdef OSMIUM_WITH_LZMA
+# define OSMIUM_LINK_WITH_LIBS_LZMA -llzma
+# include <lzma.h>
+#endif
+
+#ifdef OSMIUM_WITH_ZSTD
+# define OSMIUM_LINK_WITH_LIBS_ZSTD -lzstd
+# include <zstd.h>
+#endif
+
+#ifdef OSMIUM_WITH_LZ4
+# define OSMIUM_LINK_WITH_LIBS_LZ4 -llz4
+# include <lz4.h>
+#endif
+
+#include <osmium/compression/decompressor.hpp>
+
+namespace Osmium {
+
+    namespace Compression {
+
+        /**
+         * Compression of the blobs in PBF files.
+         *
+         * zlib is always available. lzma (xz container format), zstd,
+         * and lz4 (block format) are only available if OSMIUM_WITH_LZMA,
+         * OSMIUM_WITH_ZSTD, or OSMIUM_WITH_LZ4 is defined before
+         * including this file. Most other programs can only read zlib
+         * compressed or uncompressed blobs, the other codecs are mainly
+         * useful for temporary files.
+         *
+         * A codec is a small value object, it can be copied freely:
+         *
+         * @code
+         * Osmium::Compression::BlobCodec codec = Osmium::Compression::BlobCodec::parse("zstd:3");
+         * @endcode
+         */
+        class BlobCodec {
+
+        public:
+
+            /**
+             * Compression types. The values are the field numbers of the
+             * data in the Blob message of the PBF format.
+             */
+            enum type_t {
+                none = 1,
+                zlib = 3,
+                lzma = 4,
+                lz4  = 6,
+                zstd = 7
+            };
+
+            /// Use the default compression level of the codec.
+            enum { default_level = -1 };
+
+            BlobCodec(type_t type=zlib, int level=default_level) :
+                m_type(type),
+                m_level(level) {
+                int min = 0;
+                int max = 0;
+                switch (type) {
+                    case none:
+                    case lz4:
+                        break;
+                    case zlib:
+                    case lzma:
+                        max = 9;
+                        break;
+                    case zstd:
+                        min = 1;
+                        max = 22;
+                        break;
+                    default:
+                        throw std::invalid_argument("unknown blob compression");
+                }
+                if (level != default_level && (level < min || level > max || max == 0)) {
+                    throw std::invalid_argument(std::string("invalid compression level for ") + name());
+                }
+            }
+
+            /**
+             * Create a codec from a string like "zlib", "zlib:9", "zstd:19",
+             * "lz4", or "none".
+             *
+             * @throws std::invalid_argument if the string can't be parsed
+             *         or the codec wasn't compiled in.
+             */
+            static BlobCodec parse(const std::string& spec) {
+                const std::string::size_type colon = spec.find(':');
+                const std::string name = spec.substr(0, colon);
+                int level = default_level;
+                if (colon != std::string::npos) {
+                    const char* start = spec.c_str() + colon + 1;
+                    char* end;
+                    level = static_cast<int>(std::strtol(start, &end, 10));
+                    if (end == start || *end != '\0') {
+                        throw std::invalid_argument("invalid compression level: " + spec);
+                    }
+                }
+
+                static const type_t types[] = { none, zlib, lzma, lz4, zstd };
+                for (size_t i=0; i < sizeof(types) / sizeof(type_t); ++i) {
+                    if (name == type_name(types[i])) {
+                        if (!available(types[i])) {
+                            throw std::invalid_argument("compression not available (not compiled in): " + name);
+                        }
+                        return BlobCodec(types[i], level);
+                    }
+                }
+                throw std::invalid_argument("unknown blob compression: " + name);
+            }
+
+            type_t type() const {
+                return m_type;
+            }
+
+            int level() const {
+                return m_level;
+            }
+
+            const char* name() const {
+                return type_name(m_type);
+            }
+
+            static const char* type_name(type_t type) {
+                switch (type) {
+                    case none:
+                        return "none";
+                    case zlib:
+                        return "zlib";
+                    case lzma:
+                        return "lzma";
+                    case lz4:
+                        return "lz4";
+                    case zstd:
+                        return "zstd";
+                }
+                return "unknown";
+            }
+
+            /**
+             * Can blobs of this type be read and written?
+             */
+            static bool available(type_t type) {
+                switch (type) {
+                    case none:
+                    case zlib:
+                        return true;
+#ifdef OSMIUM_WITH_LZMA
+                    case lzma:
+                        return true;
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+                    case zstd:
+                        return true;
+#endif
+#ifdef OSMIUM_WITH_LZ4
+                    case lz4:
+                        return true;
+#endif
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * Compress data. For the type none the data is copied.
+             *
+             * @param in Uncompressed data.
+             * @param out String the compressed data is written to.
+             * @throws std::runtime_error if the compression fails.
+             */
+            void compress(const std::string& in, std::string& out) const {
+                switch (m_type) {
+                    case none:
+                        out = in;
+                        return;
+                    case zlib:
+                        zlib_compress(in, out);
+                        return;
+#ifdef OSMIUM_WITH_LZMA
+                    case lzma:
+                        lzma_compress(in, out);
+                        return;
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+                    case zstd:
+                        zstd_compress(in, out);
+                        return;
+#endif
+#ifdef OSMIUM_WITH_LZ4
+                    case lz4:
+                        lz4_compress(in, out);
+                        return;
+#endif
+                    default:
+                        throw std::runtime_error(std::string("compression not available (not compiled in): ") + name());
+                }
+            }
+
+            /**
+             * Uncompress data. The size of the uncompressed data has to be
+             * known (it is stored in the Blob message).
+             *
+             * @param type Type of the compression.
+             * @param data Compressed data.
+             * @param size Size of compressed data.
+             * @param out Buffer for the uncompressed data.
+             * @param raw_size Size of the uncompressed data and the buffer.
+             * @throws DecompressionError if the data is invalid or doesn't have the expected size.
+             * @throws std::runtime_error if the type wasn't compiled in.
+             */
+            static void uncompress(type_t type, const char* data, size_t size, char* out, size_t raw_size) {
+                switch (type) {
+                    case zlib: {
+                        unsigned long unpacked_size = raw_size;
+                        if (::uncompress(reinterpret_cast<unsigned char*>(out), &unpacked_size, reinterpret_cast<const unsigned char*>(data), size) != Z_OK || unpacked_size != raw_size) {
+                            throw DecompressionError("zlib error");
+                        }
+                        return;
+                    }
+#ifdef OSMIUM_WITH_LZMA
+                    case lzma: {
+                        uint64_t memlimit = UINT64_MAX;
+                        size_t in_pos = 0;
+                        size_t out_pos = 0;
+                        if (lzma_stream_buffer_decode(&memlimit, 0, NULL, reinterpret_cast<const uint8_t*>(data), &in_pos, size, reinterpret_cast<uint8_t*>(out), &out_pos, raw_size) != LZMA_OK || out_pos != raw_size) {
+                            throw DecompressionError("lzma error");
+                        }
+                        return;
+                    }
+#endif
+#ifdef OSMIUM_WITH_ZSTD
+                    case zstd: {
+                        const size_t result = ZSTD_decompress(out, raw_size, data, size);
+                        if (ZSTD_isError(result) || result != raw_size) {
+                            throw DecompressionError("zstd error");
+                        }
+                        return;
+                    }
+#endif
+#ifdef OSMIUM_WITH_LZ4
+                    case lz4: {
+                        if (LZ4_decompress_safe(data, out, static_cast<int>(size), static_cast<int>(raw_size)) != static_cast<int>(raw_size)) {
+                            throw DecompressionError("lz4 error");
+                        }
+                        return;
+                    }
+#endif
+                    default:
+                        throw std::runtime_error(std::string(type_name(type)) + " blobs not supported (not compiled in)");
+                }
+            }
+
+        private:
+
+            type_t m_type;
+            int m_level;
+
+            void zlib_compress(const std::string& in, std::string& out) const {
+                z_stream z;
+                z.zalloc = Z_NULL;
+                z.zfree  = Z_NULL;
+                z.opaque = Z_NULL;
+
+                if (deflateInit(&z, m_level == default_level ? Z_DEFAULT_COMPRESSION : m_level) != Z_OK) {
+                    throw std::runtime_error("failed to init zlib stream");
+                }
+
+                // space for compressed data, large enough to compress in one go
+                out.resize(deflateBound(&z, in.size()));
+
+                z.next_in   = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(in.data()));
+                z.avail_in  = in.size();
+                z.next_out  = reinterpret_cast<uint8_t*>(&out[0]);
+                z.avail_out = out.size();
+
+                if (deflate(&z, Z_FINISH) != Z_STREAM_END) {
+                    deflateEnd(&z);
+                    throw std::runtime_error("failed to deflate zlib stream");
+                }
+
+                if (deflateEnd(&z) != Z_OK) {
+                    throw std::runtime_error("failed to deinit zlib stream");
+                }
+
+                out.resize(z.total_out);
+            }
+
+#ifdef OSMIUM_WITH_LZMA
+            void lzma_compress(const std::string& in, std::string& out) const {
+                out.resize(lzma_stream_buffer_bound(in.size()));
+                size_t out_pos = 0;
+                if (lzma_easy_buffer_encode(m_level == default_level ? LZMA_PRESET_DEFAULT : m_level, LZMA_CHECK_CRC32, NULL,
+                                            reinterpret_cast<const uint8_t*>(in.data()), in.size(),
+                                            reinterpret_cast<uint8_t*>(&out[0]), &out_pos, out.size()) != LZMA_OK) {
+                    throw std::runtime_error("lzma compression failed");
+                }
+                out.resize(out_pos);
+            }
+#endif
+
+#ifdef OSMIUM_WITH_ZSTD
+            void zstd_compress(const std::string& in, std::string& out) const {
+                out.resize(ZSTD_compressBound(in.size()));
+                const size_t result = ZSTD_compress(&out[0], out.size(), in.data(), in.size(), m_level == default_level ? 3 : m_level);
+                if (ZSTD_isError(result)) {
+                    throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(result));
+                }
+                out.resize(result);
+            }
+#endif
+
+#ifdef OSMIUM_WITH_LZ4
+            void lz4_compress(const std::string& in, std::string& out) const {
+                out.resize(LZ4_compressBound(static_cast<int>(in.size())));
+                const int result = LZ4_compress_default(in.data(), &out[0], static_cast<int>(in.size()), static_cast<int>(out.size()));
+                if (result <= 0) {
+                    throw std::runtime_error("lz4 compression failed");
+                }
+                out.resize(result);
+            }
+#endif
+
+        }; // class BlobCodec
+
+    } // namespace Compression
+
+} // namespace Osmium
+
+#endif // OSMIUM_COMPRESSION_BLOB_CODEC_HPP
@@ -0,0 +1,408 @@
+#ifndef OSMIUM_COMPRESSION_BZIP2_HPP
+#define OSMIUM_COMPRESSION_BZIP2_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#define OSMIUM_LINK_WITH_LIBS_BZIP2 -lbz2 -lboost_thread -lboost_system
+
+#include <algorithm>
+#include <bzlib.h>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <osmium/smart_ptr.hpp>
+#include <osmium/compression/decompressor.hpp>
+#include <osmium/thread/pool.hpp>
+
+namespace Osmium {
+
+    namespace Compression {
+
+        /**
+         * Decompressor for bzip2 compressed data using libbz2.
+         *
+         * A bzip2 file can contain several independently compressed
+         * streams. Parallel compressors like pbzip2 write files this way.
+         * The input is cut into segments at the start of each stream, the
+         * segments are decompressed in parallel on a thread pool and the
+         * results are handed out in order.
+         *
+         * The start of a stream is found by looking for the stream header
+         * followed by the magic number of the first block. In rare cases
+         * these bytes can also appear inside compressed data. Streams can
+         * also be larger than the maximum segment size. In both cases a
+         * segment ends inside a stream, and the thread calling read()
+         * continues decompressing that stream through the following
+         * segments. So files with a single stream, as written by the
+         * bzip2 program, are decompressed serially.
+         */
+        class Bzip2Decompressor : public Decompressor {
+
+            /**
+             * A piece of the input file. It is decompressed by a worker
+             * thread if it starts with a stream header.
+             */
+            class Segment : boost::noncopyable {
+
+            public:
+
+                Segment() :
+                    input(),
+                    output(),
+                    stream(NULL),
+                    error(),
+                    submitted(false),
+                    m_done(false),
+                    m_mutex(),
+                    m_decompressed() {
+                }
+
+                ~Segment() {
+                    if (stream) {
+                        end_stream(stream);
+                    }
+                }
+
+                std::string input;
+                std::string output;
+
+                /// Stream that didn't end inside this segment.
+                bz_stream* stream;
+
+                std::string error;
+
+                /// Has the segment been handed to a worker thread?
+                bool submitted;
+
+                /**
+                 * Decompress the segment. This runs in a worker thread.
+                 */
+                void decompress() {
+                    std::string decompress_error;
+                    try {
+                        Bzip2Decompressor::decompress(stream, input, output);
+                    } catch (std::exception& e) {
+                        decompress_error = e.what();
+                    }
+
+                    boost::lock_guard<boost::mutex> lock(m_mutex);
+                    error = decompress_error;
+                    m_done = true;
+                    m_decompressed.notify_all();
+                }
+
+                /**
+                 * Wait until decompress() has finished.
+                 */
+                void wait() {
+                    boost::unique_lock<boost::mutex> lock(m_mutex);
+                    while (!m_done) {
+                        m_decompressed.wait(lock);
+                    }
+                }
+
+            private:
+
+                bool m_done;
+                boost::mutex m_mutex;
+                boost::condition_variable m_decompressed;
+
+            }; // class Segment
+
+            typedef shared_ptr<Segment> segment_ptr_t;
+
+        public:
+
+            /**
+             * @param fd File descriptor to read from. It is not closed by
+             *           the decompressor.
+             * @param num_threads Number of worker threads. If this is 0 or
+             *                    negative, the number of hardware threads
+             *                    is used.
+             */
+            Bzip2Decompressor(int fd, int num_threads=0) :
+                Decompressor(),
+                m_fd(fd),
+                m_pool(num_threads),
+                m_max_segments_in_flight(2 * m_pool.num_threads() + 1),
+                m_segments(),
+                m_pending(),
+                m_scan_pos(1),
+                m_eof(false),
+                m_stream(NULL),
+                m_output(),
+                m_output_pos(0) {
+            }
+
+            ~Bzip2Decompressor() {
+                if (m_stream) {
+                    end_stream(m_stream);
+                }
+            }
+
+            size_t read(char* buffer, size_t size) {
+                while (m_output_pos == m_output.size()) {
+                    if (!next_output()) {
+                        return 0;
+                    }
+                }
+                const size_t length = std::min(size, m_output.size() - m_output_pos);
+                std::memcpy(buffer, m_output.data() + m_output_pos, length);
+                m_output_pos += length;
+                return length;
+            }
+
+        private:
+
+            /// Number of bytes read from the file at once.
+            static const size_t c_read_size = 1024 * 1024;
+
+            /// Maximum size of a segment if no stream header is found.
+            static const size_t c_max_segment_size = 8 * 1024 * 1024;
+
+            /// Size of stream header plus magic number of the first block.
+            static const size_t c_header_size = 10;
+
+            int m_fd;
+
+            Osmium::Thread::Pool m_pool;
+
+            const size_t m_max_segments_in_flight;
+
+            /// Segments being decompressed, in the order of the file.
+            std::deque<segment_ptr_t> m_segments;
+
+            /// Data read from the file, but not yet put into a segment.
+            std::string m_pending;
+
+            /// Position in m_pending to continue looking for a stream header.
+            size_t m_scan_pos;
+
+            bool m_eof;
+
+            /// Stream continued in this thread, because a segment ended inside it.
+            bz_stream* m_stream;
+
+            /// Uncompressed data handed out by read().
+            std::string m_output;
+            size_t m_output_pos;
+
+            static bz_stream* begin_stream() {
+                bz_stream* stream = new bz_stream;
+                std::memset(stream, 0, sizeof(bz_stream));
+                if (BZ2_bzDecompressInit(stream, 0, 0) != BZ_OK) {
+                    delete stream;
+                    throw std::runtime_error("Can't initialize bzip2 decompression");
+                }
+                return stream;
+            }
+
+            static void end_stream(bz_stream*& stream) {
+                BZ2_bzDecompressEnd(stream);
+                delete stream;
+                stream = NULL;
+            }
+
+            static void throw_error(int result) {
+                switch (result) {
+                    case BZ_DATA_ERROR_MAGIC:
+                        throw DecompressionError("bzip2 error: not bzip2 data");
+                    case BZ_MEM_ERROR:
+                        throw DecompressionError("bzip2 error: out of memory");
+                    default:
+                        throw DecompressionError("bzip2 error: data integrity error");
+                }
+            }
+
+            /**
+             * Decompress input and append the result to output. If stream
+             * is not NULL, it is continued, otherwise a new stream is
+             * started. Further streams following in the input are
+             * decompressed, too. If the input ends inside a stream, it is
+             * left open in stream, otherwise stream is NULL afterwards.
+             */
+            static void decompress(bz_stream*& stream, const std::string& input, std::string& output) {
+                const char* data = input.data();
+                size_t size = input.size();
+                size_t used = output.size();
+
+                while (size > 0) {
+                    if (!stream) {
+                        stream = begin_stream();
+                    }
+                    stream->next_in  = const_cast<char*>(data);
+                    stream->avail_in = static_cast<unsigned int>(size);
+
+                    int result = BZ_OK;
+                    do {
+                        if (used == output.size()) {
+                            output.resize(used + std::max(size * 4, static_cast<size_t>(64 * 1024)));
+                        }
+                        stream->next_out  = &output[used];
+                        stream->avail_out = static_cast<unsigned int>(output.size() - used);
+                        result = BZ2_bzDecompress(stream);
+                        used = output.size() - stream->avail_out;
+                        if (result != BZ_OK && result != BZ_STREAM_END) {
+                            output.resize(used);
+                            throw_error(result);
+                        }
+                    } while (result == BZ_OK && (stream->avail_in > 0 || stream->avail_out == 0));
+
+                    data += size - stream->avail_in;
+                    size = stream->avail_in;
+                    if (result == BZ_STREAM_END) {
+                        end_stream(stream);
+                    }
+                }
+
+                output.resize(used);
+            }
+
+            bool is_stream_header(size_t pos) const {
+                const char* p = m_pending.data() + pos;
+                return p[0] == 'B' && p[1] == 'Z' && p[2] == 'h' && p[3] >= '1' && p[3] <= '9' &&
+                       std::memcmp(p + 4, "\x31\x41\x59\x26\x53\x59", 6) == 0;
+            }
+
+            /**
+             * Find the next stream header in m_pending after the first
+             * byte.
+             *
+             * @returns Position of the header or std::string::npos if there is none.
+             */
+            size_t find_stream_header() {
+                const char* begin = m_pending.data();
+                const char* end = begin + m_pending.size();
+                for (const char* p = begin + m_scan_pos; end - p >= static_cast<ptrdiff_t>(c_header_size); ++p) {
+                    p = static_cast<const char*>(std::memchr(p, 'B', end - p));
+                    if (!p || end - p < static_cast<ptrdiff_t>(c_header_size)) {
+                        break;
+                    }
+                    if (is_stream_header(p - begin)) {
+                        return p - begin;
+                    }
+                }
+                if (m_pending.size() > c_header_size) {
+                    m_scan_pos = m_pending.size() - c_header_size + 1;
+                }
+                return std::string::npos;
+            }
+
+            void read_input() {
+                const size_t old_size = m_pending.size();
+                m_pending.resize(old_size + c_read_size);
+                ssize_t length;
+                do {
+                    length = ::read(m_fd, &m_pending[old_size], c_read_size);
+                } while (length < 0 && errno == EINTR);
+                if (length < 0) {
+                    m_pending.resize(old_size);
+                    throw std::runtime_error("read error");
+                }
+                m_pending.resize(old_size + length);
+                if (length == 0) {
+                    m_eof = true;
+                }
+            }
+
+            /**
+             * Cut the next segment from the input and hand it to a worker
+             * thread if it starts with a stream header.
+             */
+            void read_segment() {
+                size_t cut;
+                while ((cut = find_stream_header()) == std::string::npos && !m_eof && m_pending.size() < c_max_segment_size) {
+                    read_input();
+                }
+                if (cut == std::string::npos) {
+                    cut = m_pending.size();
+                }
+
+                segment_ptr_t segment = make_shared<Segment>();
+                segment->input.assign(m_pending, 0, cut);
+                m_pending.erase(0, cut);
+                m_scan_pos = 1;
+
+                if (segment->input.size() >= c_header_size && std::memcmp(segment->input.data(), "BZh", 3) == 0) {
+                    segment->submitted = true;
+                    m_pool.submit(boost::bind(&Segment::decompress, segment));
+                }
+                m_segments.push_back(segment);
+            }
+
+            void fill_segments() {
+                while (m_segments.size() < m_max_segments_in_flight && !(m_eof && m_pending.empty())) {
+                    read_segment();
+                }
+            }
+
+            /**
+             * Get the uncompressed data of the next segment into m_output.
+             *
+             * @returns false at the end of the input, true otherwise.
+             */
+            bool next_output() {
+                fill_segments();
+                if (m_segments.empty()) {
+                    if (m_stream) {
+                        throw DecompressionError("bzip2 error: unexpected end of file");
+                    }
+                    return false;
+                }
+
+                segment_ptr_t segment = m_segments.front();
+                m_segments.pop_front();
+                m_output.clear();
+                m_output_pos = 0;
+
+                if (m_stream || !segment->submitted) {
+                    // the result of a worker (if any) is not used, this
+                    // segment doesn't start with a new stream
+                    decompress(m_stream, segment->input, m_output);
+                } else {
+                    segment->wait();
+                    if (!segment->error.empty()) {
+                        throw DecompressionError(segment->error);
+                    }
+                    m_output.swap(segment->output);
+                    m_stream = segment->stream;
+                    segment->stream = NULL;
+                }
+
+                fill_segments();
+                return true;
+            }
+
+        }; // class Bzip2Decompressor
+
+    } // namespace Compression
+
+} // namespace Osmium
+
+#endif // OSMIUM_COMPRESSION_BZIP2_HPP
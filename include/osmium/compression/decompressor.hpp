@@ -0,0 +1,78 @@
+#ifndef OSMIUM_COMPRESSION_DECOMPRESSOR_HPP
+#define OSMIUM_COMPRESSION_DECOMPRESSOR_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include <boost/utility.hpp>
+
+namespace Osmium {
+
+    /**
+     * @brief Compression and decompression inside the process.
+     */
+    namespace Compression {
+
+        /**
+         * Exception thrown when compressed data is invalid.
+         */
+        class DecompressionError : public std::runtime_error {
+
+        public:
+
+            DecompressionError(const std::string& what) :
+                std::runtime_error(what) {
+            }
+
+        };
+
+        /**
+         * Virtual base class for decompressors. A decompressor reads
+         * compressed data from a file descriptor and hands out the
+         * uncompressed data through read().
+         */
+        class Decompressor : boost::noncopyable {
+
+        public:
+
+            virtual ~Decompressor() {
+            }
+
+            /**
+             * Read up to size bytes of uncompressed data into buffer.
+             *
+             * @returns Number of bytes read, 0 at the end of the data.
+             * @throws DecompressionError if the data is invalid.
+             * @throws std::runtime_error if reading the file fails.
+             */
+            virtual size_t read(char* buffer, size_t size) = 0;
+
+        }; // class Decompressor
+
+    } // namespace Compression
+
+} // namespace Osmium
+
+#endif // OSMIUM_COMPRESSION_DECOMPRESSOR_HPP
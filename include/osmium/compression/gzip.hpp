@@ -0,0 +1,99 @@
+#ifndef OSMIUM_COMPRESSION_GZIP_HPP
+#define OSMIUM_COMPRESSION_GZIP_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#define OSMIUM_LINK_WITH_LIBS_GZIP -lz
+
+#include <cerrno>
+#include <climits>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <osmium/compression/decompressor.hpp>
+
+namespace Osmium {
+
+    namespace Compression {
+
+        /**
+         * Decompressor for gzip compressed data using zlib. Files with
+         * several concatenated gzip members are read completely.
+         */
+        class GzipDecompressor : public Decompressor {
+
+        public:
+
+            /**
+             * @param fd File descriptor to read from. It is not closed by
+             *           the decompressor.
+             * @throws std::runtime_error if zlib can't be initialized.
+             */
+            GzipDecompressor(int fd) :
+                Decompressor(),
+                m_gzfile(NULL) {
+                const int gzfd = ::dup(fd);
+                if (gzfd < 0 || !(m_gzfile = gzdopen(gzfd, "rb"))) {
+                    if (gzfd >= 0) {
+                        ::close(gzfd);
+                    }
+                    throw std::runtime_error("Can't initialize gzip decompression");
+                }
+                gzbuffer(m_gzfile, c_buffer_size);
+            }
+
+            ~GzipDecompressor() {
+                gzclose(m_gzfile);
+            }
+
+            size_t read(char* buffer, size_t size) {
+                if (size > INT_MAX) {
+                    size = INT_MAX;
+                }
+                const int result = gzread(m_gzfile, buffer, static_cast<unsigned int>(size));
+                if (result <= 0) {
+                    // zlib reports truncated data as end of file with Z_BUF_ERROR set
+                    int error;
+                    const char* message = gzerror(m_gzfile, &error);
+                    if (error == Z_ERRNO) {
+                        throw std::runtime_error("read error");
+                    }
+                    if (error != Z_OK) {
+                        throw DecompressionError(std::string("gzip error: ") + message);
+                    }
+                }
+                return result;
+            }
+
+        private:
+
+            static const unsigned int c_buffer_size = 256 * 1024;
+
+            gzFile m_gzfile;
+
+        }; // class GzipDecompressor
+
+    } // namespace Compression
+
+} // namespace Osmium
+
+#endif // OSMIUM_COMPRESSION_GZIP_HPP
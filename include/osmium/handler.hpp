@@ -27,9 +27,11 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 #include <osmium/debug.hpp>
 
 #include <osmium/osm/meta.hpp>
+#include <osmium/osm/types.hpp>
 #include <osmium/osm/node.hpp>
 #include <osmium/osm/way.hpp>
 #include <osmium/osm/relation.hpp>
+#include <osmium/osm/batch.hpp>
 
 namespace Osmium {
 
@@ -65,6 +67,21 @@ namespace Osmium {
          * To define your own handler create a subclass of this class.
          * Only overwrite the methods you actually use. They must be declared public.
          * If you overwrite the constructor, call the Base constructor without arguments.
+         *
+         * Inputs that read their data in blocks (currently only PBF) can
+         * hand all objects from one block to the handler at once. If a
+         * handler overwrites nodes(), ways(), or relations(), those are
+         * called with a batch of objects instead of calling node(), way(),
+         * or relation() for each object. This is faster if the handler does
+         * little work per object. Handlers that don't overwrite them still
+         * get each object through node(), way(), and relation() from all
+         * inputs. after_block() is called after each block.
+         *
+         * Handlers that only need the IDs and positions of nodes (for
+         * instance to build a node location index) can overwrite
+         * node_location() instead of node(). Inputs then don't have to
+         * build complete Node objects with tags and metadata. See
+         * NodeLocationsOnly.
          */
         class Base : boost::noncopyable, public Osmium::WithDebug {
 
@@ -87,6 +104,12 @@ namespace Osmium {
             void node(const shared_ptr<Osmium::OSM::Node const>&) const {
             }
 
+            void nodes(const Osmium::OSM::NodeBatch&) const {
+            }
+
+            void node_location(const osm_object_id_t, const Osmium::OSM::Position&) const {
+            }
+
             void after_nodes() const {
             }
 
@@ -96,6 +119,9 @@ namespace Osmium {
             void way(const shared_ptr<Osmium::OSM::Way const>&) const {
             }
 
+            void ways(const Osmium::OSM::WayBatch&) const {
+            }
+
             void after_ways() const {
             }
 
@@ -105,9 +131,15 @@ namespace Osmium {
             void relation(const shared_ptr<Osmium::OSM::Relation const>&) const {
             }
 
+            void relations(const Osmium::OSM::RelationBatch&) const {
+            }
+
             void after_relations() const {
             }
 
+            void after_block() const {
+            }
+
             void area(const shared_ptr<Osmium::OSM::Area const>&) const {
             }
 
@@ -116,6 +148,292 @@ namespace Osmium {
 
         }; // class Base
 
+        /**
+         * Traits class telling the input classes which types of objects
+         * a handler needs (a combination of NODE_MASK, WAY_MASK, and
+         * RELATION_MASK). The input can then avoid reading or decoding
+         * objects of other types.
+         *
+         * By default this is decided from the methods a handler overwrites:
+         * If none of before_nodes(), node(), nodes(), node_location(), and
+         * after_nodes() is
+         * overwritten, the handler doesn't need nodes. Same for ways and
+         * relations.
+         *
+         * To decide at run time a handler can define a method
+         * @code
+         * uint32_t object_types() const;
+         * @endcode
+         * which is used instead. Or you can specialize this template
+         * for your handler.
+         */
+        template <class THandler>
+        class ObjectTypes {
+
+            typedef char yes_type;
+
+            struct no_type {
+                char dummy[2];
+            };
+
+            template <bool B>
+            struct bool_tag {
+            };
+
+            template <class T, uint32_t (T::*)() const>
+            struct method_check {
+            };
+
+            template <class T>
+            static yes_type has_object_types_method(method_check<T, &T::object_types>*);
+
+            template <class T>
+            static no_type has_object_types_method(...);
+
+            static bool is_base_method(void (Base::*)() const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const shared_ptr<Osmium::OSM::Node const>&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const shared_ptr<Osmium::OSM::Way const>&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const shared_ptr<Osmium::OSM::Relation const>&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const Osmium::OSM::NodeBatch&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const Osmium::OSM::WayBatch&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const Osmium::OSM::RelationBatch&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const osm_object_id_t, const Osmium::OSM::Position&) const) {
+                return true;
+            }
+
+            template <typename T>
+            static bool is_base_method(T) {
+                return false;
+            }
+
+            static uint32_t mask(const THandler& handler, bool_tag<true>) {
+                return handler.object_types();
+            }
+
+            static uint32_t mask(const THandler&, bool_tag<false>) {
+                uint32_t types = 0;
+                if (!is_base_method(&THandler::before_nodes) || !is_base_method(&THandler::node) || !is_base_method(&THandler::nodes) || !is_base_method(&THandler::node_location) || !is_base_method(&THandler::after_nodes)) {
+                    types |= NODE_MASK;
+                }
+                if (!is_base_method(&THandler::before_ways) || !is_base_method(&THandler::way) || !is_base_method(&THandler::ways) || !is_base_method(&THandler::after_ways)) {
+                    types |= WAY_MASK;
+                }
+                if (!is_base_method(&THandler::before_relations) || !is_base_method(&THandler::relation) || !is_base_method(&THandler::relations) || !is_base_method(&THandler::after_relations)) {
+                    types |= RELATION_MASK;
+                }
+                return types;
+            }
+
+        public:
+
+            /**
+             * Get the types of objects the handler needs.
+             */
+            static uint32_t mask(const THandler& handler) {
+                return mask(handler, bool_tag<sizeof(has_object_types_method<THandler>(0)) == sizeof(yes_type)>());
+            }
+
+        }; // class ObjectTypes
+
+        /**
+         * Traits class telling the input classes whether a handler only
+         * needs the IDs and positions of nodes. If so, the input calls
+         * node_location() on the handler instead of node() or nodes() and
+         * can skip decoding tags and metadata of nodes.
+         *
+         * By default this is the case if the handler overwrites
+         * node_location(), but neither node() nor nodes(). A handler can
+         * define a method
+         * @code
+         * bool node_locations_only() const;
+         * @endcode
+         * which is used instead.
+         */
+        template <class THandler>
+        class NodeLocationsOnly {
+
+            typedef char yes_type;
+
+            struct no_type {
+                char dummy[2];
+            };
+
+            template <bool B>
+            struct bool_tag {
+            };
+
+            template <class T, bool (T::*)() const>
+            struct method_check {
+            };
+
+            template <class T>
+            static yes_type has_node_locations_only_method(method_check<T, &T::node_locations_only>*);
+
+            template <class T>
+            static no_type has_node_locations_only_method(...);
+
+            static bool is_base_method(void (Base::*)(const shared_ptr<Osmium::OSM::Node const>&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const Osmium::OSM::NodeBatch&) const) {
+                return true;
+            }
+
+            static bool is_base_method(void (Base::*)(const osm_object_id_t, const Osmium::OSM::Position&) const) {
+                return true;
+            }
+
+            template <typename T>
+            static bool is_base_method(T) {
+                return false;
+            }
+
+            static bool value(const THandler& handler, bool_tag<true>) {
+                return handler.node_locations_only();
+            }
+
+            static bool value(const THandler&, bool_tag<false>) {
+                return !is_base_method(&THandler::node_location) && is_base_method(&THandler::node) && is_base_method(&THandler::nodes);
+            }
+
+        public:
+
+            static bool value(const THandler& handler) {
+                return value(handler, bool_tag<sizeof(has_node_locations_only_method<THandler>(0)) == sizeof(yes_type)>());
+            }
+
+        }; // class NodeLocationsOnly
+
+        template <class THandler>
+        class Forward;
+
+        /**
+         * Hands a batch of objects to a handler. If the handler overwrites
+         * the nodes(), ways(), or relations() method, it is called with the
+         * whole batch. Otherwise node(), way(), or relation() is called for
+         * each object in the batch.
+         *
+         * A subclass of Forward that overwrites node(), way(), or
+         * relation() gets the objects one by one, even though it inherits
+         * the batch methods of Forward.
+         */
+        template <class THandler>
+        class BatchCallbacks {
+
+            template <class T, class TObject>
+            static bool is_forward_method(void (Forward<T>::*)(const shared_ptr<TObject>&) const) {
+                return true;
+            }
+
+            template <typename T>
+            static bool is_forward_method(T) {
+                return false;
+            }
+
+            static void call(THandler& handler, const Osmium::OSM::NodeBatch& batch, void (Base::*)(const Osmium::OSM::NodeBatch&) const) {
+                for (size_t n=0; n < batch.size(); ++n) {
+                    handler.node(batch.ptr(n));
+                }
+            }
+
+            template <class T>
+            static void call(THandler& handler, const Osmium::OSM::NodeBatch& batch, void (Forward<T>::*)(const Osmium::OSM::NodeBatch&) const) {
+                if (is_forward_method(&THandler::node)) {
+                    handler.nodes(batch);
+                } else {
+                    for (size_t n=0; n < batch.size(); ++n) {
+                        handler.node(batch.ptr(n));
+                    }
+                }
+            }
+
+            template <typename T>
+            static void call(THandler& handler, const Osmium::OSM::NodeBatch& batch, T) {
+                handler.nodes(batch);
+            }
+
+            static void call(THandler& handler, const Osmium::OSM::WayBatch& batch, void (Base::*)(const Osmium::OSM::WayBatch&) const) {
+                for (size_t n=0; n < batch.size(); ++n) {
+                    handler.way(batch.ptr(n));
+                }
+            }
+
+            template <class T>
+            static void call(THandler& handler, const Osmium::OSM::WayBatch& batch, void (Forward<T>::*)(const Osmium::OSM::WayBatch&) const) {
+                if (is_forward_method(&THandler::way)) {
+                    handler.ways(batch);
+                } else {
+                    for (size_t n=0; n < batch.size(); ++n) {
+                        handler.way(batch.ptr(n));
+                    }
+                }
+            }
+
+            template <typename T>
+            static void call(THandler& handler, const Osmium::OSM::WayBatch& batch, T) {
+                handler.ways(batch);
+            }
+
+            static void call(THandler& handler, const Osmium::OSM::RelationBatch& batch, void (Base::*)(const Osmium::OSM::RelationBatch&) const) {
+                for (size_t n=0; n < batch.size(); ++n) {
+                    handler.relation(batch.ptr(n));
+                }
+            }
+
+            template <class T>
+            static void call(THandler& handler, const Osmium::OSM::RelationBatch& batch, void (Forward<T>::*)(const Osmium::OSM::RelationBatch&) const) {
+                if (is_forward_method(&THandler::relation)) {
+                    handler.relations(batch);
+                } else {
+                    for (size_t n=0; n < batch.size(); ++n) {
+                        handler.relation(batch.ptr(n));
+                    }
+                }
+            }
+
+            template <typename T>
+            static void call(THandler& handler, const Osmium::OSM::RelationBatch& batch, T) {
+                handler.relations(batch);
+            }
+
+        public:
+
+            static void nodes(THandler& handler, const Osmium::OSM::NodeBatch& batch) {
+                call(handler, batch, &THandler::nodes);
+            }
+
+            static void ways(THandler& handler, const Osmium::OSM::WayBatch& batch) {
+                call(handler, batch, &THandler::ways);
+            }
+
+            static void relations(THandler& handler, const Osmium::OSM::RelationBatch& batch) {
+                call(handler, batch, &THandler::relations);
+            }
+
+        }; // class BatchCallbacks
+
         /**
          * This handler forwards all calls to another handler.
          * Use this as a base for your handler instead of Base() if you want calls
@@ -143,6 +461,14 @@ namespace Osmium {
                 m_next_handler.node(node);
             }
 
+            void nodes(const Osmium::OSM::NodeBatch& batch) const {
+                BatchCallbacks<THandler>::nodes(m_next_handler, batch);
+            }
+
+            void node_location(const osm_object_id_t id, const Osmium::OSM::Position& position) const {
+                m_next_handler.node_location(id, position);
+            }
+
             void after_nodes() const {
                 m_next_handler.after_nodes();
             }
@@ -155,6 +481,10 @@ namespace Osmium {
                 m_next_handler.way(way);
             }
 
+            void ways(const Osmium::OSM::WayBatch& batch) const {
+                BatchCallbacks<THandler>::ways(m_next_handler, batch);
+            }
+
             void after_ways() const {
                 m_next_handler.after_ways();
             }
@@ -167,10 +497,18 @@ namespace Osmium {
                 m_next_handler.relation(relation);
             }
 
+            void relations(const Osmium::OSM::RelationBatch& batch) const {
+                BatchCallbacks<THandler>::relations(m_next_handler, batch);
+            }
+
             void after_relations() const {
                 m_next_handler.after_relations();
             }
 
+            void after_block() const {
+                m_next_handler.after_block();
+            }
+
             void area(const shared_ptr<Osmium::OSM::Area>& area) const {
                 m_next_handler.area(area);
             }
@@ -183,6 +521,14 @@ namespace Osmium {
                 m_next_handler.set_debug_level(debug);
             }
 
+            uint32_t object_types() const {
+                return ObjectTypes<THandler>::mask(m_next_handler);
+            }
+
+            bool node_locations_only() const {
+                return NodeLocationsOnly<THandler>::value(m_next_handler);
+            }
+
         protected:
 
             THandler& next_handler() const {
@@ -224,6 +570,16 @@ namespace Osmium {
                 m_handler2.node(node);
             }
 
+            void nodes(const Osmium::OSM::NodeBatch& batch) const {
+                BatchCallbacks<THandler1>::nodes(m_handler1, batch);
+                BatchCallbacks<THandler2>::nodes(m_handler2, batch);
+            }
+
+            void node_location(const osm_object_id_t id, const Osmium::OSM::Position& position) const {
+                m_handler1.node_location(id, position);
+                m_handler2.node_location(id, position);
+            }
+
             void after_nodes() const {
                 m_handler1.after_nodes();
                 m_handler2.after_nodes();
@@ -239,6 +595,11 @@ namespace Osmium {
                 m_handler2.way(way);
             }
 
+            void ways(const Osmium::OSM::WayBatch& batch) const {
+                BatchCallbacks<THandler1>::ways(m_handler1, batch);
+                BatchCallbacks<THandler2>::ways(m_handler2, batch);
+            }
+
             void after_ways() const {
                 m_handler1.after_ways();
                 m_handler2.after_ways();
@@ -254,11 +615,21 @@ namespace Osmium {
                 m_handler2.relation(relation);
             }
 
+            void relations(const Osmium::OSM::RelationBatch& batch) const {
+                BatchCallbacks<THandler1>::relations(m_handler1, batch);
+                BatchCallbacks<THandler2>::relations(m_handler2, batch);
+            }
+
             void after_relations() const {
                 m_handler1.after_relations();
                 m_handler2.after_relations();
             }
 
+            void after_block() const {
+                m_handler1.after_block();
+                m_handler2.after_block();
+            }
+
             void area(const shared_ptr<Osmium::OSM::Area>& area) const {
                 m_handler1.area(area);
                 m_handler2.area(area);
@@ -274,6 +645,19 @@ namespace Osmium {
                 m_handler2.set_debug_level(debug);
             }
 
+            uint32_t object_types() const {
+                return ObjectTypes<THandler1>::mask(m_handler1) | ObjectTypes<THandler2>::mask(m_handler2);
+            }
+
+            /**
+             * The sequence only needs node locations if each handler either
+             * only needs node locations or no nodes at all.
+             */
+            bool node_locations_only() const {
+                return (NodeLocationsOnly<THandler1>::value(m_handler1) || !(ObjectTypes<THandler1>::mask(m_handler1) & NODE_MASK)) &&
+                       (NodeLocationsOnly<THandler2>::value(m_handler2) || !(ObjectTypes<THandler2>::mask(m_handler2) & NODE_MASK));
+            }
+
         private:
 
             THandler1& m_handler1;
@@ -31,6 +31,10 @@ namespace Osmium {
         /**
          * Handler to retrieve locations from nodes and add them to ways.
          *
+         * If the input already has the locations on the ways (see
+         * Osmium::OSM::Meta::has_locations_on_ways()), this handler does
+         * nothing and the storage stays empty.
+         *
          * @tparam TStorage Class that handles the actual storage of the node locations.
          *                  It must support the set(id, value) method and operator[] for
          *                  reading a value.
@@ -43,21 +47,41 @@ namespace Osmium {
             CoordinatesForWays(TStoragePosIDs& storage_pos,
                                TStorageNegIDs& storage_neg) :
                 m_storage_pos(storage_pos),
-                m_storage_neg(storage_neg) {
+                m_storage_neg(storage_neg),
+                m_locations_on_ways(false) {
+            }
+
+            void init(Osmium::OSM::Meta& meta) {
+                m_locations_on_ways = meta.has_locations_on_ways();
             }
 
             /**
              * Store the location of the node in the storage.
              */
-            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
-                int64_t id = node->id();
+            void node_location(const osm_object_id_t id, const Osmium::OSM::Position& position) {
+                if (m_locations_on_ways) {
+                    return;
+                }
                 if (id >= 0) {
-                    m_storage_pos.set(id, node->position());
+                    m_storage_pos.set(id, position);
                 } else {
-                    m_storage_neg.set(-id, node->position());
+                    m_storage_neg.set(-id, position);
                 }
             }
 
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                node_location(node->id(), node->position());
+            }
+
+            /**
+             * This handler only needs the node locations, so inputs call
+             * node_location() and don't have to decode tags and metadata.
+             * See Osmium::Handler::NodeLocationsOnly.
+             */
+            bool node_locations_only() const {
+                return true;
+            }
+
             Osmium::OSM::Position get_node_pos(const int64_t id) const {
                 return id >= 0 ? m_storage_pos[id] : m_storage_neg[-id];
             }
@@ -67,6 +91,9 @@ namespace Osmium {
              * them to the way object.
              */
             void way(const shared_ptr<Osmium::OSM::Way>& way) {
+                if (m_locations_on_ways) {
+                    return;
+                }
                 for (Osmium::OSM::WayNodeList::iterator it = way->nodes().begin(); it != way->nodes().end(); ++it) {
                     const int64_t id = it->ref();
                     it->position(id >= 0 ? m_storage_pos[id] : m_storage_neg[-id]);
@@ -81,6 +108,9 @@ namespace Osmium {
             /// Object that handles the actual storage of the node locations (with negative IDs).
             TStorageNegIDs& m_storage_neg;
 
+            /// Does the input have the locations on the ways already?
+            bool m_locations_on_ways;
+
         }; // class CoordinatesForWays
 
     } // namespace Handler
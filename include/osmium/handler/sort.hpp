@@ -0,0 +1,518 @@
+#ifndef OSMIUM_HANDLER_SORT_HPP
+#define OSMIUM_HANDLER_SORT_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+#include <osmium/handler.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/utils/dump.hpp>
+
+namespace Osmium {
+
+    namespace Handler {
+
+        /**
+         * Handler that sorts the objects it gets by type (nodes, then
+         * ways, then relations), id, and version and hands them to another
+         * handler in that order when final() is called. Objects with the
+         * same type, id, and version stay in the order they came in. IDs
+         * are ordered by their absolute value like Osmium::OSM::Node and
+         * the other objects do.
+         *
+         * The objects are stored in the Osmium dump format (see
+         * Osmium::Dump). Whenever the buffered objects reach the memory
+         * budget divided by the number of buffers, the buffer is sorted
+         * and written to a temporary file (a "run") by a pool of worker
+         * threads while the next buffer is filled. At the end the runs are
+         * memory mapped and merged with the last buffer, which is sorted
+         * in memory. If all objects fit into one buffer, no temporary file
+         * is written at all.
+         *
+         * Temporary files are removed as soon as they are created, they
+         * go away when the handler is destroyed or the program ends.
+         *
+         * @code
+         * Osmium::Output::Handler out(outfile);
+         * Osmium::Handler::Sort<Osmium::Output::Handler> sort(out);
+         * sort.memory_budget(1024 * 1024 * 1024).temp_directory("/var/tmp");
+         * Osmium::Input::read(infile, sort);
+         * @endcode
+         *
+         * @tparam THandler Handler getting the sorted objects.
+         */
+        template <class THandler>
+        class Sort : public Base {
+
+        public:
+
+            Sort(THandler& handler) :
+                Base(),
+                m_handler(handler),
+                m_meta(),
+                m_memory_budget(512 * 1024 * 1024),
+                m_num_workers(Osmium::Thread::Pool::default_num_threads()),
+                m_temp_directory(default_temp_directory()),
+                m_num_runs(0),
+                m_run(),
+                m_runs(),
+                m_pending(),
+                m_pool() {
+            }
+
+            ~Sort() {
+                // worker threads must not access runs after they are gone
+                m_pool.reset();
+            }
+
+            size_t memory_budget() const {
+                return m_memory_budget;
+            }
+
+            /**
+             * Set the amount of memory used for buffering objects. The
+             * actual memory use is somewhat larger. Must be called before
+             * the first object is added.
+             */
+            Sort& memory_budget(size_t size) {
+                m_memory_budget = size;
+                return *this;
+            }
+
+            int num_workers() const {
+                return m_num_workers;
+            }
+
+            /**
+             * Set the number of threads sorting and writing runs. If this is
+             * 0, runs are written by the thread adding the objects. Must
+             * be called before the first object is added.
+             */
+            Sort& num_workers(int num) {
+                m_num_workers = num < 0 ? 0 : num;
+                return *this;
+            }
+
+            const std::string& temp_directory() const {
+                return m_temp_directory;
+            }
+
+            /**
+             * Set the directory for the temporary files. The default is
+             * the TMPDIR environment variable or /tmp.
+             */
+            Sort& temp_directory(const std::string& directory) {
+                m_temp_directory = directory;
+                return *this;
+            }
+
+            /**
+             * Number of runs written to temporary files so far.
+             */
+            size_t num_runs() const {
+                return m_num_runs;
+            }
+
+            void init(Osmium::OSM::Meta& meta) {
+                m_meta = meta;
+            }
+
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                current_run().add(NODE, node->id(), node->version(), current_run().records().add_node(*node));
+                check_run_size();
+            }
+
+            void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+                current_run().add(WAY, way->id(), way->version(), current_run().records().add_way(*way));
+                check_run_size();
+            }
+
+            void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+                current_run().add(RELATION, relation->id(), relation->version(), current_run().records().add_relation(*relation));
+                check_run_size();
+            }
+
+            /**
+             * Wait for the runs to be written, merge them with the last
+             * run, which is kept in memory, and hand the objects to the
+             * handler, calling all callbacks from init() to final() on it.
+             *
+             * @throws std::runtime_error if a temporary file can't be written.
+             */
+            void final() {
+                while (!m_pending.empty()) {
+                    m_pending.front()->wait();
+                    m_pending.pop_front();
+                }
+                m_pool.reset();
+                if (m_run) {
+                    m_runs.push_back(m_run);
+                    m_run.reset();
+                }
+
+                merge();
+
+                m_runs.clear();
+            }
+
+        private:
+
+            /**
+             * A part of the input. Objects are added to its buffer as
+             * dump records. Then it is either written to a temporary file
+             * or kept in memory. When merging, next() returns the objects
+             * sorted.
+             */
+            class Run : boost::noncopyable {
+
+            public:
+
+                Run() :
+                    m_records(),
+                    m_keys(),
+                    m_next_key(0),
+                    m_fd(-1),
+                    m_mapped_data(NULL),
+                    m_mapped_size(0),
+                    m_reader(),
+                    m_error(),
+                    m_done(false),
+                    m_mutex(),
+                    m_written() {
+                }
+
+                ~Run() {
+                    if (m_mapped_data) {
+                        ::munmap(m_mapped_data, m_mapped_size);
+                    }
+                    if (m_fd >= 0) {
+                        ::close(m_fd);
+                    }
+                }
+
+                Osmium::Dump::RecordBuffer& records() {
+                    return m_records;
+                }
+
+                /**
+                 * Remember the sort key of the record just added.
+                 */
+                void add(osm_object_type_t type, osm_object_id_t id, osm_version_t version, size_t offset) {
+                    m_keys.push_back(Osmium::Dump::RecordKey(type, id, version, offset));
+                }
+
+                /**
+                 * Approximate amount of memory used by this run.
+                 */
+                size_t memory() const {
+                    return m_records.size() + m_keys.size() * sizeof(Osmium::Dump::RecordKey);
+                }
+
+                /**
+                 * Sort the objects and write them to a new temporary
+                 * file in the directory. Errors are remembered and thrown
+                 * from wait(). The memory used by the buffer is freed
+                 * afterwards.
+                 */
+                void write(const std::string& directory) {
+                    std::string error;
+                    try {
+                        sort_keys();
+
+                        std::string filename = directory + "/osmium-sort-XXXXXX";
+                        m_fd = ::mkstemp(&filename[0]);
+                        if (m_fd < 0) {
+                            throw std::runtime_error(std::string("can't create temporary file in ") + directory + ": " + std::strerror(errno));
+                        }
+                        ::unlink(filename.c_str());
+
+                        Osmium::Dump::RecordBuffer out;
+                        out.reserve(write_size + 64 * 1024);
+                        out.add_header(Osmium::OSM::Meta(), false);
+                        for (std::vector<Osmium::Dump::RecordKey>::const_iterator it = m_keys.begin(); it != m_keys.end(); ++it) {
+                            const Osmium::Dump::ObjectView object(m_records.data().data() + it->offset);
+                            out.add_raw(object.data(), object.size());
+                            if (out.size() >= write_size) {
+                                write_data(out);
+                            }
+                        }
+                        write_data(out);
+                    } catch (std::exception& e) {
+                        error = e.what();
+                    }
+
+                    Osmium::Dump::RecordBuffer().swap(m_records);
+                    std::vector<Osmium::Dump::RecordKey>().swap(m_keys);
+
+                    boost::lock_guard<boost::mutex> lock(m_mutex);
+                    m_error = error;
+                    m_done = true;
+                    m_written.notify_all();
+                }
+
+                /**
+                 * Wait until write() has finished.
+                 *
+                 * @throws std::runtime_error if it failed.
+                 */
+                void wait() {
+                    boost::unique_lock<boost::mutex> lock(m_mutex);
+                    while (!m_done) {
+                        m_written.wait(lock);
+                    }
+                    if (!m_error.empty()) {
+                        throw std::runtime_error(m_error);
+                    }
+                }
+
+                /**
+                 * Prepare for reading the objects with next(). A run
+                 * written to a file is mapped into memory, a run kept in
+                 * memory is sorted.
+                 */
+                void start_reading() {
+                    if (m_fd < 0) {
+                        sort_keys();
+                        return;
+                    }
+                    const off_t size = ::lseek(m_fd, 0, SEEK_END);
+                    void* data = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+                    if (data == MAP_FAILED) {
+                        throw std::runtime_error(std::string("can't map temporary file: ") + std::strerror(errno));
+                    }
+                    ::madvise(data, size, MADV_SEQUENTIAL);
+                    m_mapped_data = static_cast<char*>(data);
+                    m_mapped_size = size;
+                    m_reader.reset(new Osmium::Dump::Reader(m_mapped_data, m_mapped_size));
+                }
+
+                /**
+                 * Get the next object in sort order.
+                 *
+                 * @returns false if there are no more objects.
+                 */
+                bool next(Osmium::Dump::ObjectView& object) {
+                    if (m_reader) {
+                        return m_reader->next(object);
+                    }
+                    if (m_next_key == m_keys.size()) {
+                        return false;
+                    }
+                    object = Osmium::Dump::ObjectView(m_records.data().data() + m_keys[m_next_key++].offset);
+                    return true;
+                }
+
+            private:
+
+                /// Write to the file when the output buffer has grown to this size.
+                enum { write_size = 1024 * 1024 };
+
+                Osmium::Dump::RecordBuffer m_records;
+                std::vector<Osmium::Dump::RecordKey> m_keys;
+                size_t m_next_key;
+
+                /// Temporary file, -1 if the run is kept in memory.
+                int m_fd;
+                char* m_mapped_data;
+                size_t m_mapped_size;
+                boost::scoped_ptr<Osmium::Dump::Reader> m_reader;
+
+                std::string m_error;
+                bool m_done;
+                boost::mutex m_mutex;
+                boost::condition_variable m_written;
+
+                void sort_keys() {
+                    std::stable_sort(m_keys.begin(), m_keys.end());
+                }
+
+                void write_data(Osmium::Dump::RecordBuffer& buffer) {
+                    const char* data = buffer.data().data();
+                    size_t size = buffer.size();
+                    while (size > 0) {
+                        const ssize_t length = ::write(m_fd, data, size);
+                        if (length < 0) {
+                            if (errno == EINTR) {
+                                continue;
+                            }
+                            throw std::runtime_error(std::string("can't write temporary file: ") + std::strerror(errno));
+                        }
+                        data += length;
+                        size -= length;
+                    }
+                    buffer.clear();
+                }
+
+            }; // class Run
+
+            typedef shared_ptr<Run> run_ptr_t;
+
+            /**
+             * An object on the heap used for merging runs, with the
+             * number of the run it came from.
+             */
+            struct MergeItem {
+                Osmium::Dump::ObjectView object;
+                Osmium::Dump::RecordKey key;
+                size_t run;
+
+                MergeItem(const Osmium::Dump::ObjectView& o, size_t r) :
+                    object(o),
+                    key(o),
+                    run(r) {
+                }
+
+                /// Reverse order, so the smallest object is on top of the heap.
+                bool operator<(const MergeItem& other) const {
+                    if (other.key < key) {
+                        return true;
+                    }
+                    if (key < other.key) {
+                        return false;
+                    }
+                    return other.run < run;
+                }
+            };
+
+            THandler& m_handler;
+
+            Osmium::OSM::Meta m_meta;
+
+            size_t m_memory_budget;
+
+            int m_num_workers;
+
+            std::string m_temp_directory;
+
+            size_t m_num_runs;
+
+            /// The run currently filled.
+            run_ptr_t m_run;
+
+            /// All runs written or being written to temporary files, in input order.
+            std::vector<run_ptr_t> m_runs;
+
+            /// Runs being written by the worker threads.
+            std::deque<run_ptr_t> m_pending;
+
+            /// Worker threads writing runs, started with the first run.
+            boost::scoped_ptr<Osmium::Thread::Pool> m_pool;
+
+            static std::string default_temp_directory() {
+                const char* directory = std::getenv("TMPDIR");
+                return directory && *directory ? directory : "/tmp";
+            }
+
+            Run& current_run() {
+                if (!m_run) {
+                    m_run = make_shared<Run>();
+                }
+                return *m_run;
+            }
+
+            /**
+             * The memory budget is shared between the run currently filled
+             * and the runs the workers are writing.
+             */
+            void check_run_size() {
+                if (m_run->memory() >= m_memory_budget / (m_num_workers + 1)) {
+                    spill();
+                }
+            }
+
+            /**
+             * Hand the current run to a worker thread for writing. If all
+             * workers are busy, wait for the oldest run to be written
+             * first.
+             */
+            void spill() {
+                m_runs.push_back(m_run);
+                ++m_num_runs;
+                if (m_num_workers == 0) {
+                    m_run->write(m_temp_directory);
+                    m_run->wait();
+                } else {
+                    if (!m_pool) {
+                        m_pool.reset(new Osmium::Thread::Pool(m_num_workers));
+                    }
+                    if (m_pending.size() >= static_cast<size_t>(m_num_workers)) {
+                        m_pending.front()->wait();
+                        m_pending.pop_front();
+                    }
+                    m_pending.push_back(m_run);
+                    m_pool->submit(boost::bind(&Run::write, m_run.get(), m_temp_directory));
+                }
+                m_run.reset();
+            }
+
+            /**
+             * Merge the runs and hand the objects to the handler.
+             */
+            void merge() {
+                std::priority_queue<MergeItem> heap;
+                Osmium::Dump::ObjectView object;
+                for (size_t n=0; n < m_runs.size(); ++n) {
+                    m_runs[n]->start_reading();
+                    if (m_runs[n]->next(object)) {
+                        heap.push(MergeItem(object, n));
+                    }
+                }
+
+                Osmium::Dump::Feeder<THandler> feeder(m_handler);
+                m_handler.init(m_meta);
+                while (!heap.empty()) {
+                    const MergeItem item = heap.top();
+                    heap.pop();
+                    feeder.object(item.object);
+                    if (m_runs[item.run]->next(object)) {
+                        heap.push(MergeItem(object, item.run));
+                    }
+                }
+                feeder.finish();
+                m_handler.final();
+            }
+
+        }; // class Sort
+
+    } // namespace Handler
+
+} // namespace Osmium
+
+#endif // OSMIUM_HANDLER_SORT_HPP
@@ -45,7 +45,11 @@ namespace Osmium {
          * - init(Osmium::OSM::Meta&)
          * - before_nodes/ways/relations()
          * - node/way/relation(const shared_ptr<Osmium::OSM::Node/Way/Relation>&)
+         * - nodes/ways/relations(const Osmium::OSM::NodeBatch/WayBatch/RelationBatch&)
+         * - node_location(osm_object_id_t, const Osmium::OSM::Position&)
          * - after_nodes/ways/relations()
+         * - after_block()
+         * - raw_blob(const Osmium::Input::PBFBlob&) (PBF input only, see Osmium::Input::PBFRawBlobs)
          * - final()
          * - area(Osmium::OSM::Area*)
          *
@@ -53,7 +57,14 @@ namespace Osmium {
          * after all others.
          *
          * For every object node(), way(), or
-         * relation() will be called, respectively.
+         * relation() will be called, respectively. Inputs reading the
+         * data in blocks call nodes(), ways(), or relations() instead with
+         * all objects of a block if the handler overwrites them, and
+         * after_block() after each block. See Osmium::Handler::Base.
+         *
+         * If the handler only needs node locations (see
+         * Osmium::Handler::NodeLocationsOnly), node_location() is called
+         * for each node instead of node() or nodes().
          *
          * When there are several objects of the same type in a row the
          * before_*() function will be called before them and the
@@ -67,7 +78,8 @@ namespace Osmium {
          *
          * But if you have nodes, ways, and relations intermixed in an input
          * file these handlers will probably not called in a useful way for you.
-         * You can use osmosis --sort to sort your input file first.
+         * You can use osmosis --sort or Osmium::Handler::Sort (see the
+         * osmium_sort example) to sort your input file first.
          *
          * The method area() is special. It will only be called if
          * you have the multipolygon handler before your handler. There are no
@@ -93,8 +105,10 @@ namespace Osmium {
             Base(const Osmium::OSMFile& file,
                  THandler& handler) :
                 m_last_object_type(UNKNOWN),
+                m_init_called(false),
                 m_file(file),
                 m_handler(handler),
+                m_node_locations_only(Osmium::Handler::NodeLocationsOnly<THandler>::value(handler)),
                 m_meta(),
                 m_node(),
                 m_way(),
@@ -109,7 +123,7 @@ namespace Osmium {
                 if (current_object_type != m_last_object_type) {
                     switch (m_last_object_type) {
                         case UNKNOWN:
-                            m_handler.init(m_meta);
+                            call_init_on_handler();
                             break;
                         case NODE:
                             m_handler.after_nodes();
@@ -140,22 +154,109 @@ namespace Osmium {
                 }
             }
 
+            /*
+               The objects handed to the handler might contain tags and user
+               names borrowed from the input buffer (see
+               Osmium::OSM::Tag). If the handler keeps a reference to the
+               object, it has to get its own copy of those strings before the
+               buffer goes away. Objects nobody keeps are reused by the
+               prepare_*() functions below without ever copying the strings.
+            */
             void call_node_on_handler() const {
+                if (m_node_locations_only) {
+                    m_handler.node_location(m_node->id(), m_node->position());
+                    return;
+                }
                 m_handler.node(m_node);
+                if (!m_node.unique()) {
+                    m_node->materialize();
+                }
             }
 
             void call_way_on_handler() const {
                 m_handler.way(m_way);
+                if (!m_way.unique()) {
+                    m_way->materialize();
+                }
             }
 
             void call_relation_on_handler() const {
                 m_handler.relation(m_relation);
+                if (!m_relation.unique()) {
+                    m_relation->materialize();
+                }
+            }
+
+            /*
+               The following methods hand a batch of objects to the handler,
+               either as a whole or one object at a time, depending on the
+               handler (see Osmium::Handler::BatchCallbacks).
+            */
+            void call_nodes_on_handler(Osmium::OSM::NodeBatch& batch) {
+                if (m_node_locations_only) {
+                    for (size_t n=0; n < batch.size(); ++n) {
+                        m_handler.node_location(batch[n].id(), batch[n].position());
+                    }
+                    return;
+                }
+                Osmium::Handler::BatchCallbacks<THandler>::nodes(m_handler, batch);
+                batch.materialize_retained();
+            }
+
+            void call_ways_on_handler(Osmium::OSM::WayBatch& batch) {
+                Osmium::Handler::BatchCallbacks<THandler>::ways(m_handler, batch);
+                batch.materialize_retained();
+            }
+
+            void call_relations_on_handler(Osmium::OSM::RelationBatch& batch) {
+                Osmium::Handler::BatchCallbacks<THandler>::relations(m_handler, batch);
+                batch.materialize_retained();
+            }
+
+            /**
+             * Hand the location of a node to the handler. Inputs can use
+             * this instead of building a Node object if
+             * node_locations_only() is true.
+             */
+            void call_node_location_on_handler(const osm_object_id_t id, const Osmium::OSM::Position& position) const {
+                m_handler.node_location(id, position);
             }
 
-            void call_final_on_handler() const {
+            /**
+             * Does the handler only need the IDs and positions of nodes?
+             */
+            bool node_locations_only() const {
+                return m_node_locations_only;
+            }
+
+            void call_after_block_on_handler() const {
+                m_handler.after_block();
+            }
+
+            /**
+             * Call init() on the handler unless that was already done.
+             */
+            void call_init_on_handler() {
+                if (!m_init_called) {
+                    m_handler.init(m_meta);
+                    m_init_called = true;
+                }
+            }
+
+            /**
+             * Call final() on the handler. If the input didn't contain any
+             * objects the handler needs, init() has not been called yet,
+             * so it is called first.
+             */
+            void call_final_on_handler() {
+                call_init_on_handler();
                 m_handler.final();
             }
 
+            THandler& handler() const {
+                return m_handler;
+            }
+
             Osmium::OSM::Meta& meta() {
                 return m_meta;
             }
@@ -172,15 +273,15 @@ namespace Osmium {
                The following methods prepare the m_node/way/relation member
                variable for use. If it is empty or in use by somebody other
                than this parser, a new object will be allocated. If it not is
-               use, it will be reset to it's pristine state by calling the
-               destructor directly and then placement new. This gets around a
-               memory deallocation and re-allocation which was timed to slow
-               down the program noticably.
+               use, it will be reset to it's pristine state with reset(),
+               which keeps the memory for the user name, the tags, and the
+               node and member lists. So once the object has grown to the
+               size needed, parsing doesn't allocate any memory for objects
+               the handler doesn't keep.
             */
             Osmium::OSM::Node& prepare_node() {
                 if (m_node && m_node.unique()) {
-                    m_node->~Node();
-                    new (m_node.get()) Osmium::OSM::Node();
+                    m_node->reset();
                 } else {
                     m_node = make_shared<Osmium::OSM::Node>();
                 }
@@ -189,8 +290,7 @@ namespace Osmium {
 
             Osmium::OSM::Way& prepare_way() {
                 if (m_way && m_way.unique()) {
-                    m_way->~Way();
-                    new (m_way.get()) Osmium::OSM::Way(2000);
+                    m_way->reset();
                 } else {
                     m_way = make_shared<Osmium::OSM::Way>(2000);
                 }
@@ -199,8 +299,7 @@ namespace Osmium {
 
             Osmium::OSM::Relation& prepare_relation() {
                 if (m_relation && m_relation.unique()) {
-                    m_relation->~Relation();
-                    new (m_relation.get()) Osmium::OSM::Relation();
+                    m_relation->reset();
                 } else {
                     m_relation = make_shared<Osmium::OSM::Relation>();
                 }
@@ -215,6 +314,11 @@ namespace Osmium {
              */
             osm_object_type_t m_last_object_type;
 
+            /**
+             * Has init() been called on the handler?
+             */
+            bool m_init_called;
+
             /**
              * The OSMFile we opened this file with.
              */
@@ -225,6 +329,11 @@ namespace Osmium {
              */
             THandler& m_handler;
 
+            /**
+             * Call node_location() instead of node() on the handler.
+             */
+            const bool m_node_locations_only;
+
             Osmium::OSM::Meta m_meta;
 
         protected:
@@ -0,0 +1,258 @@
+#ifndef OSMIUM_INPUT_DUMP_HPP
+#define OSMIUM_INPUT_DUMP_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#include <osmium/input.hpp>
+#include <osmium/osm/batch.hpp>
+#include <osmium/utils/dump.hpp>
+
+namespace Osmium {
+
+    namespace Input {
+
+        /**
+        * Class for reading files in the Osmium dump format (see
+        * Osmium::Dump).
+        *
+        * Memory mapped files (regular files, see OSMFile::mapped_data())
+        * are read in place: Nothing is uncompressed or decoded, records of
+        * object types the handler doesn't need are skipped, and tags and
+        * user names of the objects handed to the handler point into the
+        * mapping instead of being copied (see Osmium::OSM::Tag). Other
+        * files are read through a buffer.
+        *
+        * Objects of the same type are collected in batches of up to
+        * batch_size objects, so the handler can use the batch callbacks
+        * and after_block(). The objects of the batches are reused.
+        *
+        * Programs that don't need OSM objects at all can walk through the
+        * records of a mapped file with Osmium::Dump::Reader instead.
+        *
+        * Generally you are not supposed to instantiate this class yourself.
+        * Use the Osmium::Input::read() function instead.
+        *
+        * @tparam THandler A handler class (subclass of Osmium::Handler::Base).
+        */
+        template <class THandler>
+        class Dump : public Base<THandler> {
+
+        public:
+
+            /// Maximum number of objects handed to the handler in one batch.
+            enum { batch_size = 8000 };
+
+            /**
+            * Instantiate dump file parser.
+            *
+            * @param file OSMFile instance.
+            * @param handler Instance of THandler.
+            */
+            Dump(const Osmium::OSMFile& file, THandler& handler) :
+                Base<THandler>(file, handler),
+                m_object_types(Osmium::Handler::ObjectTypes<THandler>::mask(handler)),
+                m_batch_type(UNKNOWN),
+                m_node_batch(),
+                m_way_batch(),
+                m_relation_batch() {
+            }
+
+            /**
+             * @throws Osmium::Dump::FormatError if the file is broken.
+             */
+            void parse() {
+                try {
+                    if (this->file().mapped_data()) {
+                        parse_mapped();
+                    } else {
+                        parse_stream();
+                    }
+                    flush_batch();
+                    this->call_after_and_before_on_handler(UNKNOWN);
+                } catch (Osmium::Handler::StopReading) {
+                    // if a handler says to stop reading, we do
+                }
+                this->call_final_on_handler();
+            }
+
+        private:
+
+            /// Size of the buffer for input that is not memory mapped.
+            enum { buffer_size = 1024 * 1024 };
+
+            /**
+             * Types of objects needed by the handler (osm_object_type_mask_t).
+             */
+            const uint32_t m_object_types;
+
+            /// Type of the objects in the current batch.
+            osm_object_type_t m_batch_type;
+
+            Osmium::OSM::NodeBatch     m_node_batch;
+            Osmium::OSM::WayBatch      m_way_batch;
+            Osmium::OSM::RelationBatch m_relation_batch;
+
+            void parse_mapped() {
+                Osmium::Dump::Reader reader(this->file().mapped_data(), this->file().mapped_size());
+                handle_header(reader.header());
+                Osmium::Dump::ObjectView object;
+                while (reader.next(object)) {
+                    handle_object(object);
+                }
+            }
+
+            /**
+             * Read the input through a buffer. The buffer consists of
+             * uint64_t, so the records in it are aligned.
+             */
+            void parse_stream() {
+                std::vector<uint64_t> buffer(buffer_size / sizeof(uint64_t));
+                size_t used = 0;
+                bool header_done = false;
+                bool eof = false;
+                while (!eof) {
+                    char* data = reinterpret_cast<char*>(&buffer[0]);
+                    const size_t length = this->file().read(data + used, buffer.size() * sizeof(uint64_t) - used);
+                    used += length;
+                    eof = (length == 0);
+
+                    const char* begin = data;
+                    const char* end = data + used;
+                    if (!header_done) {
+                        if (used < sizeof(Osmium::Dump::FileHeader) && !eof) {
+                            continue;
+                        }
+                        handle_header(Osmium::Dump::Reader::check_header(begin, used));
+                        begin += sizeof(Osmium::Dump::FileHeader);
+                        header_done = true;
+                    }
+
+                    while (static_cast<size_t>(end - begin) >= sizeof(Osmium::Dump::ObjectRecord)) {
+                        const Osmium::Dump::ObjectView object(begin);
+                        if (object.size() > static_cast<size_t>(end - begin)) {
+                            break; // read the rest of the record first
+                        }
+                        Osmium::Dump::Reader::check_record(object.record(), end - begin);
+                        handle_object(object);
+                        begin += object.size();
+                    }
+
+                    // the objects borrow strings from the buffer, so they
+                    // have to be handed over before it changes
+                    flush_batch();
+
+                    used = end - begin;
+                    if (eof && used > 0) {
+                        throw Osmium::Dump::FormatError("truncated record");
+                    }
+                    std::memmove(data, begin, used);
+                    if (used >= sizeof(Osmium::Dump::ObjectRecord)) {
+                        const size_t size = Osmium::Dump::ObjectView(data).size();
+                        if (size > buffer.size() * sizeof(uint64_t)) {
+                            buffer.resize(size / sizeof(uint64_t) + 1);
+                        }
+                    }
+                }
+            }
+
+            void handle_header(const Osmium::Dump::FileHeader& header) {
+                if (header.flags & Osmium::Dump::flag_history) {
+                    this->meta().has_multiple_object_versions(true);
+                }
+                const Osmium::OSM::Position bottom_left(header.min_x, header.min_y);
+                if (bottom_left.defined()) {
+                    this->meta().bounds().extend(bottom_left).extend(Osmium::OSM::Position(header.max_x, header.max_y));
+                }
+            }
+
+            void handle_object(const Osmium::Dump::ObjectView& object) {
+                const osm_object_type_t type = object.type();
+                if (!(m_object_types & (1 << type))) {
+                    return;
+                }
+                if (type != m_batch_type || batch_full()) {
+                    flush_batch();
+                    m_batch_type = type;
+                }
+                switch (type) {
+                    case NODE:
+                        if (this->node_locations_only()) {
+                            this->call_after_and_before_on_handler(NODE);
+                            this->call_node_location_on_handler(object.id(), object.position());
+                        } else {
+                            object.copy_to(m_node_batch.add());
+                        }
+                        break;
+                    case WAY:
+                        object.copy_to(m_way_batch.add());
+                        break;
+                    default:
+                        object.copy_to(m_relation_batch.add());
+                        break;
+                }
+            }
+
+            bool batch_full() const {
+                return m_node_batch.size() + m_way_batch.size() + m_relation_batch.size() >= static_cast<size_t>(batch_size);
+            }
+
+            /**
+             * Hand the objects collected in the current batch to the handler.
+             */
+            void flush_batch() {
+                switch (m_batch_type) {
+                    case NODE:
+                        if (m_node_batch.empty()) {
+                            return;
+                        }
+                        this->call_after_and_before_on_handler(NODE);
+                        this->call_nodes_on_handler(m_node_batch);
+                        m_node_batch.clear();
+                        break;
+                    case WAY:
+                        this->call_after_and_before_on_handler(WAY);
+                        this->call_ways_on_handler(m_way_batch);
+                        m_way_batch.clear();
+                        break;
+                    case RELATION:
+                        this->call_after_and_before_on_handler(RELATION);
+                        this->call_relations_on_handler(m_relation_batch);
+                        m_relation_batch.clear();
+                        break;
+                    default:
+                        return;
+                }
+                this->call_after_block_on_handler();
+                m_batch_type = UNKNOWN;
+            }
+
+        }; // class Dump
+
+    } // namespace Input
+
+} // namespace Osmium
+
+#endif // OSMIUM_INPUT_DUMP_HPP
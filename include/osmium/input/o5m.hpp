@@ -0,0 +1,318 @@
+#ifndef OSMIUM_INPUT_O5M_HPP
+#define OSMIUM_INPUT_O5M_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <osmium/input.hpp>
+#include <osmium/utils/o5m.hpp>
+
+namespace Osmium {
+
+    namespace Input {
+
+        /**
+        * Class for parsing o5m and o5c files.
+        *
+        * o5m needs no compression library, all data is delta and varint
+        * encoded. Regular files are read from the memory mapping, other
+        * input through a buffer.
+        *
+        * Objects in change files (o5c) and history files that only have
+        * an id and version information are deleted objects, they are
+        * marked as not visible.
+        *
+        * Generally you are not supposed to instantiate this class yourself.
+        * Use the Osmium::Input::read() function instead.
+        *
+        * @tparam THandler A handler class (subclass of Osmium::Handler::Base).
+        */
+        template <class THandler>
+        class O5M : public Base<THandler> {
+
+        public:
+
+            /**
+            * Instantiate o5m Parser.
+            *
+            * @param file OSMFile instance.
+            * @param handler Instance of THandler.
+            */
+            O5M(const Osmium::OSMFile& file, THandler& handler) :
+                Base<THandler>(file, handler),
+                m_buffer(),
+                m_data(NULL),
+                m_end(NULL),
+                m_eof(false),
+                m_strings(),
+                m_delta_id(),
+                m_delta_timestamp(0),
+                m_delta_changeset(0),
+                m_delta_lon(0),
+                m_delta_lat(0),
+                m_delta_way_node(0),
+                m_delta_member() {
+                reset();
+            }
+
+            /**
+             * @throws Osmium::O5M::ParseError if the input is not valid o5m.
+             */
+            void parse() {
+                if (this->file().mapped_data()) {
+                    m_data = this->file().mapped_data();
+                    m_end = m_data + this->file().mapped_size();
+                    m_eof = true;
+                }
+
+                try {
+                    while (fill(1)) {
+                        const unsigned char type = *m_data++;
+                        if (type >= Osmium::O5M::first_dataset_without_length) {
+                            if (type == Osmium::O5M::dataset_reset) {
+                                reset();
+                            } else if (type == Osmium::O5M::dataset_eof) {
+                                break;
+                            }
+                            continue;
+                        }
+
+                        fill(10);
+                        const uint64_t length = Osmium::O5M::decode_varint(m_data, m_end);
+                        if (!fill(length) || static_cast<uint64_t>(m_end - m_data) < length) {
+                            throw Osmium::O5M::ParseError("truncated dataset");
+                        }
+                        const char* data = m_data;
+                        m_data += length;
+
+                        switch (type) {
+                            case Osmium::O5M::dataset_node:
+                                this->call_after_and_before_on_handler(NODE);
+                                decode_node(data, m_data);
+                                break;
+                            case Osmium::O5M::dataset_way:
+                                this->call_after_and_before_on_handler(WAY);
+                                decode_way(data, m_data);
+                                break;
+                            case Osmium::O5M::dataset_relation:
+                                this->call_after_and_before_on_handler(RELATION);
+                                decode_relation(data, m_data);
+                                break;
+                            case Osmium::O5M::dataset_bbox:
+                                decode_bbox(data, m_data);
+                                break;
+                            case Osmium::O5M::dataset_header:
+                                if (length != 4 || (std::memcmp(data, "o5m2", 4) && std::memcmp(data, "o5c2", 4))) {
+                                    throw Osmium::O5M::ParseError("unknown file format in header");
+                                }
+                                break;
+                            default:
+                                // ignore file timestamp and unknown datasets
+                                break;
+                        }
+                    }
+                    this->call_after_and_before_on_handler(UNKNOWN);
+                } catch (Osmium::Handler::StopReading) {
+                    // if a handler says to stop reading, we do
+                }
+                this->call_final_on_handler();
+            }
+
+        private:
+
+            /// Buffer for input that is not memory mapped.
+            std::vector<char> m_buffer;
+
+            /// The part of the input not yet parsed.
+            const char* m_data;
+            const char* m_end;
+
+            /// Is the whole input in [m_data, m_end)?
+            bool m_eof;
+
+            Osmium::O5M::InputStringTable m_strings;
+
+            int64_t m_delta_id[3];
+            int64_t m_delta_timestamp;
+            int64_t m_delta_changeset;
+            int64_t m_delta_lon;
+            int64_t m_delta_lat;
+            int64_t m_delta_way_node;
+            int64_t m_delta_member[3];
+
+            /**
+             * Make sure at least size bytes are available in
+             * [m_data, m_end), unless the input ends before.
+             *
+             * @returns false if no bytes are left at all.
+             */
+            bool fill(uint64_t size) {
+                if (size > Osmium::O5M::max_dataset_length) {
+                    throw Osmium::O5M::ParseError("dataset too long");
+                }
+                while (!m_eof && static_cast<size_t>(m_end - m_data) < size) {
+                    const size_t left = m_end - m_data;
+                    const size_t wanted = std::max(static_cast<size_t>(size) * 2, static_cast<size_t>(buffer_size));
+                    if (m_buffer.size() < wanted) {
+                        std::vector<char> buffer(wanted);
+                        std::copy(m_data, m_end, buffer.begin());
+                        m_buffer.swap(buffer);
+                    } else if (left) {
+                        std::memmove(&m_buffer[0], m_data, left);
+                    }
+                    const size_t length = this->file().read(&m_buffer[left], m_buffer.size() - left);
+                    m_data = &m_buffer[0];
+                    m_end = m_data + left + length;
+                    if (length == 0) {
+                        m_eof = true;
+                    }
+                }
+                return m_data != m_end;
+            }
+
+            void reset() {
+                m_strings.clear();
+                for (int n=0; n < 3; ++n) {
+                    m_delta_id[n] = 0;
+                    m_delta_member[n] = 0;
+                }
+                m_delta_timestamp = 0;
+                m_delta_changeset = 0;
+                m_delta_lon = 0;
+                m_delta_lat = 0;
+                m_delta_way_node = 0;
+            }
+
+            /**
+             * Decode id and version information of an object.
+             *
+             * @returns true if the object has more data, false if it is
+             *          a deleted object.
+             */
+            bool decode_object(Osmium::OSM::Object& object, int type, const char*& data, const char* end) {
+                m_delta_id[type] += Osmium::O5M::decode_zigzag(data, end);
+                object.id(m_delta_id[type]);
+
+                const uint64_t version = Osmium::O5M::decode_varint(data, end);
+                if (version) {
+                    object.version(version);
+                    m_delta_timestamp += Osmium::O5M::decode_zigzag(data, end);
+                    if (m_delta_timestamp) {
+                        object.timestamp(m_delta_timestamp);
+                        m_delta_changeset += Osmium::O5M::decode_zigzag(data, end);
+                        object.changeset(m_delta_changeset);
+                        const char* uid = m_strings.read(data, end, 2);
+                        const char* user = uid + std::strlen(uid) + 1;
+                        const char* uid_end = user;
+                        object.uid(Osmium::O5M::decode_varint(uid, uid_end));
+                        object.user(user);
+                    }
+                }
+
+                if (data == end) {
+                    object.visible(false);
+                    return false;
+                }
+                return true;
+            }
+
+            void decode_tags(Osmium::OSM::Object& object, const char* data, const char* end) {
+                while (data != end) {
+                    const char* key = m_strings.read(data, end, 2);
+                    object.tags().add(key, key + std::strlen(key) + 1);
+                }
+            }
+
+            void decode_node(const char* data, const char* end) {
+                Osmium::OSM::Node& node = this->prepare_node();
+                if (decode_object(node, 0, data, end)) {
+                    m_delta_lon += Osmium::O5M::decode_zigzag(data, end);
+                    m_delta_lat += Osmium::O5M::decode_zigzag(data, end);
+                    node.position(Osmium::OSM::Position(static_cast<int32_t>(m_delta_lon), static_cast<int32_t>(m_delta_lat)));
+                    decode_tags(node, data, end);
+                }
+                this->call_node_on_handler();
+            }
+
+            void decode_way(const char* data, const char* end) {
+                Osmium::OSM::Way& way = this->prepare_way();
+                if (decode_object(way, 1, data, end)) {
+                    const uint64_t length = Osmium::O5M::decode_varint(data, end);
+                    if (length > static_cast<uint64_t>(end - data)) {
+                        throw Osmium::O5M::ParseError("way node list too long");
+                    }
+                    const char* refs_end = data + length;
+                    while (data != refs_end) {
+                        m_delta_way_node += Osmium::O5M::decode_zigzag(data, refs_end);
+                        way.add_node(m_delta_way_node);
+                    }
+                    decode_tags(way, data, end);
+                }
+                this->call_way_on_handler();
+            }
+
+            void decode_relation(const char* data, const char* end) {
+                Osmium::OSM::Relation& relation = this->prepare_relation();
+                if (decode_object(relation, 2, data, end)) {
+                    const uint64_t length = Osmium::O5M::decode_varint(data, end);
+                    if (length > static_cast<uint64_t>(end - data)) {
+                        throw Osmium::O5M::ParseError("member list too long");
+                    }
+                    const char* members_end = data + length;
+                    while (data != members_end) {
+                        const int64_t delta = Osmium::O5M::decode_zigzag(data, members_end);
+                        const char* type_and_role = m_strings.read(data, members_end, 1);
+                        const char* types = "nwr";
+                        if (type_and_role[0] < '0' || type_and_role[0] > '2') {
+                            throw Osmium::O5M::ParseError("unknown member type");
+                        }
+                        const int type = type_and_role[0] - '0';
+                        m_delta_member[type] += delta;
+                        relation.add_member(types[type], m_delta_member[type], type_and_role + 1);
+                    }
+                    decode_tags(relation, data, end);
+                }
+                this->call_relation_on_handler();
+            }
+
+            void decode_bbox(const char* data, const char* end) {
+                const int32_t minlon = Osmium::O5M::decode_zigzag(data, end);
+                const int32_t minlat = Osmium::O5M::decode_zigzag(data, end);
+                const int32_t maxlon = Osmium::O5M::decode_zigzag(data, end);
+                const int32_t maxlat = Osmium::O5M::decode_zigzag(data, end);
+                this->meta().bounds().extend(Osmium::OSM::Position(minlon, minlat)).extend(Osmium::OSM::Position(maxlon, maxlat));
+            }
+
+            /// Size of the buffer for input that is not memory mapped.
+            enum { buffer_size = 1024 * 1024 };
+
+        }; // class O5M
+
+    } // namespace Input
+
+} // namespace Osmium
+
+#endif // OSMIUM_INPUT_O5M_HPP
@@ -0,0 +1,733 @@
+#ifndef OSMIUM_INPUT_OPL_HPP
+#define OSMIUM_INPUT_OPL_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <osmium/input.hpp>
+#include <osmium/osm/batch.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/thread/queue.hpp>
+#include <osmium/utils/opl.hpp>
+#include <osmium/utils/timestamp.hpp>
+
+namespace Osmium {
+
+    namespace Input {
+
+        /**
+         * Parses single lines of an OPL file into OSM objects. See
+         * Osmium::OPL for the format.
+         */
+        class OPLParser {
+
+        public:
+
+            OPLParser() :
+                m_key(),
+                m_value() {
+            }
+
+            /**
+             * Get the end of a line without the '\r' of a CRLF line ending.
+             *
+             * @param line Beginning of the line.
+             * @param end End of the line (position of the '\n').
+             */
+            static const char* content_end(const char* line, const char* end) {
+                if (end != line && *(end - 1) == '\r') {
+                    return end - 1;
+                }
+                return end;
+            }
+
+            /**
+             * Get the type of the object in a line. Empty lines and lines
+             * starting with '#' contain no object.
+             *
+             * @returns NODE, WAY, RELATION, or UNKNOWN if there is no object in the line.
+             * @throws Osmium::OPL::ParseError if the line starts with something else.
+             */
+            static osm_object_type_t object_type(const char* line, const char* end) {
+                if (line == end || *line == '#') {
+                    return UNKNOWN;
+                }
+                switch (*line) {
+                    case 'n': return NODE;
+                    case 'w': return WAY;
+                    case 'r': return RELATION;
+                }
+                throw Osmium::OPL::ParseError("unknown object type");
+            }
+
+            void parse_node(Osmium::OSM::Node& node, const char* line, const char* end) {
+                Osmium::OSM::Position position;
+                for (const char* p = parse_id(node, line, end); p != end; ) {
+                    const char field = *p++;
+                    switch (field) {
+                        case 'x':
+                            if (p != end && *p != ' ') {
+                                position.x(parse_coordinate(p, end));
+                            }
+                            break;
+                        case 'y':
+                            if (p != end && *p != ' ') {
+                                position.y(parse_coordinate(p, end));
+                            }
+                            break;
+                        default:
+                            parse_field(node, field, p, end);
+                    }
+                    p = next_field(p, end);
+                }
+                node.position(position);
+            }
+
+            void parse_way(Osmium::OSM::Way& way, const char* line, const char* end) {
+                for (const char* p = parse_id(way, line, end); p != end; ) {
+                    const char field = *p++;
+                    if (field == 'N') {
+                        while (p != end && *p != ' ') {
+                            if (*p != 'n') {
+                                throw Osmium::OPL::ParseError("expected node reference");
+                            }
+                            ++p;
+                            way.add_node(parse_integer(p, end));
+                            if (p != end && *p == ',') {
+                                ++p;
+                            }
+                        }
+                    } else {
+                        parse_field(way, field, p, end);
+                    }
+                    p = next_field(p, end);
+                }
+            }
+
+            void parse_relation(Osmium::OSM::Relation& relation, const char* line, const char* end) {
+                for (const char* p = parse_id(relation, line, end); p != end; ) {
+                    const char field = *p++;
+                    if (field == 'M') {
+                        while (p != end && *p != ' ') {
+                            const char type = *p++;
+                            if (type != 'n' && type != 'w' && type != 'r') {
+                                throw Osmium::OPL::ParseError("unknown member type");
+                            }
+                            const osm_object_id_t ref = parse_integer(p, end);
+                            if (p == end || *p != '@') {
+                                throw Osmium::OPL::ParseError("expected '@'");
+                            }
+                            ++p;
+                            Osmium::OPL::decode_string(p, end, m_value);
+                            relation.add_member(type, ref, m_value.c_str());
+                            if (p != end && *p == ',') {
+                                ++p;
+                            }
+                        }
+                    } else {
+                        parse_field(relation, field, p, end);
+                    }
+                    p = next_field(p, end);
+                }
+            }
+
+        private:
+
+            /// Buffers for decoded strings.
+            std::string m_key;
+            std::string m_value;
+
+            static int64_t parse_integer(const char*& p, const char* end) {
+                const bool negative = (p != end && *p == '-');
+                if (negative) {
+                    ++p;
+                }
+                const char* digits = p;
+                int64_t value = 0;
+                for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+                    value = value * 10 + (*p - '0');
+                }
+                if (p == digits || p - digits > 18) {
+                    throw Osmium::OPL::ParseError("expected number");
+                }
+                return negative ? -value : value;
+            }
+
+            static int32_t parse_coordinate(const char*& p, const char* end) {
+                const bool negative = (p != end && *p == '-');
+                if (negative) {
+                    ++p;
+                }
+                const char* digits = p;
+                int64_t value = 0;
+                for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+                    value = value * 10 + (*p - '0');
+                }
+                if (p == digits || p - digits > 3) {
+                    throw Osmium::OPL::ParseError("invalid coordinate");
+                }
+                int scale = Osmium::OSM::coordinate_precision;
+                if (p != end && *p == '.') {
+                    ++p;
+                    for (; p != end && *p >= '0' && *p <= '9'; ++p) {
+                        if (scale == 1) {
+                            throw Osmium::OPL::ParseError("too many digits in coordinate");
+                        }
+                        value = value * 10 + (*p - '0');
+                        scale /= 10;
+                    }
+                }
+                value *= scale;
+                return static_cast<int32_t>(negative ? -value : value);
+            }
+
+            static const char* next_field(const char* p, const char* end) {
+                if (p != end && *p != ' ') {
+                    throw Osmium::OPL::ParseError("expected space");
+                }
+                while (p != end && *p == ' ') {
+                    ++p;
+                }
+                return p;
+            }
+
+            /**
+             * Parse the object id at the beginning of the line.
+             *
+             * @returns Pointer to the first field.
+             */
+            static const char* parse_id(Osmium::OSM::Object& object, const char* line, const char* end) {
+                const char* p = line + 1;
+                object.id(parse_integer(p, end));
+                return next_field(p, end);
+            }
+
+            /**
+             * Parse a field that all object types have.
+             */
+            void parse_field(Osmium::OSM::Object& object, char field, const char*& p, const char* end) {
+                switch (field) {
+                    case 'v':
+                        object.version(parse_integer(p, end));
+                        break;
+                    case 'd':
+                        if (p == end || (*p != 'V' && *p != 'D')) {
+                            throw Osmium::OPL::ParseError("invalid visible flag");
+                        }
+                        object.visible(*p++ == 'V');
+                        break;
+                    case 'c':
+                        object.changeset(parse_integer(p, end));
+                        break;
+                    case 't': {
+                        const char* start = p;
+                        while (p != end && *p != ' ') {
+                            ++p;
+                        }
+                        if (p != start) {
+                            m_value.assign(start, p - start);
+                            try {
+                                object.timestamp(m_value.c_str());
+                            } catch (std::invalid_argument&) {
+                                throw Osmium::OPL::ParseError("invalid timestamp");
+                            }
+                        }
+                        break;
+                    }
+                    case 'i':
+                        object.uid(parse_integer(p, end));
+                        break;
+                    case 'u':
+                        Osmium::OPL::decode_string(p, end, m_value);
+                        object.user(m_value.c_str());
+                        break;
+                    case 'T':
+                        while (p != end && *p != ' ') {
+                            Osmium::OPL::decode_string(p, end, m_key);
+                            if (p == end || *p != '=') {
+                                throw Osmium::OPL::ParseError("expected '='");
+                            }
+                            ++p;
+                            Osmium::OPL::decode_string(p, end, m_value);
+                            object.tags().add(m_key.c_str(), m_value.c_str());
+                            if (p != end && *p == ',') {
+                                ++p;
+                            }
+                        }
+                        break;
+                    default:
+                        throw Osmium::OPL::ParseError(std::string("unknown field '") + field + "'");
+                }
+            }
+
+        }; // class OPLParser
+
+        /**
+         * Create a ParseError with the line number of the given line in
+         * the message.
+         */
+        inline Osmium::OPL::ParseError opl_parse_error(int line_number, const std::exception& e) {
+            std::ostringstream message;
+            message << "OPL parsing error in line " << line_number << ": " << e.what();
+            return Osmium::OPL::ParseError(message.str());
+        }
+
+        /**
+         * A part of an OPL file parsed by a worker thread. Chunks always
+         * contain whole lines. The objects are collected in batches, a new
+         * batch is started whenever the object type changes.
+         */
+        class OPLChunk : boost::noncopyable {
+
+        public:
+
+            /**
+             * Objects of one type in a row.
+             */
+            struct Run {
+
+                osm_object_type_t type;
+
+                /// Only the batch for type is set.
+                shared_ptr<Osmium::OSM::NodeBatch>     nodes;
+                shared_ptr<Osmium::OSM::WayBatch>      ways;
+                shared_ptr<Osmium::OSM::RelationBatch> relations;
+
+            };
+
+            /**
+             * @param document Start of the whole document in memory.
+             * @param begin Start of the chunk.
+             * @param end End of the chunk.
+             */
+            OPLChunk(const char* document, const char* begin, const char* end) :
+                m_document(document),
+                m_begin(begin),
+                m_end(end),
+                m_runs(),
+                m_error(),
+                m_done(false),
+                m_mutex(),
+                m_decoded() {
+            }
+
+            /**
+             * Parse the chunk. This is called from a worker thread.
+             * Errors are remembered and thrown from wait().
+             */
+            void decode() {
+                std::string error;
+                OPLParser parser;
+                const char* line = m_begin;
+                try {
+                    while (line != m_end) {
+                        const char* line_end = static_cast<const char*>(std::memchr(line, '\n', m_end - line));
+                        if (!line_end) {
+                            line_end = m_end;
+                        }
+                        const char* content_end = OPLParser::content_end(line, line_end);
+                        switch (OPLParser::object_type(line, content_end)) {
+                            case NODE:
+                                parser.parse_node(run(NODE).nodes->add(), line, content_end);
+                                break;
+                            case WAY:
+                                parser.parse_way(run(WAY).ways->add(), line, content_end);
+                                break;
+                            case RELATION:
+                                parser.parse_relation(run(RELATION).relations->add(), line, content_end);
+                                break;
+                            default:
+                                break;
+                        }
+                        line = line_end == m_end ? m_end : line_end + 1;
+                    }
+                } catch (Osmium::OPL::ParseError& e) {
+                    error = opl_parse_error(std::count(m_document, line, '\n') + 1, e).what();
+                } catch (std::exception& e) {
+                    error = e.what();
+                }
+
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_error = error;
+                m_done = true;
+                m_decoded.notify_all();
+            }
+
+            /**
+             * Mark the chunk as failed without parsing it.
+             */
+            void fail(const std::string& error) {
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_error = error;
+                m_done = true;
+                m_decoded.notify_all();
+            }
+
+            /**
+             * Wait until decode() has finished.
+             *
+             * @throws Osmium::OPL::ParseError if there was an error.
+             */
+            void wait() {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_done) {
+                    m_decoded.wait(lock);
+                }
+                if (!m_error.empty()) {
+                    throw Osmium::OPL::ParseError(m_error);
+                }
+            }
+
+            const std::vector<Run>& runs() const {
+                return m_runs;
+            }
+
+        private:
+
+            const char* m_document;
+            const char* m_begin;
+            const char* m_end;
+
+            std::vector<Run> m_runs;
+
+            std::string m_error;
+            bool m_done;
+            boost::mutex m_mutex;
+            boost::condition_variable m_decoded;
+
+            Run& run(osm_object_type_t type) {
+                if (m_runs.empty() || m_runs.back().type != type) {
+                    m_runs.push_back(Run());
+                    Run& run = m_runs.back();
+                    run.type = type;
+                    switch (type) {
+                        case NODE:
+                            run.nodes = make_shared<Osmium::OSM::NodeBatch>();
+                            break;
+                        case WAY:
+                            run.ways = make_shared<Osmium::OSM::WayBatch>();
+                            break;
+                        default:
+                            run.relations = make_shared<Osmium::OSM::RelationBatch>();
+                            break;
+                    }
+                }
+                return m_runs.back();
+            }
+
+        }; // class OPLChunk
+
+        /**
+        * Class for parsing OPL files.
+        *
+        * Memory mapped files (regular uncompressed files, see
+        * OSMFile::mapped_data()) are cut into chunks of whole lines, which
+        * are parsed in parallel by worker threads. The objects of each
+        * chunk are handed to the handler in order like the blocks of a
+        * PBF file, so the handler can use the batch callbacks and
+        * after_block(). Other files are parsed line by line in the thread
+        * calling parse().
+        *
+        * Generally you are not supposed to instantiate this class yourself.
+        * Use the Osmium::Input::read() function instead. Instantiate it
+        * directly if you want to change the number of threads used:
+        *
+        * @code
+        * Osmium::Input::OPL<MyHandler> input(file, handler);
+        * input.num_workers(8).chunk_size(16 * 1024 * 1024);
+        * input.parse();
+        * @endcode
+        *
+        * @tparam THandler A handler class (subclass of Osmium::Handler::Base).
+        */
+        template <class THandler>
+        class OPL : public Base<THandler> {
+
+            typedef shared_ptr<OPLChunk> chunk_ptr_t;
+            typedef Osmium::Thread::Queue<chunk_ptr_t> chunk_queue_t;
+
+            /**
+             * Number of threads parsing chunks. If this is 0, the file is
+             * parsed in the thread calling parse().
+             */
+            int m_num_workers;
+
+            /**
+             * Maximum number of chunks cut from the file but not yet
+             * handed to the handler. This limits the memory use.
+             */
+            int m_max_chunks_in_flight;
+
+            /// Approximate size of the chunks in bytes.
+            size_t m_chunk_size;
+
+            /**
+             * Shuts down the chunk queue and waits for the thread cutting
+             * the chunks when parse() is left, regardless of how.
+             */
+            class ReaderGuard : boost::noncopyable {
+
+                chunk_queue_t& m_queue;
+                boost::thread& m_thread;
+
+            public:
+
+                ReaderGuard(chunk_queue_t& queue, boost::thread& thread) :
+                    m_queue(queue),
+                    m_thread(thread) {
+                }
+
+                ~ReaderGuard() {
+                    m_queue.shutdown();
+                    m_thread.join();
+                }
+
+            }; // class ReaderGuard
+
+        public:
+
+            /**
+            * Instantiate OPL Parser.
+            *
+            * @param file OSMFile instance.
+            * @param handler Instance of THandler.
+            */
+            OPL(const Osmium::OSMFile& file, THandler& handler) :
+                Base<THandler>(file, handler),
+                m_num_workers(Osmium::Thread::Pool::default_num_threads()),
+                m_max_chunks_in_flight(4 * m_num_workers),
+                m_chunk_size(4 * 1024 * 1024) {
+            }
+
+            int num_workers() const {
+                return m_num_workers;
+            }
+
+            /**
+             * Set the number of threads used for parsing chunks. Set to 0
+             * to parse everything in the thread calling parse(). Defaults
+             * to the number of hardware threads. Workers are only used
+             * for memory mapped files.
+             */
+            OPL& num_workers(int num) {
+                m_num_workers = num < 0 ? 0 : num;
+                return *this;
+            }
+
+            int max_chunks_in_flight() const {
+                return m_max_chunks_in_flight;
+            }
+
+            /**
+             * Set the maximum number of chunks that are parsed ahead of
+             * the chunk currently handled. Defaults to 4 times the number
+             * of workers.
+             */
+            OPL& max_chunks_in_flight(int num) {
+                m_max_chunks_in_flight = num < 1 ? 1 : num;
+                return *this;
+            }
+
+            size_t chunk_size() const {
+                return m_chunk_size;
+            }
+
+            /**
+             * Set the approximate size of the chunks in bytes. Defaults to
+             * 4 MB.
+             */
+            OPL& chunk_size(size_t size) {
+                m_chunk_size = size < 1 ? 1 : size;
+                return *this;
+            }
+
+            /**
+             * @throws Osmium::OPL::ParseError if a line can't be parsed.
+             */
+            void parse() {
+                try {
+                    if (m_num_workers > 0 && this->file().mapped_data()) {
+                        parse_with_workers();
+                    } else {
+                        parse_lines();
+                    }
+                    this->call_after_and_before_on_handler(UNKNOWN);
+                } catch (Osmium::Handler::StopReading) {
+                    // if a handler says to stop reading, we do
+                }
+                this->call_final_on_handler();
+            }
+
+        private:
+
+            /// Size of the buffer for input that is not memory mapped.
+            enum { buffer_size = 1024 * 1024 };
+
+            void parse_line(OPLParser& parser, const char* line, const char* end) {
+                end = OPLParser::content_end(line, end);
+                const osm_object_type_t type = OPLParser::object_type(line, end);
+                if (type == UNKNOWN) {
+                    return;
+                }
+                this->call_after_and_before_on_handler(type);
+                switch (type) {
+                    case NODE:
+                        parser.parse_node(this->prepare_node(), line, end);
+                        this->call_node_on_handler();
+                        break;
+                    case WAY:
+                        parser.parse_way(this->prepare_way(), line, end);
+                        this->call_way_on_handler();
+                        break;
+                    default:
+                        parser.parse_relation(this->prepare_relation(), line, end);
+                        this->call_relation_on_handler();
+                        break;
+                }
+            }
+
+            /**
+             * Parse the input line by line in this thread.
+             */
+            void parse_lines() {
+                OPLParser parser;
+                std::vector<char> buffer(buffer_size);
+                size_t used = 0;
+                int line_number = 0;
+                bool eof = false;
+                while (!eof || used > 0) {
+                    if (!eof) {
+                        if (used == buffer.size()) {
+                            buffer.resize(buffer.size() * 2);
+                        }
+                        const size_t length = this->file().read(&buffer[used], buffer.size() - used);
+                        used += length;
+                        eof = (length == 0);
+                    }
+                    const char* line = &buffer[0];
+                    const char* end = line + used;
+                    while (line != end) {
+                        const char* line_end = static_cast<const char*>(std::memchr(line, '\n', end - line));
+                        if (!line_end) {
+                            if (!eof) {
+                                break; // read the rest of the line first
+                            }
+                            line_end = end;
+                        }
+                        ++line_number;
+                        try {
+                            parse_line(parser, line, line_end);
+                        } catch (Osmium::OPL::ParseError& e) {
+                            throw opl_parse_error(line_number, e);
+                        }
+                        line = line_end == end ? end : line_end + 1;
+                    }
+                    used = end - line;
+                    std::memmove(&buffer[0], line, used);
+                }
+            }
+
+            void parse_with_workers() {
+                Osmium::Thread::Pool pool(m_num_workers);
+                chunk_queue_t queue(m_max_chunks_in_flight);
+                boost::thread reader(boost::bind(&OPL::read_chunks, this, boost::ref(queue), boost::ref(pool)));
+                ReaderGuard guard(queue, reader);
+
+                chunk_ptr_t chunk;
+                while (queue.pop(chunk) && chunk) {
+                    chunk->wait();
+                    handle_chunk(*chunk);
+                }
+            }
+
+            /**
+             * This runs in the reader thread. It cuts the file into chunks
+             * of whole lines and hands them to the worker pool for parsing
+             * and to the queue to keep their order. A NULL pointer in the
+             * queue marks the end of the file.
+             */
+            void read_chunks(chunk_queue_t& queue, Osmium::Thread::Pool& pool) {
+                try {
+                    const char* document = this->file().mapped_data();
+                    const char* end = document + this->file().mapped_size();
+                    for (const char* begin = document; begin != end; ) {
+                        const char* chunk_end = end;
+                        if (static_cast<size_t>(end - begin) > m_chunk_size) {
+                            const char* newline = static_cast<const char*>(std::memchr(begin + m_chunk_size, '\n', end - begin - m_chunk_size));
+                            if (newline) {
+                                chunk_end = newline + 1;
+                            }
+                        }
+                        chunk_ptr_t chunk = make_shared<OPLChunk>(document, begin, chunk_end);
+                        if (!queue.push(chunk)) {
+                            return; // queue was shut down, stop reading
+                        }
+                        pool.submit(boost::bind(&OPLChunk::decode, chunk));
+                        begin = chunk_end;
+                    }
+                } catch (std::exception& e) {
+                    chunk_ptr_t chunk = make_shared<OPLChunk>(static_cast<const char*>(NULL), static_cast<const char*>(NULL), static_cast<const char*>(NULL));
+                    chunk->fail(e.what());
+                    queue.push(chunk);
+                }
+                queue.push(chunk_ptr_t());
+            }
+
+            void handle_chunk(OPLChunk& chunk) {
+                for (std::vector<OPLChunk::Run>::const_iterator it = chunk.runs().begin(); it != chunk.runs().end(); ++it) {
+                    this->call_after_and_before_on_handler(it->type);
+                    switch (it->type) {
+                        case NODE:
+                            this->call_nodes_on_handler(*it->nodes);
+                            break;
+                        case WAY:
+                            this->call_ways_on_handler(*it->ways);
+                            break;
+                        default:
+                            this->call_relations_on_handler(*it->relations);
+                            break;
+                    }
+                }
+                if (!chunk.runs().empty()) {
+                    this->call_after_block_on_handler();
+                }
+            }
+
+        }; // class OPL
+
+    } // namespace Input
+
+} // namespace Osmium
+
+#endif // OSMIUM_INPUT_OPL_HPP
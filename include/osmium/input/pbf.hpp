@@ -28,37 +28,527 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 #include <stdexcept>
 #include <string>
 #include <utility>
-#include <zlib.h>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <osmpbf/osmpbf.h>
 
 #include <osmium/input.hpp>
+#include <osmium/compression/blob_codec.hpp>
+#include <osmium/input/pbf_dense_nodes.hpp>
+#include <osmium/input/pbf_index.hpp>
+#include <osmium/input/pbf_primitive_block.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/thread/queue.hpp>
+#include <osmium/utils/protobuf.hpp>
 
 namespace Osmium {
 
     namespace Input {
 
+        /**
+         * A blob read from a PBF file together with its decoded contents.
+         *
+         * Blobs are read from the file by one thread and decoded (inflated
+         * and parsed) by another, so access to the decoded data is
+         * synchronized: wait() blocks until decode() has finished.
+         */
+        class PBFBlob : boost::noncopyable {
+
+        public:
+
+            enum blob_type_t {
+                header_blob,
+                data_blob
+            };
+
+            PBFBlob(blob_type_t type, uint64_t offset=0) :
+                m_type(type),
+                m_offset(offset),
+                m_length(0),
+                m_data(NULL),
+                m_size(0),
+                m_buffer(),
+                m_unpack_buffer(),
+                m_header_block(),
+                m_primitive_block(),
+                m_error(),
+                m_done(false),
+                m_mutex(),
+                m_decoded() {
+            }
+
+            blob_type_t type() const {
+                return m_type;
+            }
+
+            /**
+             * Offset of this blob in the file.
+             */
+            uint64_t offset() const {
+                return m_offset;
+            }
+
+            /**
+             * Length of this blob in the file including its BlobHeader.
+             */
+            uint32_t length() const {
+                return m_length;
+            }
+
+            void length(uint32_t length) {
+                m_length = length;
+            }
+
+            /**
+             * Use the serialized Blob message at the given address. The
+             * data is not copied, it must stay valid until the blob is
+             * decoded. This is used for memory mapped files.
+             */
+            void data(const char* data, size_t size) {
+                m_data = data;
+                m_size = size;
+            }
+
+            /**
+             * Allocate a buffer of the given size inside the blob for the
+             * serialized Blob message and return a pointer to it. This is
+             * used when the data has to be read from the file.
+             */
+            char* allocate(size_t size) {
+                m_buffer.resize(size);
+                m_data = m_buffer.data();
+                m_size = size;
+                return &m_buffer[0];
+            }
+
+            /**
+             * Inflate and decode the blob. Errors are not thrown from here,
+             * but from the next call to wait(). This is called by a worker
+             * thread or directly from the reading thread.
+             *
+             * @param object_types Types of objects needed. If a data blob
+             *        contains no objects of these types, its string table
+             *        is not decoded. group_types() still works in this case.
+             * @param keep_data Keep the serialized Blob message, so that it
+             *        is still available from raw_data() afterwards.
+             */
+            void decode(uint32_t object_types = ALL_OBJECTS_MASK, bool keep_data = false) {
+                std::string error;
+                try {
+                    const std::pair<char*, size_t> a = unpack();
+                    if (m_type == data_blob) {
+                        m_primitive_block.decode(a.first, a.second);
+                        if (m_primitive_block.group_types() & object_types) {
+                            m_primitive_block.decode_stringtable();
+                        }
+                    } else {
+                        if (!m_header_block.ParseFromArray(a.first, a.second)) {
+                            throw std::runtime_error("Failed to parse HeaderBlock.");
+                        }
+                    }
+                } catch (std::exception& e) {
+                    error = e.what();
+                }
+
+                // the raw data isn't needed any more, free the memory
+                if (!keep_data) {
+                    m_data = NULL;
+                    m_size = 0;
+                    std::string().swap(m_buffer);
+                }
+
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_error = error;
+                m_done = true;
+                m_decoded.notify_all();
+            }
+
+            /**
+             * Mark the blob as failed. This is used by the reading thread
+             * to hand on read errors in the proper order.
+             */
+            void fail(const std::string& error) {
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_error = error;
+                m_done = true;
+                m_decoded.notify_all();
+            }
+
+            /**
+             * Wait until the blob is decoded.
+             *
+             * @throws std::runtime_error if decoding failed.
+             */
+            void wait() {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_done) {
+                    m_decoded.wait(lock);
+                }
+                if (!m_error.empty()) {
+                    throw std::runtime_error(m_error);
+                }
+            }
+
+            const OSMPBF::HeaderBlock& header_block() const {
+                return m_header_block;
+            }
+
+            /**
+             * The decoded PrimitiveBlock. It points into the inflated data
+             * in this blob, so it can only be used while the blob exists.
+             */
+            const PBFPrimitiveBlock& primitive_block() const {
+                return m_primitive_block;
+            }
+
+            /**
+             * Types of objects in this data blob.
+             */
+            uint32_t group_types() const {
+                return m_primitive_block.group_types();
+            }
+
+            /**
+             * The serialized Blob message as it was read from the file
+             * (without the BlobHeader). After decoding it is only available
+             * if decode() was told to keep it, otherwise the pointer is NULL.
+             */
+            std::pair<const char*, size_t> raw_data() const {
+                return std::make_pair(m_data, m_size);
+            }
+
+            /**
+             * Get the index entry for this blob: Its position in the file,
+             * the types of objects in it and the range of their IDs. For
+             * data blobs the IDs are read from the decoded PrimitiveBlock,
+             * so this only works after the blob was decoded.
+             */
+            PBFIndex::Entry summary() const {
+                PBFIndex::Entry entry(m_offset, m_length);
+                if (m_type == header_blob) {
+                    entry.types = PBFIndex::header_flag;
+                    return entry;
+                }
+                for (std::vector<PBFPrimitiveBlock::data_t>::const_iterator it = m_primitive_block.groups().begin(); it != m_primitive_block.groups().end(); ++it) {
+                    Osmium::Protobuf::Message group(it->first, it->second);
+                    while (group.next()) {
+                        switch (group.tag()) {
+                            case 1: // nodes
+                                entry.add_object(NODE_MASK, decode_id(group.get_message(), true));
+                                break;
+                            case 2: { // dense
+                                Osmium::Protobuf::Message dense = group.get_message();
+                                while (dense.next()) {
+                                    if (dense.tag() == 1) {
+                                        Osmium::Protobuf::PackedVarints ids = dense.get_packed();
+                                        osm_object_id_t id = 0;
+                                        while (!ids.empty()) {
+                                            id += ids.next_sint64();
+                                            entry.add_object(NODE_MASK, id);
+                                        }
+                                    } else {
+                                        dense.skip();
+                                    }
+                                }
+                                break;
+                            }
+                            case 3: // ways
+                                entry.add_object(WAY_MASK, decode_id(group.get_message(), false));
+                                break;
+                            case 4: // relations
+                                entry.add_object(RELATION_MASK, decode_id(group.get_message(), false));
+                                break;
+                            default:
+                                group.skip();
+                        }
+                    }
+                }
+                return entry;
+            }
+
+        private:
+
+            const blob_type_t m_type;
+
+            const uint64_t m_offset;
+            uint32_t m_length;
+
+            /// The serialized Blob message, either in m_buffer or in a memory mapped file.
+            const char* m_data;
+            size_t m_size;
+
+            std::string m_buffer;
+
+            /// The uncompressed data, m_primitive_block points into it.
+            std::string m_unpack_buffer;
+
+            OSMPBF::HeaderBlock m_header_block;
+            PBFPrimitiveBlock   m_primitive_block;
+
+            std::string m_error;
+            bool m_done;
+            boost::mutex m_mutex;
+            boost::condition_variable m_decoded;
+
+            /**
+             * Get the id (field 1) of an encoded Node, Way, or Relation.
+             * It is a sint64 in Nodes and an int64 in the others.
+             */
+            static osm_object_id_t decode_id(Osmium::Protobuf::Message object, bool zigzag) {
+                while (object.next()) {
+                    if (object.tag() == 1) {
+                        return zigzag ? object.get_sint64() : object.get_int64();
+                    }
+                    object.skip();
+                }
+                return 0;
+            }
+
+            /**
+             * Parse the Blob message and uncompress its contents into
+             * m_unpack_buffer. The message is parsed by hand instead of
+             * through OSMPBF::Blob, so that the (possibly compressed) data
+             * doesn't have to be copied out of the input buffer or memory
+             * mapping. Uncompressed blobs are copied, because
+             * PBFPrimitiveBlock needs a writable buffer with one byte of
+             * space after the data.
+             */
+            std::pair<char*, size_t> unpack() {
+                std::pair<const char*, size_t> raw(NULL, 0);
+                std::pair<const char*, size_t> compressed(NULL, 0);
+                Osmium::Compression::BlobCodec::type_t compression = Osmium::Compression::BlobCodec::zlib;
+                int64_t raw_size = -1;
+
+                Osmium::Protobuf::Message blob(m_data, m_size);
+                while (blob.next()) {
+                    switch (blob.tag()) {
+                        case Osmium::Compression::BlobCodec::none:
+                            raw = blob.get_data();
+                            break;
+                        case 2:
+                            raw_size = blob.get_int32();
+                            break;
+                        case Osmium::Compression::BlobCodec::zlib:
+                        case Osmium::Compression::BlobCodec::lzma:
+                        case Osmium::Compression::BlobCodec::lz4:
+                        case Osmium::Compression::BlobCodec::zstd:
+                            compression = static_cast<Osmium::Compression::BlobCodec::type_t>(blob.tag());
+                            compressed = blob.get_data();
+                            break;
+                        case 5:
+                            throw std::runtime_error("bzip2 blobs not supported");
+                        default:
+                            blob.skip();
+                    }
+                }
+
+                if (raw.first) {
+                    m_unpack_buffer.reserve(raw.second + 1);
+                    m_unpack_buffer.assign(raw.first, raw.second);
+                } else if (compressed.first) {
+                    if (raw_size < 0 || raw_size > OSMPBF::max_uncompressed_blob_size) {
+                        throw std::runtime_error("invalid blob size");
+                    }
+                    m_unpack_buffer.resize(raw_size);
+                    Osmium::Compression::BlobCodec::uncompress(compression, compressed.first, compressed.second, &m_unpack_buffer[0], raw_size);
+                } else {
+                    throw std::runtime_error("Blob contains no data");
+                }
+                const size_t size = m_unpack_buffer.size();
+                m_unpack_buffer.push_back('\0'); // space for the terminator of the last string
+                return std::make_pair(&m_unpack_buffer[0], size);
+            }
+
+        }; // class PBFBlob
+
+        /**
+         * Traits class telling Input::PBF whether a handler wants to see
+         * the data blobs of a PBF file before their objects are decoded.
+         * This is the case if the handler defines a method
+         * @code
+         * bool raw_blob(const Osmium::Input::PBFBlob& blob);
+         * @endcode
+         * It is called for every OSMData blob in file order, after init()
+         * and before the objects of the blob are handed to the handler.
+         * If it returns true, the handler has dealt with the whole blob
+         * and its objects are not handed to the handler. This allows
+         * tools to copy blobs that pass unchanged to a PBF output with
+         * Osmium::Output::PBF::write_raw_blob() or to drop them, and to
+         * decode only the blobs that actually change. Use
+         * PBFBlob::summary() to find out what is in a blob.
+         */
+        template <class THandler>
+        class PBFRawBlobs {
+
+            typedef char yes_type;
+
+            struct no_type {
+                char dummy[2];
+            };
+
+            template <bool B>
+            struct bool_tag {
+            };
+
+            template <class T, bool (T::*)(const PBFBlob&)>
+            struct method_check {
+            };
+
+            template <class T>
+            static yes_type has_raw_blob_method(method_check<T, &T::raw_blob>*);
+
+            template <class T>
+            static no_type has_raw_blob_method(...);
+
+            static bool call(THandler& handler, const PBFBlob& blob, bool_tag<true>) {
+                return handler.raw_blob(blob);
+            }
+
+            static bool call(THandler&, const PBFBlob&, bool_tag<false>) {
+                return false;
+            }
+
+        public:
+
+            /**
+             * Does the handler have a raw_blob() method?
+             */
+            static const bool value = sizeof(has_raw_blob_method<THandler>(0)) == sizeof(yes_type);
+
+            /**
+             * Call raw_blob() on the handler if it has this method.
+             *
+             * @returns true if the handler has dealt with the blob
+             */
+            static bool call(THandler& handler, const PBFBlob& blob) {
+                return call(handler, blob, bool_tag<value>());
+            }
+
+        }; // class PBFRawBlobs
+
         /**
         * Class for parsing PBF files.
         *
         * Generally you are not supposed to instantiate this class yourself.
-        * Use the Osmium::Input::read() function instead.
+        * Use the Osmium::Input::read() function instead. Instantiate it
+        * directly if you want to change the number of threads used:
+        *
+        * @code
+        * Osmium::Input::PBF<MyHandler> input(file, handler);
+        * input.num_workers(8).max_blobs_in_flight(32);
+        * input.parse();
+        * @endcode
+        *
+        * Reading is done in a pipeline: One thread reads the blobs from the
+        * file, a pool of worker threads uncompresses them and decodes the
+        * string tables, and the thread that called parse() decodes the
+        * objects and calls the handler on them in the order they appear in
+        * the file. So the handler is always called from the same thread and
+        * doesn't have to be thread-safe.
+        *
+        * Handlers can look at the data blobs before they are decoded and
+        * copy them to the output unchanged, see PBFRawBlobs.
         *
         * @tparam THandler A handler class (subclass of Osmium::Handler::Base).
         */
         template <class THandler>
         class PBF : public Base<THandler> {
 
-            typedef std::pair<const void*, size_t> array_t;
+            typedef shared_ptr<PBFBlob> blob_ptr_t;
+            typedef Osmium::Thread::Queue<blob_ptr_t> blob_queue_t;
 
-            unsigned char m_input_buffer[OSMPBF::max_uncompressed_blob_size];
-            unsigned char m_unpack_buffer[OSMPBF::max_uncompressed_blob_size];
+            /**
+             * Number of threads decoding blobs. If this is 0, the blobs
+             * are read and decoded in the thread calling parse().
+             */
+            int m_num_workers;
 
-            OSMPBF::Blob           m_pbf_blob;
-            OSMPBF::BlobHeader     m_pbf_blob_header;
-            OSMPBF::PrimitiveBlock m_pbf_primitive_block;
+            /**
+             * Maximum number of blobs read from the file but not yet
+             * handed to the handler. This limits the memory use.
+             */
+            int m_max_blobs_in_flight;
 
             int64_t m_date_factor;
+            int32_t m_granularity;
+            int64_t m_lat_offset;
+            int64_t m_lon_offset;
+
+            /**
+             * Current position in the input file.
+             */
+            uint64_t m_input_offset;
+
+            /**
+             * Types of objects needed by the handler (osm_object_type_mask_t).
+             */
+            uint32_t m_object_types;
+
+            bool m_use_index;
+            bool m_build_index;
+
+            /**
+             * Set if the file header says the file is sorted by type and
+             * ID. Reading can then stop when the types needed are done.
+             */
+            bool m_sorted;
+
+            /**
+             * Index loaded from the index file. Empty if no index was
+             * loaded, for instance because all object types are needed.
+             */
+            PBFIndex m_index;
+
+            /**
+             * Position in m_index of the next blob that might be read.
+             */
+            size_t m_index_pos;
+
+            /**
+             * Index built while reading the file if m_build_index is set.
+             */
+            PBFIndex m_new_index;
+
+            /**
+             * The objects of the PrimitiveGroup currently decoded. They are
+             * handed to the handler together after the whole group is
+             * decoded.
+             */
+            Osmium::OSM::NodeBatch     m_node_batch;
+            Osmium::OSM::WayBatch      m_way_batch;
+            Osmium::OSM::RelationBatch m_relation_batch;
+
+            /// Columns of the DenseNodes message currently decoded.
+            PBFDenseNodes m_dense_nodes;
+
+            /**
+             * Shuts down the blob queue and waits for the reading thread
+             * when parse() is left, regardless of how.
+             */
+            class ReaderGuard : boost::noncopyable {
+
+                blob_queue_t& m_queue;
+                boost::thread& m_thread;
+
+            public:
+
+                ReaderGuard(blob_queue_t& queue, boost::thread& thread) :
+                    m_queue(queue),
+                    m_thread(thread) {
+                }
+
+                ~ReaderGuard() {
+                    m_queue.shutdown();
+                    m_thread.join();
+                }
+
+            }; // class ReaderGuard
 
         public:
 
@@ -70,15 +560,101 @@ namespace Osmium {
             */
             PBF(const OSMFile& file, THandler& handler) :
                 Base<THandler>(file, handler),
-                m_input_buffer(),
-                m_unpack_buffer(),
-                m_pbf_blob(),
-                m_pbf_blob_header(),
-                m_pbf_primitive_block(),
-                m_date_factor() {
+                m_num_workers(Osmium::Thread::Pool::default_num_threads()),
+                m_max_blobs_in_flight(4 * m_num_workers),
+                m_date_factor(),
+                m_granularity(),
+                m_lat_offset(),
+                m_lon_offset(),
+                m_input_offset(0),
+                m_object_types(Osmium::Handler::ObjectTypes<THandler>::mask(handler)),
+                m_use_index(true),
+                m_build_index(false),
+                m_sorted(false),
+                m_index(),
+                m_index_pos(0),
+                m_new_index(),
+                m_node_batch(),
+                m_way_batch(),
+                m_relation_batch(),
+                m_dense_nodes() {
                 GOOGLE_PROTOBUF_VERIFY_VERSION;
             }
 
+            int num_workers() const {
+                return m_num_workers;
+            }
+
+            /**
+             * Set the number of threads used for decoding blobs. Set to 0
+             * to read and decode everything in the thread calling parse().
+             * Defaults to the number of hardware threads.
+             */
+            PBF& num_workers(int num) {
+                m_num_workers = num < 0 ? 0 : num;
+                return *this;
+            }
+
+            int max_blobs_in_flight() const {
+                return m_max_blobs_in_flight;
+            }
+
+            /**
+             * Set the maximum number of blobs that are read ahead of the
+             * blob currently handled. Every blob can take up to a few
+             * megabytes of memory. Defaults to 4 times the number of
+             * workers.
+             */
+            PBF& max_blobs_in_flight(int num) {
+                m_max_blobs_in_flight = num < 1 ? 1 : num;
+                return *this;
+            }
+
+            uint32_t object_types() const {
+                return m_object_types;
+            }
+
+            /**
+             * Set the types of objects the handler needs (a combination
+             * of NODE_MASK, WAY_MASK, and RELATION_MASK). Objects of other
+             * types are not handed to the handler and the before_*() and
+             * after_*() methods are not called for them.
+             *
+             * Blobs containing only objects of other types are inflated,
+             * but not parsed. If an index file exists for the input file
+             * (see PBFIndex), they are not even read. If the file is
+             * sorted by type, reading stops when all needed types are done.
+             *
+             * Defaults to the types the handler declares through
+             * Osmium::Handler::ObjectTypes.
+             */
+            PBF& object_types(uint32_t mask) {
+                m_object_types = mask;
+                return *this;
+            }
+
+            /**
+             * Set whether an existing index file should be used to skip
+             * blobs. Defaults to true.
+             */
+            PBF& use_index(bool use) {
+                m_use_index = use;
+                return *this;
+            }
+
+            /**
+             * Set whether an index should be built while reading the file.
+             * It is written to the index file after the whole file was
+             * read. The index is not built if blobs are skipped or the
+             * handler stops reading early. Defaults to false.
+             *
+             * @throws Osmium::OSMFile::IOError from parse() if the index file can't be written.
+             */
+            PBF& build_index(bool build) {
+                m_build_index = build;
+                return *this;
+            }
+
             /**
             * Parse PBF file.
             *
@@ -86,63 +662,29 @@ namespace Osmium {
             * turns out while parsing the file, that it is of the wrong type.
             */
             void parse() {
-                try {
-                    while (read_blob_header()) {
-                        const array_t a = read_blob(m_pbf_blob_header.datasize());
-
-                        if (m_pbf_blob_header.type() == "OSMData") {
-                            if (!m_pbf_primitive_block.ParseFromArray(a.first, a.second)) {
-                                throw std::runtime_error("Failed to parse PrimitiveBlock.");
-                            }
-                            const OSMPBF::StringTable& stringtable = m_pbf_primitive_block.stringtable();
-                            m_date_factor = m_pbf_primitive_block.date_granularity() / 1000;
-                            for (int i=0; i < m_pbf_primitive_block.primitivegroup_size(); ++i) {
-                                parse_group(m_pbf_primitive_block.primitivegroup(i), stringtable);
-                            }
-                        } else if (m_pbf_blob_header.type() == "OSMHeader") {
-                            OSMPBF::HeaderBlock pbf_header_block;
-                            if (!pbf_header_block.ParseFromArray(a.first, a.second)) {
-                                throw std::runtime_error("Failed to parse HeaderBlock.");
-                            }
-
-                            bool has_historical_information_feature = false;
-                            for (int i=0; i < pbf_header_block.required_features_size(); ++i) {
-                                const std::string& feature = pbf_header_block.required_features(i);
-
-                                if (feature == "OsmSchema-V0.6") continue;
-                                if (feature == "DenseNodes") continue;
-                                if (feature == "HistoricalInformation") {
-                                    has_historical_information_feature = true;
-                                    continue;
-                                }
-
-                                std::ostringstream errmsg;
-                                errmsg << "Required feature not supported: " << feature;
-                                throw std::runtime_error(errmsg.str());
-                            }
-
-                            const Osmium::OSMFile::FileType* expected_file_type = this->file().type();
-                            if (expected_file_type == Osmium::OSMFile::FileType::OSM() && has_historical_information_feature) {
-                                throw Osmium::OSMFile::FileTypeOSMExpected();
-                            }
-                            if (expected_file_type == Osmium::OSMFile::FileType::History() && !has_historical_information_feature) {
-                                throw Osmium::OSMFile::FileTypeHistoryExpected();
-                            }
+                if (m_use_index && (m_object_types & ALL_OBJECTS_MASK) != ALL_OBJECTS_MASK) {
+                    m_index.load(this->file().filename());
+                }
+                m_index_pos = 0;
+                m_new_index.clear();
 
-                            if (pbf_header_block.has_writingprogram()) {
-                                this->meta().generator(pbf_header_block.writingprogram());
-                            }
-                            if (pbf_header_block.has_bbox()) {
-                                const OSMPBF::HeaderBBox& bbox = pbf_header_block.bbox();
-                                const int64_t resolution_convert = OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision;
-                                this->meta().bounds().extend(Osmium::OSM::Position(bbox.left()  / resolution_convert, bbox.bottom() / resolution_convert));
-                                this->meta().bounds().extend(Osmium::OSM::Position(bbox.right() / resolution_convert, bbox.top()    / resolution_convert));
+                try {
+                    if (m_num_workers > 0) {
+                        parse_with_workers();
+                    } else {
+                        blob_ptr_t blob;
+                        while ((blob = read_blob())) {
+                            blob->decode(stringtable_object_types(), PBFRawBlobs<THandler>::value);
+                            blob->wait();
+                            if (!handle_blob(*blob)) {
+                                break;
                             }
-                        } else {
-//                            std::cerr << "Ignoring unknown blob type (" << m_pbf_blob_header.type().data() << ").\n";
                         }
                     }
                     this->call_after_and_before_on_handler(UNKNOWN);
+                    if (m_build_index && m_index.empty()) {
+                        m_new_index.save(this->file().filename());
+                    }
                 } catch (Osmium::Handler::StopReading) {
                     // if a handler says to stop reading, we do
                 }
@@ -151,313 +693,804 @@ namespace Osmium {
 
         private:
 
-            /**
-            * Parse one PrimitiveGroup inside a PrimitiveBlock. This function will check what
-            * type of data the group contains (nodes, dense nodes, ways, or relations) and
-            * call the proper parsing function. It will also make sure the right before_*
-            * and after_* methods are called.
-            *
-            * @param group The PrimitiveGroup to parse.
-            * @param stringtable The string table inside the PrimitiveBlock with tags and usernames.
-            */
-            void parse_group(const OSMPBF::PrimitiveGroup& group, const OSMPBF::StringTable& stringtable) {
-                if (group.has_dense())  {
-                    this->call_after_and_before_on_handler(NODE);
-                    parse_dense_node_group(group, stringtable, &THandler::node);
-                } else if (group.ways_size() != 0) {
-                    this->call_after_and_before_on_handler(WAY);
-                    parse_way_group(group, stringtable, &THandler::way);
-                } else if (group.relations_size() != 0) {
-                    this->call_after_and_before_on_handler(RELATION);
-                    parse_relation_group(group, stringtable, &THandler::relation);
-                } else if (group.nodes_size() != 0) {
-                    this->call_after_and_before_on_handler(NODE);
-                    parse_node_group(group, stringtable, &THandler::node);
-                } else {
-                    throw std::runtime_error("Group of unknown type.");
+            void parse_with_workers() {
+                Osmium::Thread::Pool pool(m_num_workers);
+                blob_queue_t queue(m_max_blobs_in_flight);
+                boost::thread reader(boost::bind(&PBF::read_blobs, this, boost::ref(queue), boost::ref(pool)));
+                ReaderGuard guard(queue, reader);
+
+                blob_ptr_t blob;
+                while (queue.pop(blob) && blob) {
+                    blob->wait();
+                    if (!handle_blob(*blob)) {
+                        break;
+                    }
                 }
             }
 
-            // empty specialization to optimize the case where the node() method on the handler is empty
-            void parse_node_group(const OSMPBF::PrimitiveGroup& /*group*/, const OSMPBF::StringTable& /*stringtable*/,
-                                  void (Osmium::Handler::Base::*)(const shared_ptr<Osmium::OSM::Node const>&) const) {
+            /**
+             * This runs in the reader thread. It reads all blobs from the
+             * file and hands them to the worker pool for decoding and to the
+             * queue to keep their order. A NULL pointer in the queue marks
+             * the end of the file. Read errors are handed through the queue,
+             * so they are thrown in the right order.
+             */
+            void read_blobs(blob_queue_t& queue, Osmium::Thread::Pool& pool) {
+                try {
+                    blob_ptr_t blob;
+                    while ((blob = read_blob())) {
+                        if (!queue.push(blob)) {
+                            return; // queue was shut down, stop reading
+                        }
+                        pool.submit(boost::bind(&PBFBlob::decode, blob, stringtable_object_types(), PBFRawBlobs<THandler>::value));
+                    }
+                } catch (std::exception& e) {
+                    blob_ptr_t blob = make_shared<PBFBlob>(PBFBlob::data_blob);
+                    blob->fail(e.what());
+                    queue.push(blob);
+                }
+                queue.push(blob_ptr_t());
             }
 
-            template <typename T>
-            void parse_node_group(const OSMPBF::PrimitiveGroup& group, const OSMPBF::StringTable& stringtable, T) {
-                int max_entity = group.nodes_size();
-                for (int entity=0; entity < max_entity; ++entity) {
-                    Osmium::OSM::Node& node = this->prepare_node();
+            /**
+             * Types of objects the blobs have to be parsed for. If an
+             * index is built, everything has to be parsed.
+             */
+            uint32_t decode_object_types() const {
+                return (m_build_index && m_index.empty()) ? static_cast<uint32_t>(ALL_OBJECTS_MASK) : m_object_types;
+            }
 
-                    const OSMPBF::Node& pbf_node = group.nodes(entity);
+            /**
+             * Types of objects that need the string table of a blob. Node
+             * locations don't need any strings.
+             */
+            uint32_t stringtable_object_types() const {
+                return this->node_locations_only() ? (decode_object_types() & ~NODE_MASK) : decode_object_types();
+            }
 
-                    node.id(pbf_node.id());
-                    if (pbf_node.has_info()) {
-                        node.version(pbf_node.info().version())
-                        .changeset(pbf_node.info().changeset())
-                        .timestamp(pbf_node.info().timestamp() * m_date_factor)
-                        .uid(pbf_node.info().uid())
-                        .user(stringtable.s(pbf_node.info().user_sid()).data());
-                        if (pbf_node.info().has_visible()) {
-                            node.visible(pbf_node.info().visible());
+            /**
+             * Call the handler on the contents of a decoded blob.
+             *
+             * @returns false if the rest of the file doesn't contain
+             *          anything the handler needs, true otherwise
+             */
+            bool handle_blob(PBFBlob& blob) {
+                if (m_build_index && m_index.empty()) {
+                    m_new_index.add(blob.summary());
+                }
+                if (blob.type() == PBFBlob::data_blob) {
+                    if (PBFRawBlobs<THandler>::value) {
+                        this->call_init_on_handler();
+                        if (PBFRawBlobs<THandler>::call(this->handler(), blob)) {
+                            return true;
                         }
                     }
-
-                    Osmium::OSM::TagList& tags = node.tags();
-                    for (int tag=0; tag < pbf_node.keys_size(); ++tag) {
-                        tags.add(stringtable.s(pbf_node.keys(tag)).data(),
-                                 stringtable.s(pbf_node.vals(tag)).data());
+                    const PBFPrimitiveBlock& block = blob.primitive_block();
+                    m_date_factor = block.date_granularity() / 1000;
+                    m_granularity = block.granularity();
+                    m_lat_offset  = block.lat_offset();
+                    m_lon_offset  = block.lon_offset();
+                    for (std::vector<PBFPrimitiveBlock::data_t>::const_iterator it = block.groups().begin(); it != block.groups().end(); ++it) {
+                        parse_group(*it, block);
                     }
-
-                    node.position(Osmium::OSM::Position(
-                                      (pbf_node.lon() * m_pbf_primitive_block.granularity() + m_pbf_primitive_block.lon_offset()) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision),
-                                      (pbf_node.lat() * m_pbf_primitive_block.granularity() + m_pbf_primitive_block.lat_offset()) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision)));
-                    this->call_node_on_handler();
+                    this->call_after_block_on_handler();
+                    if (m_sorted && decode_object_types() != ALL_OBJECTS_MASK) {
+                        return !all_needed_types_seen(blob.group_types());
+                    }
+                } else {
+                    handle_header_block(blob.header_block());
                 }
+                return true;
             }
 
-            // empty specialization to optimize the case where the way() method on the handler is empty
-            void parse_way_group(const OSMPBF::PrimitiveGroup& /*group*/, const OSMPBF::StringTable& /*stringtable*/,
-                                 void (Osmium::Handler::Base::*)(const shared_ptr<Osmium::OSM::Way const>&) const) {
+            /**
+             * In a file sorted by type, no objects of a type can come
+             * after objects of a later type (ie. no nodes after ways).
+             * This checks whether, after seeing the given types, there can
+             * be no more objects of types the handler needs.
+             */
+            bool all_needed_types_seen(uint32_t types) const {
+                if (types == 0) {
+                    return false;
+                }
+                uint32_t highest_type_seen = NODE_MASK;
+                while (types >>= 1) {
+                    highest_type_seen <<= 1;
+                }
+                // types that can still come are the highest seen and all later ones
+                const uint32_t still_possible = ALL_OBJECTS_MASK & ~(highest_type_seen - 1);
+                return !(m_object_types & still_possible);
             }
 
-            template <typename T>
-            void parse_way_group(const OSMPBF::PrimitiveGroup& group, const OSMPBF::StringTable& stringtable, T) {
-                int max_entity = group.ways_size();
-                for (int entity=0; entity < max_entity; ++entity) {
-                    Osmium::OSM::Way& way = this->prepare_way();
+            void handle_header_block(const OSMPBF::HeaderBlock& pbf_header_block) {
+                bool has_historical_information_feature = false;
+                for (int i=0; i < pbf_header_block.required_features_size(); ++i) {
+                    const std::string& feature = pbf_header_block.required_features(i);
 
-                    const OSMPBF::Way& pbf_way = group.ways(entity);
-
-                    way.id(pbf_way.id());
-                    if (pbf_way.has_info()) {
-                        way.version(pbf_way.info().version())
-                        .changeset(pbf_way.info().changeset())
-                        .timestamp(pbf_way.info().timestamp() * m_date_factor)
-                        .uid(pbf_way.info().uid())
-                        .user(stringtable.s(pbf_way.info().user_sid()).data());
-                        if (pbf_way.info().has_visible()) {
-                            way.visible(pbf_way.info().visible());
-                        }
+                    if (feature == "OsmSchema-V0.6") continue;
+                    if (feature == "DenseNodes") continue;
+                    if (feature == "HistoricalInformation") {
+                        has_historical_information_feature = true;
+                        continue;
                     }
 
-                    Osmium::OSM::TagList& tags = way.tags();
-                    for (int tag=0; tag < pbf_way.keys_size(); ++tag) {
-                        tags.add(stringtable.s(pbf_way.keys(tag)).data(),
-                                 stringtable.s(pbf_way.vals(tag)).data());
-                    }
+                    std::ostringstream errmsg;
+                    errmsg << "Required feature not supported: " << feature;
+                    throw std::runtime_error(errmsg.str());
+                }
 
-                    uint64_t ref = 0;
-                    for (int i=0; i < pbf_way.refs_size(); ++i) {
-                        ref += pbf_way.refs(i);
-                        way.add_node(ref);
+                m_sorted = false;
+                for (int i=0; i < pbf_header_block.optional_features_size(); ++i) {
+                    if (pbf_header_block.optional_features(i) == "Sort.Type_then_ID") {
+                        m_sorted = true;
+                    } else if (pbf_header_block.optional_features(i) == "LocationsOnWays") {
+                        this->meta().has_locations_on_ways(true);
                     }
+                }
 
-                    this->call_way_on_handler();
+                const Osmium::OSMFile::FileType* expected_file_type = this->file().type();
+                if (expected_file_type == Osmium::OSMFile::FileType::OSM() && has_historical_information_feature) {
+                    throw Osmium::OSMFile::FileTypeOSMExpected();
+                }
+                if (expected_file_type == Osmium::OSMFile::FileType::History() && !has_historical_information_feature) {
+                    throw Osmium::OSMFile::FileTypeHistoryExpected();
+                }
+
+                if (pbf_header_block.has_writingprogram()) {
+                    this->meta().generator(pbf_header_block.writingprogram());
+                }
+                if (pbf_header_block.has_bbox()) {
+                    const OSMPBF::HeaderBBox& bbox = pbf_header_block.bbox();
+                    const int64_t resolution_convert = OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision;
+                    this->meta().bounds().extend(Osmium::OSM::Position(bbox.left()  / resolution_convert, bbox.bottom() / resolution_convert));
+                    this->meta().bounds().extend(Osmium::OSM::Position(bbox.right() / resolution_convert, bbox.top()    / resolution_convert));
                 }
             }
 
-            // empty specialization to optimize the case where the relation() method on the handler is empty
-            void parse_relation_group(const OSMPBF::PrimitiveGroup& /*group*/, const OSMPBF::StringTable& /*stringtable*/,
-                                      void (Osmium::Handler::Base::*)(const shared_ptr<Osmium::OSM::Relation const>&) const) {
+            /**
+            * Parse one PrimitiveGroup inside a PrimitiveBlock. This function will check what
+            * type of data the group contains (nodes, ways, or relations) and
+            * call the proper parsing function. It will also make sure the right before_*
+            * and after_* methods are called.
+            *
+            * @param group The encoded PrimitiveGroup to parse.
+            * @param block The PrimitiveBlock with the string table containing tags and usernames.
+            */
+            void parse_group(const PBFPrimitiveBlock::data_t& group, const PBFPrimitiveBlock& block) {
+                switch (PBFPrimitiveBlock::group_type(group)) {
+                    case NODE_MASK:
+                        if (m_object_types & NODE_MASK) {
+                            this->call_after_and_before_on_handler(NODE);
+                            if (this->node_locations_only()) {
+                                parse_node_locations(group, block);
+                            } else {
+                                parse_node_group(group, block, &THandler::node, &THandler::nodes);
+                            }
+                        }
+                        break;
+                    case WAY_MASK:
+                        if (m_object_types & WAY_MASK) {
+                            this->call_after_and_before_on_handler(WAY);
+                            parse_way_group(group, block, &THandler::way, &THandler::ways);
+                        }
+                        break;
+                    case RELATION_MASK:
+                        if (m_object_types & RELATION_MASK) {
+                            this->call_after_and_before_on_handler(RELATION);
+                            parse_relation_group(group, block, &THandler::relation, &THandler::relations);
+                        }
+                        break;
+                    default:
+                        throw std::runtime_error("Group of unknown type.");
+                }
             }
 
-            template <typename T>
-            void parse_relation_group(const OSMPBF::PrimitiveGroup& group, const OSMPBF::StringTable& stringtable, T) {
-                int max_entity = group.relations_size();
-                for (int entity=0; entity < max_entity; ++entity) {
-                    Osmium::OSM::Relation& relation = this->prepare_relation();
+            /**
+            * Parse an encoded Info message into the object.
+            */
+            void parse_info(Osmium::Protobuf::Message pbf_info, const PBFPrimitiveBlock& block, Osmium::OSM::Object& object) {
+                int32_t version   = -1;
+                int64_t timestamp = 0;
+                int64_t changeset = 0;
+                int32_t uid       = 0;
+                uint32_t user_sid = 0;
+                bool has_visible  = false;
+                bool visible      = true;
+
+                while (pbf_info.next()) {
+                    switch (pbf_info.tag()) {
+                        case 1:
+                            version = pbf_info.get_int32();
+                            break;
+                        case 2:
+                            timestamp = pbf_info.get_int64();
+                            break;
+                        case 3:
+                            changeset = pbf_info.get_int64();
+                            break;
+                        case 4:
+                            uid = pbf_info.get_int32();
+                            break;
+                        case 5:
+                            user_sid = pbf_info.get_uint32();
+                            break;
+                        case 6:
+                            has_visible = true;
+                            visible = pbf_info.get_bool();
+                            break;
+                        default:
+                            pbf_info.skip();
+                    }
+                }
 
-                    const OSMPBF::Relation& pbf_relation = group.relations(entity);
+                object.version(version)
+                .changeset(changeset)
+                .timestamp(timestamp * m_date_factor)
+                .uid(uid)
+                .user_borrowed(block.s(user_sid));
+                if (has_visible) {
+                    object.visible(visible);
+                }
+            }
 
-                    relation.id(pbf_relation.id());
-                    if (pbf_relation.has_info()) {
-                        relation.version(pbf_relation.info().version())
-                        .changeset(pbf_relation.info().changeset())
-                        .timestamp(pbf_relation.info().timestamp() * m_date_factor)
-                        .uid(pbf_relation.info().uid())
-                        .user(stringtable.s(pbf_relation.info().user_sid()).data());
-                        if (pbf_relation.info().has_visible()) {
-                            relation.visible(pbf_relation.info().visible());
-                        }
-                    }
+            /**
+            * Add the tags from the packed keys and vals fields of a Node, Way, or Relation.
+            */
+            void parse_tags(Osmium::OSM::TagList& tags, Osmium::Protobuf::PackedVarints keys, Osmium::Protobuf::PackedVarints vals, const PBFPrimitiveBlock& block) {
+                while (!keys.empty()) {
+                    const char* key = block.s(keys.next_uint32());
+                    tags.add_borrowed(key, block.s(vals.next_uint32()));
+                }
+            }
 
-                    Osmium::OSM::TagList& tags = relation.tags();
-                    for (int tag=0; tag < pbf_relation.keys_size(); ++tag) {
-                        tags.add(stringtable.s(pbf_relation.keys(tag)).data(),
-                                 stringtable.s(pbf_relation.vals(tag)).data());
+            // empty specialization to optimize the case where the node() and nodes() methods on the handler are empty
+            void parse_node_group(const PBFPrimitiveBlock::data_t& /*group*/, const PBFPrimitiveBlock& /*block*/,
+                                  void (Osmium::Handler::Base::*)(const shared_ptr<Osmium::OSM::Node const>&) const,
+                                  void (Osmium::Handler::Base::*)(const Osmium::OSM::NodeBatch&) const) {
+            }
+
+            template <typename T1, typename T2>
+            void parse_node_group(const PBFPrimitiveBlock::data_t& group, const PBFPrimitiveBlock& block, T1, T2) {
+                m_node_batch.clear();
+                Osmium::Protobuf::Message pbf_group(group.first, group.second);
+                while (pbf_group.next()) {
+                    switch (pbf_group.tag()) {
+                        case 1:
+                            parse_node(pbf_group.get_message(), block);
+                            break;
+                        case 2:
+                            parse_dense_nodes(pbf_group.get_message(), block);
+                            break;
+                        default:
+                            pbf_group.skip();
                     }
+                }
+                this->call_nodes_on_handler(m_node_batch);
+            }
 
-                    uint64_t ref = 0;
-                    for (int i=0; i < pbf_relation.types_size(); ++i) {
-                        char type = 'x';
-                        switch (pbf_relation.types(i)) {
-                            case OSMPBF::Relation::NODE:
-                                type = 'n';
-                                break;
-                            case OSMPBF::Relation::WAY:
-                                type = 'w';
-                                break;
-                            case OSMPBF::Relation::RELATION:
-                                type = 'r';
-                                break;
+            /**
+            * Hand only the IDs and positions of the nodes in a group to the
+            * handler. Tags and metadata are not decoded.
+            */
+            void parse_node_locations(const PBFPrimitiveBlock::data_t& group, const PBFPrimitiveBlock& block) {
+                Osmium::Protobuf::Message pbf_group(group.first, group.second);
+                while (pbf_group.next()) {
+                    switch (pbf_group.tag()) {
+                        case 1: {
+                            Osmium::Protobuf::Message pbf_node = pbf_group.get_message();
+                            osm_object_id_t id = 0;
+                            int64_t lat = 0;
+                            int64_t lon = 0;
+                            while (pbf_node.next()) {
+                                switch (pbf_node.tag()) {
+                                    case 1:
+                                        id = pbf_node.get_sint64();
+                                        break;
+                                    case 8:
+                                        lat = pbf_node.get_sint64();
+                                        break;
+                                    case 9:
+                                        lon = pbf_node.get_sint64();
+                                        break;
+                                    default:
+                                        pbf_node.skip();
+                                }
+                            }
+                            this->call_node_location_on_handler(id, Osmium::OSM::Position(
+                                (lon * m_granularity + m_lon_offset) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision),
+                                (lat * m_granularity + m_lat_offset) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision)));
+                            break;
                         }
-                        ref += pbf_relation.memids(i);
-                        relation.add_member(type, ref, stringtable.s(pbf_relation.roles_sid(i)).data());
+                        case 2: {
+                            m_dense_nodes.decode(pbf_group.get_message(), block);
+                            const int64_t* ids = m_dense_nodes.ids();
+                            const int32_t* x   = m_dense_nodes.x();
+                            const int32_t* y   = m_dense_nodes.y();
+                            for (size_t n=0; n < m_dense_nodes.size(); ++n) {
+                                this->call_node_location_on_handler(ids[n], Osmium::OSM::Position(x[n], y[n]));
+                            }
+                            break;
+                        }
+                        default:
+                            pbf_group.skip();
                     }
-
-                    this->call_relation_on_handler();
                 }
             }
 
-            // empty specialization to optimize the case where the node() method on the handler is empty
-            void parse_dense_node_group(const OSMPBF::PrimitiveGroup& /*group*/, const OSMPBF::StringTable& /*stringtable*/,
-                                        void (Osmium::Handler::Base::*)(const shared_ptr<Osmium::OSM::Node const>&) const) {
+            /**
+            * Decode a Node message and add the node to m_node_batch.
+            */
+            void parse_node(Osmium::Protobuf::Message pbf_node, const PBFPrimitiveBlock& block) {
+                Osmium::OSM::Node& node = m_node_batch.add();
+
+                Osmium::Protobuf::PackedVarints keys;
+                Osmium::Protobuf::PackedVarints vals;
+                int64_t lat = 0;
+                int64_t lon = 0;
+
+                while (pbf_node.next()) {
+                    switch (pbf_node.tag()) {
+                        case 1:
+                            node.id(pbf_node.get_sint64());
+                            break;
+                        case 2:
+                            keys = pbf_node.get_packed();
+                            break;
+                        case 3:
+                            vals = pbf_node.get_packed();
+                            break;
+                        case 4:
+                            parse_info(pbf_node.get_message(), block, node);
+                            break;
+                        case 8:
+                            lat = pbf_node.get_sint64();
+                            break;
+                        case 9:
+                            lon = pbf_node.get_sint64();
+                            break;
+                        default:
+                            pbf_node.skip();
+                    }
+                }
+
+                parse_tags(node.tags(), keys, vals, block);
+
+                node.position(Osmium::OSM::Position(
+                                  (lon * m_granularity + m_lon_offset) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision),
+                                  (lat * m_granularity + m_lat_offset) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision)));
             }
 
-            template <typename T>
-            void parse_dense_node_group(const OSMPBF::PrimitiveGroup& group, const OSMPBF::StringTable& stringtable, T) {
-                int64_t last_dense_id        = 0;
-                int64_t last_dense_latitude  = 0;
-                int64_t last_dense_longitude = 0;
+            /**
+            * Decode a DenseNodes message and add the nodes to m_node_batch.
+            */
+            void parse_dense_nodes(Osmium::Protobuf::Message dense, const PBFPrimitiveBlock& block) {
+                m_dense_nodes.decode(dense, block);
+
+                const bool has_denseinfo = m_dense_nodes.has_denseinfo();
+                Osmium::Protobuf::PackedVarints versions   = m_dense_nodes.versions();
+                Osmium::Protobuf::PackedVarints timestamps = m_dense_nodes.timestamps();
+                Osmium::Protobuf::PackedVarints changesets = m_dense_nodes.changesets();
+                Osmium::Protobuf::PackedVarints uids       = m_dense_nodes.uids();
+                Osmium::Protobuf::PackedVarints user_sids  = m_dense_nodes.user_sids();
+                Osmium::Protobuf::PackedVarints visibles   = m_dense_nodes.visibles();
+                Osmium::Protobuf::PackedVarints keys_vals  = m_dense_nodes.keys_vals();
+
+                const bool has_visible = !visibles.empty();
+
                 int64_t last_dense_uid       = 0;
                 int64_t last_dense_user_sid  = 0;
                 int64_t last_dense_changeset = 0;
                 int64_t last_dense_timestamp = 0;
-                int     last_dense_tag       = 0;
 
-                const OSMPBF::DenseNodes& dense = group.dense();
-                int max_entity = dense.id_size();
-                for (int entity=0; entity < max_entity; ++entity) {
-                    Osmium::OSM::Node& node = this->prepare_node();
+                const int64_t* ids = m_dense_nodes.ids();
+                const int32_t* x   = m_dense_nodes.x();
+                const int32_t* y   = m_dense_nodes.y();
+
+                for (size_t n=0; n < m_dense_nodes.size(); ++n) {
+                    Osmium::OSM::Node& node = m_node_batch.add();
 
-                    last_dense_id += dense.id(entity);
-                    node.id(last_dense_id);
+                    node.id(ids[n]);
+                    node.position(Osmium::OSM::Position(x[n], y[n]));
 
-                    if (dense.has_denseinfo()) {
-                        last_dense_changeset += dense.denseinfo().changeset(entity);
-                        last_dense_timestamp += dense.denseinfo().timestamp(entity);
-                        last_dense_uid       += dense.denseinfo().uid(entity);
-                        last_dense_user_sid  += dense.denseinfo().user_sid(entity);
+                    if (has_denseinfo) {
+                        last_dense_changeset += changesets.next_sint64();
+                        last_dense_timestamp += timestamps.next_sint64();
+                        last_dense_uid       += uids.next_sint32();
+                        last_dense_user_sid  += user_sids.next_sint32();
 
-                        node.version(dense.denseinfo().version(entity));
+                        node.version(versions.next_int32());
                         node.changeset(last_dense_changeset);
                         node.timestamp(last_dense_timestamp * m_date_factor);
                         node.uid(last_dense_uid);
-                        node.user(stringtable.s(last_dense_user_sid).data());
+                        node.user_borrowed(block.s(static_cast<uint32_t>(last_dense_user_sid)));
 
-                        if (dense.denseinfo().visible_size() > 0) {
-                            node.visible(dense.denseinfo().visible(entity));
+                        if (has_visible) {
+                            node.visible(visibles.next_bool());
                         }
                     }
 
-                    last_dense_latitude  += dense.lat(entity);
-                    last_dense_longitude += dense.lon(entity);
-                    node.position(Osmium::OSM::Position(
-                                      (last_dense_longitude * m_pbf_primitive_block.granularity() + m_pbf_primitive_block.lon_offset()) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision),
-                                      (last_dense_latitude  * m_pbf_primitive_block.granularity() + m_pbf_primitive_block.lat_offset()) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision)));
-
-                    while (last_dense_tag < dense.keys_vals_size()) {
-                        int tag_key_pos = dense.keys_vals(last_dense_tag);
+                    while (!keys_vals.empty()) {
+                        const uint32_t tag_key_pos = keys_vals.next_uint32();
 
                         if (tag_key_pos == 0) {
-                            last_dense_tag++;
                             break;
                         }
 
                         Osmium::OSM::TagList& tags = node.tags();
-                        tags.add(stringtable.s(tag_key_pos).data(),
-                                 stringtable.s(dense.keys_vals(last_dense_tag+1)).data());
+                        const char* key = block.s(tag_key_pos);
+                        tags.add_borrowed(key, block.s(keys_vals.next_uint32()));
+                    }
+                }
+            }
+
+            // empty specialization to optimize the case where the way() and ways() methods on the handler are empty
+            void parse_way_group(const PBFPrimitiveBlock::data_t& /*group*/, const PBFPrimitiveBlock& /*block*/,
+                                 void (Osmium::Handler::Base::*)(const shared_ptr<Osmium::OSM::Way const>&) const,
+                                 void (Osmium::Handler::Base::*)(const Osmium::OSM::WayBatch&) const) {
+            }
 
-                        last_dense_tag += 2;
+            template <typename T1, typename T2>
+            void parse_way_group(const PBFPrimitiveBlock::data_t& group, const PBFPrimitiveBlock& block, T1, T2) {
+                m_way_batch.clear();
+                Osmium::Protobuf::Message pbf_group(group.first, group.second);
+                while (pbf_group.next()) {
+                    if (pbf_group.tag() != 3) {
+                        pbf_group.skip();
+                        continue;
                     }
 
-                    this->call_node_on_handler();
+                    Osmium::OSM::Way& way = m_way_batch.add();
+
+                    Osmium::Protobuf::Message pbf_way = pbf_group.get_message();
+                    Osmium::Protobuf::PackedVarints keys;
+                    Osmium::Protobuf::PackedVarints vals;
+                    Osmium::Protobuf::PackedVarints refs;
+                    Osmium::Protobuf::PackedVarints lats;
+                    Osmium::Protobuf::PackedVarints lons;
+
+                    while (pbf_way.next()) {
+                        switch (pbf_way.tag()) {
+                            case 1:
+                                way.id(pbf_way.get_int64());
+                                break;
+                            case 2:
+                                keys = pbf_way.get_packed();
+                                break;
+                            case 3:
+                                vals = pbf_way.get_packed();
+                                break;
+                            case 4:
+                                parse_info(pbf_way.get_message(), block, way);
+                                break;
+                            case 8:
+                                refs = pbf_way.get_packed();
+                                break;
+                            case 9:
+                                lats = pbf_way.get_packed();
+                                break;
+                            case 10:
+                                lons = pbf_way.get_packed();
+                                break;
+                            default:
+                                pbf_way.skip();
+                        }
+                    }
+
+                    parse_tags(way.tags(), keys, vals, block);
+
+                    uint64_t ref = 0;
+                    if (lats.empty() || lons.empty()) {
+                        while (!refs.empty()) {
+                            ref += refs.next_sint64();
+                            way.add_node(ref);
+                        }
+                    } else {
+                        // node locations written by Output::PBF::locations_on_ways(),
+                        // locations outside the valid range mark way nodes without
+                        // a position
+                        int64_t lat = 0;
+                        int64_t lon = 0;
+                        while (!refs.empty()) {
+                            ref += refs.next_sint64();
+                            if (!lats.empty() && !lons.empty()) {
+                                lat += lats.next_sint64();
+                                lon += lons.next_sint64();
+                                const int64_t x = (lon * m_granularity + m_lon_offset) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision);
+                                const int64_t y = (lat * m_granularity + m_lat_offset) / (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision);
+                                if (x >= -180LL * Osmium::OSM::coordinate_precision && x <= 180LL * Osmium::OSM::coordinate_precision &&
+                                    y >=  -90LL * Osmium::OSM::coordinate_precision && y <=  90LL * Osmium::OSM::coordinate_precision) {
+                                    way.nodes().add(Osmium::OSM::WayNode(ref, Osmium::OSM::Position(x, y)));
+                                    continue;
+                                }
+                            }
+                            way.add_node(ref);
+                        }
+                    }
                 }
+                this->call_ways_on_handler(m_way_batch);
+            }
+
+            // empty specialization to optimize the case where the relation() and relations() methods on the handler are empty
+            void parse_relation_group(const PBFPrimitiveBlock::data_t& /*group*/, const PBFPrimitiveBlock& /*block*/,
+                                      void (Osmium::Handler::Base::*)(const shared_ptr<Osmium::OSM::Relation const>&) const,
+                                      void (Osmium::Handler::Base::*)(const Osmium::OSM::RelationBatch&) const) {
+            }
+
+            template <typename T1, typename T2>
+            void parse_relation_group(const PBFPrimitiveBlock::data_t& group, const PBFPrimitiveBlock& block, T1, T2) {
+                m_relation_batch.clear();
+                Osmium::Protobuf::Message pbf_group(group.first, group.second);
+                while (pbf_group.next()) {
+                    if (pbf_group.tag() != 4) {
+                        pbf_group.skip();
+                        continue;
+                    }
+
+                    Osmium::OSM::Relation& relation = m_relation_batch.add();
+
+                    Osmium::Protobuf::Message pbf_relation = pbf_group.get_message();
+                    Osmium::Protobuf::PackedVarints keys;
+                    Osmium::Protobuf::PackedVarints vals;
+                    Osmium::Protobuf::PackedVarints roles_sid;
+                    Osmium::Protobuf::PackedVarints memids;
+                    Osmium::Protobuf::PackedVarints types;
+
+                    while (pbf_relation.next()) {
+                        switch (pbf_relation.tag()) {
+                            case 1:
+                                relation.id(pbf_relation.get_int64());
+                                break;
+                            case 2:
+                                keys = pbf_relation.get_packed();
+                                break;
+                            case 3:
+                                vals = pbf_relation.get_packed();
+                                break;
+                            case 4:
+                                parse_info(pbf_relation.get_message(), block, relation);
+                                break;
+                            case 8:
+                                roles_sid = pbf_relation.get_packed();
+                                break;
+                            case 9:
+                                memids = pbf_relation.get_packed();
+                                break;
+                            case 10:
+                                types = pbf_relation.get_packed();
+                                break;
+                            default:
+                                pbf_relation.skip();
+                        }
+                    }
+
+                    parse_tags(relation.tags(), keys, vals, block);
+
+                    uint64_t ref = 0;
+                    while (!types.empty()) {
+                        char type = 'x';
+                        switch (types.next_int32()) {
+                            case OSMPBF::Relation::NODE:
+                                type = 'n';
+                                break;
+                            case OSMPBF::Relation::WAY:
+                                type = 'w';
+                                break;
+                            case OSMPBF::Relation::RELATION:
+                                type = 'r';
+                                break;
+                        }
+                        ref += memids.next_sint64();
+                        relation.add_member(type, ref, block.s(roles_sid.next_uint32()));
+                    }
+                }
+                this->call_relations_on_handler(m_relation_batch);
             }
 
             /**
             * Convert 4 bytes from network byte order.
             */
-            int convert_from_network_byte_order(unsigned char data[4]) {
+            int convert_from_network_byte_order(const unsigned char data[4]) {
                 return (data[0] << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
             }
 
             /**
-            * Read blob header by first reading the size and then the header
+            * Read exactly size bytes from the input into buffer.
             *
-            * @returns false for EOF, true otherwise
+            * @returns false if EOF was reached before anything was read, true otherwise
+            * @throws std::runtime_error if EOF was reached in the middle of the data or on read error
             */
-            bool read_blob_header() {
-                unsigned char size_in_network_byte_order[4];
+            bool read_exactly(char* buffer, const int size) {
                 int offset = 0;
-                while (offset < static_cast<int>(sizeof(size_in_network_byte_order))) {
-                    int nread = ::read(this->fd(), size_in_network_byte_order + offset, sizeof(size_in_network_byte_order) - offset);
+                while (offset < size) {
+                    int nread = ::read(this->fd(), buffer + offset, size - offset);
                     if (nread < 0) {
                         throw std::runtime_error("read error");
                     } else if (nread == 0) {
-                        return false; // EOF
+                        if (offset == 0) {
+                            return false; // EOF
+                        }
+                        throw std::runtime_error("unexpected EOF");
                     }
                     offset += nread;
                 }
+                m_input_offset += size;
+                return true;
+            }
 
-                const int size = convert_from_network_byte_order(size_in_network_byte_order);
-                if (size > OSMPBF::max_blob_header_size || size < 0) {
-                    std::ostringstream errmsg;
-                    errmsg << "BlobHeader size invalid:" << size;
-                    throw std::runtime_error(errmsg.str());
+            /**
+            * Move to the given offset in the input file.
+            *
+            * @throws std::runtime_error if the input is not seekable
+            */
+            void seek(uint64_t offset) {
+                if (offset == m_input_offset) {
+                    return;
                 }
-
-                offset = 0;
-                while (offset < size) {
-                    int nread = ::read(this->fd(), m_input_buffer + offset, size - offset);
-                    if (nread < 1) {
-                        throw std::runtime_error("failed to read BlobHeader");
+                if (this->file().mapped_data()) {
+                    if (offset > this->file().mapped_size()) {
+                        throw std::runtime_error("seek beyond end of file");
                     }
-                    offset += nread;
+                } else if (::lseek(this->fd(), offset, SEEK_SET) == static_cast<off_t>(-1)) {
+                    throw std::runtime_error("seek failed");
                 }
+                m_input_offset = offset;
+            }
 
-                if (!m_pbf_blob_header.ParseFromArray(m_input_buffer, size)) {
-                    throw std::runtime_error("failed to parse BlobHeader");
+            /**
+            * If an index is used, move to the next blob in the index the
+            * handler needs.
+            *
+            * @returns false if there is no further blob needed, true otherwise
+            */
+            bool seek_to_next_needed_blob() {
+                if (m_index.empty()) {
+                    return true;
                 }
+                const PBFIndex::entries_t& entries = m_index.entries();
+                while (m_index_pos < entries.size() && !entries[m_index_pos].needed_for(m_object_types)) {
+                    ++m_index_pos;
+                }
+                if (m_index_pos == entries.size()) {
+                    return false;
+                }
+                seek(entries[m_index_pos++].offset);
                 return true;
             }
 
             /**
-            * Read a (possibly compressed) blob of data. If the blob is compressed, it is uncompressed.
+            * Get the next size bytes of the input. If the input file is
+            * memory mapped, this returns a pointer into the mapping and
+            * the buffer is not used. Otherwise the data is read into the
+            * buffer, which must be large enough.
+            *
+            * @returns Pointer to the data or NULL if EOF was reached before anything was read
+            * @throws std::runtime_error if EOF was reached in the middle of the data or on read error
+            */
+            const char* next_input(char* buffer, const int size) {
+                const char* mapped_data = this->file().mapped_data();
+                if (mapped_data) {
+                    const size_t available = this->file().mapped_size() - m_input_offset;
+                    if (available == 0 && size > 0) {
+                        return NULL; // EOF
+                    }
+                    if (available < static_cast<size_t>(size)) {
+                        throw std::runtime_error("unexpected EOF");
+                    }
+                    const char* data = mapped_data + m_input_offset;
+                    m_input_offset += size;
+                    return data;
+                }
+                return read_exactly(buffer, size) ? buffer : NULL;
+            }
+
+            /**
+            * Read blob header by first reading the size and then the header.
+            * The BlobHeader message is parsed by hand, only its type and
+            * datasize fields are used.
+            *
+            * @returns false for EOF, true otherwise
             */
-            array_t read_blob(const int size) {
-                if (size < 0 || size > OSMPBF::max_uncompressed_blob_size) {
+            bool read_blob_header(std::string& type, int32_t& datasize) {
+                char size_buffer[4];
+                const char* size_in_network_byte_order = next_input(size_buffer, sizeof(size_buffer));
+                if (!size_in_network_byte_order) {
+                    return false; // EOF
+                }
+
+                const int size = convert_from_network_byte_order(reinterpret_cast<const unsigned char*>(size_in_network_byte_order));
+                if (size > OSMPBF::max_blob_header_size || size < 0) {
                     std::ostringstream errmsg;
-                    errmsg << "invalid blob size: " << size;
+                    errmsg << "BlobHeader size invalid:" << size;
                     throw std::runtime_error(errmsg.str());
                 }
-                int offset = 0;
-                while (offset < size) {
-                    int nread = ::read(this->fd(), m_input_buffer + offset, size - offset);
-                    if (nread < 1) {
-                        throw std::runtime_error("failed to read blob");
+
+                char buffer[OSMPBF::max_blob_header_size];
+                const char* data = next_input(buffer, size);
+                if (size > 0 && !data) {
+                    throw std::runtime_error("failed to read BlobHeader");
+                }
+
+                bool has_type = false;
+                bool has_datasize = false;
+                Osmium::Protobuf::Message blob_header(data, size);
+                while (blob_header.next()) {
+                    switch (blob_header.tag()) {
+                        case 1:
+                            type = blob_header.get_string();
+                            has_type = true;
+                            break;
+                        case 3:
+                            datasize = blob_header.get_int32();
+                            has_datasize = true;
+                            break;
+                        default:
+                            blob_header.skip();
                     }
-                    offset += nread;
                 }
-                if (!m_pbf_blob.ParseFromArray(m_input_buffer, size)) {
-                    throw std::runtime_error("failed to parse blob");
+                if (!has_type || !has_datasize) {
+                    throw std::runtime_error("failed to parse BlobHeader");
                 }
+                return true;
+            }
 
-                if (m_pbf_blob.has_raw()) {
-                    return array_t(m_pbf_blob.raw().data(), m_pbf_blob.raw().size());
-                } else if (m_pbf_blob.has_zlib_data()) {
-                    unsigned long raw_size = m_pbf_blob.raw_size();
-                    assert(raw_size <= static_cast<unsigned long>(OSMPBF::max_uncompressed_blob_size));
-                    if (uncompress(m_unpack_buffer, &raw_size, reinterpret_cast<const unsigned char*>(m_pbf_blob.zlib_data().data()), m_pbf_blob.zlib_data().size()) != Z_OK || m_pbf_blob.raw_size() != static_cast<long>(raw_size)) {
-                        throw std::runtime_error("zlib error");
+            /**
+            * Read the next OSMHeader or OSMData blob from the file. Blobs
+            * of unknown type are skipped. The blob is not decoded yet.
+            *
+            * If the input file is memory mapped, the blob will point into
+            * the mapping instead of getting a copy of the data.
+            *
+            * @returns The blob or an empty pointer on EOF.
+            */
+            blob_ptr_t read_blob() {
+                std::string type;
+                int32_t size = 0;
+                while (seek_to_next_needed_blob()) {
+                    const uint64_t offset = m_input_offset;
+                    if (!read_blob_header(type, size)) {
+                        break; // EOF
+                    }
+
+                    if (size < 0 || size > OSMPBF::max_uncompressed_blob_size) {
+                        std::ostringstream errmsg;
+                        errmsg << "invalid blob size: " << size;
+                        throw std::runtime_error(errmsg.str());
+                    }
+
+                    blob_ptr_t blob;
+                    if (type == "OSMData") {
+                        blob = make_shared<PBFBlob>(PBFBlob::data_blob, offset);
+                    } else if (type == "OSMHeader") {
+                        blob = make_shared<PBFBlob>(PBFBlob::header_blob, offset);
+                    }
+
+                    if (this->file().mapped_data()) {
+                        this->file().advise_will_need(m_input_offset, size);
+                        const char* data = next_input(NULL, size);
+                        if (size > 0 && !data) {
+                            throw std::runtime_error("failed to read blob");
+                        }
+                        if (blob) {
+                            blob->data(data, size);
+                        }
+                    } else if (blob) {
+                        if (size > 0 && !read_exactly(blob->allocate(size), size)) {
+                            throw std::runtime_error("failed to read blob");
+                        }
+                    } else {
+                        // ignore unknown blob type, but we still have to read it
+                        std::string buffer(size, '\0');
+                        if (size > 0 && !read_exactly(&buffer[0], size)) {
+                            throw std::runtime_error("failed to read blob");
+                        }
+                    }
+
+                    if (blob) {
+                        blob->length(m_input_offset - offset);
+                        return blob;
                     }
-                    return array_t(m_unpack_buffer, raw_size);
-                } else if (m_pbf_blob.has_lzma_data()) {
-                    throw std::runtime_error("lzma blobs not implemented");
-                } else {
-                    throw std::runtime_error("Blob contains no data");
                 }
+                return blob_ptr_t();
             }
 
         }; // class PBF
@@ -0,0 +1,270 @@
+#ifndef OSMIUM_INPUT_PBF_DENSE_NODES_HPP
+#define OSMIUM_INPUT_PBF_DENSE_NODES_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstddef>
+#include <vector>
+
+#include <osmpbf/osmpbf.h>
+
+#include <osmium/osm/position.hpp>
+#include <osmium/input/pbf_primitive_block.hpp>
+#include <osmium/utils/protobuf.hpp>
+
+namespace Osmium {
+
+    namespace Input {
+
+        /**
+         * Columnar decoder for the DenseNodes message in a PBF file.
+         *
+         * The IDs and coordinates of all nodes in the message are decoded
+         * in one go into the arrays ids(), x(), and y(). The coordinates
+         * are already converted to the fixed point format of
+         * Osmium::OSM::Position. For the usual granularity of 100
+         * nanodegrees without offsets this needs no arithmetic at all.
+         *
+         * The other fields (DenseInfo and tags) are only located. Use
+         * the PackedVarints returned by versions(), keys_vals(), etc.
+         * to read them node by node.
+         *
+         * The memory for the arrays is kept and reused for the next
+         * message.
+         */
+        class PBFDenseNodes {
+
+        public:
+
+            PBFDenseNodes() :
+                m_ids(),
+                m_lats(),
+                m_lons(),
+                m_x(),
+                m_y(),
+                m_size(0),
+                m_has_denseinfo(false),
+                m_versions(),
+                m_timestamps(),
+                m_changesets(),
+                m_uids(),
+                m_user_sids(),
+                m_visibles(),
+                m_keys_vals() {
+            }
+
+            /**
+             * Decode a DenseNodes message.
+             *
+             * @throws Osmium::Protobuf::ParseError if the data is invalid.
+             */
+            void decode(Osmium::Protobuf::Message dense, const PBFPrimitiveBlock& block) {
+                Osmium::Protobuf::PackedVarints ids;
+                Osmium::Protobuf::PackedVarints lats;
+                Osmium::Protobuf::PackedVarints lons;
+                m_has_denseinfo = false;
+                m_versions   = Osmium::Protobuf::PackedVarints();
+                m_timestamps = Osmium::Protobuf::PackedVarints();
+                m_changesets = Osmium::Protobuf::PackedVarints();
+                m_uids       = Osmium::Protobuf::PackedVarints();
+                m_user_sids  = Osmium::Protobuf::PackedVarints();
+                m_visibles   = Osmium::Protobuf::PackedVarints();
+                m_keys_vals  = Osmium::Protobuf::PackedVarints();
+
+                while (dense.next()) {
+                    switch (dense.tag()) {
+                        case 1:
+                            ids = dense.get_packed();
+                            break;
+                        case 5:
+                            m_has_denseinfo = true;
+                            decode_denseinfo(dense.get_message());
+                            break;
+                        case 8:
+                            lats = dense.get_packed();
+                            break;
+                        case 9:
+                            lons = dense.get_packed();
+                            break;
+                        case 10:
+                            m_keys_vals = dense.get_packed();
+                            break;
+                        default:
+                            dense.skip();
+                    }
+                }
+
+                reserve(m_ids, ids.max_count());
+                reserve(m_lats, lats.max_count());
+                reserve(m_lons, lons.max_count());
+
+                m_size = ids.decode_delta_sint64(&m_ids[0]);
+                if (lats.decode_delta_sint64(&m_lats[0]) < m_size || lons.decode_delta_sint64(&m_lons[0]) < m_size) {
+                    throw Osmium::Protobuf::ParseError("packed field has too few values");
+                }
+
+                reserve(m_x, m_size);
+                reserve(m_y, m_size);
+                convert_coordinates(block);
+            }
+
+            /// Number of nodes in the message.
+            size_t size() const {
+                return m_size;
+            }
+
+            bool empty() const {
+                return m_size == 0;
+            }
+
+            const int64_t* ids() const {
+                return &m_ids[0];
+            }
+
+            const int32_t* x() const {
+                return &m_x[0];
+            }
+
+            const int32_t* y() const {
+                return &m_y[0];
+            }
+
+            Osmium::OSM::Position position(size_t n) const {
+                return Osmium::OSM::Position(m_x[n], m_y[n]);
+            }
+
+            bool has_denseinfo() const {
+                return m_has_denseinfo;
+            }
+
+            Osmium::Protobuf::PackedVarints versions() const {
+                return m_versions;
+            }
+
+            Osmium::Protobuf::PackedVarints timestamps() const {
+                return m_timestamps;
+            }
+
+            Osmium::Protobuf::PackedVarints changesets() const {
+                return m_changesets;
+            }
+
+            Osmium::Protobuf::PackedVarints uids() const {
+                return m_uids;
+            }
+
+            Osmium::Protobuf::PackedVarints user_sids() const {
+                return m_user_sids;
+            }
+
+            Osmium::Protobuf::PackedVarints visibles() const {
+                return m_visibles;
+            }
+
+            Osmium::Protobuf::PackedVarints keys_vals() const {
+                return m_keys_vals;
+            }
+
+        private:
+
+            std::vector<int64_t> m_ids;
+            std::vector<int64_t> m_lats;
+            std::vector<int64_t> m_lons;
+            std::vector<int32_t> m_x;
+            std::vector<int32_t> m_y;
+            size_t m_size;
+
+            bool m_has_denseinfo;
+            Osmium::Protobuf::PackedVarints m_versions;
+            Osmium::Protobuf::PackedVarints m_timestamps;
+            Osmium::Protobuf::PackedVarints m_changesets;
+            Osmium::Protobuf::PackedVarints m_uids;
+            Osmium::Protobuf::PackedVarints m_user_sids;
+            Osmium::Protobuf::PackedVarints m_visibles;
+            Osmium::Protobuf::PackedVarints m_keys_vals;
+
+            /**
+             * Make sure the vector has space for at least size elements
+             * (and at least one, so that &v[0] is always valid). It is
+             * never shrunk, so after a few messages this does nothing.
+             */
+            template <typename T>
+            static void reserve(std::vector<T>& v, size_t size) {
+                if (v.size() < size || v.empty()) {
+                    v.resize(size + 1);
+                }
+            }
+
+            void decode_denseinfo(Osmium::Protobuf::Message denseinfo) {
+                while (denseinfo.next()) {
+                    switch (denseinfo.tag()) {
+                        case 1:
+                            m_versions = denseinfo.get_packed();
+                            break;
+                        case 2:
+                            m_timestamps = denseinfo.get_packed();
+                            break;
+                        case 3:
+                            m_changesets = denseinfo.get_packed();
+                            break;
+                        case 4:
+                            m_uids = denseinfo.get_packed();
+                            break;
+                        case 5:
+                            m_user_sids = denseinfo.get_packed();
+                            break;
+                        case 6:
+                            m_visibles = denseinfo.get_packed();
+                            break;
+                        default:
+                            denseinfo.skip();
+                    }
+                }
+            }
+
+            void convert_coordinates(const PBFPrimitiveBlock& block) {
+                const int64_t resolution_convert = OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision;
+                const int64_t granularity = block.granularity();
+                const int64_t lat_offset  = block.lat_offset();
+                const int64_t lon_offset  = block.lon_offset();
+
+                if (granularity == resolution_convert && lat_offset == 0 && lon_offset == 0) {
+                    // the coordinates are already in the format we need
+                    for (size_t n=0; n < m_size; ++n) {
+                        m_x[n] = static_cast<int32_t>(m_lons[n]);
+                        m_y[n] = static_cast<int32_t>(m_lats[n]);
+                    }
+                } else {
+                    for (size_t n=0; n < m_size; ++n) {
+                        m_x[n] = static_cast<int32_t>((m_lons[n] * granularity + lon_offset) / resolution_convert);
+                        m_y[n] = static_cast<int32_t>((m_lats[n] * granularity + lat_offset) / resolution_convert);
+                    }
+                }
+            }
+
+        }; // class PBFDenseNodes
+
+    } // namespace Input
+
+} // namespace Osmium
+
+#endif // OSMIUM_INPUT_PBF_DENSE_NODES_HPP
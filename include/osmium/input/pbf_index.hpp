@@ -0,0 +1,293 @@
+#ifndef OSMIUM_INPUT_PBF_INDEX_HPP
+#define OSMIUM_INPUT_PBF_INDEX_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+
+#include <osmium/osm/types.hpp>
+#include <osmium/osmfile.hpp>
+
+namespace Osmium {
+
+    namespace Input {
+
+        /**
+         * Index of the blobs in a PBF file. For every blob it contains the
+         * offset and length in the file, the types of objects in it, and
+         * the range of their IDs. Input::PBF uses the index to skip over
+         * blobs with objects the handler doesn't need without reading and
+         * decoding them.
+         *
+         * The index is stored in a sidecar file next to the PBF file (see
+         * index_filename()). It remembers size and modification time of
+         * the PBF file, an index for a changed PBF file is not loaded.
+         */
+        class PBFIndex {
+
+        public:
+
+            /**
+             * Flag in Entry::types marking the OSMHeader blob.
+             */
+            static const uint32_t header_flag = 0x80000000;
+
+            struct Entry {
+
+                /// Offset of the blob in the file (pointing to the size of the BlobHeader).
+                uint64_t offset;
+
+                /// Length of the blob in the file including the BlobHeader.
+                uint32_t length;
+
+                /// Types of objects in the blob (osm_object_type_mask_t) or header_flag.
+                uint32_t types;
+
+                /// Smallest object ID in the blob.
+                osm_object_id_t min_id;
+
+                /// Largest object ID in the blob.
+                osm_object_id_t max_id;
+
+                Entry(uint64_t o=0, uint32_t l=0, uint32_t t=0, osm_object_id_t min=0, osm_object_id_t max=0) :
+                    offset(o),
+                    length(l),
+                    types(t),
+                    min_id(min),
+                    max_id(max) {
+                }
+
+                bool is_header() const {
+                    return types & header_flag;
+                }
+
+                /**
+                 * Record that the blob contains an object of the given
+                 * type (as osm_object_type_mask_t) and ID.
+                 */
+                void add_object(uint32_t type_mask, osm_object_id_t id) {
+                    if (types & ALL_OBJECTS_MASK) {
+                        if (id < min_id) {
+                            min_id = id;
+                        }
+                        if (id > max_id) {
+                            max_id = id;
+                        }
+                    } else {
+                        min_id = id;
+                        max_id = id;
+                    }
+                    types |= type_mask;
+                }
+
+                /**
+                 * Does this blob have to be read if only objects of
+                 * the types in the mask are needed? Header blobs always
+                 * have to be read.
+                 */
+                bool needed_for(uint32_t mask) const {
+                    return is_header() || (types & mask);
+                }
+
+            }; // struct Entry
+
+            typedef std::vector<Entry> entries_t;
+
+            PBFIndex() :
+                m_entries() {
+            }
+
+            /**
+             * Name of the index file for the given PBF file.
+             */
+            static std::string index_filename(const std::string& pbf_filename) {
+                return pbf_filename + ".idx";
+            }
+
+            const entries_t& entries() const {
+                return m_entries;
+            }
+
+            bool empty() const {
+                return m_entries.empty();
+            }
+
+            void clear() {
+                m_entries.clear();
+            }
+
+            void add(const Entry& entry) {
+                m_entries.push_back(entry);
+            }
+
+            /**
+             * Load the index for the given PBF file from its index file.
+             *
+             * @returns false if there is no index file or if it doesn't
+             *          match the PBF file, true otherwise.
+             */
+            bool load(const std::string& pbf_filename) {
+                clear();
+
+                struct stat pbf_stat;
+                if (pbf_filename == "" || ::stat(pbf_filename.c_str(), &pbf_stat) != 0) {
+                    return false;
+                }
+
+                int fd = ::open(index_filename(pbf_filename).c_str(), O_RDONLY);
+                if (fd < 0) {
+                    return false;
+                }
+
+                std::string data;
+                char buffer[64 * 1024];
+                int nread;
+                while ((nread = ::read(fd, buffer, sizeof(buffer))) > 0) {
+                    data.append(buffer, nread);
+                }
+                ::close(fd);
+                if (nread < 0 || data.size() < header_size || data.compare(0, magic_size, magic(), magic_size) != 0) {
+                    return false;
+                }
+
+                const char* p = data.data() + magic_size;
+                if (get_uint64(p) != static_cast<uint64_t>(pbf_stat.st_size) || get_uint64(p) != static_cast<uint64_t>(pbf_stat.st_mtime)) {
+                    return false;
+                }
+                const uint64_t count = get_uint64(p);
+                if ((data.size() - header_size) / entry_size != count || (data.size() - header_size) % entry_size != 0) {
+                    return false;
+                }
+
+                m_entries.reserve(count);
+                for (uint64_t i=0; i < count; ++i) {
+                    Entry entry;
+                    entry.offset = get_uint64(p);
+                    entry.length = get_uint32(p);
+                    entry.types  = get_uint32(p);
+                    entry.min_id = get_uint64(p);
+                    entry.max_id = get_uint64(p);
+                    m_entries.push_back(entry);
+                }
+                return true;
+            }
+
+            /**
+             * Save the index for the given PBF file to its index file.
+             *
+             * @throws Osmium::OSMFile::IOError if the file can't be written.
+             */
+            void save(const std::string& pbf_filename) const {
+                struct stat pbf_stat;
+                if (::stat(pbf_filename.c_str(), &pbf_stat) != 0) {
+                    throw Osmium::OSMFile::IOError("Can't stat PBF file", pbf_filename, errno);
+                }
+
+                std::string data(magic(), magic_size);
+                append_uint64(data, pbf_stat.st_size);
+                append_uint64(data, pbf_stat.st_mtime);
+                append_uint64(data, m_entries.size());
+                for (entries_t::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+                    append_uint64(data, it->offset);
+                    append_uint32(data, it->length);
+                    append_uint32(data, it->types);
+                    append_uint64(data, it->min_id);
+                    append_uint64(data, it->max_id);
+                }
+
+                const std::string filename = index_filename(pbf_filename);
+                int fd = ::open(filename.c_str(), O_WRONLY | O_TRUNC | O_CREAT, 0666);
+                if (fd < 0) {
+                    throw Osmium::OSMFile::IOError("Open failed", filename, errno);
+                }
+                size_t offset = 0;
+                while (offset < data.size()) {
+                    const ssize_t nwrite = ::write(fd, data.data() + offset, data.size() - offset);
+                    if (nwrite < 0) {
+                        const int e = errno;
+                        ::close(fd);
+                        throw Osmium::OSMFile::IOError("Write failed", filename, e);
+                    }
+                    offset += nwrite;
+                }
+                ::close(fd);
+            }
+
+        private:
+
+            static const size_t magic_size = 8;
+            static const size_t header_size = magic_size + 3 * 8;
+            static const size_t entry_size = 8 + 4 + 4 + 8 + 8;
+
+            entries_t m_entries;
+
+            /**
+             * The index file starts with these magic bytes.
+             */
+            static const char* magic() {
+                return "OSMPBFI1";
+            }
+
+            // all numbers in the index file are stored in little endian byte order
+
+            static void append_uint32(std::string& data, uint32_t value) {
+                for (int i=0; i < 4; ++i) {
+                    data += static_cast<char>((value >> (8 * i)) & 0xff);
+                }
+            }
+
+            static void append_uint64(std::string& data, uint64_t value) {
+                for (int i=0; i < 8; ++i) {
+                    data += static_cast<char>((value >> (8 * i)) & 0xff);
+                }
+            }
+
+            static uint32_t get_uint32(const char*& p) {
+                uint32_t value = 0;
+                for (int i=0; i < 4; ++i) {
+                    value |= static_cast<uint32_t>(static_cast<unsigned char>(*p++)) << (8 * i);
+                }
+                return value;
+            }
+
+            static uint64_t get_uint64(const char*& p) {
+                uint64_t value = 0;
+                for (int i=0; i < 8; ++i) {
+                    value |= static_cast<uint64_t>(static_cast<unsigned char>(*p++)) << (8 * i);
+                }
+                return value;
+            }
+
+        }; // class PBFIndex
+
+    } // namespace Input
+
+} // namespace Osmium
+
+#endif // OSMIUM_INPUT_PBF_INDEX_HPP
@@ -0,0 +1,249 @@
+#ifndef OSMIUM_INPUT_PBF_PRIMITIVE_BLOCK_HPP
+#define OSMIUM_INPUT_PBF_PRIMITIVE_BLOCK_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <osmium/osm/types.hpp>
+#include <osmium/utils/protobuf.hpp>
+
+namespace Osmium {
+
+    namespace Input {
+
+        /**
+         * Lazily decoded PrimitiveBlock of a PBF file.
+         *
+         * Only the top level of the message is decoded: The block settings
+         * (granularity, offsets) are read and the string table and the
+         * PrimitiveGroups are located. The groups are decoded later with
+         * Osmium::Protobuf::Message directly from the buffer when the
+         * objects in them are needed.
+         *
+         * Strings in the string table are not copied. Instead each one is
+         * NUL-terminated in place by overwriting the byte after it, which
+         * is always the (already decoded) key of the next field or the end
+         * of the buffer. So the buffer must be writable and have one byte
+         * of space after the data. Everything points into the buffer, so
+         * it has to live as long as the block is used.
+         */
+        class PBFPrimitiveBlock {
+
+        public:
+
+            /// Pointer and size of some data inside the buffer.
+            typedef std::pair<const char*, size_t> data_t;
+
+            PBFPrimitiveBlock() :
+                m_stringtable(),
+                m_strings(),
+                m_groups(),
+                m_granularity(100),
+                m_date_granularity(1000),
+                m_lat_offset(0),
+                m_lon_offset(0) {
+            }
+
+            /**
+             * Decode the top level of the PrimitiveBlock in the given
+             * buffer. The string table is not decoded yet, call
+             * decode_stringtable() for that.
+             *
+             * @param data Buffer with the PrimitiveBlock. data[size] must be writable.
+             * @param size Size of the PrimitiveBlock.
+             * @throws Osmium::Protobuf::ParseError if the data is invalid.
+             */
+            void decode(char* data, size_t size) {
+                m_stringtable.clear();
+                m_strings.clear();
+                m_groups.clear();
+                m_granularity = 100;
+                m_date_granularity = 1000;
+                m_lat_offset = 0;
+                m_lon_offset = 0;
+
+                Osmium::Protobuf::Message block(data, size);
+                while (block.next()) {
+                    switch (block.tag()) {
+                        case 1: // stringtable
+                            m_stringtable.push_back(block.get_data());
+                            break;
+                        case 2: // primitivegroup
+                            m_groups.push_back(block.get_data());
+                            break;
+                        case 17:
+                            m_granularity = block.get_int32();
+                            break;
+                        case 18:
+                            m_date_granularity = block.get_int32();
+                            break;
+                        case 19:
+                            m_lat_offset = block.get_int64();
+                            break;
+                        case 20:
+                            m_lon_offset = block.get_int64();
+                            break;
+                        default:
+                            block.skip();
+                    }
+                }
+                if (m_granularity <= 0) {
+                    throw Osmium::Protobuf::ParseError("invalid granularity");
+                }
+            }
+
+            /**
+             * Decode the string table and NUL-terminate all strings in it.
+             * This must be called after decode() and before any strings
+             * are accessed.
+             */
+            void decode_stringtable() {
+                for (std::vector<data_t>::const_iterator it = m_stringtable.begin(); it != m_stringtable.end(); ++it) {
+                    Osmium::Protobuf::Message stringtable(it->first, it->second);
+                    while (stringtable.next()) {
+                        if (stringtable.tag() == 1) {
+                            m_strings.push_back(stringtable.get_data());
+                        } else {
+                            stringtable.skip();
+                        }
+                    }
+                }
+
+                // Only now that all keys have been read, can they be
+                // overwritten. The pointers point into the buffer given
+                // to decode(), which is writable.
+                for (std::vector<data_t>::const_iterator it = m_strings.begin(); it != m_strings.end(); ++it) {
+                    const_cast<char*>(it->first)[it->second] = '\0';
+                }
+            }
+
+            /**
+             * Get a string from the string table.
+             *
+             * @returns Pointer to NUL-terminated string.
+             * @throws std::runtime_error if there is no string with this index.
+             */
+            const char* s(uint32_t index) const {
+                return string(index).first;
+            }
+
+            /**
+             * Get a string from the string table as pointer and size.
+             *
+             * @throws std::runtime_error if there is no string with this index.
+             */
+            const data_t& string(uint32_t index) const {
+                if (index >= m_strings.size()) {
+                    std::ostringstream errmsg;
+                    errmsg << "string table index out of range: " << index;
+                    throw std::runtime_error(errmsg.str());
+                }
+                return m_strings[index];
+            }
+
+            size_t stringtable_size() const {
+                return m_strings.size();
+            }
+
+            /**
+             * The encoded PrimitiveGroups in this block.
+             */
+            const std::vector<data_t>& groups() const {
+                return m_groups;
+            }
+
+            int32_t granularity() const {
+                return m_granularity;
+            }
+
+            int32_t date_granularity() const {
+                return m_date_granularity;
+            }
+
+            int64_t lat_offset() const {
+                return m_lat_offset;
+            }
+
+            int64_t lon_offset() const {
+                return m_lon_offset;
+            }
+
+            /**
+             * Find out which type of objects an encoded PrimitiveGroup
+             * contains. A group only contains objects of one type, so only
+             * its first field has to be looked at.
+             *
+             * @returns NODE_MASK, WAY_MASK, RELATION_MASK, or 0 if the group is empty or contains something else.
+             */
+            static uint32_t group_type(const data_t& group) {
+                Osmium::Protobuf::Message message(group.first, group.second);
+                if (message.next()) {
+                    switch (message.tag()) {
+                        case 1: // nodes
+                        case 2: // dense
+                            return NODE_MASK;
+                        case 3: // ways
+                            return WAY_MASK;
+                        case 4: // relations
+                            return RELATION_MASK;
+                    }
+                }
+                return 0;
+            }
+
+            /**
+             * Types of objects in all groups of this block.
+             */
+            uint32_t group_types() const {
+                uint32_t types = 0;
+                for (std::vector<data_t>::const_iterator it = m_groups.begin(); it != m_groups.end(); ++it) {
+                    types |= group_type(*it);
+                }
+                return types;
+            }
+
+        private:
+
+            /// The StringTable messages (there is usually only one).
+            std::vector<data_t> m_stringtable;
+
+            /// The strings in the string table.
+            std::vector<data_t> m_strings;
+
+            std::vector<data_t> m_groups;
+
+            int32_t m_granularity;
+            int32_t m_date_granularity;
+            int64_t m_lat_offset;
+            int64_t m_lon_offset;
+
+        }; // class PBFPrimitiveBlock
+
+    } // namespace Input
+
+} // namespace Osmium
+
+#endif // OSMIUM_INPUT_PBF_PRIMITIVE_BLOCK_HPP
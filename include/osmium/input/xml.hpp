@@ -22,8 +22,7 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 
 */
 
-#define OSMIUM_LINK_WITH_LIBS_EXPAT -lexpat
-
+#include <cassert>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -31,90 +30,189 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <expat.h>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/ref.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 #include <osmium/input.hpp>
+#include <osmium/input/xml_scanner.hpp>
+#include <osmium/osm/batch.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/thread/queue.hpp>
 
 namespace Osmium {
 
     namespace Input {
 
         /**
-        * Class for parsing OSM XML files.
-        *
-        * Generally you are not supposed to instantiate this class yourself.
-        * Use the Osmium::Input::read() function instead.
-        *
-        * @tparam THandler A handler class (subclass of Osmium::Handler::Base).
-        */
-        template <class THandler>
-        class XML : public Base<THandler> {
+         * Builds OSM objects from the elements returned by an XMLScanner.
+         *
+         * Element and attribute names are dispatched on their length and
+         * first character and the values of the common attributes are
+         * parsed by hand. Derived classes decide where the objects go by
+         * implementing the begin_*() and end_*() methods.
+         *
+         * The parser either starts at the beginning of a document or, if
+         * it is parsing a fragment, in the middle of a document between
+         * two objects (see XMLChunk).
+         */
+        class XMLObjectParser : boost::noncopyable {
 
         public:
 
+            virtual ~XMLObjectParser() {
+            }
+
             /**
-            * Instantiate XML Parser.
-            *
-            * @param file OSMFile instance.
-            * @param handler Instance of THandler.
-            */
-            XML(const Osmium::OSMFile& file, THandler& handler) :
-                Base<THandler>(file, handler),
+             * Parse a decimal integer. Anything but an optional minus sign
+             * followed by digits is handed to atoll().
+             */
+            static int64_t parse_integer(const char* value) {
+                const char* p = value;
+                const bool negative = (*p == '-');
+                if (negative) {
+                    ++p;
+                }
+                int64_t result = 0;
+                const char* digits = p;
+                while (*p >= '0' && *p <= '9' && p - digits < 18) {
+                    result = result * 10 + (*p - '0');
+                    ++p;
+                }
+                if (*p || p == digits) {
+                    return atoll(value);
+                }
+                return negative ? -result : result;
+            }
+
+            /**
+             * Parse a coordinate in decimal notation into the fixed point
+             * format used by Position. The value is rounded to the
+             * precision of the fixed point format. Anything but an optional
+             * minus sign, digits and a decimal point is handed to atof().
+             */
+            static int32_t parse_coordinate(const char* value) {
+                const char* p = value;
+                const bool negative = (*p == '-');
+                if (negative) {
+                    ++p;
+                }
+                int64_t result = 0;
+                const char* digits = p;
+                while (*p >= '0' && *p <= '9' && p - digits < 4) {
+                    result = result * 10 + (*p - '0');
+                    ++p;
+                }
+                int scale = Osmium::OSM::coordinate_precision;
+                if (*p == '.') {
+                    ++p;
+                    for (; *p >= '0' && *p <= '9' && scale > 1; ++p) {
+                        result = result * 10 + (*p - '0');
+                        scale /= 10;
+                    }
+                    if (*p >= '5' && *p <= '9') {
+                        ++result;
+                    }
+                    while (*p >= '0' && *p <= '9') {
+                        ++p;
+                    }
+                }
+                if (*p || p == digits) {
+                    return Osmium::OSM::Position().lon(atof(value)).x();
+                }
+                result *= scale;
+                return static_cast<int32_t>(negative ? -result : result);
+            }
+
+        protected:
+
+            /**
+             * The sections of change files. Objects in delete sections are
+             * marked as not visible.
+             */
+            enum section_t {
+                section_unknown, ///< in a fragment before the first section tag
+                section_other,
+                section_delete
+            };
+
+            XMLObjectParser(bool fragment) :
                 m_current_object(NULL),
-                m_context(context_root),
-                m_last_context(context_root),
-                m_in_delete_section(false) {
+                m_current_way(NULL),
+                m_current_relation(NULL),
+                m_context(fragment ? context_top : context_root),
+                m_last_context(m_context),
+                m_ignored_depth(0),
+                m_section(fragment ? section_unknown : section_other) {
             }
 
-            void parse() {
-                XML_Parser parser = XML_ParserCreate(0);
-                if (!parser) {
-                    throw std::runtime_error("Error creating parser");
+            /**
+             * Parse all elements the scanner returns.
+             */
+            void parse_elements(XMLScanner& scanner) {
+                XMLScanner::event_t event;
+                while ((event = scanner.next()) != XMLScanner::end_of_document) {
+                    if (event == XMLScanner::start_element) {
+                        start_element(scanner);
+                    } else {
+                        end_element(scanner);
+                    }
                 }
+            }
 
-                XML_SetUserData(parser, this);
+            section_t section() const {
+                return m_section;
+            }
 
-                XML_SetElementHandler(parser, Osmium::Input::XML<THandler>::start_element_wrapper, Osmium::Input::XML<THandler>::end_element_wrapper);
+            /**
+             * Continue parsing in the middle of a document between two
+             * objects, after the part before was parsed elsewhere.
+             *
+             * @param in_delete_section Does the part before end in a delete section?
+             */
+            void continue_fragment(bool in_delete_section) {
+                m_context = context_top;
+                m_last_context = context_top;
+                m_ignored_depth = 0;
+                m_section = in_delete_section ? section_delete : section_other;
+            }
 
-                try {
-                    int done;
-                    do {
-                        void* buffer = XML_GetBuffer(parser, c_buffer_size);
-                        if (buffer == 0) {
-                            throw std::runtime_error("out of memory");
-                        }
+            /*
+               The begin_*() methods return a new object which is then
+               filled by the parser. The end_*() methods are called when
+               the object is complete.
+            */
+            virtual Osmium::OSM::Node& begin_node() = 0;
+            virtual Osmium::OSM::Way& begin_way() = 0;
+            virtual Osmium::OSM::Relation& begin_relation() = 0;
 
-                        int result = ::read(this->fd(), buffer, c_buffer_size);
-                        if (result < 0) {
-                            throw std::runtime_error("read error");
-                        }
-                        done = (result == 0);
-                        if (XML_ParseBuffer(parser, result, done) == XML_STATUS_ERROR) {
-                            XML_Error errorCode = XML_GetErrorCode(parser);
-                            long errorLine = XML_GetCurrentLineNumber(parser);
-                            long errorCol = XML_GetCurrentColumnNumber(parser);
-                            const XML_LChar* errorString = XML_ErrorString(errorCode);
-
-                            std::stringstream errorDesc;
-                            errorDesc << "XML parsing error at line " << errorLine << ":" << errorCol;
-                            errorDesc << ": " << errorString;
-                            throw std::runtime_error(errorDesc.str());
-                        }
-                    } while (!done);
-                    XML_ParserFree(parser);
+            virtual void end_node() = 0;
+            virtual void end_way() = 0;
+            virtual void end_relation() = 0;
 
-                    this->call_after_and_before_on_handler(UNKNOWN);
-                } catch (Osmium::Handler::StopReading) {
-                    // if a handler says to stop reading, we do
-                }
-                this->call_final_on_handler();
+            /**
+             * Meta data from the root element and the bounds element.
+             */
+            virtual Osmium::OSM::Meta& document_meta() = 0;
+
+            /**
+             * Called for objects without visible attribute found in a
+             * fragment before the first section tag. Whether they are in
+             * a delete section is only known after the fragments before
+             * were parsed.
+             */
+            virtual void object_in_unknown_section(Osmium::OSM::Object& /*object*/) {
             }
 
         private:
 
-            static const int c_buffer_size = 10240;
-
             Osmium::OSM::Object* m_current_object;
+            Osmium::OSM::Way* m_current_way;
+            Osmium::OSM::Relation* m_current_relation;
 
             enum context_t {
                 context_root,
@@ -128,188 +226,926 @@ namespace Osmium {
             context_t m_context;
             context_t m_last_context;
 
+            /**
+             * Number of open elements inside a tag, way node, or member.
+             * They are ignored. This only happens in documents that are
+             * not OSM files or in chunks cut at the wrong place.
+             */
+            int m_ignored_depth;
+
             /**
              * This is used only for change files which contain create, modify,
              * and delete sections.
              */
-            bool m_in_delete_section;
+            section_t m_section;
+
+            enum element_t {
+                element_other,
+                element_osm,
+                element_bounds,
+                element_node,
+                element_way,
+                element_relation,
+                element_tag,
+                element_nd,
+                element_member,
+                element_create,
+                element_modify,
+                element_delete
+            };
 
-            static void XMLCALL start_element_wrapper(void* data, const XML_Char* element, const XML_Char** attrs) {
-                static_cast<Osmium::Input::XML<THandler> *>(data)->start_element(element, attrs);
+            enum attribute_t {
+                attribute_other,
+                attribute_id,
+                attribute_version,
+                attribute_changeset,
+                attribute_timestamp,
+                attribute_uid,
+                attribute_user,
+                attribute_visible,
+                attribute_lat,
+                attribute_lon,
+                attribute_k,
+                attribute_v,
+                attribute_ref,
+                attribute_type,
+                attribute_role
+            };
+
+            static bool equal(const char* name, size_t length, const char* expected) {
+                return !std::memcmp(name, expected, length);
             }
 
-            static void XMLCALL end_element_wrapper(void* data, const XML_Char* element) {
-                static_cast<Osmium::Input::XML<THandler> *>(data)->end_element(element);
+            /**
+             * Look up element name. The length together with the first
+             * character identifies the name, the rest is only compared to
+             * make sure.
+             */
+            static element_t lookup_element(const XMLScanner& scanner) {
+                const char* name = scanner.name();
+                const size_t length = scanner.name_length();
+                switch (length) {
+                    case 2:
+                        return equal(name, length, "nd") ? element_nd : element_other;
+                    case 3:
+                        switch (name[0]) {
+                            case 't': return equal(name, length, "tag") ? element_tag : element_other;
+                            case 'w': return equal(name, length, "way") ? element_way : element_other;
+                            case 'o': return equal(name, length, "osm") ? element_osm : element_other;
+                        }
+                        break;
+                    case 4:
+                        return equal(name, length, "node") ? element_node : element_other;
+                    case 6:
+                        switch (name[0]) {
+                            case 'm': return equal(name, length, "member") ? element_member : (equal(name, length, "modify") ? element_modify : element_other);
+                            case 'b': return equal(name, length, "bounds") ? element_bounds : element_other;
+                            case 'c': return equal(name, length, "create") ? element_create : element_other;
+                            case 'd': return equal(name, length, "delete") ? element_delete : element_other;
+                        }
+                        break;
+                    case 8:
+                        return equal(name, length, "relation") ? element_relation : element_other;
+                    case 9:
+                        return equal(name, length, "osmChange") ? element_osm : element_other;
+                }
+                return element_other;
             }
 
-            void init_object(Osmium::OSM::Object& obj, const XML_Char** attrs) {
-                if (m_in_delete_section) {
+            /**
+             * Look up attribute name. Works like lookup_element().
+             */
+            static attribute_t lookup_attribute(const XMLScanner::Attribute& attr) {
+                const char* name = attr.name;
+                const size_t length = attr.name_length;
+                switch (length) {
+                    case 1:
+                        switch (name[0]) {
+                            case 'k': return attribute_k;
+                            case 'v': return attribute_v;
+                        }
+                        break;
+                    case 2:
+                        return equal(name, length, "id") ? attribute_id : attribute_other;
+                    case 3:
+                        switch (name[0]) {
+                            case 'l': return equal(name, length, "lat") ? attribute_lat : (equal(name, length, "lon") ? attribute_lon : attribute_other);
+                            case 'u': return equal(name, length, "uid") ? attribute_uid : attribute_other;
+                            case 'r': return equal(name, length, "ref") ? attribute_ref : attribute_other;
+                        }
+                        break;
+                    case 4:
+                        switch (name[0]) {
+                            case 'u': return equal(name, length, "user") ? attribute_user : attribute_other;
+                            case 't': return equal(name, length, "type") ? attribute_type : attribute_other;
+                            case 'r': return equal(name, length, "role") ? attribute_role : attribute_other;
+                        }
+                        break;
+                    case 7:
+                        switch (name[1]) {
+                            case 'e': return equal(name, length, "version") ? attribute_version : attribute_other;
+                            case 'i': return equal(name, length, "visible") ? attribute_visible : attribute_other;
+                        }
+                        break;
+                    case 9:
+                        switch (name[0]) {
+                            case 'c': return equal(name, length, "changeset") ? attribute_changeset : attribute_other;
+                            case 't': return equal(name, length, "timestamp") ? attribute_timestamp : attribute_other;
+                        }
+                        break;
+                }
+                return attribute_other;
+            }
+
+            /**
+             * Set the attributes of a new object. node is the same object
+             * as obj if it is a node, NULL otherwise.
+             */
+            void init_object(Osmium::OSM::Object& obj, Osmium::OSM::Node* node, const XMLScanner& scanner) {
+                if (m_section == section_delete) {
                     obj.visible(false);
                 }
                 m_current_object = &obj;
-                for (int count = 0; attrs[count]; count += 2) {
-                    if (!strcmp(attrs[count], "lon")) {
-                        if (this->m_node) {
-                            this->m_node->lon(atof(attrs[count+1]));
-                        }
-                    } else if (!strcmp(attrs[count], "lat")) {
-                        if (this->m_node) {
-                            this->m_node->lat(atof(attrs[count+1]));
-                        }
-                    } else {
-                        m_current_object->set_attribute(attrs[count], attrs[count+1]);
+                bool has_visible = false;
+                int32_t x = Osmium::OSM::Position::invalid;
+                int32_t y = Osmium::OSM::Position::invalid;
+                for (size_t count = 0; count < scanner.attribute_count(); ++count) {
+                    const XMLScanner::Attribute& attr = scanner.attribute(count);
+                    switch (lookup_attribute(attr)) {
+                        case attribute_id:
+                            obj.id(parse_integer(attr.value));
+                            break;
+                        case attribute_version:
+                            obj.version(parse_integer(attr.value));
+                            break;
+                        case attribute_changeset:
+                            obj.changeset(parse_integer(attr.value));
+                            break;
+                        case attribute_timestamp:
+                            obj.timestamp(attr.value);
+                            break;
+                        case attribute_uid:
+                            obj.uid(parse_integer(attr.value));
+                            break;
+                        case attribute_user:
+                            obj.user(attr.value);
+                            break;
+                        case attribute_visible:
+                            obj.visible(attr.value);
+                            has_visible = true;
+                            break;
+                        case attribute_lon:
+                            x = parse_coordinate(attr.value);
+                            break;
+                        case attribute_lat:
+                            y = parse_coordinate(attr.value);
+                            break;
+                        default:
+                            break;
                     }
                 }
+                if (node) {
+                    node->position(Osmium::OSM::Position(x, y));
+                }
+                if (m_section == section_unknown && !has_visible) {
+                    object_in_unknown_section(obj);
+                }
             }
 
-            void check_tag(const XML_Char* element, const XML_Char** attrs) {
-                if (!strcmp(element, "tag")) {
+            void check_tag(const XMLScanner& scanner) {
+                if (lookup_element(scanner) == element_tag) {
                     const char* key = "";
                     const char* value = "";
-                    for (int count = 0; attrs[count]; count += 2) {
-                        if (attrs[count][0] == 'k' && attrs[count][1] == 0) {
-                            key = attrs[count+1];
-                        }
-                        if (attrs[count][0] == 'v' && attrs[count][1] == 0) {
-                            value = attrs[count+1];
+                    for (size_t count = 0; count < scanner.attribute_count(); ++count) {
+                        const XMLScanner::Attribute& attr = scanner.attribute(count);
+                        switch (lookup_attribute(attr)) {
+                            case attribute_k:
+                                key = attr.value;
+                                break;
+                            case attribute_v:
+                                value = attr.value;
+                                break;
+                            default:
+                                break;
                         }
                     }
                     m_current_object->tags().add(key, value);
                 }
             }
 
-            void start_element(const XML_Char* element, const XML_Char** attrs) {
+            void start_element(const XMLScanner& scanner) {
                 switch (m_context) {
                     case context_root:
-                        if (!strcmp(element, "osm") || !strcmp(element, "osmChange")) {
-                            for (int count = 0; attrs[count]; count += 2) {
-                                if (!strcmp(attrs[count], "version")) {
-                                    if (strcmp(attrs[count+1], "0.6")) {
+                        if (lookup_element(scanner) == element_osm) {
+                            for (size_t count = 0; count < scanner.attribute_count(); ++count) {
+                                const XMLScanner::Attribute& attr = scanner.attribute(count);
+                                if (attr.name_length == 7 && equal(attr.name, 7, "version")) {
+                                    if (strcmp(attr.value, "0.6")) {
                                         throw std::runtime_error("can only read version 0.6 files");
                                     }
-                                } else if (!strcmp(attrs[count], "generator")) {
-                                    this->meta().generator(attrs[count+1]);
+                                } else if (attr.name_length == 9 && equal(attr.name, 9, "generator")) {
+                                    document_meta().generator(attr.value);
                                 }
                             }
                         }
                         m_context = context_top;
                         break;
                     case context_top:
-                        if (!strcmp(element, "node")) {
-                            this->call_after_and_before_on_handler(NODE);
-                            init_object(this->prepare_node(), attrs);
-                            m_context = context_node;
-                        } else if (!strcmp(element, "way")) {
-                            this->call_after_and_before_on_handler(WAY);
-                            init_object(this->prepare_way(), attrs);
-                            m_context = context_way;
-                        } else if (!strcmp(element, "relation")) {
-                            this->call_after_and_before_on_handler(RELATION);
-                            init_object(this->prepare_relation(), attrs);
-                            m_context = context_relation;
-                        } else if (!strcmp(element, "bounds")) {
-                            Osmium::OSM::Position min;
-                            Osmium::OSM::Position max;
-                            for (int count = 0; attrs[count]; count += 2) {
-                                if (!strcmp(attrs[count], "minlon")) {
-                                    min.lon(atof(attrs[count+1]));
-                                } else if (!strcmp(attrs[count], "minlat")) {
-                                    min.lat(atof(attrs[count+1]));
-                                } else if (!strcmp(attrs[count], "maxlon")) {
-                                    max.lon(atof(attrs[count+1]));
-                                } else if (!strcmp(attrs[count], "maxlat")) {
-                                    max.lat(atof(attrs[count+1]));
+                        switch (lookup_element(scanner)) {
+                            case element_node: {
+                                Osmium::OSM::Node& node = begin_node();
+                                m_context = context_node;
+                                init_object(node, &node, scanner);
+                                break;
+                            }
+                            case element_way:
+                                m_current_way = &begin_way();
+                                m_context = context_way;
+                                init_object(*m_current_way, NULL, scanner);
+                                break;
+                            case element_relation:
+                                m_current_relation = &begin_relation();
+                                m_context = context_relation;
+                                init_object(*m_current_relation, NULL, scanner);
+                                break;
+                            case element_bounds: {
+                                Osmium::OSM::Position min;
+                                Osmium::OSM::Position max;
+                                for (size_t count = 0; count < scanner.attribute_count(); ++count) {
+                                    const XMLScanner::Attribute& attr = scanner.attribute(count);
+                                    if (attr.name_length != 6 || attr.name[0] != 'm') {
+                                        continue;
+                                    }
+                                    if (equal(attr.name, 6, "minlon")) {
+                                        min.lon(atof(attr.value));
+                                    } else if (equal(attr.name, 6, "minlat")) {
+                                        min.lat(atof(attr.value));
+                                    } else if (equal(attr.name, 6, "maxlon")) {
+                                        max.lon(atof(attr.value));
+                                    } else if (equal(attr.name, 6, "maxlat")) {
+                                        max.lat(atof(attr.value));
+                                    }
                                 }
+                                document_meta().bounds().extend(min).extend(max);
+                                break;
                             }
-                            this->meta().bounds().extend(min).extend(max);
-                        } else if (!strcmp(element, "delete")) {
-                            m_in_delete_section = true;
+                            case element_create:
+                            case element_modify:
+                                m_section = section_other;
+                                break;
+                            case element_delete:
+                                m_section = section_delete;
+                                break;
+                            default:
+                                break;
                         }
                         break;
                     case context_node:
                         m_last_context = context_node;
                         m_context = context_in_object;
-                        check_tag(element, attrs);
+                        check_tag(scanner);
                         break;
                     case context_way:
                         m_last_context = context_way;
                         m_context = context_in_object;
-                        if (!strcmp(element, "nd")) {
-                            for (int count = 0; attrs[count]; count += 2) {
-                                if (!strcmp(attrs[count], "ref")) {
-                                    this->m_way->add_node(Osmium::string_to_osm_object_id_t(attrs[count+1]));
+                        if (lookup_element(scanner) == element_nd) {
+                            for (size_t count = 0; count < scanner.attribute_count(); ++count) {
+                                const XMLScanner::Attribute& attr = scanner.attribute(count);
+                                if (lookup_attribute(attr) == attribute_ref) {
+                                    m_current_way->add_node(parse_integer(attr.value));
                                 }
                             }
                         } else {
-                            check_tag(element, attrs);
+                            check_tag(scanner);
                         }
                         break;
                     case context_relation:
                         m_last_context = context_relation;
                         m_context = context_in_object;
-                        if (!strcmp(element, "member")) {
+                        if (lookup_element(scanner) == element_member) {
                             char        type = 'x';
                             uint64_t    ref  = 0;
                             const char* role = "";
-                            for (int count = 0; attrs[count]; count += 2) {
-                                if (!strcmp(attrs[count], "type")) {
-                                    type = static_cast<char>(attrs[count+1][0]);
-                                } else if (!strcmp(attrs[count], "ref")) {
-                                    ref = Osmium::string_to_osm_object_id_t(attrs[count+1]);
-                                } else if (!strcmp(attrs[count], "role")) {
-                                    role = static_cast<const char*>(attrs[count+1]);
+                            for (size_t count = 0; count < scanner.attribute_count(); ++count) {
+                                const XMLScanner::Attribute& attr = scanner.attribute(count);
+                                switch (lookup_attribute(attr)) {
+                                    case attribute_type:
+                                        type = attr.value[0];
+                                        break;
+                                    case attribute_ref:
+                                        ref = parse_integer(attr.value);
+                                        break;
+                                    case attribute_role:
+                                        role = attr.value;
+                                        break;
+                                    default:
+                                        break;
                                 }
                             }
                             // XXX assert type, ref, role are set
-                            if (m_current_object && this->m_relation) {
-                                this->m_relation->add_member(type, ref, role);
-                            }
+                            m_current_relation->add_member(type, ref, role);
                         } else {
-                            check_tag(element, attrs);
+                            check_tag(scanner);
                         }
                         break;
                     case context_in_object:
-                        // fallthrough
+                        ++m_ignored_depth;
+                        break;
                     default:
                         assert(false); // should never be here
                 }
             }
 
-            void end_element(const XML_Char* element) {
+            void end_element(const XMLScanner& scanner) {
                 switch (m_context) {
                     case context_root:
-                        assert(false); // should never be here
+                        // only happens in fragments of documents that are
+                        // not well-formed, the error is reported later
                         break;
                     case context_top:
-                        if (!strcmp(element, "osm") || !strcmp(element, "osmChange")) {
-                            m_context = context_root;
-                        } else if (!strcmp(element, "delete")) {
-                            m_in_delete_section = false;
+                        switch (lookup_element(scanner)) {
+                            case element_osm:
+                                m_context = context_root;
+                                break;
+                            case element_create:
+                            case element_modify:
+                            case element_delete:
+                                m_section = section_other;
+                                break;
+                            default:
+                                break;
                         }
                         break;
                     case context_node:
-                        this->call_node_on_handler();
+                        end_node();
                         m_current_object = NULL;
                         m_context = context_top;
                         break;
                     case context_way:
-                        this->call_way_on_handler();
+                        end_way();
                         m_current_object = NULL;
+                        m_current_way = NULL;
                         m_context = context_top;
                         break;
                     case context_relation:
-                        this->call_relation_on_handler();
+                        end_relation();
                         m_current_object = NULL;
+                        m_current_relation = NULL;
                         m_context = context_top;
                         break;
                     case context_in_object:
-                        m_context = m_last_context;
+                        if (m_ignored_depth > 0) {
+                            --m_ignored_depth;
+                        } else {
+                            m_context = m_last_context;
+                        }
                         break;
                     default:
                         assert(false); // should never be here
                 }
             }
 
+        }; // class XMLObjectParser
+
+        /**
+         * A part of an XML file parsed by a worker thread. Chunks start at
+         * the beginning of the file or at the start tag of a node, way, or
+         * relation. The objects are collected in batches, a new batch is
+         * started whenever the object type changes.
+         */
+        class XMLChunk : public XMLObjectParser {
+
+        public:
+
+            /**
+             * Objects of one type in a row.
+             */
+            struct Run {
+
+                osm_object_type_t type;
+
+                /// Only the batch for type is set.
+                shared_ptr<Osmium::OSM::NodeBatch>     nodes;
+                shared_ptr<Osmium::OSM::WayBatch>      ways;
+                shared_ptr<Osmium::OSM::RelationBatch> relations;
+
+            };
+
+            /**
+             * @param document Start of the whole document in memory.
+             * @param begin Start of the chunk.
+             * @param end End of the chunk.
+             */
+            XMLChunk(const char* document, const char* begin, const char* end) :
+                XMLObjectParser(begin != document),
+                m_document(document),
+                m_begin(begin),
+                m_end(end),
+                m_meta(),
+                m_runs(),
+                m_unknown_section_objects(),
+                m_depth_change(0),
+                m_seen_element(false),
+                m_error(),
+                m_parse_error(false),
+                m_done(false),
+                m_mutex(),
+                m_decoded() {
+            }
+
+            /**
+             * Parse the chunk. This is called from a worker thread.
+             * Errors are remembered and thrown from wait().
+             */
+            void decode() {
+                std::string error;
+                bool parse_error = false;
+                try {
+                    XMLScanner scanner(m_document, m_begin, m_end);
+                    parse_elements(scanner);
+                    m_depth_change = scanner.depth_change();
+                    m_seen_element = scanner.seen_element();
+                } catch (XMLScanner::ParseError& e) {
+                    error = e.what();
+                    parse_error = true;
+                } catch (std::exception& e) {
+                    error = e.what();
+                }
+
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_error = error;
+                m_parse_error = parse_error;
+                m_done = true;
+                m_decoded.notify_all();
+            }
+
+            /**
+             * Mark the chunk as failed without parsing it.
+             */
+            void fail(const std::string& error) {
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_error = error;
+                m_done = true;
+                m_decoded.notify_all();
+            }
+
+            /**
+             * Wait until decode() has finished.
+             *
+             * @throws XMLScanner::ParseError if the chunk is not well-formed.
+             * @throws std::runtime_error for other errors.
+             */
+            void wait() {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_done) {
+                    m_decoded.wait(lock);
+                }
+                if (!m_error.empty()) {
+                    if (m_parse_error) {
+                        throw XMLScanner::ParseError(m_error);
+                    }
+                    throw std::runtime_error(m_error);
+                }
+            }
+
+            /// Is this the chunk at the beginning of the file?
+            bool first() const {
+                return m_begin == m_document;
+            }
+
+            /// Start of the chunk.
+            const char* begin() const {
+                return m_begin;
+            }
+
+            /**
+             * Meta data of the file. Only set in the first chunk.
+             */
+            const Osmium::OSM::Meta& meta() const {
+                return m_meta;
+            }
+
+            const std::vector<Run>& runs() const {
+                return m_runs;
+            }
+
+            /// See XMLScanner::depth_change().
+            long depth_change() const {
+                return m_depth_change;
+            }
+
+            /// Does the chunk contain a start tag?
+            bool seen_element() const {
+                return m_seen_element;
+            }
+
+            /**
+             * Mark the objects at the start of the chunk as not visible if
+             * the chunk starts inside a delete section of a change file.
+             *
+             * @param in_delete_section Does the chunk before end in a delete section?
+             * @returns Does this chunk end in a delete section?
+             */
+            bool resolve_delete_section(bool in_delete_section) {
+                if (in_delete_section) {
+                    for (std::vector<Osmium::OSM::Object*>::iterator it = m_unknown_section_objects.begin(); it != m_unknown_section_objects.end(); ++it) {
+                        (*it)->visible(false);
+                    }
+                }
+                return section() == section_unknown ? in_delete_section : section() == section_delete;
+            }
+
+        private:
+
+            const char* m_document;
+            const char* m_begin;
+            const char* m_end;
+
+            Osmium::OSM::Meta m_meta;
+
+            std::vector<Run> m_runs;
+
+            std::vector<Osmium::OSM::Object*> m_unknown_section_objects;
+
+            long m_depth_change;
+            bool m_seen_element;
+
+            std::string m_error;
+            bool m_parse_error;
+            bool m_done;
+            boost::mutex m_mutex;
+            boost::condition_variable m_decoded;
+
+            Run& run(osm_object_type_t type) {
+                if (m_runs.empty() || m_runs.back().type != type) {
+                    m_runs.push_back(Run());
+                    Run& run = m_runs.back();
+                    run.type = type;
+                    switch (type) {
+                        case NODE:
+                            run.nodes = make_shared<Osmium::OSM::NodeBatch>();
+                            break;
+                        case WAY:
+                            run.ways = make_shared<Osmium::OSM::WayBatch>();
+                            break;
+                        default:
+                            run.relations = make_shared<Osmium::OSM::RelationBatch>();
+                            break;
+                    }
+                }
+                return m_runs.back();
+            }
+
+            Osmium::OSM::Node& begin_node() {
+                return run(NODE).nodes->add();
+            }
+
+            Osmium::OSM::Way& begin_way() {
+                return run(WAY).ways->add();
+            }
+
+            Osmium::OSM::Relation& begin_relation() {
+                return run(RELATION).relations->add();
+            }
+
+            void end_node() {
+            }
+
+            void end_way() {
+            }
+
+            void end_relation() {
+            }
+
+            Osmium::OSM::Meta& document_meta() {
+                return m_meta;
+            }
+
+            void object_in_unknown_section(Osmium::OSM::Object& object) {
+                m_unknown_section_objects.push_back(&object);
+            }
+
+        }; // class XMLChunk
+
+        /**
+        * Class for parsing OSM XML files.
+        *
+        * The XML is read with the XMLScanner, which only understands the
+        * parts of XML used in OSM files.
+        *
+        * Memory mapped files (regular uncompressed files, see
+        * OSMFile::mapped_data()) are cut into chunks, which are parsed in
+        * parallel by worker threads. The chunks start at the start tag of
+        * a node, way, or relation. The objects of each chunk are handed to
+        * the handler in order like the blocks of a PBF file, so the
+        * handler can use the batch callbacks and after_block(). Other
+        * files are parsed in the thread calling parse().
+        *
+        * Chunks are cut where "<node", "<way", or "<relation" appears in
+        * the file. If this is inside a comment or CDATA section, the
+        * chunk before is not well-formed. The rest of the file from the
+        * start of that chunk is then parsed in the thread calling parse().
+        *
+        * Generally you are not supposed to instantiate this class yourself.
+        * Use the Osmium::Input::read() function instead. Instantiate it
+        * directly if you want to change the number of threads used:
+        *
+        * @code
+        * Osmium::Input::XML<MyHandler> input(file, handler);
+        * input.num_workers(8).chunk_size(16 * 1024 * 1024);
+        * input.parse();
+        * @endcode
+        *
+        * @tparam THandler A handler class (subclass of Osmium::Handler::Base).
+        */
+        template <class THandler>
+        class XML : public Base<THandler>, private XMLObjectParser {
+
+            typedef shared_ptr<XMLChunk> chunk_ptr_t;
+            typedef Osmium::Thread::Queue<chunk_ptr_t> chunk_queue_t;
+
+            /**
+             * Number of threads parsing chunks. If this is 0, the file is
+             * parsed in the thread calling parse().
+             */
+            int m_num_workers;
+
+            /**
+             * Maximum number of chunks cut from the file but not yet
+             * handed to the handler. This limits the memory use.
+             */
+            int m_max_chunks_in_flight;
+
+            /// Approximate size of the chunks in bytes.
+            size_t m_chunk_size;
+
+            /**
+             * Shuts down the chunk queue and waits for the thread cutting
+             * the chunks when parse() is left, regardless of how.
+             */
+            class ReaderGuard : boost::noncopyable {
+
+                chunk_queue_t& m_queue;
+                boost::thread& m_thread;
+
+            public:
+
+                ReaderGuard(chunk_queue_t& queue, boost::thread& thread) :
+                    m_queue(queue),
+                    m_thread(thread) {
+                }
+
+                ~ReaderGuard() {
+                    m_queue.shutdown();
+                    m_thread.join();
+                }
+
+            }; // class ReaderGuard
+
+        public:
+
+            /**
+            * Instantiate XML Parser.
+            *
+            * @param file OSMFile instance.
+            * @param handler Instance of THandler.
+            */
+            XML(const Osmium::OSMFile& file, THandler& handler) :
+                Base<THandler>(file, handler),
+                XMLObjectParser(false),
+                m_num_workers(Osmium::Thread::Pool::default_num_threads()),
+                m_max_chunks_in_flight(4 * m_num_workers),
+                m_chunk_size(4 * 1024 * 1024) {
+            }
+
+            int num_workers() const {
+                return m_num_workers;
+            }
+
+            /**
+             * Set the number of threads used for parsing chunks. Set to 0
+             * to parse everything in the thread calling parse(). Defaults
+             * to the number of hardware threads. Workers are only used
+             * for memory mapped files.
+             */
+            XML& num_workers(int num) {
+                m_num_workers = num < 0 ? 0 : num;
+                return *this;
+            }
+
+            int max_chunks_in_flight() const {
+                return m_max_chunks_in_flight;
+            }
+
+            /**
+             * Set the maximum number of chunks that are parsed ahead of
+             * the chunk currently handled. Defaults to 4 times the number
+             * of workers.
+             */
+            XML& max_chunks_in_flight(int num) {
+                m_max_chunks_in_flight = num < 1 ? 1 : num;
+                return *this;
+            }
+
+            size_t chunk_size() const {
+                return m_chunk_size;
+            }
+
+            /**
+             * Set the approximate size of the chunks in bytes. Defaults to
+             * 4 MB.
+             */
+            XML& chunk_size(size_t size) {
+                m_chunk_size = size < 1 ? 1 : size;
+                return *this;
+            }
+
+            void parse() {
+                try {
+                    if (m_num_workers > 0 && this->file().mapped_data()) {
+                        parse_with_workers();
+                    } else {
+                        XMLScanner scanner(this->file());
+                        parse_elements(scanner);
+                    }
+                    this->call_after_and_before_on_handler(UNKNOWN);
+                } catch (Osmium::Handler::StopReading) {
+                    // if a handler says to stop reading, we do
+                }
+                this->call_final_on_handler();
+            }
+
+        private:
+
+            Osmium::OSM::Node& begin_node() {
+                this->call_after_and_before_on_handler(NODE);
+                return this->prepare_node();
+            }
+
+            Osmium::OSM::Way& begin_way() {
+                this->call_after_and_before_on_handler(WAY);
+                return this->prepare_way();
+            }
+
+            Osmium::OSM::Relation& begin_relation() {
+                this->call_after_and_before_on_handler(RELATION);
+                return this->prepare_relation();
+            }
+
+            void end_node() {
+                this->call_node_on_handler();
+            }
+
+            void end_way() {
+                this->call_way_on_handler();
+            }
+
+            void end_relation() {
+                this->call_relation_on_handler();
+            }
+
+            Osmium::OSM::Meta& document_meta() {
+                return this->meta();
+            }
+
+            void parse_with_workers() {
+                Osmium::Thread::Pool pool(m_num_workers);
+                chunk_queue_t queue(m_max_chunks_in_flight);
+                boost::thread reader(boost::bind(&XML::read_chunks, this, boost::ref(queue), boost::ref(pool)));
+                ReaderGuard guard(queue, reader);
+
+                bool in_delete_section = false;
+                long depth = 0;
+                bool seen_element = false;
+
+                chunk_ptr_t chunk;
+                chunk_ptr_t failed_chunk;
+                while (queue.pop(chunk) && chunk) {
+                    try {
+                        chunk->wait();
+                    } catch (XMLScanner::ParseError&) {
+                        // The chunk might have been cut inside a comment
+                        // or CDATA section, parse the rest of the file
+                        // here.
+                        failed_chunk = chunk;
+                        break;
+                    }
+                    depth += chunk->depth_change();
+                    seen_element = seen_element || chunk->seen_element();
+                    in_delete_section = chunk->resolve_delete_section(in_delete_section);
+                    handle_chunk(*chunk);
+                }
+
+                if (failed_chunk) {
+                    if (failed_chunk->first()) {
+                        XMLScanner scanner(this->file().mapped_data(), this->file().mapped_size());
+                        parse_elements(scanner);
+                        return;
+                    }
+                    // All chunks before were well-formed, so this one
+                    // really starts at an object.
+                    XMLScanner scanner(this->file().mapped_data(), failed_chunk->begin(), this->file().mapped_data() + this->file().mapped_size());
+                    continue_fragment(in_delete_section);
+                    parse_elements(scanner);
+                    depth += scanner.depth_change();
+                    seen_element = seen_element || scanner.seen_element();
+                }
+
+                if (depth != 0 || !seen_element) {
+                    // The chunks are fine on their own, but they don't fit
+                    // together. Scan the whole file to find the error.
+                    XMLScanner scanner(this->file().mapped_data(), this->file().mapped_size());
+                    while (scanner.next() != XMLScanner::end_of_document) {
+                    }
+                }
+            }
+
+            /**
+             * This runs in the reader thread. It cuts the file into chunks
+             * and hands them to the worker pool for parsing and to the
+             * queue to keep their order. A NULL pointer in the queue marks
+             * the end of the file.
+             */
+            void read_chunks(chunk_queue_t& queue, Osmium::Thread::Pool& pool) {
+                try {
+                    const char* document = this->file().mapped_data();
+                    const char* end = document + this->file().mapped_size();
+                    for (const char* begin = document; begin != end; ) {
+                        const char* chunk_end = find_chunk_end(begin, end);
+                        chunk_ptr_t chunk = make_shared<XMLChunk>(document, begin, chunk_end);
+                        if (!queue.push(chunk)) {
+                            return; // queue was shut down, stop reading
+                        }
+                        pool.submit(boost::bind(&XMLChunk::decode, chunk));
+                        begin = chunk_end;
+                    }
+                } catch (std::exception& e) {
+                    chunk_ptr_t chunk = make_shared<XMLChunk>(static_cast<const char*>(NULL), static_cast<const char*>(NULL), static_cast<const char*>(NULL));
+                    chunk->fail(e.what());
+                    queue.push(chunk);
+                }
+                queue.push(chunk_ptr_t());
+            }
+
+            /**
+             * Does the start tag of a node, way, or relation start at p?
+             */
+            static bool is_object_start(const char* p, const char* end) {
+                const char* name = p + 1;
+                size_t length;
+                if (end - name > 4 && !std::memcmp(name, "node", 4)) {
+                    length = 4;
+                } else if (end - name > 3 && !std::memcmp(name, "way", 3)) {
+                    length = 3;
+                } else if (end - name > 8 && !std::memcmp(name, "relation", 8)) {
+                    length = 8;
+                } else {
+                    return false;
+                }
+                const char c = name[length];
+                return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '>' || c == '/';
+            }
+
+            /**
+             * Find the end of the chunk starting at begin. It ends at the
+             * first object start tag after m_chunk_size bytes.
+             */
+            const char* find_chunk_end(const char* begin, const char* end) const {
+                if (static_cast<size_t>(end - begin) <= m_chunk_size) {
+                    return end;
+                }
+                for (const char* p = begin + m_chunk_size; (p = static_cast<const char*>(std::memchr(p, '<', end - p))); ++p) {
+                    if (is_object_start(p, end)) {
+                        return p;
+                    }
+                }
+                return end;
+            }
+
+            void handle_chunk(XMLChunk& chunk) {
+                if (chunk.first()) {
+                    this->meta().generator(chunk.meta().generator());
+                    this->meta().bounds() = chunk.meta().bounds();
+                }
+                for (std::vector<XMLChunk::Run>::const_iterator it = chunk.runs().begin(); it != chunk.runs().end(); ++it) {
+                    this->call_after_and_before_on_handler(it->type);
+                    switch (it->type) {
+                        case NODE:
+                            this->call_nodes_on_handler(*it->nodes);
+                            break;
+                        case WAY:
+                            this->call_ways_on_handler(*it->ways);
+                            break;
+                        default:
+                            this->call_relations_on_handler(*it->relations);
+                            break;
+                    }
+                }
+                if (!chunk.runs().empty()) {
+                    this->call_after_block_on_handler();
+                }
+            }
+
         }; // class XML
 
     } // namespace Input
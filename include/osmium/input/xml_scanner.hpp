@@ -0,0 +1,807 @@
+#ifndef OSMIUM_INPUT_XML_SCANNER_HPP
+#define OSMIUM_INPUT_XML_SCANNER_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/utility.hpp>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#include <osmium/osmfile.hpp>
+
+namespace Osmium {
+
+    namespace Input {
+
+        /**
+         * Scanner for the subset of XML used in OSM files.
+         *
+         * This is a pull parser: next() returns the start and end tags of
+         * elements one after the other. Character data, comments,
+         * processing instructions and DOCTYPE declarations are skipped.
+         * There is no support for DTDs, so only the predefined entities
+         * and character references are decoded in attribute values.
+         * Encodings other than UTF-8 (and its ASCII subset) are not
+         * supported either.
+         *
+         * The scanner either works on a memory mapped file or reads the
+         * file into a large buffer. The delimiters are searched 16 bytes
+         * at a time if SSE2 is available. Attribute values are copied
+         * into a separate buffer and NUL-terminated; entities are only
+         * decoded if the value contains an '&'.
+         *
+         * Element names and attributes returned by the scanner are only
+         * valid until the next call to next().
+         *
+         * A scanner can also work on a fragment of a document, for
+         * instance some elements cut out of the middle of a file. It then
+         * accepts end tags of elements opened before the fragment and
+         * elements that are still open at its end.
+         */
+        class XMLScanner : boost::noncopyable {
+
+        public:
+
+            /**
+             * Exception thrown when the input is not well-formed.
+             */
+            class ParseError : public std::runtime_error {
+
+            public:
+
+                ParseError(const std::string& what) :
+                    std::runtime_error(what) {
+                }
+
+            };
+
+            struct Attribute {
+                const char* name;
+                size_t name_length;
+
+                /// NUL-terminated value with entities decoded
+                const char* value;
+                size_t value_length;
+            };
+
+            enum event_t {
+                start_element,
+                end_element,
+                end_of_document
+            };
+
+            /**
+             * Scan a complete document in memory.
+             */
+            XMLScanner(const char* data, size_t size) :
+                m_file(NULL),
+                m_buffer(),
+                m_begin(data),
+                m_data(data),
+                m_end(data + size),
+                m_eof(true),
+                m_line(1),
+                m_column(0),
+                m_name(NULL),
+                m_name_length(0),
+                m_attributes(),
+                m_attribute_count(0),
+                m_values(),
+                m_open_elements(),
+                m_depth(0),
+                m_unmatched_end_tags(0),
+                m_fragment(false),
+                m_seen_root(false),
+                m_pending_end(false) {
+            }
+
+            /**
+             * Scan the fragment [begin, end) of the document in memory
+             * starting at document. Positions in error messages are
+             * relative to the start of the document.
+             */
+            XMLScanner(const char* document, const char* begin, const char* end) :
+                m_file(NULL),
+                m_buffer(),
+                m_begin(document),
+                m_data(begin),
+                m_end(end),
+                m_eof(true),
+                m_line(1),
+                m_column(0),
+                m_name(NULL),
+                m_name_length(0),
+                m_attributes(),
+                m_attribute_count(0),
+                m_values(),
+                m_open_elements(),
+                m_depth(0),
+                m_unmatched_end_tags(0),
+                m_fragment(true),
+                m_seen_root(false),
+                m_pending_end(false) {
+            }
+
+            /**
+             * Scan the file opened with OSMFile::open_for_input(). If the
+             * file is memory mapped, the mapping is used, otherwise the
+             * file is read in chunks of buffer_size bytes.
+             */
+            explicit XMLScanner(const Osmium::OSMFile& file, size_t buffer_size = c_default_buffer_size) :
+                m_file(&file),
+                m_buffer(),
+                m_begin(file.mapped_data()),
+                m_data(m_begin),
+                m_end(m_begin + file.mapped_size()),
+                m_eof(m_begin != NULL),
+                m_line(1),
+                m_column(0),
+                m_name(NULL),
+                m_name_length(0),
+                m_attributes(),
+                m_attribute_count(0),
+                m_values(),
+                m_open_elements(),
+                m_depth(0),
+                m_unmatched_end_tags(0),
+                m_fragment(false),
+                m_seen_root(false),
+                m_pending_end(false) {
+                if (!m_begin) {
+                    m_buffer.resize(std::max(buffer_size, static_cast<size_t>(16)));
+                    m_begin = m_data = m_end = &m_buffer[0];
+                }
+            }
+
+            /**
+             * Get the next start or end tag. A tag like <tag/> is returned
+             * as a start tag followed by an end tag.
+             *
+             * @throws ParseError if the input is not well-formed.
+             * @throws OSMFile::IOError if reading the file fails.
+             */
+            event_t next() {
+                if (m_pending_end) {
+                    m_pending_end = false;
+                    close_element();
+                    return end_element;
+                }
+
+                while (true) {
+                    const char* p = m_data;
+                    const scan_result_t result = scan_markup(p);
+                    if (result == scan_incomplete) {
+                        if (m_eof) {
+                            if (m_data != m_end && find_lt(m_data, m_end) != m_end) {
+                                error(m_data, "unclosed token");
+                            }
+                            if (!m_fragment && (m_depth > 0 || !m_seen_root)) {
+                                error(m_end, "no element found");
+                            }
+                            m_data = m_end;
+                            return end_of_document;
+                        }
+                        refill();
+                        continue;
+                    }
+                    m_data = p;
+                    if (result == scan_start_tag) {
+                        return start_element;
+                    }
+                    if (result == scan_end_tag) {
+                        close_element();
+                        return end_element;
+                    }
+                }
+            }
+
+            /// Name of the element returned by the last call to next().
+            const char* name() const {
+                return m_name;
+            }
+
+            size_t name_length() const {
+                return m_name_length;
+            }
+
+            /// Does the element returned by the last call to next() have this name?
+            bool name_is(const char* name) const {
+                return std::strlen(name) == m_name_length && !std::memcmp(name, m_name, m_name_length);
+            }
+
+            /// Number of attributes of the last start tag.
+            size_t attribute_count() const {
+                return m_attribute_count;
+            }
+
+            const Attribute& attribute(size_t n) const {
+                return m_attributes[n];
+            }
+
+            /// Has the scanner seen a start tag?
+            bool seen_element() const {
+                return m_seen_root;
+            }
+
+            /**
+             * Number of elements opened but not closed minus the number of
+             * end tags for elements opened before the fragment.
+             */
+            long depth_change() const {
+                return static_cast<long>(m_depth) - static_cast<long>(m_unmatched_end_tags);
+            }
+
+        private:
+
+            static const size_t c_default_buffer_size = 1024 * 1024;
+
+            enum scan_result_t {
+                scan_start_tag,
+                scan_end_tag,
+                scan_incomplete
+            };
+
+            const Osmium::OSMFile* m_file;
+
+            std::vector<char> m_buffer;
+
+            /// Start of the data in memory (buffer or mapping).
+            const char* m_begin;
+
+            /// Start of the data not scanned yet.
+            const char* m_data;
+
+            /// End of the data in memory.
+            const char* m_end;
+
+            /// No more data can be read.
+            bool m_eof;
+
+            /// Line and column at m_begin, used for error messages.
+            long m_line;
+            long m_column;
+
+            const char* m_name;
+            size_t m_name_length;
+
+            std::vector<Attribute> m_attributes;
+            size_t m_attribute_count;
+
+            /// NUL-terminated attribute values of the current tag.
+            std::vector<char> m_values;
+
+            std::vector<std::string> m_open_elements;
+            size_t m_depth;
+
+            /// End tags in a fragment for elements opened before it.
+            size_t m_unmatched_end_tags;
+
+            bool m_fragment;
+            bool m_seen_root;
+
+            /// The last start tag was an empty element tag (<tag/>).
+            bool m_pending_end;
+
+            static bool is_space(char c) {
+                return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+            }
+
+            /// Is c a character that ends a name?
+            static bool is_name_end(char c) {
+                return is_space(c) || c == '=' || c == '/' || c == '>' || c == '<' || c == '"' || c == '\'';
+            }
+
+            /**
+             * Find the first '<' in [p, end).
+             * @returns Pointer to the '<' or end.
+             */
+            static const char* find_lt(const char* p, const char* end) {
+#ifdef __SSE2__
+                const __m128i lt = _mm_set1_epi8('<');
+                while (end - p >= 16) {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, lt));
+                    if (mask) {
+                        return p + __builtin_ctz(mask);
+                    }
+                    p += 16;
+                }
+#endif
+                const char* lt_pos = static_cast<const char*>(std::memchr(p, '<', end - p));
+                return lt_pos ? lt_pos : end;
+            }
+
+            /**
+             * Find the end of an attribute value in [p, end). This stops
+             * at the closing quote and at all characters that need special
+             * handling: '&', '<' and control characters.
+             * @returns Pointer to the character found or end.
+             */
+            static const char* find_value_end(const char* p, const char* end, char quote) {
+#ifdef __SSE2__
+                const __m128i quotes = _mm_set1_epi8(quote);
+                const __m128i amp = _mm_set1_epi8('&');
+                const __m128i lt = _mm_set1_epi8('<');
+                const __m128i control = _mm_set1_epi8(0x1f);
+                while (end - p >= 16) {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    const __m128i special = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(bytes, quotes), _mm_cmpeq_epi8(bytes, amp)),
+                        _mm_or_si128(_mm_cmpeq_epi8(bytes, lt), _mm_cmpeq_epi8(_mm_min_epu8(bytes, control), bytes)));
+                    const int mask = _mm_movemask_epi8(special);
+                    if (mask) {
+                        return p + __builtin_ctz(mask);
+                    }
+                    p += 16;
+                }
+#endif
+                for (; p != end; ++p) {
+                    const char c = *p;
+                    if (c == quote || c == '&' || c == '<' || static_cast<unsigned char>(c) < 0x20) {
+                        break;
+                    }
+                }
+                return p;
+            }
+
+            /**
+             * Find the string s (which must not be empty) in [p, end).
+             * @returns Pointer to the start of the string or NULL.
+             */
+            static const char* find_string(const char* p, const char* end, const char* s) {
+                const size_t length = std::strlen(s);
+                while (static_cast<size_t>(end - p) >= length) {
+                    p = static_cast<const char*>(std::memchr(p, s[0], end - p - length + 1));
+                    if (!p) {
+                        return NULL;
+                    }
+                    if (!std::memcmp(p, s, length)) {
+                        return p;
+                    }
+                    ++p;
+                }
+                return NULL;
+            }
+
+            void error(const char* pos, const char* message) const {
+                long line = m_line;
+                long column = m_column;
+                for (const char* p = m_begin; p != pos; ++p) {
+                    if (*p == '\n') {
+                        ++line;
+                        column = 0;
+                    } else {
+                        ++column;
+                    }
+                }
+                std::ostringstream desc;
+                desc << "XML parsing error at line " << line << ":" << column << ": " << message;
+                throw ParseError(desc.str());
+            }
+
+            /**
+             * Move the data not scanned yet to the start of the buffer and
+             * read more data from the file.
+             */
+            void refill() {
+                for (const char* p = m_begin; p != m_data; ++p) {
+                    if (*p == '\n') {
+                        ++m_line;
+                        m_column = 0;
+                    } else {
+                        ++m_column;
+                    }
+                }
+
+                const size_t remaining = m_end - m_data;
+                std::memmove(&m_buffer[0], m_data, remaining);
+                if (remaining == m_buffer.size()) {
+                    // a single token doesn't fit into the buffer
+                    m_buffer.resize(m_buffer.size() * 2);
+                }
+
+                const size_t length = m_file->read(&m_buffer[remaining], m_buffer.size() - remaining);
+                m_begin = m_data = &m_buffer[0];
+                m_end = m_begin + remaining + length;
+                if (length == 0) {
+                    m_eof = true;
+                }
+            }
+
+            void close_element() {
+                if (m_depth > 0) {
+                    --m_depth;
+                } else {
+                    ++m_unmatched_end_tags;
+                }
+            }
+
+            /**
+             * Decode the entity or character reference starting at p (which
+             * points to the '&') and append it to m_values.
+             *
+             * @returns Pointer behind the ';' or NULL if the data ends
+             *          before the ';'.
+             */
+            const char* decode_entity(const char* p) {
+                const char* semicolon = static_cast<const char*>(std::memchr(p, ';', std::min(m_end - p, static_cast<ptrdiff_t>(12))));
+                if (!semicolon) {
+                    if (m_end - p < 12) {
+                        return NULL;
+                    }
+                    error(p, "not well-formed (invalid token)");
+                }
+
+                const char* name = p + 1;
+                const size_t length = semicolon - name;
+                if (length >= 2 && name[0] == '#') {
+                    unsigned long code = 0;
+                    const bool hex = (name[1] == 'x');
+                    for (const char* d = name + (hex ? 2 : 1); d != semicolon; ++d) {
+                        int digit = 0;
+                        if (*d >= '0' && *d <= '9') {
+                            digit = *d - '0';
+                        } else if (hex && *d >= 'a' && *d <= 'f') {
+                            digit = *d - 'a' + 10;
+                        } else if (hex && *d >= 'A' && *d <= 'F') {
+                            digit = *d - 'A' + 10;
+                        } else {
+                            error(p, "not well-formed (invalid token)");
+                        }
+                        code = code * (hex ? 16 : 10) + digit;
+                        if (code > 0x10ffff) {
+                            error(p, "reference to invalid character number");
+                        }
+                    }
+                    if (code == 0 || code > 0x10ffff || (code >= 0xd800 && code <= 0xdfff) ||
+                        (code < 0x20 && code != 0x09 && code != 0x0a && code != 0x0d) || code == 0xfffe || code == 0xffff) {
+                        error(p, "reference to invalid character number");
+                    }
+                    append_utf8(code);
+                } else if (length == 2 && !std::memcmp(name, "lt", 2)) {
+                    m_values.push_back('<');
+                } else if (length == 2 && !std::memcmp(name, "gt", 2)) {
+                    m_values.push_back('>');
+                } else if (length == 3 && !std::memcmp(name, "amp", 3)) {
+                    m_values.push_back('&');
+                } else if (length == 4 && !std::memcmp(name, "quot", 4)) {
+                    m_values.push_back('"');
+                } else if (length == 4 && !std::memcmp(name, "apos", 4)) {
+                    m_values.push_back('\'');
+                } else {
+                    error(p, "undefined entity");
+                }
+                return semicolon + 1;
+            }
+
+            void append_utf8(unsigned long code) {
+                if (code < 0x80) {
+                    m_values.push_back(static_cast<char>(code));
+                } else if (code < 0x800) {
+                    m_values.push_back(static_cast<char>(0xc0 | (code >> 6)));
+                    m_values.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                } else if (code < 0x10000) {
+                    m_values.push_back(static_cast<char>(0xe0 | (code >> 12)));
+                    m_values.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                    m_values.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                } else {
+                    m_values.push_back(static_cast<char>(0xf0 | (code >> 18)));
+                    m_values.push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3f)));
+                    m_values.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3f)));
+                    m_values.push_back(static_cast<char>(0x80 | (code & 0x3f)));
+                }
+            }
+
+            /**
+             * Scan an attribute value starting behind the opening quote
+             * and append it to m_values. Entities are decoded and
+             * whitespace characters are replaced by spaces as required by
+             * the XML specification.
+             *
+             * @returns Pointer behind the closing quote or NULL if the data
+             *          ends before the closing quote.
+             */
+            const char* scan_value(const char* p, char quote) {
+                while (true) {
+                    const char* special = find_value_end(p, m_end, quote);
+                    m_values.insert(m_values.end(), p, special);
+                    if (special == m_end) {
+                        return NULL;
+                    }
+                    p = special;
+                    const char c = *p;
+                    if (c == quote) {
+                        m_values.push_back('\0');
+                        return p + 1;
+                    } else if (c == '&') {
+                        p = decode_entity(p);
+                        if (!p) {
+                            return NULL;
+                        }
+                    } else if (c == '\t' || c == '\n') {
+                        m_values.push_back(' ');
+                        ++p;
+                    } else if (c == '\r') {
+                        if (p + 1 == m_end) {
+                            return NULL;
+                        }
+                        m_values.push_back(' ');
+                        p += (p[1] == '\n') ? 2 : 1;
+                    } else {
+                        error(p, "not well-formed (invalid token)");
+                    }
+                }
+            }
+
+            /**
+             * Scan a name starting at p.
+             * @returns Pointer behind the name or NULL if the data ends
+             *          inside the name.
+             */
+            const char* scan_name(const char* p) const {
+                if (p == m_end) {
+                    return NULL;
+                }
+                if (is_name_end(*p)) {
+                    error(p, "not well-formed (invalid token)");
+                }
+                while (p != m_end && !is_name_end(*p)) {
+                    ++p;
+                }
+                return p == m_end ? NULL : p;
+            }
+
+            /**
+             * Skip whitespace.
+             * @returns Pointer to the next other character or NULL if the
+             *          data ends before.
+             */
+            const char* skip_space(const char* p) const {
+                while (p != m_end && is_space(*p)) {
+                    ++p;
+                }
+                return p == m_end ? NULL : p;
+            }
+
+            /**
+             * Skip character data and anything that is not a start or end
+             * tag and scan the next tag. On success p is moved behind the
+             * tag. Nothing is changed if the data ends before the tag is
+             * complete, so that the scan can be repeated with more data.
+             */
+            scan_result_t scan_markup(const char*& p) {
+                if (p == m_begin && m_line == 1 && m_column == 0) {
+                    // skip UTF-8 byte order mark at the start of the document
+                    if (m_end - p < 3 && !m_eof) {
+                        return scan_incomplete;
+                    }
+                    if (m_end - p >= 3 && !std::memcmp(p, "\xef\xbb\xbf", 3)) {
+                        m_data = p += 3;
+                    }
+                }
+
+                while (true) {
+                    const char* lt = find_lt(p, m_end);
+                    if (lt != p && m_depth == 0 && !m_fragment) {
+                        for (const char* c = p; c != lt; ++c) {
+                            if (!is_space(*c)) {
+                                error(c, m_seen_root ? "junk after document element" : "syntax error");
+                            }
+                        }
+                    }
+                    // character data is skipped, the scan can continue from here
+                    m_data = p = lt;
+                    if (m_end - p < 2) {
+                        return scan_incomplete;
+                    }
+
+                    const char* end;
+                    if (p[1] == '/') {
+                        return scan_end_tag_at(p);
+                    } else if (p[1] == '?') {
+                        end = find_string(p + 2, m_end, "?>");
+                        if (!end) {
+                            return scan_incomplete;
+                        }
+                        p = end + 2;
+                    } else if (p[1] == '!') {
+                        if (m_end - p < 9) {
+                            return scan_incomplete;
+                        }
+                        if (!std::memcmp(p, "<!--", 4)) {
+                            end = find_string(p + 4, m_end, "-->");
+                            if (!end) {
+                                return scan_incomplete;
+                            }
+                            p = end + 3;
+                        } else if (!std::memcmp(p, "<![CDATA[", 9)) {
+                            if (m_depth == 0 && !m_fragment) {
+                                error(p, "syntax error");
+                            }
+                            end = find_string(p + 9, m_end, "]]>");
+                            if (!end) {
+                                return scan_incomplete;
+                            }
+                            p = end + 3;
+                        } else {
+                            // DOCTYPE declaration, the internal subset is skipped, too
+                            end = p + 2;
+                            int brackets = 0;
+                            for (; end != m_end && (*end != '>' || brackets > 0); ++end) {
+                                if (*end == '[') {
+                                    ++brackets;
+                                } else if (*end == ']') {
+                                    --brackets;
+                                }
+                            }
+                            if (end == m_end) {
+                                return scan_incomplete;
+                            }
+                            p = end + 1;
+                        }
+                    } else {
+                        return scan_start_tag_at(p);
+                    }
+                }
+            }
+
+            scan_result_t scan_end_tag_at(const char*& p) {
+                const char* name = p + 2;
+                const char* name_end = scan_name(name);
+                if (!name_end) {
+                    return scan_incomplete;
+                }
+                const char* end = skip_space(name_end);
+                if (!end) {
+                    return scan_incomplete;
+                }
+                if (*end != '>') {
+                    error(end, "not well-formed (invalid token)");
+                }
+                const size_t length = name_end - name;
+                if (m_depth == 0 ? !m_fragment : (m_open_elements[m_depth - 1].size() != length ||
+                    std::memcmp(m_open_elements[m_depth - 1].data(), name, length))) {
+                    error(p, "mismatched tag");
+                }
+                m_name = name;
+                m_name_length = length;
+                m_attribute_count = 0;
+                p = end + 1;
+                return scan_end_tag;
+            }
+
+            scan_result_t scan_start_tag_at(const char*& p) {
+                if (m_depth == 0 && m_seen_root && !m_fragment) {
+                    error(p, "junk after document element");
+                }
+
+                const char* name = p + 1;
+                const char* s = scan_name(name);
+                if (!s) {
+                    return scan_incomplete;
+                }
+                const size_t name_length = s - name;
+
+                m_values.clear();
+                size_t count = 0;
+                bool empty_element = false;
+                while (true) {
+                    const char* next = skip_space(s);
+                    if (!next) {
+                        return scan_incomplete;
+                    }
+                    if (*next == '>') {
+                        s = next + 1;
+                        break;
+                    }
+                    if (*next == '/') {
+                        if (next + 1 == m_end) {
+                            return scan_incomplete;
+                        }
+                        if (next[1] != '>') {
+                            error(next, "not well-formed (invalid token)");
+                        }
+                        empty_element = true;
+                        s = next + 2;
+                        break;
+                    }
+                    if (next == s) {
+                        // attributes must be separated by whitespace
+                        error(s, "not well-formed (invalid token)");
+                    }
+
+                    const char* attr_name = next;
+                    const char* attr_name_end = scan_name(attr_name);
+                    if (!attr_name_end) {
+                        return scan_incomplete;
+                    }
+                    const char* eq = skip_space(attr_name_end);
+                    if (!eq) {
+                        return scan_incomplete;
+                    }
+                    if (*eq != '=') {
+                        error(eq, "not well-formed (invalid token)");
+                    }
+                    const char* quote = skip_space(eq + 1);
+                    if (!quote) {
+                        return scan_incomplete;
+                    }
+                    if (*quote != '"' && *quote != '\'') {
+                        error(quote, "not well-formed (invalid token)");
+                    }
+
+                    if (count == m_attributes.size()) {
+                        m_attributes.resize(count + 8);
+                    }
+                    Attribute& attr = m_attributes[count++];
+                    attr.name = attr_name;
+                    attr.name_length = attr_name_end - attr_name;
+                    // the values buffer can still grow, value is an offset until the tag is complete
+                    const size_t offset = m_values.size();
+                    attr.value = NULL;
+                    attr.value_length = offset;
+
+                    s = scan_value(quote + 1, *quote);
+                    if (!s) {
+                        return scan_incomplete;
+                    }
+                }
+
+                for (size_t i=0; i < count; ++i) {
+                    const size_t offset = m_attributes[i].value_length;
+                    const size_t end = (i + 1 < count) ? m_attributes[i+1].value_length : m_values.size();
+                    m_attributes[i].value = &m_values[offset];
+                    m_attributes[i].value_length = end - offset - 1;
+                }
+
+                if (m_depth == m_open_elements.size()) {
+                    m_open_elements.push_back(std::string());
+                }
+                m_open_elements[m_depth].assign(name, name_length);
+                ++m_depth;
+                m_seen_root = true;
+
+                m_name = name;
+                m_name_length = name_length;
+                m_attribute_count = count;
+                m_pending_end = empty_element;
+                p = s;
+                return scan_start_tag;
+            }
+
+        }; // class XMLScanner
+
+    } // namespace Input
+
+} // namespace Osmium
+
+#endif // OSMIUM_INPUT_XML_SCANNER_HPP
@@ -369,6 +369,24 @@ namespace Osmium {
                 }
             }
 
+            /**
+             * Only the types of objects for which the Javascript code
+             * defines callbacks are needed.
+             */
+            uint32_t object_types() const {
+                uint32_t types = 0;
+                if (!cb.before_nodes.IsEmpty() || !cb.node.IsEmpty() || !cb.after_nodes.IsEmpty()) {
+                    types |= NODE_MASK;
+                }
+                if (!cb.before_ways.IsEmpty() || !cb.way.IsEmpty() || !cb.after_ways.IsEmpty()) {
+                    types |= WAY_MASK;
+                }
+                if (!cb.before_relations.IsEmpty() || !cb.relation.IsEmpty() || !cb.after_relations.IsEmpty()) {
+                    types |= RELATION_MASK;
+                }
+                return types;
+            }
+
         }; // class Handler
 
     } // namespace Javascript
@@ -0,0 +1,168 @@
+#ifndef OSMIUM_OSM_BATCH_HPP
+#define OSMIUM_OSM_BATCH_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstddef>
+#include <vector>
+
+#include <boost/iterator/indirect_iterator.hpp>
+#include <boost/utility.hpp>
+
+#include <osmium/smart_ptr.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/osm/relation.hpp>
+
+namespace Osmium {
+
+    namespace OSM {
+
+        /**
+         * A batch of objects of the same type, usually all objects from
+         * one block of the input file. Handlers get read-only access to
+         * the objects through operator[] and the iterators. If a handler
+         * wants to keep an object, it can get a shared pointer to it with
+         * ptr().
+         *
+         * The objects are reused for the next batch, unless somebody
+         * keeps a pointer to them.
+         */
+        template <class TObject>
+        class Batch : boost::noncopyable {
+
+        public:
+
+            typedef shared_ptr<TObject> object_ptr_t;
+
+            typedef boost::indirect_iterator<typename std::vector<object_ptr_t>::const_iterator, const TObject> const_iterator;
+
+            Batch() :
+                m_objects(),
+                m_size(0) {
+            }
+
+            size_t size() const {
+                return m_size;
+            }
+
+            bool empty() const {
+                return m_size == 0;
+            }
+
+            const TObject& operator[](size_t n) const {
+                return *m_objects[n];
+            }
+
+            const_iterator begin() const {
+                return const_iterator(m_objects.begin());
+            }
+
+            const_iterator end() const {
+                return const_iterator(m_objects.begin() + m_size);
+            }
+
+            /**
+             * Get a shared pointer to the object with index n. Use this if
+             * you want to keep the object after the handler callback
+             * returns.
+             */
+            const object_ptr_t& ptr(size_t n) const {
+                return m_objects[n];
+            }
+
+            /**
+             * Remove all objects from the batch. The memory is kept for
+             * reuse.
+             */
+            void clear() {
+                m_size = 0;
+            }
+
+            /**
+             * Add an object to the end of the batch and return a reference
+             * to it. Like Osmium::Input::Base::prepare_node() this reuses
+             * an old object with reset() if nobody else uses it.
+             */
+            TObject& add() {
+                if (m_size < m_objects.size()) {
+                    object_ptr_t& object = m_objects[m_size];
+                    if (object.unique()) {
+                        object->reset();
+                    } else {
+                        object = create(static_cast<TObject*>(NULL));
+                    }
+                } else {
+                    m_objects.push_back(create(static_cast<TObject*>(NULL)));
+                }
+                return *m_objects[m_size++];
+            }
+
+            /**
+             * Call materialize() on all objects somebody else keeps a
+             * pointer to. See Osmium::OSM::Object::materialize().
+             */
+            void materialize_retained() {
+                for (size_t n=0; n < m_size; ++n) {
+                    if (!m_objects[n].unique()) {
+                        m_objects[n]->materialize();
+                    }
+                }
+            }
+
+        private:
+
+            /**
+             * Initial size of the node list of ways in a batch. There are
+             * thousands of ways in a batch, so they start out small
+             * instead of with the default size of WayNodeList.
+             */
+            enum { initial_way_node_list_size = 32 };
+
+            std::vector<object_ptr_t> m_objects;
+
+            /// Number of objects in use, m_objects can contain more for reuse.
+            size_t m_size;
+
+            static shared_ptr<Node> create(Node*) {
+                return make_shared<Node>();
+            }
+
+            static shared_ptr<Way> create(Way*) {
+                return make_shared<Way>(static_cast<int>(initial_way_node_list_size));
+            }
+
+            static shared_ptr<Relation> create(Relation*) {
+                return make_shared<Relation>();
+            }
+
+        }; // class Batch
+
+        typedef Batch<Node>     NodeBatch;
+        typedef Batch<Way>      WayBatch;
+        typedef Batch<Relation> RelationBatch;
+
+    } // namespace OSM
+
+} // namespace Osmium
+
+#endif // OSMIUM_OSM_BATCH_HPP
@@ -38,12 +38,14 @@ namespace Osmium {
             Meta() :
                 m_bounds(),
                 m_has_multiple_object_versions(false),
+                m_has_locations_on_ways(false),
                 m_generator() {
             }
 
             Meta(const Bounds& bounds) :
                 m_bounds(bounds),
                 m_has_multiple_object_versions(false),
+                m_has_locations_on_ways(false),
                 m_generator() {
             }
 
@@ -64,6 +66,20 @@ namespace Osmium {
                 return *this;
             }
 
+            /**
+             * Do the ways in this stream of objects come with the locations
+             * of their nodes? Then Osmium::Handler::CoordinatesForWays is
+             * not needed.
+             */
+            bool has_locations_on_ways() const {
+                return m_has_locations_on_ways;
+            }
+
+            Meta& has_locations_on_ways(bool h) {
+                m_has_locations_on_ways = h;
+                return *this;
+            }
+
             const std::string& generator() const {
                 return m_generator;
             }
@@ -83,6 +99,9 @@ namespace Osmium {
              */
             bool m_has_multiple_object_versions;
 
+            /// Do all way nodes have locations?
+            bool m_has_locations_on_ways;
+
             /// Program that generated this file.
             std::string m_generator;
 
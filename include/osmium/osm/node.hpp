@@ -61,6 +61,15 @@ namespace Osmium {
                 return NODE;
             }
 
+            /**
+             * Make this node look like a newly created one, keeping
+             * allocated memory for reuse (see TagList::reset()).
+             */
+            void reset() {
+                Object::reset();
+                m_position = Position();
+            }
+
             void lon(double x) {
                 m_position.lon(x);
             }
@@ -176,7 +176,7 @@ namespace Osmium {
              * @return Pointer to internal buffer with user name.
              */
             const char* user() const {
-                return m_user.c_str();
+                return m_borrowed_user ? m_borrowed_user : m_user.c_str();
             }
 
             /**
@@ -189,9 +189,40 @@ namespace Osmium {
                     throw std::length_error("user name too long");
                 }
                 m_user = user;
+                m_borrowed_user = NULL;
                 return *this;
             }
 
+            /**
+             * Set the name of the user who last changed this object without
+             * copying it. The string must stay valid as long as the object
+             * is used or until materialize() is called. Copies of the
+             * object always have their own copy of the user name.
+             * @return Reference to object to make calls chainable.
+             * @exception std::length_error Thrown when the username contains more than max_characters_username (255 UTF-8 characters).
+             */
+            Object& user_borrowed(const char* user) {
+                if (strlen(user) > max_length_username) {
+                    throw std::length_error("user name too long");
+                }
+                m_borrowed_user = user;
+                return *this;
+            }
+
+            /**
+             * Make sure the object has its own copy of the user name and
+             * all tags. This has to be called before the strings given to
+             * user_borrowed() or TagList::add_borrowed() go away if the
+             * object is still needed.
+             */
+            void materialize() {
+                if (m_borrowed_user) {
+                    m_user = m_borrowed_user;
+                    m_borrowed_user = NULL;
+                }
+                m_tags.materialize();
+            }
+
             /**
              * Get the visible flag of this object.
              * (This is only used in OSM files with history.)
@@ -272,6 +303,7 @@ namespace Osmium {
                 m_endtime(0),
                 m_uid(-1), // to be compatible with Osmosis we use -1 for unknown user id
                 m_user(),
+                m_borrowed_user(NULL),
                 m_visible(true),
                 m_tags() {
             }
@@ -283,14 +315,48 @@ namespace Osmium {
                 m_timestamp(o.m_timestamp),
                 m_endtime(o.m_endtime),
                 m_uid(o.m_uid),
-                m_user(o.m_user),
+                m_user(o.user()),
+                m_borrowed_user(NULL),
                 m_visible(o.m_visible),
                 m_tags(o.m_tags) {
             }
 
+            Object& operator=(const Object& o) {
+                m_id            = o.m_id;
+                m_version       = o.m_version;
+                m_changeset     = o.m_changeset;
+                m_timestamp     = o.m_timestamp;
+                m_endtime       = o.m_endtime;
+                m_uid           = o.m_uid;
+                m_user          = o.user();
+                m_borrowed_user = NULL;
+                m_visible       = o.m_visible;
+                m_tags          = o.m_tags;
+                return *this;
+            }
+
             virtual ~Object() {
             }
 
+            /**
+             * Set all attributes to the values of a newly created object
+             * and remove all tags, keeping the memory of the user name and
+             * the tags for reuse. Used by the reset() functions of the
+             * subclasses.
+             */
+            void reset() {
+                m_id            = 0;
+                m_version       = 0;
+                m_changeset     = 0;
+                m_timestamp     = 0;
+                m_endtime       = 0;
+                m_uid           = -1;
+                m_user.clear();
+                m_borrowed_user = NULL;
+                m_visible       = true;
+                m_tags.reset();
+            }
+
         private:
 
             osm_object_id_t    m_id;          ///< object id
@@ -300,6 +366,7 @@ namespace Osmium {
             time_t             m_endtime;     ///< when this object version was replaced by a new one
             osm_user_id_t      m_uid;         ///< user id of user who last changed this object
             std::string        m_user;        ///< name of user who last changed this object
+            const char*        m_borrowed_user; ///< user name not owned by this object (see user_borrowed())
             bool               m_visible;     ///< object visible (only when working with history data)
 
             TagList m_tags;
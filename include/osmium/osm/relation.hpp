@@ -53,6 +53,16 @@ namespace Osmium {
                 return RELATION;
             }
 
+            /**
+             * Make this relation look like a newly created one, keeping
+             * allocated memory for reuse (see TagList::reset() and
+             * RelationMemberList::reset()).
+             */
+            void reset() {
+                Object::reset();
+                m_members.reset();
+            }
+
             void add_member(const char type, osm_object_id_t ref, const char* role) {
                 m_members.add_member(type, ref, role);
             }
@@ -30,20 +30,48 @@ namespace Osmium {
 
     namespace OSM {
 
+        /**
+         * The members of a relation.
+         *
+         * After reset() the members are kept for reuse, so adding members
+         * again doesn't need new memory for them or their roles.
+         */
         class RelationMemberList {
 
         public:
 
             RelationMemberList() :
-                m_list() {
+                m_list(),
+                m_size(0) {
+            }
+
+            RelationMemberList(const RelationMemberList& other) :
+                m_list(other.begin(), other.end()),
+                m_size(other.m_size) {
+            }
+
+            RelationMemberList& operator=(const RelationMemberList& other) {
+                m_list.assign(other.begin(), other.end());
+                m_size = other.m_size;
+                return *this;
             }
 
             osm_sequence_id_t size() const {
-                return m_list.size();
+                return m_size;
             }
 
+            /// Remove all members and free their memory.
             void clear() {
                 m_list.clear();
+                m_size = 0;
+            }
+
+            /**
+             * Remove all members, but keep them and their roles for reuse
+             * by add_member().
+             */
+            void reset() {
+                m_size = 0;
             }
 
             RelationMember& operator[](int i) {
@@ -66,29 +94,37 @@ namespace Osmium {
             }
 
             iterator end() {
-                return m_list.end();
+                return m_list.begin() + m_size;
             }
 
             const_iterator end() const {
-                return m_list.end();
+                return m_list.begin() + m_size;
             }
 
             void add_member(const char type, osm_object_id_t ref, const char* role) {
-                /* first we resize the vector... */
-                m_list.resize(m_list.size()+1);
+                /* first we make room in the vector unless there is an old
+                member to reuse... */
+                if (m_size == m_list.size()) {
+                    m_list.resize(m_size+1);
+                }
                 /* ...and get an address for the new element... */
-                RelationMember* m = &m_list[m_list.size()-1];
+                RelationMember* m = &m_list[m_size];
                 /* ...so that we can directly write into the memory and avoid
                 a second copy */
                 m->type(type);
                 m->ref(ref);
                 m->role(role);
+                ++m_size;
             }
 
         private:
 
+            /// The members, there can be more than m_size for reuse.
             std::vector<RelationMember> m_list;
 
+            /// Number of members in use.
+            size_t m_size;
+
         }; // class RelationMemberList
 
     } // namespace OSM
@@ -22,6 +22,7 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 
 */
 
+#include <cstring>
 #include <string>
 
 namespace Osmium {
@@ -33,6 +34,14 @@ namespace Osmium {
         *
         * Tag keys and values are not allowed to be longer than 255 characters
         * each, but this is not checked by this class.
+        *
+        * Normally a tag has its own copy of key and value. A tag created
+        * with borrow_strings only stores the pointers it was given, the
+        * strings must then stay valid as long as the tag is used or until
+        * materialize() is called. The PBF parser uses this to point
+        * directly into the string table of the block it is decoding.
+        * Copying a borrowed tag gives another borrowed tag, but copies of a
+        * TagList or of an OSM object always have their own strings.
         */
         class Tag {
 
@@ -41,21 +50,65 @@ namespace Osmium {
             static const int max_utf16_length_key   = 2 * (255 + 1); ///< maximum number of UTF-16 units
             static const int max_utf16_length_value = 2 * (255 + 1);
 
-            Tag(const char* key, const char* value) :
-                m_key(key),
-                m_value(value) {
+            enum ownership_t {
+                copy_strings,
+                borrow_strings
+            };
+
+            Tag(const char* key, const char* value, ownership_t ownership = copy_strings) :
+                m_key(),
+                m_value(),
+                m_borrowed_key(NULL),
+                m_borrowed_value(NULL) {
+                set(key, value, ownership);
+            }
+
+            /**
+             * Set key and value of the tag. Copying them reuses the memory
+             * the tag already has for its own strings.
+             */
+            void set(const char* key, const char* value, ownership_t ownership = copy_strings) {
+                if (ownership == borrow_strings) {
+                    m_borrowed_key = key;
+                    m_borrowed_value = value;
+                } else {
+                    m_key = key;
+                    m_value = value;
+                    m_borrowed_key = NULL;
+                    m_borrowed_value = NULL;
+                }
             }
 
             const char* key() const {
-                return m_key.c_str();
+                return m_borrowed_key ? m_borrowed_key : m_key.c_str();
             }
 
             const char* value() const {
-                return m_value.c_str();
+                return m_borrowed_value ? m_borrowed_value : m_value.c_str();
+            }
+
+            /**
+             * Does this tag only point to strings owned by somebody else?
+             */
+            bool borrowed() const {
+                return m_borrowed_key != NULL;
+            }
+
+            /**
+             * Make a copy of borrowed key and value, so that the tag
+             * doesn't depend on them any more.
+             */
+            void materialize() {
+                if (m_borrowed_key) {
+                    m_key = m_borrowed_key;
+                    m_value = m_borrowed_value;
+                    m_borrowed_key = NULL;
+                    m_borrowed_value = NULL;
+                }
             }
 
             bool operator==(const Tag& other) const {
-                return this->m_key == other.m_key && this->m_value == other.m_value;
+                return !strcmp(key(), other.key()) && !strcmp(value(), other.value());
             }
 
         private:
@@ -63,6 +116,9 @@ namespace Osmium {
             std::string m_key;
             std::string m_value;
 
+            const char* m_borrowed_key;
+            const char* m_borrowed_value;
+
         };
 
         inline bool operator!=(const Tag& lhs, const Tag& rhs) {
@@ -37,27 +37,60 @@ namespace Osmium {
         *
         * Tag keys are assumed to be unique in a TagList, but this is not
         * checked.
+        *
+        * After reset() the tags are kept for reuse, so adding tags again
+        * doesn't need new memory for the tags or their strings.
         */
         class TagList {
 
         public:
 
             TagList() :
-                m_tags() {
+                m_tags(),
+                m_size(0) {
+            }
+
+            /**
+             * Copy a tag list. The copy always has its own copy of the
+             * strings, even if the tags in the original are borrowed.
+             */
+            TagList(const TagList& other) :
+                m_tags(other.begin(), other.end()),
+                m_size(other.m_size) {
+                materialize();
+            }
+
+            TagList& operator=(const TagList& other) {
+                if (this != &other) {
+                    reset();
+                    for (const_iterator it = other.begin(); it != other.end(); ++it) {
+                        add(it->key(), it->value());
+                    }
+                }
+                return *this;
             }
 
             /// Return the number of tags in this tag list.
             int size() const {
-                return m_tags.size();
+                return m_size;
             }
 
             bool empty() const {
-                return m_tags.empty();
+                return m_size == 0;
             }
 
-            /// Remove all tags from the tag list.
+            /// Remove all tags from the tag list and free their memory.
             void clear() {
                 m_tags.clear();
+                m_size = 0;
+            }
+
+            /**
+             * Remove all tags from the tag list, but keep them and their
+             * strings for reuse by add() and add_borrowed().
+             */
+            void reset() {
+                m_size = 0;
             }
 
             Tag& operator[](int i) {
@@ -80,16 +113,33 @@ namespace Osmium {
             }
 
             iterator end() {
-                return m_tags.end();
+                return m_tags.begin() + m_size;
             }
 
             const_iterator end() const {
-                return m_tags.end();
+                return m_tags.begin() + m_size;
             }
 
             /// Add new tag with given key and value to list.
             void add(const char* key, const char* value) {
-                m_tags.push_back(Tag(key, value));
+                add(key, value, Tag::copy_strings);
+            }
+
+            /**
+             * Add new tag with given key and value to list without copying
+             * them. See Tag for details.
+             */
+            void add_borrowed(const char* key, const char* value) {
+                add(key, value, Tag::borrow_strings);
+            }
+
+            /**
+             * Make sure all tags have their own copy of key and value.
+             */
+            void materialize() {
+                for (iterator it = begin(); it != end(); ++it) {
+                    it->materialize();
+                }
             }
 
             const char* get_value_by_key(const char* key) const {
@@ -103,8 +153,21 @@ namespace Osmium {
 
         private:
 
+            /// The tags, there can be more than m_size for reuse.
             std::vector<Tag> m_tags;
 
+            /// Number of tags in use.
+            size_t m_size;
+
+            void add(const char* key, const char* value, Tag::ownership_t ownership) {
+                if (m_size < m_tags.size()) {
+                    m_tags[m_size].set(key, value, ownership);
+                } else {
+                    m_tags.push_back(Tag(key, value, ownership));
+                }
+                ++m_size;
+            }
+
         }; // class TagList
 
     } // namespace OSM
@@ -36,6 +36,17 @@ enum osm_object_type_t {
     AREA               = 3
 };
 
+/**
+ * Bitmasks for sets of object types, for instance to tell an input class
+ * which types of objects are needed.
+ */
+enum osm_object_type_mask_t {
+    NODE_MASK          = 1 << NODE,
+    WAY_MASK           = 1 << WAY,
+    RELATION_MASK      = 1 << RELATION,
+    ALL_OBJECTS_MASK   = NODE_MASK | WAY_MASK | RELATION_MASK
+};
+
 /*
 * The following typedefs are chosen so that they can represent all needed
 * numbers and still be reasonably space efficient. As the %OSM database is
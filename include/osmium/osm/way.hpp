@@ -69,6 +69,16 @@ namespace Osmium {
                 return WAY;
             }
 
+            /**
+             * Make this way look like a newly created one, keeping
+             * allocated memory, including the capacity of the node list,
+             * for reuse (see TagList::reset()).
+             */
+            void reset() {
+                Object::reset();
+                m_node_list.reset();
+            }
+
             osm_object_id_t get_node_id(osm_sequence_id_t n) const {
                 return m_node_list[n].ref();
             }
@@ -58,6 +58,15 @@ namespace Osmium {
                 m_list.clear();
             }
 
+            /**
+             * Remove all nodes, keeping the memory for reuse. This is the
+             * same as clear(), it is there for symmetry with TagList and
+             * RelationMemberList.
+             */
+            void reset() {
+                m_list.clear();
+            }
+
             typedef std::vector<WayNode>::iterator iterator;
             typedef std::vector<WayNode>::const_iterator const_iterator;
             typedef std::vector<WayNode>::reverse_iterator reverse_iterator;
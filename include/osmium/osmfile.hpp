@@ -26,11 +26,26 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 #include <fcntl.h>
 #include <stdexcept>
 #include <string>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#ifndef WIN32
+# include <sys/mman.h>
+#endif
 #include <boost/utility.hpp>
 
+#include <osmium/smart_ptr.hpp>
+#include <osmium/compression/decompressor.hpp>
+
+#ifdef OSMIUM_WITH_GZIP
+# include <osmium/compression/gzip.hpp>
+#endif
+
+#ifdef OSMIUM_WITH_BZIP2
+# include <osmium/compression/bzip2.hpp>
+#endif
+
 namespace Osmium {
 
     /**
@@ -39,6 +54,11 @@ namespace Osmium {
      *
      * If the filename is empty, this means stdin or stdout is used. If you set
      * the filename to "-" it will be treated the same.
+     *
+     * Compressed input files are normally read through a zcat or bzcat
+     * child process. If OSMIUM_WITH_GZIP or OSMIUM_WITH_BZIP2 is defined
+     * before including this file, they are decompressed inside the process
+     * using zlib or libbz2 instead. Use read() to get the uncompressed data.
      */
     class OSMFile {
 
@@ -277,6 +297,31 @@ namespace Osmium {
                 return &instance;
             }
 
+            /**
+             * Encoding in o5m (or o5c for change files). The suffix
+             * replaces the suffix of the file type.
+             */
+            static FileEncoding* O5M() {
+                static FileEncoding instance(".o5m", "", "", false);
+                return &instance;
+            }
+
+            /**
+             * OPL text encoding with one object per line.
+             */
+            static FileEncoding* OPL() {
+                static FileEncoding instance(".opl", "", "", false);
+                return &instance;
+            }
+
+            /**
+             * Osmium dump format for intermediate files, see Osmium::Dump.
+             */
+            static FileEncoding* Dump() {
+                static FileEncoding instance(".dump", "", "", false);
+                return &instance;
+            }
+
         };
 
     private:
@@ -300,6 +345,21 @@ namespace Osmium {
          */
         pid_t m_childpid;
 
+        /**
+         * Start of the memory mapping if the input file was mapped into
+         * memory, NULL otherwise.
+         */
+        const char* m_mapped_data;
+
+        /// Size of the memory mapping.
+        size_t m_mapped_size;
+
+        /**
+         * Decompressor used by read() if the input file is decompressed
+         * inside the process.
+         */
+        shared_ptr<Osmium::Compression::Decompressor> m_decompressor;
+
         /**
          * Fork and execute the given command in the child.
          * A pipe is created between the child and the parent.
@@ -416,6 +476,34 @@ namespace Osmium {
             }
         }
 
+        /**
+         * Map the open input file into memory if it is a regular PBF, o5m,
+         * OPL, dump, or uncompressed XML file. Pipes, stdin, URLs and compressed files
+         * are not mapped, they are read using read() as before. If mapping
+         * fails for any reason this silently falls back to read(), too.
+         */
+        void map_input_file() {
+#ifndef WIN32
+            if (m_encoding->decompress() != "" || m_filename == "" || m_childpid != 0) {
+                return;
+            }
+
+            struct stat file_stat;
+            if (::fstat(m_fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size <= 0) {
+                return;
+            }
+
+            void* data = ::mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (data == MAP_FAILED) {
+                return;
+            }
+            ::madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+
+            m_mapped_data = static_cast<const char*>(data);
+            m_mapped_size = file_stat.st_size;
+#endif
+        }
+
     public:
 
         /**
@@ -431,7 +519,10 @@ namespace Osmium {
             m_encoding(FileEncoding::PBF()),
             m_filename(filename),
             m_fd(-1),
-            m_childpid(0) {
+            m_childpid(0),
+            m_mapped_data(NULL),
+            m_mapped_size(0),
+            m_decompressor() {
 
             // stdin/stdout
             if (filename == "" || filename == "-") {
@@ -493,6 +584,30 @@ namespace Osmium {
             } else if (suffix == "osc.gz") {
                 m_type     = FileType::Change();
                 m_encoding = FileEncoding::XMLgz();
+            } else if (suffix == "o5m" || suffix == "osm.o5m") {
+                m_type     = FileType::OSM();
+                m_encoding = FileEncoding::O5M();
+            } else if (suffix == "osh.o5m") {
+                m_type     = FileType::History();
+                m_encoding = FileEncoding::O5M();
+            } else if (suffix == "o5c" || suffix == "osc.o5m") {
+                m_type     = FileType::Change();
+                m_encoding = FileEncoding::O5M();
+            } else if (suffix == "opl" || suffix == "osm.opl") {
+                m_type     = FileType::OSM();
+                m_encoding = FileEncoding::OPL();
+            } else if (suffix == "osh.opl") {
+                m_type     = FileType::History();
+                m_encoding = FileEncoding::OPL();
+            } else if (suffix == "osc.opl") {
+                m_type     = FileType::Change();
+                m_encoding = FileEncoding::OPL();
+            } else if (suffix == "dump" || suffix == "osm.dump") {
+                m_type     = FileType::OSM();
+                m_encoding = FileEncoding::Dump();
+            } else if (suffix == "osh.dump") {
+                m_type     = FileType::History();
+                m_encoding = FileEncoding::Dump();
             } else {
                 default_settings_for_file();
             }
@@ -508,7 +623,10 @@ namespace Osmium {
             m_encoding(orig.encoding()),
             m_filename(orig.filename()),
             m_fd(-1),
-            m_childpid(0) {
+            m_childpid(0),
+            m_mapped_data(NULL),
+            m_mapped_size(0),
+            m_decompressor() {
         }
 
         /**
@@ -517,8 +635,11 @@ namespace Osmium {
          * copied.
          */
         OSMFile& operator=(const OSMFile& orig) {
-            m_fd       = -1;
-            m_childpid = 0;
+            m_fd          = -1;
+            m_childpid    = 0;
+            m_mapped_data = NULL;
+            m_mapped_size = 0;
+            m_decompressor.reset();
             m_type     = orig.type();
             m_encoding = orig.encoding();
             m_filename = orig.filename();
@@ -534,6 +655,16 @@ namespace Osmium {
         }
 
         void close() {
+            m_decompressor.reset();
+
+#ifndef WIN32
+            if (m_mapped_data) {
+                ::munmap(const_cast<char*>(m_mapped_data), m_mapped_size);
+                m_mapped_data = NULL;
+                m_mapped_size = 0;
+            }
+#endif
+
             if (m_fd >= 0) {
                 ::close(m_fd);
                 m_fd = -1;
@@ -585,6 +716,42 @@ namespace Osmium {
             return m_fd;
         }
 
+        /**
+         * Get the start of the memory mapped input file. This is only
+         * available after open_for_input() was called and only if the
+         * input is a regular PBF, o5m, OPL, dump, or uncompressed XML file.
+         *
+         * @returns Pointer to the mapped data or NULL if the file is not mapped.
+         */
+        const char* mapped_data() const {
+            return m_mapped_data;
+        }
+
+        /**
+         * Get the size of the memory mapped input file.
+         */
+        size_t mapped_size() const {
+            return m_mapped_size;
+        }
+
+        /**
+         * Tell the operating system that the given part of the memory
+         * mapped input file will be needed soon, so it can start reading
+         * it. Does nothing if the file is not mapped.
+         */
+        void advise_will_need(size_t offset, size_t size) const {
+#ifndef WIN32
+            if (m_mapped_data && offset < m_mapped_size) {
+                const size_t pagesize = ::sysconf(_SC_PAGESIZE);
+                const size_t start = offset - offset % pagesize;
+                if (offset + size > m_mapped_size) {
+                    size = m_mapped_size - offset;
+                }
+                ::madvise(const_cast<char*>(m_mapped_data) + start, size + (offset - start), MADV_WILLNEED);
+            }
+#endif
+        }
+
         FileType* type() const {
             return m_type;
         }
@@ -629,6 +796,12 @@ namespace Osmium {
                 m_encoding = FileEncoding::XMLgz();
             } else if (encoding == "xmlbz2" || encoding == "bz2") {
                 m_encoding = FileEncoding::XMLbz2();
+            } else if (encoding == "o5m") {
+                m_encoding = FileEncoding::O5M();
+            } else if (encoding == "opl") {
+                m_encoding = FileEncoding::OPL();
+            } else if (encoding == "dump") {
+                m_encoding = FileEncoding::Dump();
             } else {
                 throw ArgumentError("Unknown OSM file encoding", encoding);
             }
@@ -654,12 +827,68 @@ namespace Osmium {
 
         std::string filename_with_default_suffix() const {
             std::string filename = filename_without_suffix();
+            if (m_encoding == FileEncoding::O5M()) {
+                if (m_type == FileType::OSM()) {
+                    return filename + ".o5m";
+                } else if (m_type == FileType::Change()) {
+                    return filename + ".o5c";
+                }
+            }
             filename += m_type->suffix() + m_encoding->suffix();
             return filename;
         }
 
+        /**
+         * Open file for reading. Regular PBF, o5m, OPL, dump, and uncompressed
+         * XML files are also mapped into memory, see mapped_data().
+         */
         void open_for_input() {
+#ifdef OSMIUM_WITH_GZIP
+            if (m_encoding == FileEncoding::XMLgz()) {
+                m_fd = open_input_file_or_url();
+                m_decompressor = make_shared<Osmium::Compression::GzipDecompressor>(m_fd);
+                return;
+            }
+#endif
+#ifdef OSMIUM_WITH_BZIP2
+            if (m_encoding == FileEncoding::XMLbz2()) {
+                m_fd = open_input_file_or_url();
+                m_decompressor = make_shared<Osmium::Compression::Bzip2Decompressor>(m_fd);
+                return;
+            }
+#endif
             m_fd = m_encoding->decompress() == "" ? open_input_file_or_url() : execute(m_encoding->decompress(), 0);
+            map_input_file();
+        }
+
+        /**
+         * Read uncompressed data from the file opened with
+         * open_for_input(). If the file is decompressed inside the process
+         * this is the only way to read it, fd() gives you the compressed
+         * data in that case.
+         *
+         * @returns Number of bytes read, 0 at the end of the file.
+         * @throws IOError if reading fails.
+         * @throws Osmium::Compression::DecompressionError if compressed data is invalid.
+         */
+        size_t read(char* buffer, size_t size) const {
+            if (m_decompressor) {
+                try {
+                    return m_decompressor->read(buffer, size);
+                } catch (Osmium::Compression::DecompressionError&) {
+                    throw;
+                } catch (std::runtime_error& e) {
+                    throw IOError(e.what(), m_filename, errno);
+                }
+            }
+            ssize_t length;
+            do {
+                length = ::read(m_fd, buffer, size);
+            } while (length < 0 && errno == EINTR);
+            if (length < 0) {
+                throw IOError("Read failed", m_filename, errno);
+            }
+            return length;
         }
 
         void open_for_output() {
@@ -136,6 +136,14 @@ namespace Osmium {
                 next_handler().set_generator(generator);
             }
 
+            /**
+             * The output object, for instance to set options specific
+             * to a file format.
+             */
+            Osmium::Output::Base& output() const {
+                return next_handler();
+            }
+
         }; // Handler
 
     } // namespace Output
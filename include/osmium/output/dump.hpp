@@ -0,0 +1,127 @@
+#ifndef OSMIUM_OUTPUT_DUMP_HPP
+#define OSMIUM_OUTPUT_DUMP_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <osmium/output.hpp>
+#include <osmium/utils/dump.hpp>
+
+namespace Osmium {
+
+    namespace Output {
+
+        /**
+         * Writes files in the Osmium dump format, see Osmium::Dump.
+         *
+         * The records are assembled in a RecordBuffer which is written to
+         * the file when it gets large.
+         */
+        class Dump : public Base {
+
+            // objects of this class can't be copied
+            Dump(const Dump&);
+            Dump& operator=(const Dump&);
+
+        public:
+
+            Dump(const Osmium::OSMFile& file) :
+                Base(file),
+                m_buffer() {
+                m_buffer.reserve(flush_size + 64 * 1024);
+            }
+
+            void init(Osmium::OSM::Meta& meta) {
+                m_buffer.add_header(meta, m_file.has_multiple_object_versions());
+            }
+
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                m_buffer.add_node(*node);
+                check_flush();
+            }
+
+            void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+                m_buffer.add_way(*way);
+                check_flush();
+            }
+
+            void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+                m_buffer.add_relation(*relation);
+                check_flush();
+            }
+
+            void final() {
+                flush();
+                m_file.close();
+            }
+
+        private:
+
+            /// Output is collected here and written when it gets large.
+            Osmium::Dump::RecordBuffer m_buffer;
+
+            /// Write to the file when the buffer has grown to this size.
+            enum { flush_size = 1024 * 1024 };
+
+            void check_flush() {
+                if (m_buffer.size() >= flush_size) {
+                    flush();
+                }
+            }
+
+            void flush() {
+                const char* data = m_buffer.data().data();
+                size_t size = m_buffer.size();
+                while (size > 0) {
+                    const ssize_t length = ::write(fd(), data, size);
+                    if (length < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error("write error");
+                    }
+                    data += length;
+                    size -= length;
+                }
+                m_buffer.clear();
+            }
+
+        }; // class Dump
+
+        namespace {
+
+            inline Osmium::Output::Base* CreateOutputDump(const Osmium::OSMFile& file) {
+                return new Osmium::Output::Dump(file);
+            }
+
+            const bool dump_registered = Osmium::Output::Factory::instance().register_output_format(Osmium::OSMFile::FileEncoding::Dump(), CreateOutputDump);
+
+        } // namespace
+
+    } // namespace Output
+
+} // namespace Osmium
+
+#endif // OSMIUM_OUTPUT_DUMP_HPP
@@ -0,0 +1,267 @@
+#ifndef OSMIUM_OUTPUT_O5M_HPP
+#define OSMIUM_OUTPUT_O5M_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+#include <osmium/output.hpp>
+#include <osmium/utils/o5m.hpp>
+
+namespace Osmium {
+
+    namespace Output {
+
+        /**
+         * Writes o5m files, or o5c files if the file type is
+         * Osmium::OSMFile::FileType::Change().
+         *
+         * Delta encoding and the string table are reset whenever the
+         * object type changes. In change and history files objects that
+         * are not visible are written with id and version information
+         * only, which marks them as deleted.
+         */
+        class O5M : public Base {
+
+            // objects of this class can't be copied
+            O5M(const O5M&);
+            O5M& operator=(const O5M&);
+
+        public:
+
+            O5M(const Osmium::OSMFile& file) :
+                Base(file),
+                m_buffer(),
+                m_data(),
+                m_members(),
+                m_strings(),
+                m_last_type(UNKNOWN) {
+                reset();
+            }
+
+            void init(Osmium::OSM::Meta& meta) {
+                m_buffer += static_cast<char>(Osmium::O5M::dataset_reset);
+                m_data = m_file.type() == Osmium::OSMFile::FileType::Change() ? "o5c2" : "o5m2";
+                write_dataset(Osmium::O5M::dataset_header);
+
+                if (meta.bounds().defined()) {
+                    m_data.clear();
+                    Osmium::O5M::append_zigzag(m_data, meta.bounds().bottom_left().x());
+                    Osmium::O5M::append_zigzag(m_data, meta.bounds().bottom_left().y());
+                    Osmium::O5M::append_zigzag(m_data, meta.bounds().top_right().x());
+                    Osmium::O5M::append_zigzag(m_data, meta.bounds().top_right().y());
+                    write_dataset(Osmium::O5M::dataset_bbox);
+                }
+            }
+
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                if (write_object(*node, NODE)) {
+                    Osmium::O5M::append_zigzag(m_data, node->position().x() - m_delta_lon);
+                    m_delta_lon = node->position().x();
+                    Osmium::O5M::append_zigzag(m_data, node->position().y() - m_delta_lat);
+                    m_delta_lat = node->position().y();
+                    write_tags(node->tags());
+                }
+                write_dataset(Osmium::O5M::dataset_node);
+            }
+
+            void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+                if (write_object(*way, WAY)) {
+                    m_members.clear();
+                    Osmium::OSM::WayNodeList::const_iterator end = way->nodes().end();
+                    for (Osmium::OSM::WayNodeList::const_iterator it = way->nodes().begin(); it != end; ++it) {
+                        Osmium::O5M::append_zigzag(m_members, it->ref() - m_delta_way_node);
+                        m_delta_way_node = it->ref();
+                    }
+                    Osmium::O5M::append_varint(m_data, m_members.size());
+                    m_data += m_members;
+                    write_tags(way->tags());
+                }
+                write_dataset(Osmium::O5M::dataset_way);
+            }
+
+            void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+                if (write_object(*relation, RELATION)) {
+                    m_members.clear();
+                    Osmium::OSM::RelationMemberList::const_iterator end = relation->members().end();
+                    for (Osmium::OSM::RelationMemberList::const_iterator it = relation->members().begin(); it != end; ++it) {
+                        const int type = it->type() == 'n' ? 0 : (it->type() == 'w' ? 1 : 2);
+                        Osmium::O5M::append_zigzag(m_members, it->ref() - m_delta_member[type]);
+                        m_delta_member[type] = it->ref();
+                        std::string type_and_role(1, static_cast<char>('0' + type));
+                        type_and_role += it->role();
+                        type_and_role += '\0';
+                        m_strings.append(m_members, type_and_role, 1);
+                    }
+                    Osmium::O5M::append_varint(m_data, m_members.size());
+                    m_data += m_members;
+                    write_tags(relation->tags());
+                }
+                write_dataset(Osmium::O5M::dataset_relation);
+            }
+
+            void final() {
+                m_buffer += static_cast<char>(Osmium::O5M::dataset_eof);
+                flush();
+                m_file.close();
+            }
+
+        private:
+
+            /// Output is collected here and written when it gets large.
+            std::string m_buffer;
+
+            /// The data of the current dataset.
+            std::string m_data;
+
+            /// Way nodes or relation members of the current object.
+            std::string m_members;
+
+            Osmium::O5M::OutputStringTable m_strings;
+
+            osm_object_type_t m_last_type;
+
+            int64_t m_delta_id;
+            int64_t m_delta_timestamp;
+            int64_t m_delta_changeset;
+            int64_t m_delta_lon;
+            int64_t m_delta_lat;
+            int64_t m_delta_way_node;
+            int64_t m_delta_member[3];
+
+            /// Write to the file when the buffer has grown to this size.
+            enum { flush_size = 1024 * 1024 };
+
+            void reset() {
+                m_strings.clear();
+                m_delta_id = 0;
+                m_delta_timestamp = 0;
+                m_delta_changeset = 0;
+                m_delta_lon = 0;
+                m_delta_lat = 0;
+                m_delta_way_node = 0;
+                for (int n=0; n < 3; ++n) {
+                    m_delta_member[n] = 0;
+                }
+            }
+
+            /**
+             * Start a new dataset with the id and version information of
+             * the object.
+             *
+             * @returns false if the object is deleted and nothing more
+             *          should be written.
+             */
+            bool write_object(const Osmium::OSM::Object& object, osm_object_type_t type) {
+                if (type != m_last_type) {
+                    if (m_last_type != UNKNOWN) {
+                        m_buffer += static_cast<char>(Osmium::O5M::dataset_reset);
+                        reset();
+                    }
+                    m_last_type = type;
+                }
+
+                m_data.clear();
+                Osmium::O5M::append_zigzag(m_data, object.id() - m_delta_id);
+                m_delta_id = object.id();
+
+                if (object.version()) {
+                    Osmium::O5M::append_varint(m_data, object.version());
+                    Osmium::O5M::append_zigzag(m_data, object.timestamp() - m_delta_timestamp);
+                    m_delta_timestamp = object.timestamp();
+                    if (object.timestamp()) {
+                        Osmium::O5M::append_zigzag(m_data, object.changeset() - m_delta_changeset);
+                        m_delta_changeset = object.changeset();
+                        std::string uid_and_user;
+                        if (object.uid() > 0) {
+                            Osmium::O5M::append_varint(uid_and_user, object.uid());
+                        }
+                        uid_and_user += '\0';
+                        uid_and_user += object.user();
+                        uid_and_user += '\0';
+                        m_strings.append(m_data, uid_and_user, 2);
+                    }
+                } else {
+                    m_data += '\0';
+                }
+
+                return object.visible() || !m_file.has_multiple_object_versions();
+            }
+
+            void write_tags(const Osmium::OSM::TagList& tags) {
+                std::string key_and_value;
+                Osmium::OSM::TagList::const_iterator end = tags.end();
+                for (Osmium::OSM::TagList::const_iterator it = tags.begin(); it != end; ++it) {
+                    key_and_value = it->key();
+                    key_and_value += '\0';
+                    key_and_value += it->value();
+                    key_and_value += '\0';
+                    m_strings.append(m_data, key_and_value, 2);
+                }
+            }
+
+            void write_dataset(Osmium::O5M::dataset_type_t type) {
+                m_buffer += static_cast<char>(type);
+                Osmium::O5M::append_varint(m_buffer, m_data.size());
+                m_buffer += m_data;
+                if (m_buffer.size() >= flush_size) {
+                    flush();
+                }
+            }
+
+            void flush() {
+                const char* data = m_buffer.data();
+                size_t size = m_buffer.size();
+                while (size > 0) {
+                    const ssize_t length = ::write(fd(), data, size);
+                    if (length < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error("write error");
+                    }
+                    data += length;
+                    size -= length;
+                }
+                m_buffer.clear();
+            }
+
+        }; // class O5M
+
+        namespace {
+
+            inline Osmium::Output::Base* CreateOutputO5M(const Osmium::OSMFile& file) {
+                return new Osmium::Output::O5M(file);
+            }
+
+            const bool o5m_registered = Osmium::Output::Factory::instance().register_output_format(Osmium::OSMFile::FileEncoding::O5M(), CreateOutputO5M);
+
+        } // namespace
+
+    } // namespace Output
+
+} // namespace Osmium
+
+#endif // OSMIUM_OUTPUT_O5M_HPP
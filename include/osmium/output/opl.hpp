@@ -0,0 +1,187 @@
+#ifndef OSMIUM_OUTPUT_OPL_HPP
+#define OSMIUM_OUTPUT_OPL_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+#include <osmium/output.hpp>
+#include <osmium/utils/opl.hpp>
+#include <osmium/utils/timestamp.hpp>
+
+namespace Osmium {
+
+    namespace Output {
+
+        /**
+         * Writes OPL files, one object per line. See Osmium::OPL for the
+         * format.
+         *
+         * The lines are assembled in a buffer without any printf style
+         * formatting, numbers and coordinates are converted by hand. The
+         * buffer is written to the file when it gets large. The bounding
+         * box of the input is not written, OPL has no header.
+         */
+        class OPL : public Base {
+
+            // objects of this class can't be copied
+            OPL(const OPL&);
+            OPL& operator=(const OPL&);
+
+        public:
+
+            OPL(const Osmium::OSMFile& file) :
+                Base(file),
+                m_buffer() {
+                m_buffer.reserve(flush_size + 64 * 1024);
+            }
+
+            void init(Osmium::OSM::Meta&) {
+            }
+
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                m_buffer += 'n';
+                write_meta(*node);
+                m_buffer += " x";
+                if (node->position().defined()) {
+                    Osmium::OPL::append_coordinate(m_buffer, node->position().x());
+                }
+                m_buffer += " y";
+                if (node->position().defined()) {
+                    Osmium::OPL::append_coordinate(m_buffer, node->position().y());
+                }
+                end_line();
+            }
+
+            void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+                m_buffer += 'w';
+                write_meta(*way);
+                m_buffer += " N";
+                Osmium::OSM::WayNodeList::const_iterator end = way->nodes().end();
+                for (Osmium::OSM::WayNodeList::const_iterator it = way->nodes().begin(); it != end; ++it) {
+                    if (it != way->nodes().begin()) {
+                        m_buffer += ',';
+                    }
+                    m_buffer += 'n';
+                    Osmium::OPL::append_integer(m_buffer, it->ref());
+                }
+                end_line();
+            }
+
+            void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+                m_buffer += 'r';
+                write_meta(*relation);
+                m_buffer += " M";
+                Osmium::OSM::RelationMemberList::const_iterator end = relation->members().end();
+                for (Osmium::OSM::RelationMemberList::const_iterator it = relation->members().begin(); it != end; ++it) {
+                    if (it != relation->members().begin()) {
+                        m_buffer += ',';
+                    }
+                    m_buffer += it->type();
+                    Osmium::OPL::append_integer(m_buffer, it->ref());
+                    m_buffer += '@';
+                    Osmium::OPL::append_encoded(m_buffer, it->role());
+                }
+                end_line();
+            }
+
+            void final() {
+                flush();
+                m_file.close();
+            }
+
+        private:
+
+            /// Output is collected here and written when it gets large.
+            std::string m_buffer;
+
+            /// Write to the file when the buffer has grown to this size.
+            enum { flush_size = 1024 * 1024 };
+
+            void write_meta(const Osmium::OSM::Object& object) {
+                Osmium::OPL::append_integer(m_buffer, object.id());
+                m_buffer += " v";
+                Osmium::OPL::append_integer(m_buffer, object.version());
+                m_buffer += object.visible() ? " dV c" : " dD c";
+                Osmium::OPL::append_integer(m_buffer, object.changeset());
+                m_buffer += " t";
+                Osmium::Timestamp::append_iso(m_buffer, object.timestamp());
+                m_buffer += " i";
+                Osmium::OPL::append_integer(m_buffer, object.uid());
+                m_buffer += " u";
+                Osmium::OPL::append_encoded(m_buffer, object.user());
+                m_buffer += " T";
+                Osmium::OSM::TagList::const_iterator end = object.tags().end();
+                for (Osmium::OSM::TagList::const_iterator it = object.tags().begin(); it != end; ++it) {
+                    if (it != object.tags().begin()) {
+                        m_buffer += ',';
+                    }
+                    Osmium::OPL::append_encoded(m_buffer, it->key());
+                    m_buffer += '=';
+                    Osmium::OPL::append_encoded(m_buffer, it->value());
+                }
+            }
+
+            void end_line() {
+                m_buffer += '\n';
+                if (m_buffer.size() >= flush_size) {
+                    flush();
+                }
+            }
+
+            void flush() {
+                const char* data = m_buffer.data();
+                size_t size = m_buffer.size();
+                while (size > 0) {
+                    const ssize_t length = ::write(fd(), data, size);
+                    if (length < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error("write error");
+                    }
+                    data += length;
+                    size -= length;
+                }
+                m_buffer.clear();
+            }
+
+        }; // class OPL
+
+        namespace {
+
+            inline Osmium::Output::Base* CreateOutputOPL(const Osmium::OSMFile& file) {
+                return new Osmium::Output::OPL(file);
+            }
+
+            const bool opl_registered = Osmium::Output::Factory::instance().register_output_format(Osmium::OSMFile::FileEncoding::OPL(), CreateOutputOPL);
+
+        } // namespace
+
+    } // namespace Output
+
+} // namespace Osmium
+
+#endif // OSMIUM_OUTPUT_OPL_HPP
@@ -40,7 +40,8 @@ file contains multiple sequences of
  3. a Blob
 
 The BlobHeader tells the reader about the type and size of the following Blob. The
-Blob can contain data in raw or zlib-compressed form. After uncompressing the blob
+Blob can contain data in raw or zlib-compressed form (or compressed with lzma,
+lz4, or zstd, which only few programs can read). After uncompressing the blob
 it is treated differently depending on the type specified in the BlobHeader.
 
 The contents of the Blob belongs to the higher level. It contains either an HeaderBlock
@@ -87,9 +88,17 @@ More complete outlines of real .osm.pbf files can be created using the osmpbf-ou
 */
 
 #include <algorithm>
+#include <cerrno>
 #include <cmath>
+#include <string>
+#include <vector>
 #include <osmpbf/osmpbf.h>
-#include <zlib.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 #ifndef WIN32
 # include <netinet/in.h>
@@ -99,262 +108,286 @@ More complete outlines of real .osm.pbf files can be created using the osmpbf-ou
 
 #include <osmium/utils/stringtable.hpp>
 #include <osmium/utils/delta.hpp>
+#include <osmium/utils/protobuf.hpp>
+#include <osmium/compression/blob_codec.hpp>
 #include <osmium/output.hpp>
+#include <osmium/thread/pool.hpp>
+#include <osmium/thread/queue.hpp>
 
 namespace Osmium {
 
     namespace Output {
 
-        class PBF : public Base {
-
-            /**
-             * Maximum number of items in a primitive block.
-             *
-             * The uncompressed length of a Blob *should* be less
-             * than 16 megabytes and *must* be less than 32 megabytes.
-             *
-             * A block may contain any number of entities, as long as
-             * the size limits for the surrounding blob are obeyed.
-             * However, for simplicity, the current Osmosis (0.38)
-             * as well as Osmium implementation always
-             * uses at most 8k entities in a block.
-             */
-            static const uint32_t max_block_contents = 8000;
-
-            /**
-             * The output buffer (block) will be filled to about
-             * 95% and then written to disk. This leaves more than
-             * enough space for the string table (which typically
-             * needs about 0.1 to 0.3% of the block size).
-             */
-            static const int buffer_fill_percent = 95;
-
-            /**
-             * protobuf-struct of a Blob
-             */
-            OSMPBF::Blob pbf_blob;
+        /**
+         * A PrimitiveBlock together with its interim StringTable.
+         *
+         * The PBF output class fills a block and hands it to encode(),
+         * which sorts the StringTable, maps the interim string ids, and
+         * serializes and compresses the block. This can run on any
+         * thread. The result is the complete blob as it is written to the
+         * file, get it with wait().
+         *
+         * After the blob was written, the block can be used again with
+         * reset(). It keeps the memory of its PrimitiveBlock and
+         * StringTable, so filling it again needs hardly any allocations.
+         */
+        class PBFBlock : public Osmium::WithDebug, boost::noncopyable {
 
-            /**
-             * protobuf-struct of a BlobHeader
-             */
-            OSMPBF::BlobHeader pbf_blob_header;
+        public:
 
-            /**
-             * protobuf-struct of a HeaderBlock
-             */
-            OSMPBF::HeaderBlock pbf_header_block;
+            PBFBlock() :
+                Osmium::WithDebug(),
+                m_primitive_block(),
+                m_string_table(),
+                m_nodes(NULL),
+                m_ways(NULL),
+                m_relations(NULL),
+                m_data(),
+                m_error(),
+                m_done(false),
+                m_mutex(),
+                m_encoded() {
+            }
 
-            /**
-             * protobuf-struct of a PrimitiveBlock
-             */
-            OSMPBF::PrimitiveBlock pbf_primitive_block;
+            OSMPBF::PrimitiveBlock& primitive_block() {
+                return m_primitive_block;
+            }
 
-            /**
-             * pointer to PrimitiveGroups inside the current PrimitiveBlock,
-             * used for writing nodes, ways or relations
-             */
-            OSMPBF::PrimitiveGroup* pbf_nodes;
-            OSMPBF::PrimitiveGroup* pbf_ways;
-            OSMPBF::PrimitiveGroup* pbf_relations;
+            Osmium::StringTable& string_table() {
+                return m_string_table;
+            }
 
             /**
-             * To flexibly handle multiple resolutions, the granularity, or
-             * resolution used for representing locations is adjustable in
-             * multiples of 1 nanodegree. The default scaling factor is 100
-             * nanodegrees, corresponding to about ~1cm at the equator.
-             * This is the current resolution of the OSM database.
+             * Get the PrimitiveGroup for nodes, it is added on first use.
              */
-            int m_location_granularity;
+            OSMPBF::PrimitiveGroup* nodes() {
+                if (!m_nodes) {
+                    m_nodes = m_primitive_block.add_primitivegroup();
+                }
+                return m_nodes;
+            }
 
             /**
-             * The granularity used for representing timestamps is also adjustable in
-             * multiples of 1 millisecond. The default scaling factor is 1000
-             * milliseconds, which is the current resolution of the OSM database.
+             * Get the PrimitiveGroup for ways, it is added on first use.
              */
-            int m_date_granularity;
+            OSMPBF::PrimitiveGroup* ways() {
+                if (!m_ways) {
+                    m_ways = m_primitive_block.add_primitivegroup();
+                }
+                return m_ways;
+            }
 
             /**
-             * should nodes be serialized into the dense format?
-             *
-             * nodes can be encoded one of two ways, as a Node
-             * (m_use_dense_format = false) and a special dense format.
-             * In the dense format, all information is stored 'column wise',
-             * as an array of ID's, array of latitudes, and array of
-             * longitudes. Each column is delta-encoded. This reduces
-             * header overheads and allows delta-coding to work very effectively.
+             * Get the PrimitiveGroup for relations, it is added on first use.
              */
-            bool m_use_dense_format;
+            OSMPBF::PrimitiveGroup* relations() {
+                if (!m_relations) {
+                    m_relations = m_primitive_block.add_primitivegroup();
+                }
+                return m_relations;
+            }
 
             /**
-             * should the PBF blobs contain zlib compressed data?
+             * Store the interim StringTable into the block, map all interim
+             * string ids to real StringTable ids and encode the block into
+             * a blob. Errors are remembered and thrown from wait(). The
+             * PrimitiveBlock and StringTable are cleared afterwards, but
+             * keep their memory.
              *
-             * the zlib compression is optional, it's possible to store the
-             * blobs in raw format. Disabling the compression can improve the
-             * writing speed a little but the output will be 2x to 3x bigger.
+             * @param codec Compression used for the blob.
              */
-            bool m_use_compression;
+            void encode(const Osmium::Compression::BlobCodec& codec) {
+                std::string error;
+                try {
+                    // store the interim StringTable into the protobuf object
+                    m_string_table.store_stringtable(m_primitive_block.mutable_stringtable());
+
+                    // map all interim string ids to real ids
+                    map_string_ids();
+
+                    encode_blob("OSMData", m_primitive_block, codec, m_data, debug && has_debug_level(1));
+                } catch (std::exception& e) {
+                    error = e.what();
+                }
 
-            /**
-             * While the .osm.pbf-format is able to carry all meta information, it is
-             * also able to omit this information to reduce size.
-             */
-            bool m_should_add_metadata;
+                m_primitive_block.Clear();
+                m_string_table.clear();
+                m_nodes = NULL;
+                m_ways = NULL;
+                m_relations = NULL;
 
-            /**
-             * Should the visible flag be added on objects?
-             */
-            bool m_add_visible;
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_error = error;
+                m_done = true;
+                m_encoded.notify_all();
+            }
 
             /**
-             * counter used to quickly check the number of objects stored inside
-             * the current PrimitiveBlock. When the counter reaches max_block_contents
-             * the PrimitiveBlock is serialized into a Blob and flushed to the file.
+             * Use an already encoded OSMData Blob message for this block
+             * instead of encoding the (empty) PrimitiveBlock. The block
+             * is done immediately, wait() returns the blob with its
+             * BlobHeader.
              *
-             * this check is performed in check_block_contents_counter() which is
-             * called once for each object.
+             * @param data The serialized Blob message.
+             * @param size Size of the Blob message.
              */
-            uint16_t primitive_block_contents;
-            uint32_t primitive_block_size;
+            void raw_blob(const char* data, size_t size) {
+                wrap_blob("OSMData", data, size, m_data);
 
-            // StringTable management
-            Osmium::StringTable string_table;
-
-            /// Buffer used while compressing blobs.
-            char m_compression_buffer[OSMPBF::max_uncompressed_blob_size];
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_done = true;
+                m_encoded.notify_all();
+            }
 
             /**
-             * These variables are used to calculate the
-             * delta-encoding while storing dense-nodes. It holds the last seen values
-             * from which the difference is stored into the protobuf.
+             * Prepare the block for being filled again after its blob was
+             * written. Must not be called while encode() is running.
              */
-            Delta<int64_t> m_delta_id;
-            Delta<int64_t> m_delta_lat;
-            Delta<int64_t> m_delta_lon;
-            Delta<int64_t> m_delta_timestamp;
-            Delta<int64_t> m_delta_changeset;
-            Delta<int64_t> m_delta_uid;
-            Delta<uint32_t> m_delta_user_sid;
-
-
-            ///// Blob writing /////
+            void reset() {
+                m_data.clear();
+                m_error.clear();
+                m_done = false;
+            }
 
             /**
-             * Take a string and pack its contents.
+             * Wait until encode() has finished.
              *
-             * @param in String input.
-             * @return Number of bytes after compression.
+             * @returns The encoded blob.
+             * @throws std::runtime_error if there was an error.
              */
-            size_t zlib_compress(const std::string& in) {
-                // zlib compression context
-                z_stream z;
-
-                // next byte to compress
-                z.next_in   = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(in.c_str()));
-
-                // number of bytes to compress
-                z.avail_in  = in.size();
-
-                // place to store compressed bytes
-                z.next_out  = reinterpret_cast<uint8_t*>(m_compression_buffer);
-
-                // space for compressed data
-                z.avail_out = OSMPBF::max_uncompressed_blob_size;
-
-                // custom allocator functions - not used
-                z.zalloc    = Z_NULL;
-                z.zfree     = Z_NULL;
-                z.opaque    = Z_NULL;
-
-                // initiate the compression
-                if (deflateInit(&z, Z_DEFAULT_COMPRESSION) != Z_OK) {
-                    throw std::runtime_error("failed to init zlib stream");
-                }
-
-                // compress
-                if (deflate(&z, Z_FINISH) != Z_STREAM_END) {
-                    throw std::runtime_error("failed to deflate zlib stream");
+            const std::string& wait() {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_done) {
+                    m_encoded.wait(lock);
                 }
-
-                // finish compression
-                if (deflateEnd(&z) != Z_OK) {
-                    throw std::runtime_error("failed to deinit zlib stream");
-                }
-
-                // print debug info about the compression
-                if (debug && has_debug_level(1)) {
-                    std::cerr << "pack " << in.size() << " bytes to " << z.total_out << " bytes (1:" << static_cast<double>(in.size()) / z.total_out << ")" << std::endl;
+                if (!m_error.empty()) {
+                    throw std::runtime_error(m_error);
                 }
-
-                // number of compressed bytes
-                return z.total_out;
+                return m_data;
             }
 
             /**
-             * Serialize a protobuf-message together into a Blob, optionally apply compression
-             * and write it together with a BlobHeader to the file.
+             * Serialize a protobuf-message into a Blob, optionally apply
+             * compression and put it together with its BlobHeader and the
+             * size of the BlobHeader into out.
              *
              * @param type Type-string used in the BlobHeader.
              * @param msg Protobuf-message.
+             * @param codec Compression used for the blob.
+             * @param out String the result is written to.
+             * @param print_debug Print information about the compression?
              */
-            void store_blob(const std::string& type, const google::protobuf::MessageLite& msg) {
+            static void encode_blob(const std::string& type, const google::protobuf::MessageLite& msg, const Osmium::Compression::BlobCodec& codec, std::string& out, bool print_debug=false) {
                 // buffer to serialize the protobuf message to
                 std::string data;
 
                 // serialize the protobuf message to the string
                 msg.SerializeToString(&data);
 
-                if (use_compression()) {
-                    // compress using zlib
-                    size_t out = zlib_compress(data);
-
-                    // set the compressed data on the Blob
-                    pbf_blob.set_zlib_data(m_compression_buffer, out);
-                } else { // no compression
+                // The Blob message is assembled by hand, because older
+                // versions of libosmpbf don't know the fields for all
+                // compression types. The fields are written in the order
+                // of their numbers like protobuf does it.
+                std::string blob;
+                if (codec.type() == Osmium::Compression::BlobCodec::none) {
                     // print debug info about the raw data
-                    if (debug && has_debug_level(1)) {
+                    if (print_debug) {
                         std::cerr << "store uncompressed " << data.size() << " bytes" << std::endl;
                     }
 
-                    // just set the raw data on the Blob
-                    pbf_blob.set_raw(data);
-                }
+                    append_bytes(blob, Osmium::Compression::BlobCodec::none, data);
+                    append_raw_size(blob, data.size());
+                } else {
+                    std::string compressed;
+                    codec.compress(data, compressed);
 
-                // set the size of the uncompressed data on the blob
-                pbf_blob.set_raw_size(data.size());
+                    // print debug info about the compression
+                    if (print_debug) {
+                        std::cerr << "pack " << data.size() << " bytes to " << compressed.size() << " bytes with " << codec.name() << " (1:" << static_cast<double>(data.size()) / compressed.size() << ")" << std::endl;
+                    }
+
+                    append_raw_size(blob, data.size());
+                    append_bytes(blob, codec.type(), compressed);
+                }
 
-                // clear the blob string
-                data.clear();
+                wrap_blob(type, blob.data(), blob.size(), out);
+            }
 
-                // serialize and clear the Blob
-                pbf_blob.SerializeToString(&data);
-                pbf_blob.Clear();
+            /**
+             * Put a serialized Blob message together with its BlobHeader
+             * and the size of the BlobHeader into out.
+             *
+             * @param type Type-string used in the BlobHeader.
+             * @param blob The serialized Blob message.
+             * @param size Size of the Blob message.
+             * @param out String the result is written to.
+             */
+            static void wrap_blob(const std::string& type, const char* blob, size_t size, std::string& out) {
+                // protobuf-struct of a BlobHeader
+                OSMPBF::BlobHeader pbf_blob_header;
 
                 // set the header-type to the supplied string on the BlobHeader
                 pbf_blob_header.set_type(type);
 
                 // set the size of the serialized blob on the BlobHeader
-                pbf_blob_header.set_datasize(data.size());
+                pbf_blob_header.set_datasize(size);
 
                 // a place to serialize the BlobHeader to
                 std::string blobhead;
 
-                // serialize and clear the BlobHeader
+                // serialize the BlobHeader
                 pbf_blob_header.SerializeToString(&blobhead);
-                pbf_blob_header.Clear();
 
                 // the 4-byte size of the BlobHeader, transformed from Host- to Network-Byte-Order
                 uint32_t sz = htonl(blobhead.size());
 
-                // write to the file: the 4-byte BlobHeader-Size followed by the BlobHeader followed by the Blob
-                if (::write(fd(), &sz, sizeof(sz)) < 0) {
-                    throw std::runtime_error("file error");
-                }
-                if (::write(fd(), blobhead.c_str(), blobhead.size()) < 0) {
-                    throw std::runtime_error("file error");
-                }
-                if (::write(fd(), data.c_str(), data.size()) < 0) {
-                    throw std::runtime_error("file error");
+                // the 4-byte BlobHeader-Size followed by the BlobHeader followed by the Blob
+                out.reserve(sizeof(sz) + blobhead.size() + size);
+                out.assign(reinterpret_cast<const char*>(&sz), sizeof(sz));
+                out += blobhead;
+                out.append(blob, size);
+            }
+
+        private:
+
+            OSMPBF::PrimitiveBlock m_primitive_block;
+            Osmium::StringTable m_string_table;
+
+            /**
+             * pointer to PrimitiveGroups inside the PrimitiveBlock,
+             * used for writing nodes, ways or relations
+             */
+            OSMPBF::PrimitiveGroup* m_nodes;
+            OSMPBF::PrimitiveGroup* m_ways;
+            OSMPBF::PrimitiveGroup* m_relations;
+
+            /// The encoded blob.
+            std::string m_data;
+
+            std::string m_error;
+            bool m_done;
+            boost::mutex m_mutex;
+            boost::condition_variable m_encoded;
+
+            static void append_varint(std::string& out, uint64_t value) {
+                while (value >= 0x80) {
+                    out += static_cast<char>((value & 0x7f) | 0x80);
+                    value >>= 7;
                 }
+                out += static_cast<char>(value);
+            }
+
+            /// Append the raw_size field of a Blob message.
+            static void append_raw_size(std::string& out, size_t size) {
+                out += static_cast<char>((2 << 3) | Osmium::Protobuf::wire_varint);
+                append_varint(out, size);
+            }
+
+            /// Append a field with data to a Blob message.
+            static void append_bytes(std::string& out, int field, const std::string& data) {
+                out += static_cast<char>((field << 3) | Osmium::Protobuf::wire_length_delimited);
+                append_varint(out, data.size());
+                out += data;
             }
 
             /**
@@ -365,26 +398,29 @@ namespace Osmium {
              * all occurrences of string-ids.
              */
             void map_string_ids() {
+                // delta encoding of the user names in dense nodes
+                Delta<uint32_t> delta_user_sid;
+
                 // test, if the node-block has been allocated
-                if (pbf_nodes) {
+                if (m_nodes) {
                     // iterate over all nodes, passing them to the map_common_string_ids function
-                    for (int i=0, l=pbf_nodes->nodes_size(); i<l; i++) {
-                        map_common_string_ids(pbf_nodes->mutable_nodes(i));
+                    for (int i=0, l=m_nodes->nodes_size(); i<l; i++) {
+                        map_common_string_ids(m_nodes->mutable_nodes(i));
                     }
 
                     // test, if the node-block has a densenodes structure
-                    if (pbf_nodes->has_dense()) {
+                    if (m_nodes->has_dense()) {
                         // get a pointer to the densenodes structure
-                        OSMPBF::DenseNodes* dense = pbf_nodes->mutable_dense();
+                        OSMPBF::DenseNodes* dense = m_nodes->mutable_dense();
 
                         // in the densenodes structure keys and vals are encoded in an intermixed
                         // array, individual nodes are seperated by a value of 0 (0 in the StringTable
                         // is always unused). String-ids of 0 are thus kept alone.
                         for (int i=0, l=dense->keys_vals_size(); i<l; i++) {
                             // map interim string-ids > 0 to real string ids
-                            uint16_t sid = dense->keys_vals(i);
+                            uint32_t sid = dense->keys_vals(i);
                             if (sid > 0) {
-                                dense->set_keys_vals(i, string_table.map_string_id(sid));
+                                dense->set_keys_vals(i, m_string_table.map_string_id(sid));
                             }
                         }
 
@@ -396,29 +432,29 @@ namespace Osmium {
                             // iterate over all username string-ids
                             for (int i=0, l= denseinfo->user_sid_size(); i<l; i++) {
                                 // map interim string-ids > 0 to real string ids
-                                uint16_t user_sid = string_table.map_string_id(denseinfo->user_sid(i));
+                                uint32_t user_sid = m_string_table.map_string_id(denseinfo->user_sid(i));
 
                                 // delta encode the string-id
-                                denseinfo->set_user_sid(i, m_delta_user_sid.update(user_sid));
+                                denseinfo->set_user_sid(i, delta_user_sid.update(user_sid));
                             }
                         }
                     }
                 }
 
                 // test, if the ways-block has been allocated
-                if (pbf_ways) {
+                if (m_ways) {
                     // iterate over all ways, passing them to the map_common_string_ids function
-                    for (int i=0, l=pbf_ways->ways_size(); i<l; i++) {
-                        map_common_string_ids(pbf_ways->mutable_ways(i));
+                    for (int i=0, l=m_ways->ways_size(); i<l; i++) {
+                        map_common_string_ids(m_ways->mutable_ways(i));
                     }
                 }
 
                 // test, if the relations-block has been allocated
-                if (pbf_relations) {
+                if (m_relations) {
                     // iterate over all relations
-                    for (int i=0, l=pbf_relations->relations_size(); i<l; i++) {
+                    for (int i=0, l=m_relations->relations_size(); i<l; i++) {
                         // get a pointer to the relation
-                        OSMPBF::Relation* relation = pbf_relations->mutable_relations(i);
+                        OSMPBF::Relation* relation = m_relations->mutable_relations(i);
 
                         // pass them to the map_common_string_ids function
                         map_common_string_ids(relation);
@@ -426,7 +462,7 @@ namespace Osmium {
                         // iterate over all relation members, mapping the interim string-ids
                         // of the role to real string ids
                         for (int mi=0, ml=relation->roles_sid_size(); mi<ml; mi++) {
-                            relation->set_roles_sid(mi, string_table.map_string_id(relation->roles_sid(mi)));
+                            relation->set_roles_sid(mi, m_string_table.map_string_id(relation->roles_sid(mi)));
                         }
                     }
                 }
@@ -444,16 +480,266 @@ namespace Osmium {
                 if (in->has_info()) {
                     // map the interim-id of the user name to a real id
                     OSMPBF::Info* info = in->mutable_info();
-                    info->set_user_sid(string_table.map_string_id(info->user_sid()));
+                    info->set_user_sid(m_string_table.map_string_id(info->user_sid()));
                 }
 
                 // iterate over all tags and map the interim-ids of the key and the value to real ids
                 for (int i=0, l=in->keys_size(); i<l; i++) {
-                    in->set_keys(i, string_table.map_string_id(in->keys(i)));
-                    in->set_vals(i, string_table.map_string_id(in->vals(i)));
+                    in->set_keys(i, m_string_table.map_string_id(in->keys(i)));
+                    in->set_vals(i, m_string_table.map_string_id(in->vals(i)));
+                }
+            }
+
+        }; // class PBFBlock
+
+        /**
+         * Writes PBF files.
+         *
+         * Filled blocks are encoded (StringTable sorting, serialization,
+         * and compression) on a pool of worker threads and written to
+         * the file in order by a separate writer thread. The number of
+         * filled blocks not yet written is limited, the thread adding
+         * objects blocks when the limit is reached.
+         *
+         * The number of threads has to be set before init() is called:
+         *
+         * @code
+         * Osmium::Output::PBF output(file);
+         * output.num_workers(4).max_blocks_in_flight(8);
+         * @endcode
+         */
+        class PBF : public Base {
+
+            /**
+             * Maximum number of items in a primitive block.
+             *
+             * The uncompressed length of a Blob *should* be less
+             * than 16 megabytes and *must* be less than 32 megabytes.
+             *
+             * A block may contain any number of entities, as long as
+             * the size limits for the surrounding blob are obeyed.
+             * However, for simplicity, the current Osmosis (0.38)
+             * as well as Osmium implementation always
+             * uses at most 8k entities in a block.
+             */
+            static const uint32_t max_block_contents = 8000;
+
+            /**
+             * The output buffer (block) will be filled to about
+             * 95% and then written to disk. This leaves more than
+             * enough space for the string table (which typically
+             * needs about 0.1 to 0.3% of the block size).
+             */
+            static const int buffer_fill_percent = 95;
+
+            /**
+             * protobuf-struct of a HeaderBlock
+             */
+            OSMPBF::HeaderBlock pbf_header_block;
+
+            /**
+             * To flexibly handle multiple resolutions, the granularity, or
+             * resolution used for representing locations is adjustable in
+             * multiples of 1 nanodegree. The default scaling factor is 100
+             * nanodegrees, corresponding to about ~1cm at the equator.
+             * This is the current resolution of the OSM database.
+             */
+            int m_location_granularity;
+
+            /**
+             * The granularity used for representing timestamps is also adjustable in
+             * multiples of 1 millisecond. The default scaling factor is 1000
+             * milliseconds, which is the current resolution of the OSM database.
+             */
+            int m_date_granularity;
+
+            /**
+             * should nodes be serialized into the dense format?
+             *
+             * nodes can be encoded one of two ways, as a Node
+             * (m_use_dense_format = false) and a special dense format.
+             * In the dense format, all information is stored 'column wise',
+             * as an array of ID's, array of latitudes, and array of
+             * longitudes. Each column is delta-encoded. This reduces
+             * header overheads and allows delta-coding to work very effectively.
+             */
+            bool m_use_dense_format;
+
+            /**
+             * how should the PBF blobs be compressed?
+             *
+             * the compression is optional, it's possible to store the
+             * blobs in raw format. Disabling the compression can improve the
+             * writing speed a little but the output will be 2x to 3x bigger.
+             * Other codecs than zlib can be faster or give smaller files,
+             * but most other programs can't read them. They are only used
+             * for the data blocks, the header is always compressed with zlib.
+             */
+            Osmium::Compression::BlobCodec m_compression;
+
+            /**
+             * While the .osm.pbf-format is able to carry all meta information, it is
+             * also able to omit this information to reduce size.
+             */
+            bool m_should_add_metadata;
+
+            /**
+             * Should the visible flag be added on objects?
+             */
+            bool m_add_visible;
+
+            /**
+             * Should the locations of the way nodes be added to ways?
+             */
+            bool m_locations_on_ways;
+
+            /**
+             * counter used to quickly check the number of objects stored inside
+             * the current PrimitiveBlock. When the counter reaches max_block_contents
+             * the PrimitiveBlock is serialized into a Blob and flushed to the file.
+             *
+             * this check is performed in check_block_contents_counter() which is
+             * called once for each object.
+             */
+            uint16_t primitive_block_contents;
+            uint32_t primitive_block_size;
+
+            /**
+             * These variables are used to calculate the
+             * delta-encoding while storing dense-nodes. It holds the last seen values
+             * from which the difference is stored into the protobuf.
+             */
+            Delta<int64_t> m_delta_id;
+            Delta<int64_t> m_delta_lat;
+            Delta<int64_t> m_delta_lon;
+            Delta<int64_t> m_delta_timestamp;
+            Delta<int64_t> m_delta_changeset;
+            Delta<int64_t> m_delta_uid;
+
+            /**
+             * Number of threads encoding blocks. If this is 0, blocks are
+             * encoded and written in the thread calling the output
+             * functions.
+             */
+            int m_num_workers;
+
+            /**
+             * Maximum number of filled blocks not yet written to the file.
+             * This limits the memory use.
+             */
+            int m_max_blocks_in_flight;
+
+            typedef shared_ptr<PBFBlock> block_ptr_t;
+            typedef Osmium::Thread::Queue<block_ptr_t> block_queue_t;
+
+            /// The block currently filled.
+            block_ptr_t m_block;
+
+            /// The worker threads encoding blocks, only used if m_num_workers > 0.
+            boost::scoped_ptr<Osmium::Thread::Pool> m_pool;
+
+            /// The filled blocks in the order they have to be written.
+            boost::scoped_ptr<block_queue_t> m_queue;
+
+            /// Thread writing the encoded blocks to the file.
+            boost::scoped_ptr<boost::thread> m_writer;
+
+            /**
+             * Blocks already written, which can be filled again. The writer
+             * thread adds them, new_block() takes them. Protected by
+             * m_free_blocks_mutex.
+             */
+            std::vector<block_ptr_t> m_free_blocks;
+            boost::mutex m_free_blocks_mutex;
+
+            /// Error from the writer thread, protected by m_error_mutex.
+            std::string m_write_error;
+            boost::mutex m_error_mutex;
+
+
+            ///// Blob writing /////
+
+            /**
+             * Write data to the file.
+             */
+            void write_data(const std::string& data) {
+                const char* buffer = data.data();
+                size_t size = data.size();
+                while (size > 0) {
+                    const ssize_t length = ::write(fd(), buffer, size);
+                    if (length < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw std::runtime_error("file error");
+                    }
+                    buffer += length;
+                    size -= length;
+                }
+            }
+
+            /**
+             * This runs in the writer thread. It waits for the blocks in
+             * the queue to be encoded and writes them in order. A NULL
+             * pointer in the queue marks the end. If anything fails, the
+             * queue is shut down so that nothing more can be added.
+             */
+            void write_blocks() {
+                try {
+                    block_ptr_t block;
+                    while (m_queue->pop(block) && block) {
+                        write_data(block->wait());
+                        free_block(block);
+                    }
+                } catch (std::exception& e) {
+                    boost::lock_guard<boost::mutex> lock(m_error_mutex);
+                    m_write_error = e.what();
+                    m_queue->shutdown();
                 }
             }
 
+            /**
+             * Put a block, whose blob was written, into the list of free
+             * blocks.
+             */
+            void free_block(const block_ptr_t& block) {
+                boost::lock_guard<boost::mutex> lock(m_free_blocks_mutex);
+                m_free_blocks.push_back(block);
+            }
+
+            /**
+             * Throw an exception if the writer thread had an error.
+             */
+            void check_write_error() {
+                boost::lock_guard<boost::mutex> lock(m_error_mutex);
+                if (!m_write_error.empty()) {
+                    throw std::runtime_error(m_write_error);
+                }
+            }
+
+            /**
+             * Start the worker threads and the writer thread.
+             */
+            void start_threads() {
+                m_pool.reset(new Osmium::Thread::Pool(m_num_workers));
+                m_queue.reset(new block_queue_t(m_max_blocks_in_flight));
+                m_writer.reset(new boost::thread(boost::bind(&PBF::write_blocks, this)));
+            }
+
+            /**
+             * Wait for the writer thread to finish and stop all threads.
+             * The pool is destroyed last, so that all blocks the writer
+             * thread might wait for are encoded.
+             */
+            void stop_threads() {
+                if (m_writer) {
+                    m_writer->join();
+                    m_writer.reset();
+                }
+                m_queue.reset();
+                m_pool.reset();
+            }
+
 
             ///// MetaData helper /////
 
@@ -464,6 +750,15 @@ namespace Osmium {
                 return round(lonlat * OSMPBF::lonlat_resolution / location_granularity());
             }
 
+            /**
+             * the int stored for the lat and lon of way nodes without a position. this is
+             * the invalid coordinate, which is outside the valid range, like other programs
+             * writing LocationsOnWays store it.
+             */
+            int64_t undefined_lonlat() {
+                return static_cast<int64_t>(Osmium::OSM::Position::invalid) * (OSMPBF::lonlat_resolution / Osmium::OSM::coordinate_precision) / location_granularity();
+            }
+
             /**
              * convert a timestamp to an int, respecting the current blocks granularity
              */
@@ -486,8 +781,8 @@ namespace Osmium {
                 // interim StringTable and storing the interim ids
                 Osmium::OSM::TagList::const_iterator end = in->tags().end();
                 for (Osmium::OSM::TagList::const_iterator it = in->tags().begin(); it != end; ++it) {
-                    out->add_keys(string_table.record_string(it->key()));
-                    out->add_vals(string_table.record_string(it->value()));
+                    out->add_keys(m_block->string_table().record_string(it->key()));
+                    out->add_vals(m_block->string_table().record_string(it->value()));
                 }
 
                 if (should_add_metadata()) {
@@ -500,7 +795,7 @@ namespace Osmium {
                     out_info->set_timestamp(timestamp2int(in->timestamp()));
                     out_info->set_changeset(in->changeset());
                     out_info->set_uid(in->uid());
-                    out_info->set_user_sid(string_table.record_string(in->user()));
+                    out_info->set_user_sid(m_block->string_table().record_string(in->user()));
                 }
             }
 
@@ -509,19 +804,25 @@ namespace Osmium {
 
             /**
              * store the current pbf_header_block into a Blob and clear this struct afterwards.
+             * the header is compressed with zlib (or not at all, if compression is disabled)
+             * whatever codec is used for the data blocks, so every reader can read it.
              */
             void store_header_block() {
                 if (debug && has_debug_level(1)) {
                     std::cerr << "storing header block" << std::endl;
                 }
-                store_blob("OSMHeader", pbf_header_block);
+                const Osmium::Compression::BlobCodec codec = m_compression.type() == Osmium::Compression::BlobCodec::none ? m_compression : Osmium::Compression::BlobCodec();
+                std::string data;
+                PBFBlock::encode_blob("OSMHeader", pbf_header_block, codec, data, debug && has_debug_level(1));
+                write_data(data);
                 pbf_header_block.Clear();
             }
 
             /**
-             * store the interim StringTable to the current pbf_primitive_block, map all interim string ids
-             * to real StringTable ids and then store the current pbf_primitive_block into a Blob and clear
-             * this struct and all related pointers and maps afterwards.
+             * hand the current block over to be encoded and written and start a new one. the
+             * interim StringTable is stored into the block, all interim string ids are mapped
+             * to real StringTable ids and the block is serialized and compressed, either in
+             * one of the worker threads or, if there are none, right here.
              */
             void store_primitive_block() {
                 if (debug && has_debug_level(1)) {
@@ -529,23 +830,55 @@ namespace Osmium {
                 }
 
                 // set the granularity
-                pbf_primitive_block.set_granularity(location_granularity());
-                pbf_primitive_block.set_date_granularity(date_granularity());
+                m_block->primitive_block().set_granularity(location_granularity());
+                m_block->primitive_block().set_date_granularity(date_granularity());
 
-                // store the interim StringTable into the protobuf object
-                string_table.store_stringtable(pbf_primitive_block.mutable_stringtable());
+                if (debug && has_debug_level(1)) {
+                    m_block->set_debug_level(1);
+                }
 
-                // map all interim string ids to real ids
-                map_string_ids();
+                if (m_queue) {
+                    if (!m_queue->push(m_block)) {
+                        check_write_error();
+                        throw std::runtime_error("writer thread stopped");
+                    }
+                    m_pool->submit(boost::bind(&PBFBlock::encode, m_block, m_compression));
+                } else {
+                    m_block->encode(m_compression);
+                    write_data(m_block->wait());
+                    free_block(m_block);
+                }
 
-                // store the Blob
-                store_blob("OSMData", pbf_primitive_block);
+                new_block();
+            }
 
-                // clear the PrimitiveBlock struct
-                pbf_primitive_block.Clear();
+            /**
+             * Get an empty block. Blocks already written are reused, a new
+             * one is only allocated if there is none.
+             */
+            block_ptr_t get_free_block() {
+                block_ptr_t block;
+                {
+                    boost::lock_guard<boost::mutex> lock(m_free_blocks_mutex);
+                    if (!m_free_blocks.empty()) {
+                        block = m_free_blocks.back();
+                        m_free_blocks.pop_back();
+                    }
+                }
+                if (block) {
+                    block->reset();
+                } else {
+                    block = make_shared<PBFBlock>();
+                }
+                return block;
+            }
 
-                // clear the interim StringTable and its id map
-                string_table.clear();
+            /**
+             * start a new, empty block and reset everything that refers to the current block.
+             */
+            void new_block() {
+                m_block.reset();
+                m_block = get_free_block();
 
                 // reset the delta variables
                 m_delta_id.clear();
@@ -554,16 +887,10 @@ namespace Osmium {
                 m_delta_timestamp.clear();
                 m_delta_changeset.clear();
                 m_delta_uid.clear();
-                m_delta_user_sid.clear();
 
                 // reset the contents-counter to zero
                 primitive_block_contents = 0;
                 primitive_block_size = 0;
-
-                // reset the node/way/relation pointers to NULL
-                pbf_nodes = NULL;
-                pbf_ways = NULL;
-                pbf_relations = NULL;
             }
 
             /**
@@ -599,7 +926,7 @@ namespace Osmium {
              */
             void write_node(const shared_ptr<Osmium::OSM::Node const>& node) {
                 // add a way to the group
-                OSMPBF::Node* pbf_node = pbf_nodes->add_nodes();
+                OSMPBF::Node* pbf_node = m_block->nodes()->add_nodes();
 
                 // copy the common meta-info from the osmium-object to the pbf-object
                 apply_common_info(node, pbf_node);
@@ -617,7 +944,7 @@ namespace Osmium {
              */
             void write_dense_node(const shared_ptr<Osmium::OSM::Node const>& node) {
                 // add a DenseNodes-Section to the PrimitiveGroup
-                OSMPBF::DenseNodes* dense = pbf_nodes->mutable_dense();
+                OSMPBF::DenseNodes* dense = m_block->nodes()->mutable_dense();
 
                 // copy the id, delta encoded
                 dense->add_id(m_delta_id.update(node->id()));
@@ -636,8 +963,8 @@ namespace Osmium {
                 // have any tags and the third node has a single tag (8=>5)
                 Osmium::OSM::TagList::const_iterator end = node->tags().end();
                 for (Osmium::OSM::TagList::const_iterator it = node->tags().begin(); it != end; ++it) {
-                    dense->add_keys_vals(string_table.record_string(it->key()));
-                    dense->add_keys_vals(string_table.record_string(it->value()));
+                    dense->add_keys_vals(m_block->string_table().record_string(it->key()));
+                    dense->add_keys_vals(m_block->string_table().record_string(it->value()));
                 }
                 dense->add_keys_vals(0);
 
@@ -662,7 +989,7 @@ namespace Osmium {
 
                     // record the user-name to the interim stringtable and copy the
                     // interim string-id to the pbf-object
-                    denseinfo->add_user_sid(string_table.record_string(node->user()));
+                    denseinfo->add_user_sid(m_block->string_table().record_string(node->user()));
                 }
             }
 
@@ -673,7 +1000,7 @@ namespace Osmium {
              */
             void write_way(const shared_ptr<Osmium::OSM::Way const>& way) {
                 // add a way to the group
-                OSMPBF::Way* pbf_way = pbf_ways->add_ways();
+                OSMPBF::Way* pbf_way = m_block->ways()->add_ways();
 
                 // copy the common meta-info from the osmium-object to the pbf-object
                 apply_common_info(way, pbf_way);
@@ -687,6 +1014,20 @@ namespace Osmium {
                     pbf_way->add_refs(delta_id.update(way->get_node_id(i)));
                 }
 
+                if (m_locations_on_ways) {
+                    Delta<int64_t> delta_lat;
+                    Delta<int64_t> delta_lon;
+                    for (Osmium::OSM::WayNodeList::const_iterator it = way->nodes().begin(); it != way->nodes().end(); ++it) {
+                        if (it->position().defined()) {
+                            pbf_way->add_lat(delta_lat.update(lonlat2int(it->position().lat())));
+                            pbf_way->add_lon(delta_lon.update(lonlat2int(it->position().lon())));
+                        } else {
+                            pbf_way->add_lat(delta_lat.update(undefined_lonlat()));
+                            pbf_way->add_lon(delta_lon.update(undefined_lonlat()));
+                        }
+                    }
+                }
+
                 // count up blob size by the size of the Way
                 primitive_block_size += pbf_way->ByteSize();
             }
@@ -698,7 +1039,7 @@ namespace Osmium {
              */
             void write_relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
                 // add a relation to the group
-                OSMPBF::Relation* pbf_relation = pbf_relations->add_relations();
+                OSMPBF::Relation* pbf_relation = m_block->relations()->add_relations();
 
                 // copy the common meta-info from the osmium-object to the pbf-object
                 apply_common_info(relation, pbf_relation);
@@ -712,7 +1053,7 @@ namespace Osmium {
 
                     // record the relation-member role to the interim stringtable and copy the
                     // interim string-id to the pbf-object
-                    pbf_relation->add_roles_sid(string_table.record_string(mem->role()));
+                    pbf_relation->add_roles_sid(m_block->string_table().record_string(mem->role()));
 
                     // copy the relation-member-id, delta encoded
                     pbf_relation->add_memids(delta_id.update(mem->ref()));
@@ -748,34 +1089,77 @@ namespace Osmium {
              */
             PBF(const Osmium::OSMFile& file) :
                 Base(file),
-                pbf_blob(),
-                pbf_blob_header(),
                 pbf_header_block(),
-                pbf_primitive_block(),
-                pbf_nodes(NULL),
-                pbf_ways(NULL),
-                pbf_relations(NULL),
-                m_location_granularity(pbf_primitive_block.granularity()),
-                m_date_granularity(pbf_primitive_block.date_granularity()),
+                m_location_granularity(OSMPBF::PrimitiveBlock().granularity()),
+                m_date_granularity(OSMPBF::PrimitiveBlock().date_granularity()),
                 m_use_dense_format(true),
-                m_use_compression(true),
+                m_compression(),
                 m_should_add_metadata(true),
                 m_add_visible(file.has_multiple_object_versions()),
+                m_locations_on_ways(false),
                 primitive_block_contents(0),
                 primitive_block_size(0),
-                string_table(),
-                m_compression_buffer(),
                 m_delta_id(),
                 m_delta_lat(),
                 m_delta_lon(),
                 m_delta_timestamp(),
                 m_delta_changeset(),
                 m_delta_uid(),
-                m_delta_user_sid() {
+                m_num_workers(Osmium::Thread::Pool::default_num_threads()),
+                m_max_blocks_in_flight(4 * m_num_workers),
+                m_block(make_shared<PBFBlock>()),
+                m_pool(),
+                m_queue(),
+                m_writer(),
+                m_free_blocks(),
+                m_free_blocks_mutex(),
+                m_write_error(),
+                m_error_mutex() {
 
                 GOOGLE_PROTOBUF_VERIFY_VERSION;
             }
 
+            /**
+             * If final() was not called, the threads are stopped here.
+             * Blocks not written yet are lost.
+             */
+            ~PBF() {
+                if (m_queue) {
+                    m_queue->shutdown();
+                }
+                stop_threads();
+            }
+
+            int num_workers() const {
+                return m_num_workers;
+            }
+
+            /**
+             * Set the number of threads used for encoding blocks. Set to 0
+             * to encode and write everything in the thread calling the
+             * output functions. Defaults to the number of hardware
+             * threads. This must be called before init().
+             */
+            PBF& num_workers(int num) {
+                m_num_workers = num < 0 ? 0 : num;
+                return *this;
+            }
+
+            int max_blocks_in_flight() const {
+                return m_max_blocks_in_flight;
+            }
+
+            /**
+             * Set the maximum number of filled blocks that are not written
+             * to the file yet. Each block needs up to about 32 MB while it
+             * is encoded. Defaults to 4 times the number of workers. This
+             * must be called before init().
+             */
+            PBF& max_blocks_in_flight(int num) {
+                m_max_blocks_in_flight = num < 1 ? 1 : num;
+                return *this;
+            }
+
             /**
              * getter to check whether the densenodes-feature is used
              */
@@ -793,17 +1177,37 @@ namespace Osmium {
 
 
             /**
-             * getter to check whether zlib-compression is used
+             * getter to check whether compression is used
              */
             bool use_compression() const {
-                return m_use_compression;
+                return m_compression.type() != Osmium::Compression::BlobCodec::none;
             }
 
             /**
-             * setter to set whether zlib-compression is used
+             * setter to set whether zlib-compression (with the default
+             * level) is used
              */
             PBF& use_compression(bool flag) {
-                m_use_compression = flag;
+                m_compression = Osmium::Compression::BlobCodec(flag ? Osmium::Compression::BlobCodec::zlib : Osmium::Compression::BlobCodec::none);
+                return *this;
+            }
+
+            /**
+             * getter to access the compression of the blobs
+             */
+            const Osmium::Compression::BlobCodec& compression() const {
+                return m_compression;
+            }
+
+            /**
+             * setter to set the compression of the blobs
+             *
+             * @code
+             * output.compression(Osmium::Compression::BlobCodec::parse("zstd:3"));
+             * @endcode
+             */
+            PBF& compression(const Osmium::Compression::BlobCodec& codec) {
+                m_compression = codec;
                 return *this;
             }
 
@@ -856,6 +1260,31 @@ namespace Osmium {
             }
 
 
+            /**
+             * Getter to check whether node locations are added to ways.
+             */
+            bool locations_on_ways() const {
+                return m_locations_on_ways;
+            }
+
+            /**
+             * Setter to set whether the locations of the way nodes are
+             * added to the ways (as delta encoded lat and lon fields like
+             * the ones of DenseNodes). Readers of the file get complete
+             * way geometries without a node location store, see
+             * Osmium::OSM::Meta::has_locations_on_ways(). The positions
+             * must have been set on the way nodes before, for instance by
+             * Osmium::Handler::CoordinatesForWays. Way nodes without a
+             * position get a location outside the valid range, which is
+             * read as an undefined position. This must be called before
+             * init().
+             */
+            PBF& locations_on_ways(bool flag) {
+                m_locations_on_ways = flag;
+                return *this;
+            }
+
+
             /**
              * Initialize the writing process.
              *
@@ -881,6 +1310,10 @@ namespace Osmium {
                     pbf_header_block.add_required_features("HistoricalInformation");
                 }
 
+                if (m_locations_on_ways) {
+                    pbf_header_block.add_optional_features("LocationsOnWays");
+                }
+
                 // set the writing program
                 pbf_header_block.set_writingprogram(m_generator);
 
@@ -893,6 +1326,10 @@ namespace Osmium {
                 }
 
                 store_header_block();
+
+                if (m_num_workers > 0) {
+                    start_threads();
+                }
             }
 
             /**
@@ -911,11 +1348,6 @@ namespace Osmium {
                     std::cerr << "node " << node->id() << " v" << node->version() << std::endl;
                 }
 
-                // if no PrimitiveGroup for nodes has been added, add one and save the pointer
-                if (!pbf_nodes) {
-                    pbf_nodes = pbf_primitive_block.add_primitivegroup();
-                }
-
                 if (use_dense_format()) {
                     write_dense_node(node);
                 } else {
@@ -939,11 +1371,6 @@ namespace Osmium {
                     std::cerr << "way " << way->id() << " v" << way->version() << " with " << way->nodes().size() << " nodes" << std::endl;
                 }
 
-                // if no PrimitiveGroup for nodes has been added, add one and save the pointer
-                if (!pbf_ways) {
-                    pbf_ways = pbf_primitive_block.add_primitivegroup();
-                }
-
                 write_way(way);
             }
 
@@ -963,12 +1390,50 @@ namespace Osmium {
                     std::cerr << "relation " << relation->id() << " v" << relation->version() << " with " << relation->members().size() << " members" << std::endl;
                 }
 
-                // if no PrimitiveGroup for relations has been added, add one and save the pointer
-                if (!pbf_relations) {
-                    pbf_relations = pbf_primitive_block.add_primitivegroup();
+                write_relation(relation);
+            }
+
+            /**
+             * Write an OSMData blob read from another PBF file to the file
+             * without decoding and encoding it again. The block filled so far
+             * is flushed first, so the order of the objects is kept. Use this
+             * from a handler defining raw_blob() (see
+             * Osmium::Input::PBFRawBlobs) for blocks that pass unchanged:
+             *
+             * @code
+             * bool raw_blob(const Osmium::Input::PBFBlob& blob) {
+             *     if (...) { // everything in the blob is needed
+             *         m_output.write_raw_blob(blob.raw_data().first, blob.raw_data().second);
+             *         return true;
+             *     }
+             *     return false; // decode the blob and call node() etc.
+             * }
+             * @endcode
+             *
+             * The blob keeps its compression, granularity and so on. The
+             * required features in the HeaderBlock written by init() have to
+             * match those of the input file, ie. dense nodes and history
+             * settings have to be the same.
+             *
+             * @param data The serialized Blob message (without BlobHeader).
+             * @param size Size of the Blob message.
+             */
+            void write_raw_blob(const char* data, size_t size) {
+                if (primitive_block_contents > 0) {
+                    store_primitive_block();
                 }
 
-                write_relation(relation);
+                block_ptr_t block = get_free_block();
+                block->raw_blob(data, size);
+                if (m_queue) {
+                    if (!m_queue->push(block)) {
+                        check_write_error();
+                        throw std::runtime_error("writer thread stopped");
+                    }
+                } else {
+                    write_data(block->wait());
+                    free_block(block);
+                }
             }
 
             /**
@@ -985,6 +1450,13 @@ namespace Osmium {
                     store_primitive_block();
                 }
 
+                // tell the writer thread that there are no more blocks and wait for it
+                if (m_queue) {
+                    m_queue->push(block_ptr_t());
+                }
+                stop_threads();
+                check_write_error();
+
                 m_file.close();
             }
 
@@ -22,17 +22,14 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 
 */
 
-#define OSMIUM_COMPILE_WITH_CFLAGS_XML2 `xml2-config --cflags`
-#define OSMIUM_LINK_WITH_LIBS_XML2 `xml2-config --libs`
-
-// this is required to allow using libxml's xmlwriter in parallel to expat xml parser under debian
-#undef XMLCALL
-#include <libxml/xmlwriter.h>
-
-#define __STDC_FORMAT_MACROS
-#include <inttypes.h>
+#include <cerrno>
+#include <ctime>
+#include <string>
+#include <unistd.h>
 
 #include <osmium/output.hpp>
+#include <osmium/utils/opl.hpp>
+#include <osmium/utils/timestamp.hpp>
 
 namespace Osmium {
 
@@ -40,15 +37,17 @@ namespace Osmium {
 
         struct XMLWriteError {};
 
-        namespace {
-
-            void check_for_error(int count) {
-                if (count < 0) {
-                    throw XMLWriteError();
-                }
-            }
-        }
-
+        /**
+         * Writes OSM XML and OSM change files.
+         *
+         * The XML is assembled in a buffer that is written to the file
+         * when it gets large. Numbers, coordinates and timestamps are
+         * converted by hand. The output is exactly the same as the one
+         * libxml2's xmlTextWriter used to create: two spaces indentation,
+         * attribute values with only the characters <>&" and tab, newline
+         * and carriage return escaped and all characters outside ASCII
+         * written as character references.
+         */
         class XML : public Base {
 
             // objects of this class can't be copied
@@ -59,146 +58,373 @@ namespace Osmium {
 
             XML(const Osmium::OSMFile& file) :
                 Base(file),
-                m_xml_output_buffer(xmlOutputBufferCreateFd(this->fd(), NULL)),
-                m_xml_writer(xmlNewTextWriter(m_xml_output_buffer)),
-                m_last_op('\0') {
-                if (!m_xml_output_buffer || !m_xml_writer) {
-                    throw XMLWriteError();
-                }
+                m_buffer(),
+                m_last_op('\0'),
+                m_root_empty(true),
+                m_indent(m_file.type() == Osmium::OSMFile::FileType::Change() ? "    " : "  "),
+                m_timestamp_day(0),
+                m_timestamp_date() {
+                m_buffer.reserve(flush_size + 64 * 1024);
             }
 
             void init(Osmium::OSM::Meta& meta) {
-                check_for_error(xmlTextWriterSetIndent(m_xml_writer, 1));
-                check_for_error(xmlTextWriterSetIndentString(m_xml_writer, BAD_CAST "  "));
-                check_for_error(xmlTextWriterStartDocument(m_xml_writer, NULL, NULL, NULL)); // <?xml .. ?>
-
-                if (m_file.type() == Osmium::OSMFile::FileType::Change()) {
-                    check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "osmChange"));  // <osmChange>
-                } else {
-                    check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "osm"));  // <osm>
-                }
-                check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "version", BAD_CAST "0.6"));
-                check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "generator", BAD_CAST m_generator.c_str()));
+                m_buffer += "<?xml version=\"1.0\"?>\n";
+                m_buffer += is_change() ? "<osmChange" : "<osm";
+                write_attribute("version", "0.6");
+                write_attribute("generator", m_generator.c_str());
                 if (meta.bounds().defined()) {
-                    check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "bounds")); // <bounds>
-
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "minlon", "%.7f", meta.bounds().bottom_left().lon()));
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "minlat", "%.7f", meta.bounds().bottom_left().lat()));
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "maxlon", "%.7f", meta.bounds().top_right().lon()));
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "maxlat", "%.7f", meta.bounds().top_right().lat()));
-
-                    check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </bounds>
+                    start_root_child();
+                    m_buffer += "  <bounds";
+                    write_coordinate_attribute(" minlon=\"", meta.bounds().bottom_left().x());
+                    write_coordinate_attribute(" minlat=\"", meta.bounds().bottom_left().y());
+                    write_coordinate_attribute(" maxlon=\"", meta.bounds().top_right().x());
+                    write_coordinate_attribute(" maxlat=\"", meta.bounds().top_right().y());
+                    m_buffer += "/>\n";
                 }
             }
 
             void node(const shared_ptr<Osmium::OSM::Node const>& node) {
-                if (m_file.type() == Osmium::OSMFile::FileType::Change()) {
-                    open_close_op_tag(node->visible() ? (node->version() == 1 ? 'c' : 'm') : 'd');
-                }
-                check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "node")); // <node>
+                start_object(*node);
+                m_buffer += "<node";
 
-                write_meta(node);
+                write_meta(*node);
 
                 if (node->position().defined()) {
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "lat", "%.7f", node->position().lat()));
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "lon", "%.7f", node->position().lon()));
+                    write_coordinate_attribute(" lat=\"", node->position().y());
+                    write_coordinate_attribute(" lon=\"", node->position().x());
                 }
 
-                write_tags(node->tags());
-
-                check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </node>
+                if (node->tags().empty()) {
+                    m_buffer += "/>\n";
+                } else {
+                    m_buffer += ">\n";
+                    write_tags(node->tags());
+                    end_object("</node>\n");
+                }
+                end_element();
             }
 
             void way(const shared_ptr<Osmium::OSM::Way const>& way) {
-                if (m_file.type() == Osmium::OSMFile::FileType::Change()) {
-                    open_close_op_tag(way->visible() ? (way->version() == 1 ? 'c' : 'm') : 'd');
-                }
-                check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "way")); // <way>
+                start_object(*way);
+                m_buffer += "<way";
 
-                write_meta(way);
+                write_meta(*way);
 
-                Osmium::OSM::WayNodeList::const_iterator end = way->nodes().end();
-                for (Osmium::OSM::WayNodeList::const_iterator it = way->nodes().begin(); it != end; ++it) {
-                    check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "nd")); // <nd>
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "ref", "%" PRId64, it->ref()));
-                    check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </nd>
+                if (way->nodes().empty() && way->tags().empty()) {
+                    m_buffer += "/>\n";
+                } else {
+                    m_buffer += ">\n";
+                    Osmium::OSM::WayNodeList::const_iterator end = way->nodes().end();
+                    for (Osmium::OSM::WayNodeList::const_iterator it = way->nodes().begin(); it != end; ++it) {
+                        m_buffer += m_indent;
+                        m_buffer += "  <nd ref=\"";
+                        Osmium::OPL::append_integer(m_buffer, it->ref());
+                        m_buffer += "\"/>\n";
+                    }
+                    write_tags(way->tags());
+                    end_object("</way>\n");
                 }
-
-                write_tags(way->tags());
-
-                check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </way>
+                end_element();
             }
 
             void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
-                if (m_file.type() == Osmium::OSMFile::FileType::Change()) {
-                    open_close_op_tag(relation->visible() ? (relation->version() == 1 ? 'c' : 'm') : 'd');
-                }
-                check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "relation")); // <relation>
-
-                write_meta(relation);
+                start_object(*relation);
+                m_buffer += "<relation";
 
-                Osmium::OSM::RelationMemberList::const_iterator end = relation->members().end();
-                for (Osmium::OSM::RelationMemberList::const_iterator it = relation->members().begin(); it != end; ++it) {
-                    check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "member")); // <member>
+                write_meta(*relation);
 
-                    check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "type", BAD_CAST it->type_name()));
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "ref", "%" PRId64, it->ref()));
-                    check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "role", BAD_CAST it->role()));
-
-                    check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </member>
+                if (relation->members().size() == 0 && relation->tags().empty()) {
+                    m_buffer += "/>\n";
+                } else {
+                    m_buffer += ">\n";
+                    Osmium::OSM::RelationMemberList::const_iterator end = relation->members().end();
+                    for (Osmium::OSM::RelationMemberList::const_iterator it = relation->members().begin(); it != end; ++it) {
+                        m_buffer += m_indent;
+                        m_buffer += "  <member";
+                        write_attribute("type", it->type_name());
+                        m_buffer += " ref=\"";
+                        Osmium::OPL::append_integer(m_buffer, it->ref());
+                        m_buffer += '"';
+                        write_attribute("role", it->role());
+                        m_buffer += "/>\n";
+                    }
+                    write_tags(relation->tags());
+                    end_object("</relation>\n");
                 }
-
-                write_tags(relation->tags());
-
-                check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </relation>
+                end_element();
             }
 
             void final() {
-                if (m_file.type() == Osmium::OSMFile::FileType::Change()) {
+                if (is_change()) {
                     open_close_op_tag('\0');
                 }
-                check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </osm> or </osmChange>
-                xmlFreeTextWriter(m_xml_writer);
+                if (m_root_empty) {
+                    m_buffer += "/>\n";
+                } else {
+                    m_buffer += is_change() ? "</osmChange>\n" : "</osm>\n";
+                }
+                flush();
                 m_file.close();
             }
 
         private:
 
-            xmlOutputBufferPtr m_xml_output_buffer;
-            xmlTextWriterPtr m_xml_writer;
+            /// Output is collected here and written when it gets large.
+            std::string m_buffer;
+
+            /// Write to the file when the buffer has grown to this size.
+            enum { flush_size = 1024 * 1024 };
+
             char m_last_op;
 
-            void write_meta(const shared_ptr<Osmium::OSM::Object const>& object) {
-                check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "id", "%" PRId64, object->id()));
-                if (object->version()) {
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "version", "%d", object->version()));
+            /// Is the start tag of the root element still open?
+            bool m_root_empty;
+
+            /// Indentation of the objects.
+            const char* m_indent;
+
+            /// The day of the last timestamp written and its date part.
+            time_t m_timestamp_day;
+            std::string m_timestamp_date;
+
+            bool is_change() const {
+                return m_file.type() == Osmium::OSMFile::FileType::Change();
+            }
+
+            void start_root_child() {
+                if (m_root_empty) {
+                    m_buffer += ">\n";
+                    m_root_empty = false;
+                }
+            }
+
+            void start_object(const Osmium::OSM::Object& object) {
+                start_root_child();
+                if (is_change()) {
+                    open_close_op_tag(object.visible() ? (object.version() == 1 ? 'c' : 'm') : 'd');
                 }
-                if (object->timestamp()) {
-                    check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "timestamp", BAD_CAST object->timestamp_as_string().c_str()));
+                m_buffer += m_indent;
+            }
+
+            void end_object(const char* end_tag) {
+                m_buffer += m_indent;
+                m_buffer += end_tag;
+            }
+
+            void end_element() {
+                if (m_buffer.size() >= flush_size) {
+                    flush();
+                }
+            }
+
+            void write_meta(const Osmium::OSM::Object& object) {
+                m_buffer += " id=\"";
+                Osmium::OPL::append_integer(m_buffer, object.id());
+                m_buffer += '"';
+                if (object.version()) {
+                    m_buffer += " version=\"";
+                    Osmium::OPL::append_integer(m_buffer, static_cast<int>(object.version()));
+                    m_buffer += '"';
+                }
+                if (object.timestamp()) {
+                    m_buffer += " timestamp=\"";
+                    write_timestamp(object.timestamp());
+                    m_buffer += '"';
                 }
 
                 // uid <= 0 -> anonymous
-                if (object->uid() > 0) {
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "uid", "%d", object->uid()));
-                    check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "user", BAD_CAST object->user()));
+                if (object.uid() > 0) {
+                    m_buffer += " uid=\"";
+                    Osmium::OPL::append_integer(m_buffer, object.uid());
+                    m_buffer += '"';
+                    write_attribute("user", object.user());
                 }
 
-                if (object->changeset()) {
-                    check_for_error(xmlTextWriterWriteFormatAttribute(m_xml_writer, BAD_CAST "changeset", "%d", object->changeset()));
+                if (object.changeset()) {
+                    m_buffer += " changeset=\"";
+                    Osmium::OPL::append_integer(m_buffer, object.changeset());
+                    m_buffer += '"';
                 }
 
-                if (m_file.has_multiple_object_versions() && m_file.type() != Osmium::OSMFile::FileType::Change()) {
-                    check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "visible", object->visible() ? BAD_CAST "true" : BAD_CAST "false"));
+                if (m_file.has_multiple_object_versions() && !is_change()) {
+                    m_buffer += object.visible() ? " visible=\"true\"" : " visible=\"false\"";
                 }
             }
 
             void write_tags(const Osmium::OSM::TagList& tags) {
                 Osmium::OSM::TagList::const_iterator end = tags.end();
                 for (Osmium::OSM::TagList::const_iterator it = tags.begin(); it != end; ++it) {
-                    check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "tag")); // <tag>
-                    check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "k", BAD_CAST it->key()));
-                    check_for_error(xmlTextWriterWriteAttribute(m_xml_writer, BAD_CAST "v", BAD_CAST it->value()));
-                    check_for_error(xmlTextWriterEndElement(m_xml_writer)); // </tag>
+                    m_buffer += m_indent;
+                    m_buffer += "  <tag";
+                    write_attribute("k", it->key());
+                    write_attribute("v", it->value());
+                    m_buffer += "/>\n";
+                }
+            }
+
+            void write_attribute(const char* name, const char* value) {
+                m_buffer += ' ';
+                m_buffer += name;
+                m_buffer += "=\"";
+                append_escaped(m_buffer, value);
+                m_buffer += '"';
+            }
+
+            /**
+             * Write a coordinate with seven digits after the decimal point
+             * like printf("%.7f") does.
+             */
+            void write_coordinate_attribute(const char* start, int32_t value) {
+                m_buffer += start;
+                int64_t v = value;
+                if (v < 0) {
+                    m_buffer += '-';
+                    v = -v;
+                }
+                Osmium::OPL::append_integer(m_buffer, v / Osmium::OSM::coordinate_precision);
+                char buffer[10] = ".0000000\"";
+                for (int fraction = static_cast<int>(v % Osmium::OSM::coordinate_precision), pos = 7; fraction; fraction /= 10, --pos) {
+                    buffer[pos] = static_cast<char>('0' + fraction % 10);
+                }
+                m_buffer.append(buffer, 9);
+            }
+
+            /**
+             * Write a timestamp in ISO format. Most timestamps in a file are
+             * from a few days only, so the date part is only calculated
+             * when the day changes.
+             */
+            void write_timestamp(time_t timestamp) {
+                time_t seconds = timestamp % 86400;
+                if (seconds < 0) {
+                    seconds += 86400;
+                }
+                const time_t day = timestamp - seconds;
+                if (day != m_timestamp_day || m_timestamp_date.empty()) {
+                    m_timestamp_date.clear();
+                    Osmium::Timestamp::append_iso(m_timestamp_date, timestamp);
+                    if (m_timestamp_date.size() != 20) {
+                        // unusual year, not cached
+                        m_buffer += m_timestamp_date;
+                        m_timestamp_date.clear();
+                        return;
+                    }
+                    m_timestamp_date.resize(11);
+                    m_timestamp_day = day;
+                }
+                m_buffer += m_timestamp_date;
+                char buffer[9] = "00:00:00";
+                const int values[3] = { static_cast<int>(seconds / 3600), static_cast<int>(seconds / 60 % 60), static_cast<int>(seconds % 60) };
+                for (int i=0; i < 3; ++i) {
+                    buffer[i * 3] = static_cast<char>('0' + values[i] / 10);
+                    buffer[i * 3 + 1] = static_cast<char>('0' + values[i] % 10);
+                }
+                m_buffer.append(buffer, 8);
+                m_buffer += 'Z';
+            }
+
+            /**
+             * Is this a character allowed in XML? (Same as libxml2's IS_CHAR.)
+             */
+            static bool is_xml_char(uint32_t c) {
+                if (c < 0x100) {
+                    return c == 0x9 || c == 0xa || c == 0xd || c >= 0x20;
+                }
+                return (c <= 0xd7ff) || (c >= 0xe000 && c <= 0xfffd) || (c >= 0x10000 && c <= 0x10ffff);
+            }
+
+            static void append_char_ref(std::string& out, uint32_t value) {
+                static const char hex[] = "0123456789ABCDEF";
+                char buffer[8];
+                char* p = buffer + sizeof(buffer);
+                do {
+                    *--p = hex[value & 0xf];
+                    value >>= 4;
+                } while (value);
+                out += "&#x";
+                out.append(p, buffer + sizeof(buffer) - p);
+                out += ';';
+            }
+
+            /**
+             * Append an attribute value, escaped the same way libxml2 does
+             * it when no encoding is set. Invalid UTF-8 sequences are
+             * handled the same (odd) way, too.
+             */
+            static void append_escaped(std::string& out, const char* string) {
+                const unsigned char* cur = reinterpret_cast<const unsigned char*>(string);
+                const unsigned char* base = cur;
+                while (*cur) {
+                    const char* entity = NULL;
+                    switch (*cur) {
+                        case '\n': entity = "&#10;"; break;
+                        case '\r': entity = "&#13;"; break;
+                        case '\t': entity = "&#9;"; break;
+                        case '"': entity = "&quot;"; break;
+                        case '<': entity = "&lt;"; break;
+                        case '>': entity = "&gt;"; break;
+                        case '&': entity = "&amp;"; break;
+                    }
+                    if (entity) {
+                        out.append(reinterpret_cast<const char*>(base), cur - base);
+                        out += entity;
+                        base = ++cur;
+                    } else if (*cur >= 0x80 && cur[1]) {
+                        out.append(reinterpret_cast<const char*>(base), cur - base);
+                        uint32_t value = 0;
+                        int length = 0;
+                        if (*cur < 0xc0) {
+                            length = 0;
+                        } else if (*cur < 0xe0) {
+                            value = ((cur[0] & 0x1f) << 6) | (cur[1] & 0x3f);
+                            length = 2;
+                        } else if (*cur < 0xf0 && cur[2]) {
+                            value = ((cur[0] & 0x0f) << 12) | ((cur[1] & 0x3f) << 6) | (cur[2] & 0x3f);
+                            length = 3;
+                        } else if (*cur < 0xf8 && cur[2] && cur[3]) {
+                            value = ((cur[0] & 0x07) << 18) | ((cur[1] & 0x3f) << 12) | ((cur[2] & 0x3f) << 6) | (cur[3] & 0x3f);
+                            length = 4;
+                        }
+                        if (length == 0 || !is_xml_char(value)) {
+                            append_char_ref(out, *cur);
+                            ++cur;
+                        } else {
+                            append_char_ref(out, value);
+                            cur += length;
+                        }
+                        base = cur;
+                    } else {
+                        ++cur;
+                    }
+                }
+                out.append(reinterpret_cast<const char*>(base), cur - base);
+            }
+
+            void flush() {
+                const char* data = m_buffer.data();
+                size_t size = m_buffer.size();
+                while (size > 0) {
+                    const ssize_t length = ::write(fd(), data, size);
+                    if (length < 0) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+                        throw XMLWriteError();
+                    }
+                    data += length;
+                    size -= length;
+                }
+                m_buffer.clear();
+            }
+
+            static const char* op_name(const char op) {
+                switch (op) {
+                    case 'c':
+                        return "create";
+                    case 'm':
+                        return "modify";
+                    default:
+                        return "delete";
                 }
             }
 
@@ -208,19 +434,15 @@ namespace Osmium {
                 }
 
                 if (m_last_op) {
-                    check_for_error(xmlTextWriterEndElement(m_xml_writer));
+                    m_buffer += "  </";
+                    m_buffer += op_name(m_last_op);
+                    m_buffer += ">\n";
                 }
 
-                switch (op) {
-                    case 'c':
-                        check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "create"));
-                        break;
-                    case 'm':
-                        check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "modify"));
-                        break;
-                    case 'd':
-                        check_for_error(xmlTextWriterStartElement(m_xml_writer, BAD_CAST "delete"));
-                        break;
+                if (op) {
+                    m_buffer += "  <";
+                    m_buffer += op_name(op);
+                    m_buffer += ">\n";
                 }
 
                 m_last_op = op;
@@ -344,7 +344,7 @@ namespace Osmium {
             /**
              * This is the handler class for the second pass of the Assembler.
              */
-            class HandlerPass2 {
+            class HandlerPass2 : public Osmium::Handler::Base {
 
                 TAssembler& m_assembler;
 
@@ -407,6 +407,7 @@ namespace Osmium {
             public:
 
                 HandlerPass2(TAssembler& assembler) :
+                    Osmium::Handler::Base(),
                     m_assembler(assembler),
                     m_want_types((N?1:0) + (W?1:0) + (R?1:0)) {
                 }
@@ -475,10 +476,23 @@ namespace Osmium {
                     m_assembler.m_next_handler.after_relations();
                 }
 
+                void after_block() const {
+                    m_assembler.m_next_handler.after_block();
+                }
+
                 void final() const {
                     m_assembler.m_next_handler.final();
                 }
 
+                /**
+                 * The second pass needs the types of objects that can be
+                 * members plus everything the chained handler needs.
+                 */
+                uint32_t object_types() const {
+                    return (N ? NODE_MASK : 0) | (W ? WAY_MASK : 0) | (R ? RELATION_MASK : 0) |
+                           Osmium::Handler::ObjectTypes<THandler>::mask(m_assembler.m_next_handler);
+                }
+
             }; // class HandlerPass2
 
             /**
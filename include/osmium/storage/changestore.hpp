@@ -0,0 +1,259 @@
+#ifndef OSMIUM_STORAGE_CHANGESTORE_HPP
+#define OSMIUM_STORAGE_CHANGESTORE_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <vector>
+
+#include <osmium/handler.hpp>
+#include <osmium/utils/dump.hpp>
+
+namespace Osmium {
+
+    namespace Storage {
+
+        /**
+         * Stores the objects from one or more change files, so they can be
+         * applied to a snapshot of the data (see ApplyHandler).
+         *
+         * The objects are kept in records of the Osmium dump format (see
+         * Osmium::Dump), which needs much less memory than Osmium OSM
+         * objects. Only the newest version of each object is used, if
+         * there are several versions with the same version number, the one
+         * added last wins. Deleted objects (from the delete section of a
+         * change file) have the visible flag set to false.
+         *
+         * @code
+         * Osmium::Storage::ChangeStore changes;
+         * Osmium::Input::read(Osmium::OSMFile("changes.osc.gz"), changes);
+         * Osmium::Storage::ChangeStore::ApplyHandler<Osmium::Output::Handler> apply(changes, out);
+         * Osmium::Input::read(Osmium::OSMFile("snapshot.osm.pbf"), apply);
+         * @endcode
+         */
+        class ChangeStore : public Osmium::Handler::Base {
+
+        public:
+
+            ChangeStore() :
+                Base(),
+                m_records(),
+                m_keys(),
+                m_sorted(true) {
+            }
+
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                add(NODE, *node, m_records.add_node(*node));
+            }
+
+            void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+                add(WAY, *way, m_records.add_way(*way));
+            }
+
+            void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+                add(RELATION, *relation, m_records.add_relation(*relation));
+            }
+
+            /**
+             * Number of objects in the store. After sort() this is the
+             * number of different objects.
+             */
+            size_t size() const {
+                return m_keys.size();
+            }
+
+            /**
+             * Sort the objects by type, id, and version and remove all but
+             * the newest version of each object. This is done by the
+             * ApplyHandler, you only have to call it yourself if you use
+             * begin() and end().
+             */
+            void sort() {
+                if (m_sorted) {
+                    return;
+                }
+                std::stable_sort(m_keys.begin(), m_keys.end());
+                std::vector<Osmium::Dump::RecordKey>::iterator out = m_keys.begin();
+                for (std::vector<Osmium::Dump::RecordKey>::const_iterator it = m_keys.begin(); it != m_keys.end(); ++it) {
+                    if (it + 1 == m_keys.end() || !it->same_object(*(it + 1))) {
+                        *out++ = *it;
+                    }
+                }
+                m_keys.erase(out, m_keys.end());
+                m_sorted = true;
+            }
+
+            typedef std::vector<Osmium::Dump::RecordKey>::const_iterator const_iterator;
+
+            const_iterator begin() const {
+                return m_keys.begin();
+            }
+
+            const_iterator end() const {
+                return m_keys.end();
+            }
+
+            /**
+             * Get the object a key from this store belongs to. The view
+             * is valid until more objects are added.
+             */
+            Osmium::Dump::ObjectView object(const Osmium::Dump::RecordKey& key) const {
+                return Osmium::Dump::ObjectView(m_records.data().data() + key.offset);
+            }
+
+            /**
+             * Remove all objects from the change store.
+             */
+            void clear() {
+                m_records.clear();
+                std::vector<Osmium::Dump::RecordKey>().swap(m_keys);
+                m_sorted = true;
+            }
+
+        private:
+
+            Osmium::Dump::RecordBuffer m_records;
+            std::vector<Osmium::Dump::RecordKey> m_keys;
+            bool m_sorted;
+
+            void add(osm_object_type_t type, const Osmium::OSM::Object& object, size_t offset) {
+                m_keys.push_back(Osmium::Dump::RecordKey(type, object.id(), object.version(), offset));
+                m_sorted = false;
+            }
+
+        public:
+
+            /**
+             * Handler that applies the changes from the store to a stream
+             * of objects, which must be sorted by type, id, and version and
+             * contain only one version of each object (like a planet file),
+             * and forwards the result to another handler in one sequential
+             * pass:
+             *
+             * - Changed objects replace the object from the stream if their
+             *   version is the same or newer.
+             * - Deleted objects are removed from the stream.
+             * - New objects are inserted in the right position.
+             *
+             * All callbacks from init() to final() are called on the other
+             * handler, the before_*() and after_*() callbacks only when
+             * there are objects of that type in the result.
+             *
+             * Do not change the change store while this handler is active.
+             */
+            template <class THandler>
+            class ApplyHandler : public Osmium::Handler::Base {
+
+            public:
+
+                ApplyHandler(ChangeStore& change_store, THandler& handler) :
+                    Base(),
+                    m_change_store(change_store),
+                    m_handler(handler),
+                    m_feeder(handler),
+                    m_iter(),
+                    m_end() {
+                    change_store.sort();
+                    m_iter = change_store.begin();
+                    m_end = change_store.end();
+                }
+
+                void init(Osmium::OSM::Meta& meta) {
+                    m_handler.init(meta);
+                }
+
+                void node(const shared_ptr<Osmium::OSM::Node>& node) {
+                    if (apply(Osmium::Dump::RecordKey(NODE, node->id(), node->version()))) {
+                        m_handler.node(node);
+                    }
+                }
+
+                void way(const shared_ptr<Osmium::OSM::Way>& way) {
+                    if (apply(Osmium::Dump::RecordKey(WAY, way->id(), way->version()))) {
+                        m_handler.way(way);
+                    }
+                }
+
+                void relation(const shared_ptr<Osmium::OSM::Relation>& relation) {
+                    if (apply(Osmium::Dump::RecordKey(RELATION, relation->id(), relation->version()))) {
+                        m_handler.relation(relation);
+                    }
+                }
+
+                void final() {
+                    while (m_iter != m_end) {
+                        insert(*m_iter++);
+                    }
+                    m_feeder.finish();
+                    m_handler.final();
+                }
+
+            private:
+
+                ChangeStore& m_change_store;
+                THandler& m_handler;
+                Osmium::Dump::Feeder<THandler> m_feeder;
+                ChangeStore::const_iterator m_iter;
+                ChangeStore::const_iterator m_end;
+
+                /**
+                 * Hand a changed object to the handler unless it was
+                 * deleted.
+                 */
+                void insert(const Osmium::Dump::RecordKey& key) {
+                    const Osmium::Dump::ObjectView object = m_change_store.object(key);
+                    if (object.visible()) {
+                        m_feeder.object(object);
+                    }
+                }
+
+                /**
+                 * Insert all changed objects before the object from the
+                 * stream with the given key.
+                 *
+                 * @returns true if the object from the stream should be
+                 *          forwarded, false if it was replaced or deleted.
+                 */
+                bool apply(const Osmium::Dump::RecordKey& key) {
+                    while (m_iter != m_end && m_iter->object_before(key)) {
+                        insert(*m_iter++);
+                    }
+                    if (m_iter != m_end && m_iter->same_object(key)) {
+                        const Osmium::Dump::RecordKey& change = *m_iter++;
+                        if (change.version >= key.version) {
+                            insert(change);
+                            return false;
+                        }
+                    }
+                    m_feeder.type(static_cast<osm_object_type_t>(key.type));
+                    return true;
+                }
+
+            }; // class ApplyHandler
+
+        }; // class ChangeStore
+
+    } // namespace Storage
+
+} // namespace Osmium
+
+#endif // OSMIUM_STORAGE_CHANGESTORE_HPP
@@ -0,0 +1,297 @@
+#ifndef OSMIUM_STORAGE_OBJECTBUFFER_HPP
+#define OSMIUM_STORAGE_OBJECTBUFFER_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+#include <osmium/handler.hpp>
+#include <osmium/utils/dump.hpp>
+
+namespace Osmium {
+
+    namespace Storage {
+
+        /**
+         * Stores Nodes, Ways, and Relations in main memory, each as one
+         * contiguous record of the Osmium dump format (see Osmium::Dump)
+         * with the tags, way nodes, relation members, and strings inline.
+         *
+         * Records are appended to large blocks of memory, so storing an
+         * object doesn't need any allocations of its own, and records never
+         * move: Osmium::Dump::ObjectView%s of stored objects stay valid
+         * until the buffer is cleared. Iterating over the buffer walks
+         * through the blocks sequentially. The views have the same getters
+         * as the OSM objects, so code reading objects often works with
+         * both.
+         *
+         * Like ObjectStore the buffer is a handler. Because it doesn't keep
+         * the objects it gets, the input reuses them, so reading a file
+         * into the buffer decodes every block of the file into appends to
+         * the buffer.
+         *
+         * @code
+         * Osmium::Storage::ObjectBuffer buffer;
+         * Osmium::Input::read(infile, buffer);
+         * for (Osmium::Storage::ObjectBuffer::const_iterator it = buffer.begin(); it != buffer.end(); ++it) {
+         *     std::cout << it->id() << " " << it->tags().get_value_by_key("name") << "\n";
+         * }
+         * @endcode
+         *
+         * Objects are stored in the order they are added, there is no
+         * lookup by id.
+         */
+        class ObjectBuffer : public Osmium::Handler::Base {
+
+        private:
+
+            /**
+             * A block of memory. It consists of uint64_t, so the records
+             * in it are aligned.
+             */
+            struct Block {
+                std::vector<uint64_t> data;
+                size_t used;
+
+                Block() :
+                    data(),
+                    used(0) {
+                }
+
+                char* begin() {
+                    return reinterpret_cast<char*>(&data[0]);
+                }
+
+                const char* begin() const {
+                    return reinterpret_cast<const char*>(&data[0]);
+                }
+
+                size_t available() const {
+                    return data.size() * sizeof(uint64_t) - used;
+                }
+            };
+
+        public:
+
+            /// Default size of the blocks.
+            enum { default_block_size = 1024 * 1024 };
+
+            /**
+             * @param block_size Size of the blocks in bytes. Objects
+             *        larger than this get a block of their own.
+             */
+            ObjectBuffer(size_t block_size = default_block_size) :
+                Base(),
+                m_block_size(Osmium::Dump::padded_size(block_size)),
+                m_blocks(),
+                m_record(),
+                m_size(0) {
+            }
+
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                m_record.clear();
+                m_record.add_node(*node);
+                add_record();
+            }
+
+            void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+                m_record.clear();
+                m_record.add_way(*way);
+                add_record();
+            }
+
+            void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+                m_record.clear();
+                m_record.add_relation(*relation);
+                add_record();
+            }
+
+            /**
+             * Add an object from a record, for instance from a dump file.
+             *
+             * @returns A view of the stored copy.
+             */
+            Osmium::Dump::ObjectView add(const Osmium::Dump::ObjectView& object) {
+                return Osmium::Dump::ObjectView(append(object.data(), object.size()));
+            }
+
+            /// Number of objects in the buffer.
+            size_t size() const {
+                return m_size;
+            }
+
+            bool empty() const {
+                return m_size == 0;
+            }
+
+            /// Number of bytes allocated for the blocks.
+            size_t memory() const {
+                size_t memory = 0;
+                for (std::deque<Block>::const_iterator it = m_blocks.begin(); it != m_blocks.end(); ++it) {
+                    memory += it->data.size() * sizeof(uint64_t);
+                }
+                return memory;
+            }
+
+            /**
+             * Remove all objects from the buffer and free the memory.
+             */
+            void clear() {
+                std::deque<Block>().swap(m_blocks);
+                m_size = 0;
+            }
+
+            /**
+             * Forward iterator over the objects in the buffer.
+             */
+            class const_iterator {
+
+            public:
+
+                const_iterator(std::deque<Block>::const_iterator block, std::deque<Block>::const_iterator end) :
+                    m_block(block),
+                    m_end(end),
+                    m_offset(0),
+                    m_object() {
+                    skip_empty_blocks();
+                }
+
+                const Osmium::Dump::ObjectView& operator*() const {
+                    return m_object;
+                }
+
+                const Osmium::Dump::ObjectView* operator->() const {
+                    return &m_object;
+                }
+
+                const_iterator& operator++() {
+                    m_offset += m_object.size();
+                    skip_empty_blocks();
+                    return *this;
+                }
+
+                const_iterator operator++(int) {
+                    const_iterator tmp(*this);
+                    ++*this;
+                    return tmp;
+                }
+
+                bool operator==(const const_iterator& other) const {
+                    return m_block == other.m_block && (m_block == m_end || m_offset == other.m_offset);
+                }
+
+                bool operator!=(const const_iterator& other) const {
+                    return !(*this == other);
+                }
+
+            private:
+
+                std::deque<Block>::const_iterator m_block;
+                std::deque<Block>::const_iterator m_end;
+                size_t m_offset;
+                Osmium::Dump::ObjectView m_object;
+
+                void skip_empty_blocks() {
+                    while (m_block != m_end && m_offset == m_block->used) {
+                        ++m_block;
+                        m_offset = 0;
+                    }
+                    if (m_block != m_end) {
+                        m_object = Osmium::Dump::ObjectView(m_block->begin() + m_offset);
+                    }
+                }
+
+            }; // class const_iterator
+
+            const_iterator begin() const {
+                return const_iterator(m_blocks.begin(), m_blocks.end());
+            }
+
+            const_iterator end() const {
+                return const_iterator(m_blocks.end(), m_blocks.end());
+            }
+
+            /**
+             * Feed all objects in the buffer to the given handler, calling
+             * all callbacks from init() to final() on it. The objects are
+             * handed over in the order they were added, the before_*() and
+             * after_*() callbacks are called when the object type changes.
+             *
+             * @tparam THandler Handler class.
+             * @param handler Reference to handler.
+             * @param meta Reference to Osmium::OSM::Meta object which will be given to init() method of handler.
+             */
+            template <class THandler>
+            void feed_to(THandler& handler, Osmium::OSM::Meta& meta) const {
+                handler.init(meta);
+                Osmium::Dump::Feeder<THandler> feeder(handler);
+                for (const_iterator it = begin(); it != end(); ++it) {
+                    feeder.object(*it);
+                }
+                feeder.finish();
+                handler.final();
+            }
+
+        private:
+
+            const size_t m_block_size;
+            std::deque<Block> m_blocks;
+
+            /// The record of the object added last is assembled here.
+            Osmium::Dump::RecordBuffer m_record;
+
+            size_t m_size;
+
+            void add_record() {
+                append(m_record.data().data(), m_record.size());
+            }
+
+            /**
+             * Copy a record to the end of the last block or to a new
+             * block, if it doesn't fit.
+             *
+             * @returns Pointer to the copy.
+             */
+            const char* append(const char* data, size_t size) {
+                if (m_blocks.empty() || m_blocks.back().available() < size) {
+                    m_blocks.push_back(Block());
+                    m_blocks.back().data.resize(std::max(m_block_size, size) / sizeof(uint64_t));
+                }
+                Block& block = m_blocks.back();
+                char* out = block.begin() + block.used;
+                std::memcpy(out, data, size);
+                block.used += size;
+                ++m_size;
+                return out;
+            }
+
+        }; // class ObjectBuffer
+
+    } // namespace Storage
+
+} // namespace Osmium
+
+#endif // OSMIUM_STORAGE_OBJECTBUFFER_HPP
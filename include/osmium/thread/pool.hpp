@@ -0,0 +1,115 @@
+#ifndef OSMIUM_THREAD_POOL_HPP
+#define OSMIUM_THREAD_POOL_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#define OSMIUM_LINK_WITH_LIBS_THREAD -lboost_thread -lboost_system
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+
+#include <osmium/thread/queue.hpp>
+
+namespace Osmium {
+
+    namespace Thread {
+
+        /**
+         * A pool of worker threads executing tasks in the order they were
+         * submitted. Tasks are function objects without arguments and
+         * without return value. They must not throw exceptions, if they can
+         * fail they have to record the error somewhere where the thread that
+         * submitted them can see it.
+         *
+         * When the pool is destroyed, tasks that were not started yet are
+         * discarded and the destructor waits for running tasks to finish.
+         */
+        class Pool : boost::noncopyable {
+
+        public:
+
+            typedef boost::function<void()> task_t;
+
+            /**
+             * Create a pool and start the worker threads.
+             *
+             * @param num_threads Number of worker threads. If this is 0 or
+             *                    negative, the number of hardware threads
+             *                    is used.
+             */
+            Pool(int num_threads=0) :
+                m_tasks(),
+                m_threads() {
+                if (num_threads <= 0) {
+                    num_threads = default_num_threads();
+                }
+                for (int i=0; i < num_threads; ++i) {
+                    m_threads.create_thread(boost::bind(&Pool::worker, this));
+                }
+            }
+
+            ~Pool() {
+                m_tasks.shutdown();
+                m_threads.join_all();
+            }
+
+            /**
+             * Queue a task for execution by one of the worker threads.
+             */
+            void submit(const task_t& task) {
+                m_tasks.push(task);
+            }
+
+            int num_threads() const {
+                return static_cast<int>(m_threads.size());
+            }
+
+            /**
+             * The number of threads the hardware can run concurrently, but
+             * at least 1.
+             */
+            static int default_num_threads() {
+                const int n = boost::thread::hardware_concurrency();
+                return n > 0 ? n : 1;
+            }
+
+        private:
+
+            Queue<task_t> m_tasks;
+            boost::thread_group m_threads;
+
+            void worker() {
+                task_t task;
+                while (m_tasks.pop(task)) {
+                    task();
+                }
+            }
+
+        }; // class Pool
+
+    } // namespace Thread
+
+} // namespace Osmium
+
+#endif // OSMIUM_THREAD_POOL_HPP
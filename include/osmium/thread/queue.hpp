@@ -0,0 +1,137 @@
+#ifndef OSMIUM_THREAD_QUEUE_HPP
+#define OSMIUM_THREAD_QUEUE_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstddef>
+#include <deque>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/utility.hpp>
+
+namespace Osmium {
+
+    /**
+     * @brief Helper classes for running parts of %Osmium in several threads.
+     */
+    namespace Thread {
+
+        /**
+         * A thread-safe FIFO queue. If a maximum size is given, push() will
+         * block while the queue is full. pop() blocks while the queue is
+         * empty.
+         *
+         * Calling shutdown() wakes up all waiting threads. After that push()
+         * and pop() will not block any more, but return false.
+         */
+        template <typename T>
+        class Queue : boost::noncopyable {
+
+        public:
+
+            /**
+             * Create queue.
+             *
+             * @param max_size Maximum number of elements in the queue. 0 means unlimited.
+             */
+            Queue(size_t max_size=0) :
+                m_max_size(max_size),
+                m_queue(),
+                m_mutex(),
+                m_data_available(),
+                m_space_available(),
+                m_shutdown(false) {
+            }
+
+            /**
+             * Add an element to the end of the queue. Blocks while the queue
+             * is full.
+             *
+             * @returns false if the queue was shut down, true otherwise.
+             */
+            bool push(const T& value) {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_shutdown && m_max_size != 0 && m_queue.size() >= m_max_size) {
+                    m_space_available.wait(lock);
+                }
+                if (m_shutdown) {
+                    return false;
+                }
+                m_queue.push_back(value);
+                m_data_available.notify_one();
+                return true;
+            }
+
+            /**
+             * Remove the first element from the queue and put it into value.
+             * Blocks while the queue is empty.
+             *
+             * @returns false if the queue was shut down, true otherwise.
+             */
+            bool pop(T& value) {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+                while (!m_shutdown && m_queue.empty()) {
+                    m_data_available.wait(lock);
+                }
+                if (m_shutdown) {
+                    return false;
+                }
+                value = m_queue.front();
+                m_queue.pop_front();
+                m_space_available.notify_one();
+                return true;
+            }
+
+            /**
+             * Shut down the queue, waking up all threads waiting in push()
+             * or pop(). Elements still in the queue are removed.
+             */
+            void shutdown() {
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                m_shutdown = true;
+                m_queue.clear();
+                m_data_available.notify_all();
+                m_space_available.notify_all();
+            }
+
+            size_t size() const {
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                return m_queue.size();
+            }
+
+        private:
+
+            const size_t m_max_size;
+            std::deque<T> m_queue;
+            mutable boost::mutex m_mutex;
+            boost::condition_variable m_data_available;
+            boost::condition_variable m_space_available;
+            bool m_shutdown;
+
+        }; // class Queue
+
+    } // namespace Thread
+
+} // namespace Osmium
+
+#endif // OSMIUM_THREAD_QUEUE_HPP
@@ -0,0 +1,1056 @@
+#ifndef OSMIUM_UTILS_DUMP_HPP
+#define OSMIUM_UTILS_DUMP_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+
+#include <osmium/osm/types.hpp>
+#include <osmium/osm/position.hpp>
+#include <osmium/osm/meta.hpp>
+#include <osmium/osm/node.hpp>
+#include <osmium/osm/way_node.hpp>
+#include <osmium/osm/way.hpp>
+#include <osmium/osm/relation.hpp>
+#include <osmium/handler.hpp>
+
+namespace Osmium {
+
+    /**
+     * @brief The Osmium dump format for intermediate files.
+     *
+     * A dump file is a FileHeader followed by one ObjectRecord for each
+     * object. All numbers are stored in the byte order of the machine
+     * that wrote the file and every record starts at a multiple of 8
+     * bytes. So a memory mapped file can be used without any decoding:
+     * ObjectView gives access to the fields of a record in place and
+     * Reader walks through the records. RecordBuffer assembles records
+     * in memory, RecordKey is used to sort them, and Feeder hands them to
+     * a handler.
+     *
+     * A record consists of the fixed size ObjectRecord, followed by the
+     * array of way nodes (WayNodeRecord) or relation members
+     * (MemberRecord), the array of tags (TagRecord), and the strings
+     * (user name, tag keys and values, roles), each terminated by a NUL
+     * byte. Arrays and strings are referenced by their offset from the
+     * start of the record. The record is padded with NUL bytes to a
+     * multiple of 8 bytes.
+     *
+     * This format is not meant for exchanging data, it is for temporary
+     * files that are read several times, for instance in multi-pass
+     * programs. Files are much larger than PBF files.
+     */
+    namespace Dump {
+
+        /**
+         * Exception thrown when the data is not a valid dump file.
+         */
+        class FormatError : public std::runtime_error {
+
+        public:
+
+            FormatError(const std::string& what) :
+                std::runtime_error(what) {
+            }
+
+        };
+
+        /// Magic bytes at the start of every dump file.
+        const char magic[8] = { 'O', 'S', 'M', 'D', 'U', 'M', 'P', '1' };
+
+        /// Written in native byte order to detect files from other machines.
+        const uint32_t byte_order_mark = 0x01020304;
+
+        /// Set in FileHeader::flags if the file contains several versions of objects.
+        const uint32_t flag_history = 1;
+
+        struct FileHeader {
+            char     magic[8];
+            uint32_t byte_order;
+            uint32_t flags;
+
+            /// Bounding box of the data, Position::invalid if unknown.
+            int32_t  min_x;
+            int32_t  min_y;
+            int32_t  max_x;
+            int32_t  max_y;
+        };
+
+        struct ObjectRecord {
+            /// Size of the whole record in bytes including arrays, strings and padding.
+            uint32_t size;
+            uint8_t  type;      ///< osm_object_type_t
+            uint8_t  visible;
+            uint16_t reserved;
+            int64_t  id;
+            int64_t  timestamp;
+            uint32_t version;
+            int32_t  changeset;
+            int32_t  uid;
+            uint32_t user;      ///< Offset of the user name.
+            uint32_t num_tags;
+            uint32_t tags;      ///< Offset of the TagRecords.
+            uint32_t num_members; ///< Number of way nodes or relation members.
+            uint32_t members;   ///< Offset of the WayNodeRecords or MemberRecords.
+            int32_t  x;         ///< Position of a node, Position::invalid if undefined.
+            int32_t  y;
+        };
+
+        struct TagRecord {
+            uint32_t key;       ///< Offset of the key.
+            uint32_t value;     ///< Offset of the value.
+        };
+
+        struct WayNodeRecord {
+            int64_t ref;
+            int32_t x;          ///< Position::invalid if the location is unknown.
+            int32_t y;
+        };
+
+        struct MemberRecord {
+            int64_t  ref;
+            uint32_t role;      ///< Offset of the role.
+            char     type;      ///< 'n', 'w', or 'r'
+            char     padding[3];
+        };
+
+        /// Records are aligned to this many bytes.
+        const uint32_t alignment = 8;
+
+        inline uint32_t padded_size(uint32_t size) {
+            return (size + alignment - 1) & ~(alignment - 1);
+        }
+
+        /**
+         * Iterator over the entries of a TagListView, WayNodeListView or
+         * MemberListView. It holds the entry it points to, so operator->
+         * works like with the iterators of the OSM object lists.
+         */
+        template <class TList, class TValue>
+        class ListViewIterator {
+
+        public:
+
+            ListViewIterator(const TList& list, uint32_t n) :
+                m_list(&list),
+                m_n(n),
+                m_value() {
+            }
+
+            const TValue& operator*() const {
+                m_value = (*m_list)[m_n];
+                return m_value;
+            }
+
+            const TValue* operator->() const {
+                return &**this;
+            }
+
+            ListViewIterator& operator++() {
+                ++m_n;
+                return *this;
+            }
+
+            ListViewIterator operator++(int) {
+                ListViewIterator tmp(*this);
+                ++m_n;
+                return tmp;
+            }
+
+            bool operator==(const ListViewIterator& other) const {
+                return m_n == other.m_n;
+            }
+
+            bool operator!=(const ListViewIterator& other) const {
+                return m_n != other.m_n;
+            }
+
+        private:
+
+            const TList* m_list;
+            uint32_t m_n;
+            mutable TValue m_value;
+
+        }; // class ListViewIterator
+
+        /**
+         * A tag in a record, see Osmium::OSM::Tag.
+         */
+        class TagView {
+
+        public:
+
+            TagView(const char* key = "", const char* value = "") :
+                m_key(key),
+                m_value(value) {
+            }
+
+            const char* key() const {
+                return m_key;
+            }
+
+            const char* value() const {
+                return m_value;
+            }
+
+        private:
+
+            const char* m_key;
+            const char* m_value;
+
+        }; // class TagView
+
+        /**
+         * The tags of a record, see Osmium::OSM::TagList.
+         */
+        class TagListView {
+
+        public:
+
+            TagListView(const char* data, const TagRecord* tags, uint32_t size) :
+                m_data(data),
+                m_tags(tags),
+                m_size(size) {
+            }
+
+            uint32_t size() const {
+                return m_size;
+            }
+
+            bool empty() const {
+                return m_size == 0;
+            }
+
+            TagView operator[](uint32_t n) const {
+                return TagView(m_data + m_tags[n].key, m_data + m_tags[n].value);
+            }
+
+            typedef ListViewIterator<TagListView, TagView> const_iterator;
+
+            const_iterator begin() const {
+                return const_iterator(*this, 0);
+            }
+
+            const_iterator end() const {
+                return const_iterator(*this, m_size);
+            }
+
+            const char* get_value_by_key(const char* key) const {
+                for (uint32_t n=0; n < m_size; ++n) {
+                    if (!std::strcmp(m_data + m_tags[n].key, key)) {
+                        return m_data + m_tags[n].value;
+                    }
+                }
+                return 0;
+            }
+
+        private:
+
+            const char* m_data;
+            const TagRecord* m_tags;
+            uint32_t m_size;
+
+        }; // class TagListView
+
+        /**
+         * The nodes of a way record, see Osmium::OSM::WayNodeList. The
+         * entries are Osmium::OSM::WayNode objects created on access.
+         */
+        class WayNodeListView {
+
+        public:
+
+            WayNodeListView(const WayNodeRecord* nodes, uint32_t size) :
+                m_nodes(nodes),
+                m_size(size) {
+            }
+
+            uint32_t size() const {
+                return m_size;
+            }
+
+            bool empty() const {
+                return m_size == 0;
+            }
+
+            Osmium::OSM::WayNode operator[](uint32_t n) const {
+                return Osmium::OSM::WayNode(m_nodes[n].ref, Osmium::OSM::Position(m_nodes[n].x, m_nodes[n].y));
+            }
+
+            Osmium::OSM::WayNode front() const {
+                return (*this)[0];
+            }
+
+            Osmium::OSM::WayNode back() const {
+                return (*this)[m_size - 1];
+            }
+
+            bool is_closed() const {
+                return m_size > 0 && m_nodes[0].ref == m_nodes[m_size - 1].ref;
+            }
+
+            typedef ListViewIterator<WayNodeListView, Osmium::OSM::WayNode> const_iterator;
+
+            const_iterator begin() const {
+                return const_iterator(*this, 0);
+            }
+
+            const_iterator end() const {
+                return const_iterator(*this, m_size);
+            }
+
+        private:
+
+            const WayNodeRecord* m_nodes;
+            uint32_t m_size;
+
+        }; // class WayNodeListView
+
+        /**
+         * A member in a relation record, see Osmium::OSM::RelationMember.
+         */
+        class MemberView {
+
+        public:
+
+            MemberView(const char* data = NULL, const MemberRecord* member = NULL) :
+                m_data(data),
+                m_member(member) {
+            }
+
+            osm_object_id_t ref() const {
+                return m_member->ref;
+            }
+
+            char type() const {
+                return m_member->type;
+            }
+
+            const char* role() const {
+                return m_data + m_member->role;
+            }
+
+        private:
+
+            const char* m_data;
+            const MemberRecord* m_member;
+
+        }; // class MemberView
+
+        /**
+         * The members of a relation record, see
+         * Osmium::OSM::RelationMemberList.
+         */
+        class MemberListView {
+
+        public:
+
+            MemberListView(const char* data, const MemberRecord* members, uint32_t size) :
+                m_data(data),
+                m_members(members),
+                m_size(size) {
+            }
+
+            uint32_t size() const {
+                return m_size;
+            }
+
+            bool empty() const {
+                return m_size == 0;
+            }
+
+            MemberView operator[](uint32_t n) const {
+                return MemberView(m_data, m_members + n);
+            }
+
+            typedef ListViewIterator<MemberListView, MemberView> const_iterator;
+
+            const_iterator begin() const {
+                return const_iterator(*this, 0);
+            }
+
+            const_iterator end() const {
+                return const_iterator(*this, m_size);
+            }
+
+        private:
+
+            const char* m_data;
+            const MemberRecord* m_members;
+            uint32_t m_size;
+
+        }; // class MemberListView
+
+        /**
+         * Read-only view of an object record. It points into the record,
+         * nothing is copied. Strings are returned as pointers into the
+         * record, too. The getters have the same names as those of
+         * Osmium::OSM::Node, Way, and Relation, tags(), nodes(), and
+         * members() return lightweight views of the lists.
+         */
+        class ObjectView {
+
+        public:
+
+            explicit ObjectView(const char* data = NULL) :
+                m_data(data) {
+            }
+
+            const ObjectRecord& record() const {
+                return *reinterpret_cast<const ObjectRecord*>(m_data);
+            }
+
+            /// Pointer to the start of the record.
+            const char* data() const {
+                return m_data;
+            }
+
+            uint32_t size() const {
+                return record().size;
+            }
+
+            osm_object_type_t type() const {
+                return static_cast<osm_object_type_t>(record().type);
+            }
+
+            osm_object_id_t id() const {
+                return record().id;
+            }
+
+            osm_version_t version() const {
+                return record().version;
+            }
+
+            osm_changeset_id_t changeset() const {
+                return record().changeset;
+            }
+
+            time_t timestamp() const {
+                return record().timestamp;
+            }
+
+            osm_user_id_t uid() const {
+                return record().uid;
+            }
+
+            const char* user() const {
+                return m_data + record().user;
+            }
+
+            bool visible() const {
+                return record().visible;
+            }
+
+            /// Position of a node.
+            Osmium::OSM::Position position() const {
+                return Osmium::OSM::Position(record().x, record().y);
+            }
+
+            uint32_t tags_size() const {
+                return record().num_tags;
+            }
+
+            const char* tag_key(uint32_t n) const {
+                return m_data + tag_records()[n].key;
+            }
+
+            const char* tag_value(uint32_t n) const {
+                return m_data + tag_records()[n].value;
+            }
+
+            TagListView tags() const {
+                return TagListView(m_data, tag_records(), tags_size());
+            }
+
+            /// Number of nodes of a way or members of a relation.
+            uint32_t members_size() const {
+                return record().num_members;
+            }
+
+            const WayNodeRecord& way_node(uint32_t n) const {
+                return reinterpret_cast<const WayNodeRecord*>(m_data + record().members)[n];
+            }
+
+            const MemberRecord& member(uint32_t n) const {
+                return reinterpret_cast<const MemberRecord*>(m_data + record().members)[n];
+            }
+
+            const char* member_role(uint32_t n) const {
+                return m_data + member(n).role;
+            }
+
+            /// Nodes of a way.
+            WayNodeListView nodes() const {
+                return WayNodeListView(&way_node(0), members_size());
+            }
+
+            /// Members of a relation.
+            MemberListView members() const {
+                return MemberListView(m_data, &member(0), members_size());
+            }
+
+            /**
+             * Set the attributes and tags of an object from this record.
+             * Tags and user name are borrowed from the record (see
+             * Osmium::OSM::Tag), so the record must stay around while the
+             * object is used or until it is materialized.
+             */
+            void copy_to(Osmium::OSM::Object& object) const {
+                object.id(id())
+                      .version(version())
+                      .changeset(changeset())
+                      .timestamp(timestamp())
+                      .uid(uid())
+                      .visible(visible())
+                      .user_borrowed(user());
+                for (uint32_t n=0; n < tags_size(); ++n) {
+                    object.tags().add_borrowed(tag_key(n), tag_value(n));
+                }
+            }
+
+            /// Set a node from this record, see copy_to(Object&).
+            void copy_to(Osmium::OSM::Node& node) const {
+                copy_to(static_cast<Osmium::OSM::Object&>(node));
+                node.position(position());
+            }
+
+            /// Set a way from this record, see copy_to(Object&).
+            void copy_to(Osmium::OSM::Way& way) const {
+                copy_to(static_cast<Osmium::OSM::Object&>(way));
+                Osmium::OSM::WayNodeList& nodes = way.nodes();
+                for (uint32_t n=0; n < members_size(); ++n) {
+                    nodes.add(Osmium::OSM::WayNode(way_node(n).ref, Osmium::OSM::Position(way_node(n).x, way_node(n).y)));
+                }
+            }
+
+            /// Set a relation from this record, see copy_to(Object&).
+            void copy_to(Osmium::OSM::Relation& relation) const {
+                copy_to(static_cast<Osmium::OSM::Object&>(relation));
+                for (uint32_t n=0; n < members_size(); ++n) {
+                    relation.add_member(member(n).type, member(n).ref, member_role(n));
+                }
+            }
+
+        private:
+
+            const char* m_data;
+
+            const TagRecord* tag_records() const {
+                return reinterpret_cast<const TagRecord*>(m_data + record().tags);
+            }
+
+        }; // class ObjectView
+
+        /**
+         * Sort key of a record: The object type, id, and version and the
+         * offset of the record in its buffer. Keys are ordered like the
+         * objects in sorted OSM files: by type (nodes, ways, relations),
+         * id, and version. Ids are ordered by their absolute value like
+         * Osmium::OSM::Node and the other objects do, negative ids before
+         * positive ones.
+         */
+        struct RecordKey {
+            int             type;
+            osm_object_id_t id;
+            osm_version_t   version;
+            size_t          offset;
+
+            RecordKey(osm_object_type_t t, osm_object_id_t i, osm_version_t v, size_t o=0) :
+                type(t),
+                id(i),
+                version(v),
+                offset(o) {
+            }
+
+            explicit RecordKey(const ObjectView& object) :
+                type(object.type()),
+                id(object.id()),
+                version(object.version()),
+                offset(0) {
+            }
+
+            /// Do both keys belong to the same object (maybe in different versions)?
+            bool same_object(const RecordKey& other) const {
+                return type == other.type && id == other.id;
+            }
+
+            /// Does this key belong to an object before the other one, ignoring versions?
+            bool object_before(const RecordKey& other) const {
+                if (type != other.type) {
+                    return type < other.type;
+                }
+                if (id != other.id) {
+                    const osm_object_id_t abs_id = std::abs(id);
+                    const osm_object_id_t other_abs_id = std::abs(other.id);
+                    return abs_id == other_abs_id ? id < other.id : abs_id < other_abs_id;
+                }
+                return false;
+            }
+
+        }; // struct RecordKey
+
+        inline bool operator<(const RecordKey& lhs, const RecordKey& rhs) {
+            if (lhs.same_object(rhs)) {
+                return lhs.version < rhs.version;
+            }
+            return lhs.object_before(rhs);
+        }
+
+        /**
+         * Assembles the header and records of a dump file in a
+         * std::string.
+         */
+        class RecordBuffer {
+
+        public:
+
+            RecordBuffer() :
+                m_data() {
+            }
+
+            /// The header and records added so far.
+            const std::string& data() const {
+                return m_data;
+            }
+
+            size_t size() const {
+                return m_data.size();
+            }
+
+            void reserve(size_t size) {
+                m_data.reserve(size);
+            }
+
+            void clear() {
+                m_data.clear();
+            }
+
+            void swap(RecordBuffer& other) {
+                m_data.swap(other.m_data);
+            }
+
+            /**
+             * Add a complete record, for instance one from another buffer.
+             */
+            void add_raw(const char* data, size_t size) {
+                m_data.append(data, size);
+            }
+
+            /**
+             * Add a FileHeader with the bounding box from meta.
+             *
+             * @param meta Meta information.
+             * @param history Does the file contain several versions of objects?
+             */
+            void add_header(const Osmium::OSM::Meta& meta, bool history) {
+                FileHeader header;
+                std::memcpy(header.magic, magic, sizeof(header.magic));
+                header.byte_order = byte_order_mark;
+                header.flags = history ? flag_history : 0;
+                header.min_x = meta.bounds().bottom_left().x();
+                header.min_y = meta.bounds().bottom_left().y();
+                header.max_x = meta.bounds().top_right().x();
+                header.max_y = meta.bounds().top_right().y();
+                m_data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+            }
+
+            /**
+             * Add a record for a node.
+             *
+             * @returns The offset of the new record.
+             */
+            size_t add_node(const Osmium::OSM::Node& node) {
+                const size_t start = begin_record(node, NODE, 0, 0);
+                end_record(start, node, node.position());
+                return start;
+            }
+
+            /**
+             * Add a record for a way.
+             *
+             * @returns The offset of the new record.
+             */
+            size_t add_way(const Osmium::OSM::Way& way) {
+                const Osmium::OSM::WayNodeList& nodes = way.nodes();
+                const size_t start = begin_record(way, WAY, nodes.size(), sizeof(WayNodeRecord));
+                char* out = &m_data[start + sizeof(ObjectRecord)];
+                for (Osmium::OSM::WayNodeList::const_iterator it = nodes.begin(); it != nodes.end(); ++it) {
+                    WayNodeRecord record;
+                    record.ref = it->ref();
+                    record.x = it->position().x();
+                    record.y = it->position().y();
+                    std::memcpy(out, &record, sizeof(record));
+                    out += sizeof(record);
+                }
+                end_record(start, way, Osmium::OSM::Position());
+                return start;
+            }
+
+            /**
+             * Add a record for a relation.
+             *
+             * @returns The offset of the new record.
+             */
+            size_t add_relation(const Osmium::OSM::Relation& relation) {
+                const Osmium::OSM::RelationMemberList& members = relation.members();
+                const size_t start = begin_record(relation, RELATION, members.size(), sizeof(MemberRecord));
+                size_t offset = sizeof(ObjectRecord);
+                for (Osmium::OSM::RelationMemberList::const_iterator it = members.begin(); it != members.end(); ++it) {
+                    MemberRecord record;
+                    record.ref = it->ref();
+                    record.role = append_string(start, it->role());
+                    record.type = it->type();
+                    std::memset(record.padding, 0, sizeof(record.padding));
+                    std::memcpy(&m_data[start + offset], &record, sizeof(record));
+                    offset += sizeof(record);
+                }
+                end_record(start, relation, Osmium::OSM::Position());
+                return start;
+            }
+
+        private:
+
+            std::string m_data;
+
+            /**
+             * Add a new record with space for the fixed part, the members
+             * and the tags.
+             *
+             * @returns The offset of the new record.
+             */
+            size_t begin_record(const Osmium::OSM::Object& object, osm_object_type_t type, size_t num_members, size_t member_size) {
+                const size_t start = m_data.size();
+                m_data.resize(start + sizeof(ObjectRecord) + num_members * member_size + object.tags().size() * sizeof(TagRecord));
+
+                ObjectRecord record;
+                std::memset(&record, 0, sizeof(record));
+                record.type = type;
+                record.num_members = num_members;
+                record.members = sizeof(ObjectRecord);
+                record.num_tags = object.tags().size();
+                record.tags = record.members + num_members * member_size;
+                std::memcpy(&m_data[start], &record, sizeof(record));
+                return start;
+            }
+
+            /**
+             * Write the tags, the user name and the fixed part of the
+             * record and add the padding.
+             */
+            void end_record(size_t start, const Osmium::OSM::Object& object, const Osmium::OSM::Position& position) {
+                ObjectRecord record;
+                std::memcpy(&record, &m_data[start], sizeof(record));
+
+                size_t offset = record.tags;
+                for (Osmium::OSM::TagList::const_iterator it = object.tags().begin(); it != object.tags().end(); ++it) {
+                    TagRecord tag;
+                    tag.key = append_string(start, it->key());
+                    tag.value = append_string(start, it->value());
+                    std::memcpy(&m_data[start + offset], &tag, sizeof(tag));
+                    offset += sizeof(tag);
+                }
+
+                record.user = append_string(start, object.user());
+                m_data.resize(start + padded_size(m_data.size() - start));
+
+                record.size = m_data.size() - start;
+                record.visible = object.visible();
+                record.id = object.id();
+                record.timestamp = object.timestamp();
+                record.version = object.version();
+                record.changeset = object.changeset();
+                record.uid = object.uid();
+                record.x = position.x();
+                record.y = position.y();
+                std::memcpy(&m_data[start], &record, sizeof(record));
+            }
+
+            /**
+             * Append a string with its terminating NUL byte to the record.
+             *
+             * @returns The offset of the string in the record.
+             */
+            uint32_t append_string(size_t start, const char* string) {
+                const uint32_t offset = m_data.size() - start;
+                m_data.append(string, std::strlen(string) + 1);
+                return offset;
+            }
+
+        }; // class RecordBuffer
+
+        /**
+         * Hands the objects from records to a handler. The before_*() and
+         * after_*() callbacks are called when the object type changes.
+         * Objects are reused if the handler didn't keep them, otherwise
+         * they are materialized, so they don't point into the records any
+         * more (see Osmium::Input::Base).
+         *
+         * @tparam THandler A handler class (subclass of Osmium::Handler::Base).
+         */
+        template <class THandler>
+        class Feeder {
+
+        public:
+
+            Feeder(THandler& handler) :
+                m_handler(handler),
+                m_node_locations_only(Osmium::Handler::NodeLocationsOnly<THandler>::value(handler)),
+                m_type(UNKNOWN),
+                m_node(),
+                m_way(),
+                m_relation() {
+            }
+
+            /**
+             * Set the type of the next objects, calling the after_*()
+             * and before_*() callbacks if it changes. Use this before
+             * handing objects from elsewhere to the handler.
+             */
+            void type(osm_object_type_t type) {
+                if (type == m_type) {
+                    return;
+                }
+                switch (m_type) {
+                    case NODE:
+                        m_handler.after_nodes();
+                        break;
+                    case WAY:
+                        m_handler.after_ways();
+                        break;
+                    case RELATION:
+                        m_handler.after_relations();
+                        break;
+                    default:
+                        break;
+                }
+                switch (type) {
+                    case NODE:
+                        m_handler.before_nodes();
+                        break;
+                    case WAY:
+                        m_handler.before_ways();
+                        break;
+                    case RELATION:
+                        m_handler.before_relations();
+                        break;
+                    default:
+                        break;
+                }
+                m_type = type;
+            }
+
+            /**
+             * Hand the object in a record to the handler.
+             */
+            void object(const ObjectView& object) {
+                type(object.type());
+                switch (object.type()) {
+                    case NODE:
+                        if (m_node_locations_only) {
+                            m_handler.node_location(object.id(), object.position());
+                        } else {
+                            object.copy_to(prepare(m_node));
+                            m_handler.node(m_node);
+                            if (!m_node.unique()) {
+                                m_node->materialize();
+                            }
+                        }
+                        break;
+                    case WAY:
+                        object.copy_to(prepare(m_way));
+                        m_handler.way(m_way);
+                        if (!m_way.unique()) {
+                            m_way->materialize();
+                        }
+                        break;
+                    default:
+                        object.copy_to(prepare(m_relation));
+                        m_handler.relation(m_relation);
+                        if (!m_relation.unique()) {
+                            m_relation->materialize();
+                        }
+                        break;
+                }
+            }
+
+            /**
+             * Call the after_*() callback for the objects handed over
+             * last.
+             */
+            void finish() {
+                type(UNKNOWN);
+            }
+
+        private:
+
+            THandler& m_handler;
+            const bool m_node_locations_only;
+            osm_object_type_t m_type;
+
+            shared_ptr<Osmium::OSM::Node>     m_node;
+            shared_ptr<Osmium::OSM::Way>      m_way;
+            shared_ptr<Osmium::OSM::Relation> m_relation;
+
+            /**
+             * Get an empty object, reusing the last one if the handler
+             * didn't keep it.
+             */
+            template <class TObject>
+            static TObject& prepare(shared_ptr<TObject>& object) {
+                if (object && object.unique()) {
+                    object->reset();
+                } else {
+                    object = make_shared<TObject>();
+                }
+                return *object;
+            }
+
+        }; // class Feeder
+
+        /**
+         * Walks through the records of a dump file in memory. The data
+         * must start at an address that is a multiple of 8 (memory
+         * mappings always do). Every record is checked for consistency
+         * before it is returned, so ObjectView never points outside the
+         * data.
+         *
+         * @code
+         * Osmium::Dump::Reader reader(data, size);
+         * Osmium::Dump::ObjectView object;
+         * while (reader.next(object)) {
+         *     ...
+         * }
+         * @endcode
+         */
+        class Reader {
+
+        public:
+
+            /**
+             * @param data Start of the file including the FileHeader.
+             * @param size Size of the data.
+             * @throws FormatError if the data doesn't start with a valid header.
+             */
+            Reader(const char* data, size_t size) :
+                m_header(check_header(data, size)),
+                m_data(data + sizeof(FileHeader)),
+                m_end(data + size) {
+            }
+
+            const FileHeader& header() const {
+                return m_header;
+            }
+
+            /**
+             * Get the next object.
+             *
+             * @returns false at the end of the data
+             * @throws FormatError if the record is broken.
+             */
+            bool next(ObjectView& object) {
+                if (m_data == m_end) {
+                    return false;
+                }
+                const size_t available = m_end - m_data;
+                if (available < sizeof(ObjectRecord)) {
+                    throw FormatError("truncated record");
+                }
+                object = ObjectView(m_data);
+                check_record(object.record(), available);
+                m_data += object.size();
+                return true;
+            }
+
+            /**
+             * Check the header at the start of a dump file.
+             *
+             * @returns The header.
+             * @throws FormatError if it isn't valid.
+             */
+            static const FileHeader& check_header(const char* data, size_t size) {
+                if (size < sizeof(FileHeader) || std::memcmp(data, magic, sizeof(magic))) {
+                    throw FormatError("not an Osmium dump file");
+                }
+                const FileHeader& header = *reinterpret_cast<const FileHeader*>(data);
+                if (header.byte_order != byte_order_mark) {
+                    throw FormatError("dump file was written on a machine with different byte order");
+                }
+                return header;
+            }
+
+            /**
+             * Check that all offsets in a record point into the record
+             * and are properly aligned and that the record ends with a NUL
+             * byte, so all strings are terminated.
+             *
+             * @param record The record.
+             * @param available Number of bytes from the start of the record to the end of the data.
+             * @throws FormatError if the record is broken.
+             */
+            static void check_record(const ObjectRecord& record, size_t available) {
+                const uint64_t size = record.size;
+                if (size < sizeof(ObjectRecord) || size > available || size % alignment != 0) {
+                    throw FormatError("invalid record size");
+                }
+                if (reinterpret_cast<const char*>(&record)[size - 1] != '\0' ||
+                    record.user >= size ||
+                    record.tags % sizeof(uint32_t) != 0 ||
+                    record.members % alignment != 0 ||
+                    record.tags + static_cast<uint64_t>(record.num_tags) * sizeof(TagRecord) > size ||
+                    record.members + static_cast<uint64_t>(record.num_members) * (record.type == WAY ? sizeof(WayNodeRecord) : sizeof(MemberRecord)) > size) {
+                    throw FormatError("invalid record");
+                }
+                const TagRecord* tags = reinterpret_cast<const TagRecord*>(reinterpret_cast<const char*>(&record) + record.tags);
+                for (uint32_t n=0; n < record.num_tags; ++n) {
+                    if (tags[n].key >= size || tags[n].value >= size) {
+                        throw FormatError("invalid tag");
+                    }
+                }
+                if (record.type == RELATION) {
+                    const MemberRecord* members = reinterpret_cast<const MemberRecord*>(reinterpret_cast<const char*>(&record) + record.members);
+                    for (uint32_t n=0; n < record.num_members; ++n) {
+                        if (members[n].role >= size) {
+                            throw FormatError("invalid member role");
+                        }
+                    }
+                } else if (record.type != NODE && record.type != WAY) {
+                    throw FormatError("invalid object type");
+                }
+            }
+
+        private:
+
+            const FileHeader& m_header;
+            const char* m_data;
+            const char* m_end;
+
+        }; // class Reader
+
+    } // namespace Dump
+
+} // namespace Osmium
+
+#endif // OSMIUM_UTILS_DUMP_HPP
@@ -0,0 +1,235 @@
+#ifndef OSMIUM_UTILS_O5M_HPP
+#define OSMIUM_UTILS_O5M_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace Osmium {
+
+    /**
+     * @brief Helpers for reading and writing the o5m format.
+     *
+     * An o5m file is a sequence of datasets. Each dataset starts with a
+     * type byte followed (for most types) by the length of the data.
+     * Numbers are stored as varints, ids, coordinates and most other
+     * numbers are delta encoded. Strings and string pairs are either
+     * stored inline or as a reference to one of the last 15000 inline
+     * strings. See http://wiki.openstreetmap.org/wiki/O5m for details.
+     */
+    namespace O5M {
+
+        /**
+         * Exception thrown when the data is not valid o5m.
+         */
+        class ParseError : public std::runtime_error {
+
+        public:
+
+            ParseError(const std::string& what) :
+                std::runtime_error(what) {
+            }
+
+        };
+
+        enum dataset_type_t {
+            dataset_node      = 0x10,
+            dataset_way       = 0x11,
+            dataset_relation  = 0x12,
+            dataset_bbox      = 0xdb,
+            dataset_timestamp = 0xdc,
+            dataset_header    = 0xe0,
+            dataset_eof       = 0xfe,
+            dataset_reset     = 0xff
+        };
+
+        /// Datasets of this type and above have no length and no data.
+        const unsigned int first_dataset_without_length = 0xf0;
+
+        /// Datasets longer than this are considered broken.
+        const uint64_t max_dataset_length = 256 * 1024 * 1024;
+
+        /// Number of strings in the string reference table.
+        const size_t string_table_size = 15000;
+
+        /// Longer strings (or string pairs) are never put into the string table.
+        const size_t max_string_length_in_table = 250;
+
+        inline uint64_t decode_varint(const char*& data, const char* end) {
+            uint64_t value = 0;
+            for (int shift=0; shift < 64; shift += 7) {
+                if (data == end) {
+                    throw ParseError("truncated number");
+                }
+                const unsigned char byte = *data++;
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+            throw ParseError("number too long");
+        }
+
+        inline int64_t decode_zigzag(const char*& data, const char* end) {
+            const uint64_t value = decode_varint(data, end);
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        inline void append_varint(std::string& out, uint64_t value) {
+            while (value >= 0x80) {
+                out += static_cast<char>((value & 0x7f) | 0x80);
+                value >>= 7;
+            }
+            out += static_cast<char>(value);
+        }
+
+        inline void append_zigzag(std::string& out, int64_t value) {
+            append_varint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+        }
+
+        /**
+         * The string reference table used when reading o5m files. It
+         * contains copies of the last string_table_size strings that
+         * were stored inline.
+         */
+        class InputStringTable {
+
+        public:
+
+            InputStringTable() :
+                m_table(string_table_size * entry_size),
+                m_current(0) {
+            }
+
+            void clear() {
+                m_current = 0;
+            }
+
+            /**
+             * Read one string (pairs == 1) or a string pair (pairs == 2)
+             * and move the data pointer behind it.
+             *
+             * @returns Pointer to the first string. The second one follows
+             *          the terminating 0 of the first.
+             */
+            const char* read(const char*& data, const char* end, int pairs) {
+                const uint64_t ref = decode_varint(data, end);
+                if (ref) {
+                    if (ref > string_table_size || ref > m_current) {
+                        throw ParseError("invalid string reference");
+                    }
+                    return &m_table[((m_current - ref) % string_table_size) * entry_size];
+                }
+                const char* start = data;
+                for (int n=0; n < pairs; ++n) {
+                    const char* zero = static_cast<const char*>(std::memchr(data, 0, end - data));
+                    if (!zero) {
+                        throw ParseError("string not terminated");
+                    }
+                    data = zero + 1;
+                }
+                const size_t length = data - start;
+                if (length - pairs <= max_string_length_in_table) {
+                    std::memcpy(&m_table[(m_current % string_table_size) * entry_size], start, length);
+                    ++m_current;
+                }
+                return start;
+            }
+
+        private:
+
+            /// Longest stored string pair including the two terminating zeros.
+            static const size_t entry_size = max_string_length_in_table + 2;
+
+            std::vector<char> m_table;
+
+            /// Number of strings stored since the last clear().
+            uint64_t m_current;
+
+        }; // class InputStringTable
+
+        /**
+         * The string reference table used when writing o5m files. It
+         * remembers where the last string_table_size inline strings
+         * were written, so that they can be referenced.
+         */
+        class OutputStringTable {
+
+        public:
+
+            OutputStringTable() :
+                m_index(),
+                m_ring(string_table_size),
+                m_current(0) {
+            }
+
+            void clear() {
+                m_index.clear();
+                m_current = 0;
+            }
+
+            /**
+             * Append one string (pairs == 1) or a string pair (pairs == 2)
+             * to out. The string (pair) is given including its terminating
+             * zero(s).
+             */
+            void append(std::string& out, const std::string& string, int pairs) {
+                std::map<std::string, uint64_t>::iterator it = m_index.find(string);
+                if (it != m_index.end()) {
+                    append_varint(out, m_current - it->second);
+                    return;
+                }
+                out += '\0';
+                out += string;
+                if (string.size() - pairs <= max_string_length_in_table) {
+                    std::string& slot = m_ring[m_current % string_table_size];
+                    if (m_current >= string_table_size) {
+                        m_index.erase(slot);
+                    }
+                    slot = string;
+                    m_index[string] = m_current++;
+                }
+            }
+
+        private:
+
+            /// Maps the strings in the table to their position.
+            std::map<std::string, uint64_t> m_index;
+
+            /// The strings in the table in the order they were stored.
+            std::vector<std::string> m_ring;
+
+            /// Number of strings stored since the last clear().
+            uint64_t m_current;
+
+        }; // class OutputStringTable
+
+    } // namespace O5M
+
+} // namespace Osmium
+
+#endif // OSMIUM_UTILS_O5M_HPP
@@ -0,0 +1,195 @@
+#ifndef OSMIUM_UTILS_OPL_HPP
+#define OSMIUM_UTILS_OPL_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+
+#include <osmium/osm/position.hpp>
+
+namespace Osmium {
+
+    /**
+     * @brief Helpers for reading and writing the OPL format.
+     *
+     * OPL ("object per line") is a text format with one OSM object on
+     * each line. The line starts with the object type (n, w, or r) and
+     * the id, followed by fields separated by a space. Each field starts
+     * with a letter:
+     *
+     * @code
+     * n123 v2 dV c456 t2012-01-01T12:00:00Z i789 ufoo Tamenity=pub,name=Bar x8.1234567 y50.1
+     * w7 v1 dV c456 t2012-01-01T12:00:00Z i789 ufoo Thighway=road Nn123,n124
+     * r9 v1 dD c456 t2012-01-01T12:00:00Z i789 ufoo T Mw7@outer,n123@
+     * @endcode
+     *
+     * d is V for visible objects and D for deleted ones. Spaces, newlines,
+     * the separators ",=@" and '%' in strings are written as %XX%, where
+     * XX is the hexadecimal Unicode code point.
+     */
+    namespace OPL {
+
+        /**
+         * Exception thrown when a line can't be parsed.
+         */
+        class ParseError : public std::runtime_error {
+
+        public:
+
+            ParseError(const std::string& what) :
+                std::runtime_error(what) {
+            }
+
+        };
+
+        inline void append_integer(std::string& out, int64_t value) {
+            char buffer[24];
+            char* p = buffer + sizeof(buffer);
+            uint64_t v = value < 0 ? -static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+            do {
+                *--p = static_cast<char>('0' + v % 10);
+                v /= 10;
+            } while (v);
+            if (value < 0) {
+                *--p = '-';
+            }
+            out.append(p, buffer + sizeof(buffer) - p);
+        }
+
+        /**
+         * Append a coordinate in the fixed point format of Position as
+         * decimal number without trailing zeros.
+         */
+        inline void append_coordinate(std::string& out, int32_t value) {
+            int64_t v = value;
+            if (v < 0) {
+                out += '-';
+                v = -v;
+            }
+            append_integer(out, v / Osmium::OSM::coordinate_precision);
+            int fraction = static_cast<int>(v % Osmium::OSM::coordinate_precision);
+            if (fraction) {
+                char buffer[9] = ".0000000";
+                int length = 8;
+                while (fraction % 10 == 0) {
+                    fraction /= 10;
+                    --length;
+                }
+                for (int pos = length - 1; fraction; fraction /= 10, --pos) {
+                    buffer[pos] = static_cast<char>('0' + fraction % 10);
+                }
+                out.append(buffer, length);
+            }
+        }
+
+        /**
+         * Append a string, escaping everything that would confuse the
+         * parser. UTF-8 characters outside ASCII are kept as they are.
+         */
+        inline void append_encoded(std::string& out, const char* string) {
+            static const char hex[] = "0123456789abcdef";
+            for (const unsigned char* p = reinterpret_cast<const unsigned char*>(string); *p; ++p) {
+                const unsigned char c = *p;
+                if (c <= ' ' || c == ',' || c == '=' || c == '@' || c == '%' || c == 0x7f) {
+                    out += '%';
+                    if (c >= 0x10) {
+                        out += hex[c >> 4];
+                    }
+                    out += hex[c & 0xf];
+                    out += '%';
+                } else {
+                    out += static_cast<char>(c);
+                }
+            }
+        }
+
+        /**
+         * Append the UTF-8 encoding of a Unicode code point.
+         */
+        inline void append_utf8(std::string& out, uint32_t code_point) {
+            if (code_point < 0x80) {
+                out += static_cast<char>(code_point);
+            } else if (code_point < 0x800) {
+                out += static_cast<char>(0xc0 | (code_point >> 6));
+                out += static_cast<char>(0x80 | (code_point & 0x3f));
+            } else if (code_point < 0x10000) {
+                out += static_cast<char>(0xe0 | (code_point >> 12));
+                out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (code_point & 0x3f));
+            } else {
+                out += static_cast<char>(0xf0 | (code_point >> 18));
+                out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+                out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+                out += static_cast<char>(0x80 | (code_point & 0x3f));
+            }
+        }
+
+        /**
+         * Decode a string up to the next space, ',', '=', or '@' (or end)
+         * into out and move p behind it.
+         *
+         * @throws ParseError if an escape sequence is invalid.
+         */
+        inline void decode_string(const char*& p, const char* end, std::string& out) {
+            out.clear();
+            while (p != end && *p != ' ' && *p != ',' && *p != '=' && *p != '@') {
+                if (*p != '%') {
+                    const char* start = p;
+                    while (p != end && *p != ' ' && *p != ',' && *p != '=' && *p != '@' && *p != '%') {
+                        ++p;
+                    }
+                    out.append(start, p - start);
+                    continue;
+                }
+                ++p;
+                uint32_t code_point = 0;
+                const char* digits = p;
+                for (; p != end && *p != '%'; ++p) {
+                    const char c = *p;
+                    if (c >= '0' && c <= '9') {
+                        code_point = code_point * 16 + (c - '0');
+                    } else if (c >= 'a' && c <= 'f') {
+                        code_point = code_point * 16 + (c - 'a' + 10);
+                    } else if (c >= 'A' && c <= 'F') {
+                        code_point = code_point * 16 + (c - 'A' + 10);
+                    } else {
+                        throw ParseError("invalid escape sequence");
+                    }
+                    if (p - digits >= 6) {
+                        throw ParseError("invalid escape sequence");
+                    }
+                }
+                if (p == end || p == digits || code_point > 0x10ffff) {
+                    throw ParseError("invalid escape sequence");
+                }
+                ++p;
+                append_utf8(out, code_point);
+            }
+        }
+
+    } // namespace OPL
+
+} // namespace Osmium
+
+#endif // OSMIUM_UTILS_OPL_HPP
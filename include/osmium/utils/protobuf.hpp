@@ -0,0 +1,403 @@
+#ifndef OSMIUM_UTILS_PROTOBUF_HPP
+#define OSMIUM_UTILS_PROTOBUF_HPP
+
+/*
+
+Copyright 2012 Jochen Topf <jochen@topf.org> and others (see README).
+
+This file is part of Osmium (https://github.com/joto/osmium).
+
+Osmium is free software: you can redistribute it and/or modify it under the
+terms of the GNU Lesser General Public License or (at your option) the GNU
+General Public License as published by the Free Software Foundation, either
+version 3 of the Licenses, or (at your option) any later version.
+
+Osmium is distributed in the hope that it will be useful, but WITHOUT ANY
+WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A
+PARTICULAR PURPOSE. See the GNU Lesser General Public License and the GNU
+General Public License for more details.
+
+You should have received a copy of the Licenses along with Osmium. If not, see
+<http://www.gnu.org/licenses/>.
+
+*/
+
+#include <cstddef>
+#include <stdexcept>
+#include <stdint.h>
+#include <string>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+namespace Osmium {
+
+    /**
+     * @brief Minimal decoder for the Google Protocol Buffers wire format.
+     *
+     * This works directly on the encoded data, it never allocates memory
+     * or copies anything. It is used to read PBF files without going
+     * through the code generated by protoc.
+     */
+    namespace Protobuf {
+
+        /**
+         * Exception thrown when the data is not valid protobuf encoded data.
+         */
+        class ParseError : public std::runtime_error {
+
+        public:
+
+            ParseError(const std::string& what) :
+                std::runtime_error(what) {
+            }
+
+        };
+
+        enum wire_type_t {
+            wire_varint           = 0,
+            wire_fixed64          = 1,
+            wire_length_delimited = 2,
+            wire_fixed32          = 5
+        };
+
+        /**
+         * Decode a varint and move the data pointer behind it.
+         *
+         * @throws ParseError if the varint is longer than 10 bytes or goes beyond end.
+         */
+        inline uint64_t decode_varint(const char*& data, const char* end) {
+            // fast path for the very common one byte case
+            if (data != end && !(*data & 0x80)) {
+                return static_cast<unsigned char>(*data++);
+            }
+            uint64_t value = 0;
+            for (int shift=0; shift < 64; shift += 7) {
+                if (data == end) {
+                    throw ParseError("truncated varint");
+                }
+                const unsigned char byte = *data++;
+                value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if (!(byte & 0x80)) {
+                    return value;
+                }
+            }
+            throw ParseError("varint too long");
+        }
+
+        inline int64_t decode_zigzag64(uint64_t value) {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        inline int32_t decode_zigzag32(uint32_t value) {
+            return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+
+        /**
+         * Iterator over the values of a packed repeated varint field.
+         * Use the next_*() method matching the protobuf type of the field.
+         */
+        class PackedVarints {
+
+        public:
+
+            PackedVarints() :
+                m_data(NULL),
+                m_end(NULL) {
+            }
+
+            PackedVarints(const char* data, size_t size) :
+                m_data(data),
+                m_end(data + size) {
+            }
+
+            bool empty() const {
+                return m_data == m_end;
+            }
+
+            /**
+             * Count the number of values. This has to look at all of them.
+             */
+            size_t count() const {
+                size_t n = 0;
+                for (const char* p = m_data; p != m_end; ++p) {
+                    if (!(*p & 0x80)) {
+                        ++n;
+                    }
+                }
+                return n;
+            }
+
+            uint64_t next_uint64() {
+                if (m_data == m_end) {
+                    throw ParseError("packed field has too few values");
+                }
+                return decode_varint(m_data, m_end);
+            }
+
+            uint32_t next_uint32() {
+                return static_cast<uint32_t>(next_uint64());
+            }
+
+            int64_t next_int64() {
+                return static_cast<int64_t>(next_uint64());
+            }
+
+            int32_t next_int32() {
+                return static_cast<int32_t>(next_uint64());
+            }
+
+            int64_t next_sint64() {
+                return decode_zigzag64(next_uint64());
+            }
+
+            int32_t next_sint32() {
+                return decode_zigzag32(static_cast<uint32_t>(next_uint64()));
+            }
+
+            bool next_bool() {
+                return next_uint64() != 0;
+            }
+
+            /**
+             * Upper bound for the number of values left, every value
+             * needs at least one byte. Use this to size the output
+             * for decode_delta_sint64().
+             */
+            size_t max_count() const {
+                return m_end - m_data;
+            }
+
+            /**
+             * Decode all remaining values of a delta coded packed sint64
+             * field, as used for IDs and coordinates in PBF files, and
+             * write the running sums to out. Out must have room for
+             * max_count() values.
+             *
+             * Deltas are usually small, so many values fit into one
+             * byte. If SSE2 is available, 16 bytes at a time are checked
+             * for continuation bits and runs of one-byte values are
+             * decoded without branching on each byte.
+             *
+             * @returns Number of values decoded.
+             * @throws ParseError if the last varint is truncated.
+             */
+            size_t decode_delta_sint64(int64_t* out) {
+                int64_t* const begin = out;
+                int64_t value = 0;
+#ifdef __SSE2__
+                const __m128i one = _mm_set1_epi8(1);
+                const __m128i low_bits = _mm_set1_epi8(0x7f);
+                while (m_end - m_data >= 16) {
+                    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_data));
+                    const int continuation = _mm_movemask_epi8(bytes);
+
+                    int single = 0;
+                    while (single < 16 && !(continuation & (1 << single))) {
+                        ++single;
+                    }
+
+                    if (single > 0) {
+                        // zigzag decode all 16 bytes, only the first single ones are used
+                        const __m128i sign = _mm_cmpeq_epi8(_mm_and_si128(bytes, one), one);
+                        const __m128i half = _mm_and_si128(_mm_srli_epi16(bytes, 1), low_bits);
+                        signed char deltas[16];
+                        _mm_storeu_si128(reinterpret_cast<__m128i*>(deltas), _mm_xor_si128(half, sign));
+                        for (int i=0; i < single; ++i) {
+                            value += deltas[i];
+                            *out++ = value;
+                        }
+                        m_data += single;
+                    }
+
+                    if (single < 16) {
+                        value += decode_zigzag64(decode_varint(m_data, m_end));
+                        *out++ = value;
+                    }
+                }
+#endif
+                while (m_data != m_end) {
+                    value += decode_zigzag64(decode_varint(m_data, m_end));
+                    *out++ = value;
+                }
+                return out - begin;
+            }
+
+        private:
+
+            const char* m_data;
+            const char* m_end;
+
+        }; // class PackedVarints
+
+        /**
+         * Reader for the fields of an encoded message. Call next() to
+         * get to the next field, check tag() and wire_type() and then call
+         * the get_*() method matching the protobuf type of the field or
+         * skip() to ignore it.
+         *
+         * @code
+         * Osmium::Protobuf::Message message(data, size);
+         * while (message.next()) {
+         *     switch (message.tag()) {
+         *         case 1:
+         *             id = message.get_int64();
+         *             break;
+         *         default:
+         *             message.skip();
+         *     }
+         * }
+         * @endcode
+         */
+        class Message {
+
+        public:
+
+            Message() :
+                m_data(NULL),
+                m_end(NULL),
+                m_tag(0),
+                m_wire_type(wire_varint) {
+            }
+
+            Message(const char* data, size_t size) :
+                m_data(data),
+                m_end(data + size),
+                m_tag(0),
+                m_wire_type(wire_varint) {
+            }
+
+            /**
+             * Go to the next field.
+             *
+             * @returns false if there are no more fields, true otherwise.
+             */
+            bool next() {
+                if (m_data == m_end) {
+                    return false;
+                }
+                const uint64_t key = decode_varint(m_data, m_end);
+                m_tag = static_cast<uint32_t>(key >> 3);
+                m_wire_type = static_cast<wire_type_t>(key & 0x07);
+                return true;
+            }
+
+            /**
+             * Field number of the current field.
+             */
+            uint32_t tag() const {
+                return m_tag;
+            }
+
+            wire_type_t wire_type() const {
+                return m_wire_type;
+            }
+
+            uint64_t get_uint64() {
+                check_wire_type(wire_varint);
+                return decode_varint(m_data, m_end);
+            }
+
+            uint32_t get_uint32() {
+                return static_cast<uint32_t>(get_uint64());
+            }
+
+            int64_t get_int64() {
+                return static_cast<int64_t>(get_uint64());
+            }
+
+            int32_t get_int32() {
+                return static_cast<int32_t>(get_uint64());
+            }
+
+            int64_t get_sint64() {
+                return decode_zigzag64(get_uint64());
+            }
+
+            int32_t get_sint32() {
+                return decode_zigzag32(static_cast<uint32_t>(get_uint64()));
+            }
+
+            bool get_bool() {
+                return get_uint64() != 0;
+            }
+
+            /**
+             * Get the contents of a length-delimited field (bytes, string,
+             * embedded message, or packed repeated field) as pointer and
+             * size.
+             */
+            std::pair<const char*, size_t> get_data() {
+                check_wire_type(wire_length_delimited);
+                const uint64_t length = decode_varint(m_data, m_end);
+                if (length > static_cast<uint64_t>(m_end - m_data)) {
+                    throw ParseError("length-delimited field goes beyond end of message");
+                }
+                const char* data = m_data;
+                m_data += length;
+                return std::make_pair(data, static_cast<size_t>(length));
+            }
+
+            Message get_message() {
+                const std::pair<const char*, size_t> d = get_data();
+                return Message(d.first, d.second);
+            }
+
+            PackedVarints get_packed() {
+                const std::pair<const char*, size_t> d = get_data();
+                return PackedVarints(d.first, d.second);
+            }
+
+            std::string get_string() {
+                const std::pair<const char*, size_t> d = get_data();
+                return std::string(d.first, d.second);
+            }
+
+            /**
+             * Skip the value of the current field.
+             */
+            void skip() {
+                uint64_t length = 0;
+                switch (m_wire_type) {
+                    case wire_varint:
+                        decode_varint(m_data, m_end);
+                        return;
+                    case wire_fixed64:
+                        length = 8;
+                        break;
+                    case wire_length_delimited:
+                        length = decode_varint(m_data, m_end);
+                        break;
+                    case wire_fixed32:
+                        length = 4;
+                        break;
+                    default:
+                        throw ParseError("unknown wire type");
+                }
+                if (length > static_cast<uint64_t>(m_end - m_data)) {
+                    throw ParseError("field goes beyond end of message");
+                }
+                m_data += length;
+            }
+
+        private:
+
+            const char* m_data;
+            const char* m_end;
+            uint32_t m_tag;
+            wire_type_t m_wire_type;
+
+            void check_wire_type(wire_type_t wire_type) const {
+                if (m_wire_type != wire_type) {
+                    throw ParseError("unexpected wire type");
+                }
+            }
+
+        }; // class Message
+
+    } // namespace Protobuf
+
+} // namespace Osmium
+
+#endif // OSMIUM_UTILS_PROTOBUF_HPP
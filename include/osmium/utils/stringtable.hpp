@@ -22,27 +22,16 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 
 */
 
-#include <algorithm>
-#include <iostream>
-#include <map>
+
+#include <cstring>
 #include <stdint.h>
 #include <string>
-#include <utility>
 #include <vector>
 
 #include <osmpbf/osmpbf.h>
 
 namespace Osmium {
 
-    namespace {
-
-        template<typename A, typename B>
-        std::pair<B,A> flip_pair(const std::pair<A,B>& p) {
-            return std::pair<B,A>(p.second, p.first);
-        }
-
-    }
-
     /**
      * StringTable management for PBF writer
      *
@@ -50,76 +39,154 @@ namespace Osmium {
      * one row for each used string, so strings that are used multiple times need to be
      * stored only once. The StringTable is sorted by usage-count, so the most often used
      * string is stored at index 1.
+     *
+     * While a block is filled, the strings are interned in an open addressing hash table.
+     * The characters of all strings are kept one after the other in a single buffer, the
+     * table only contains indexes into the list of entries. All memory is kept when the
+     * table is cleared, so after the first few blocks no more allocations are needed.
      */
     class StringTable {
 
+    public:
+
         /// type for string IDs (interim and final)
-        typedef uint16_t string_id_t;
+        typedef uint32_t string_id_t;
+
+    private:
 
         /**
-         * this is the struct used to build the StringTable. It is stored as
-         * the value-part in the strings-map.
+         * this is the struct used to build the StringTable. There is one
+         * for each string, in the order the strings were first recorded.
+         * The position in this list (plus one) is the interim id, which is
+         * stored into the pbf-objects.
          *
-         * when a new string is added to the map, its count is set to 0 and
-         * the interim_id is set to the current size of the map. This interim_id
-         * is then stored into the pbf-objects.
-         *
-         * before the PrimitiveBlock is serialized, the map is sorted by count
-         * and stored into the pbf-StringTable. Afterwards the interim-ids are
-         * mapped to the "real" id in the StringTable.
+         * before the PrimitiveBlock is serialized, the entries are sorted by
+         * count and stored into the pbf-StringTable. Afterwards the interim-ids
+         * are mapped to the "real" id in the StringTable.
          *
          * this way often used strings get lower ids in the StringTable. As the
          * protobuf-serializer stores numbers in variable bit-lengths, lower
          * IDs means less used space in the resulting file.
          */
         struct string_info {
-            /// number of occurrences of this string
-            uint16_t count;
+            /// position of the string in m_chars
+            uint32_t offset;
+
+            /// length of the string
+            uint32_t length;
 
-            /// an intermediate-id
-            string_id_t interim_id;
+            /// hash of the string, so the table can be rebuilt without rehashing the strings
+            uint32_t hash;
+
+            /// number of occurrences of this string
+            uint32_t count;
         };
 
+        /// The characters of all strings.
+        std::vector<char> m_chars;
+
+        /// All strings recorded, the index is the interim id minus one.
+        std::vector<string_info> m_strings;
+
         /**
-         * Interim StringTable, storing all strings that should be written to
-         * the StringTable once the block is written to disk.
+         * Hash table with interim ids (0 for empty slots). The size is always
+         * a power of two and the table is never more than half full.
          */
-        typedef std::map<std::string, string_info> string2string_info_t;
-        string2string_info_t m_strings;
+        std::vector<string_id_t> m_table;
 
         /**
          * This vector is used to map the interim IDs to real StringTable IDs after
          * writing all strings to the StringTable.
          */
-        typedef std::vector<string_id_t> interim_id2id_t;
-        interim_id2id_t m_id2id_map;
+        std::vector<string_id_t> m_id2id_map;
+
+        /// Used for sorting the strings by count.
+        std::vector<uint32_t> m_count_start;
+        std::vector<string_id_t> m_sorted;
+
+        enum { initial_table_size = 1024 };
+
+        /**
+         * FNV-1a hash.
+         */
+        static uint32_t hash(const char* string, size_t length) {
+            uint32_t h = 2166136261u;
+            for (const char* end = string + length; string != end; ++string) {
+                h = (h ^ static_cast<unsigned char>(*string)) * 16777619u;
+            }
+            return h;
+        }
 
-        int m_size;
+        bool equal(const string_info& info, const char* string, size_t length) const {
+            return info.length == length && (length == 0 || !std::memcmp(&m_chars[info.offset], string, length));
+        }
+
+        /**
+         * Double the size of the hash table and put all entries into the new table.
+         */
+        void grow() {
+            std::vector<string_id_t> table(m_table.size() * 2, 0);
+            const uint32_t mask = table.size() - 1;
+            for (size_t i=0; i < m_strings.size(); ++i) {
+                uint32_t slot = m_strings[i].hash & mask;
+                while (table[slot]) {
+                    slot = (slot + 1) & mask;
+                }
+                table[slot] = i + 1;
+            }
+            m_table.swap(table);
+        }
 
     public:
 
         StringTable() :
+            m_chars(),
             m_strings(),
+            m_table(initial_table_size, 0),
             m_id2id_map(),
-            m_size(0) {
-        }
-
-        friend bool operator<(const string_info& lhs, const string_info& rhs) {
-            return lhs.count > rhs.count;
+            m_count_start(),
+            m_sorted() {
         }
 
         /**
          * record a string in the interim StringTable if it's missing, otherwise just increase its counter,
          * return the interim-id assigned to the string.
          */
-        string_id_t record_string(const std::string& string) {
-            string_info& info = m_strings[string];
-            if (info.interim_id == 0) {
-                info.interim_id = ++m_size;
-            } else {
-                info.count++;
+        string_id_t record_string(const char* string, size_t length) {
+            const uint32_t h = hash(string, length);
+            const uint32_t mask = m_table.size() - 1;
+            uint32_t slot = h & mask;
+            while (string_id_t id = m_table[slot]) {
+                string_info& info = m_strings[id - 1];
+                if (info.hash == h && equal(info, string, length)) {
+                    ++info.count;
+                    return id;
+                }
+                slot = (slot + 1) & mask;
+            }
+
+            string_info info;
+            info.offset = m_chars.size();
+            info.length = length;
+            info.hash = h;
+            info.count = 1;
+            m_chars.insert(m_chars.end(), string, string + length);
+            m_strings.push_back(info);
+
+            const string_id_t id = m_strings.size();
+            m_table[slot] = id;
+            if (m_strings.size() * 2 > m_table.size()) {
+                grow();
             }
-            return info.interim_id;
+            return id;
+        }
+
+        string_id_t record_string(const char* string) {
+            return record_string(string, std::strlen(string));
+        }
+
+        string_id_t record_string(const std::string& string) {
+            return record_string(string.data(), string.size());
         }
 
         /**
@@ -127,11 +194,8 @@ namespace Osmium {
          * while storing to the real table, this function fills the id2id_map with
          * pairs, mapping the interim-ids to final and real StringTable ids.
          *
-         * Note that the m_strings table is a std::map and as such is sorted lexicographically.
-         * When the transformation into the sortedby multimap is done, it gets sorted by
-         * the count. The end result (at least with the glibc standard container/algorithm
-         * implementation) is that the string table is sorted first by reverse count (ie descending)
-         * and then by reverse lexicographic order.
+         * The strings are sorted by descending count with a counting sort. Strings
+         * with the same count keep the order in which they were first recorded.
          */
         void store_stringtable(OSMPBF::StringTable* st) {
             // add empty StringTable entry at index 0
@@ -139,22 +203,39 @@ namespace Osmium {
             // this line also ensures that there's always a valid StringTable
             st->add_s("");
 
-            typedef std::multimap<string_info, std::string> cmap;
-            cmap sortedbycount;
+            uint32_t max_count = 0;
+            for (std::vector<string_info>::const_iterator it = m_strings.begin(); it != m_strings.end(); ++it) {
+                if (it->count > max_count) {
+                    max_count = it->count;
+                }
+            }
 
-            m_id2id_map.resize(m_size+1);
+            // m_count_start[max_count - count] is where strings with this count start in m_sorted
+            m_count_start.assign(max_count + 1, 0);
+            for (std::vector<string_info>::const_iterator it = m_strings.begin(); it != m_strings.end(); ++it) {
+                ++m_count_start[max_count - it->count];
+            }
+            uint32_t start = 0;
+            for (std::vector<uint32_t>::iterator it = m_count_start.begin(); it != m_count_start.end(); ++it) {
+                const uint32_t n = *it;
+                *it = start;
+                start += n;
+            }
+            m_sorted.resize(m_strings.size());
+            for (size_t i=0; i < m_strings.size(); ++i) {
+                m_sorted[m_count_start[max_count - m_strings[i].count]++] = i;
+            }
 
-            std::transform(m_strings.begin(), m_strings.end(),
-                           std::inserter(sortedbycount, sortedbycount.begin()), flip_pair<std::string, string_info>);
+            m_id2id_map.resize(m_strings.size() + 1);
+            m_id2id_map[0] = 0;
+            for (size_t n=0; n < m_sorted.size(); ++n) {
+                const string_info& info = m_strings[m_sorted[n]];
 
-            int n=0;
-            cmap::const_iterator end=sortedbycount.end();
-            for (cmap::const_iterator it = sortedbycount.begin(); it != end; ++it) {
                 // add the string of the current item to the pbf StringTable
-                st->add_s(it->second);
+                st->add_s(info.length ? &m_chars[info.offset] : "", info.length);
 
                 // store the mapping from the interim-id to the real id
-                m_id2id_map[it->first.interim_id] = ++n;
+                m_id2id_map[m_sorted[n] + 1] = n + 1;
             }
         }
 
@@ -166,12 +247,21 @@ namespace Osmium {
         }
 
         /**
-         * Clear the stringtable, preparing for the next block.
+         * Number of different strings recorded.
+         */
+        size_t size() const {
+            return m_strings.size();
+        }
+
+        /**
+         * Clear the stringtable, preparing for the next block. The memory
+         * is kept for reuse.
          */
         void clear() {
+            m_chars.clear();
             m_strings.clear();
+            m_table.assign(m_table.size(), 0);
             m_id2id_map.clear();
-            m_size = 0;
         }
 
     }; // class StringTable
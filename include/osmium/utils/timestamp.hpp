@@ -22,6 +22,7 @@ You should have received a copy of the Licenses along with Osmium. If not, see
 
 */
 
+#include <cstring>
 #include <ctime>
 #include <stdexcept>
 #include <string>
@@ -46,6 +47,61 @@ namespace Osmium {
                 static const char f[] = "%Y-%m-%dT%H:%M:%SZ";
                 return f;
             }
+
+            /**
+             * Parse a number with the given count of digits.
+             * @returns The number or -1 if there is something else.
+             */
+            inline int parse_digits(const char* s, int count) {
+                int value = 0;
+                for (int i=0; i < count; ++i) {
+                    if (s[i] < '0' || s[i] > '9') {
+                        return -1;
+                    }
+                    value = value * 10 + (s[i] - '0');
+                }
+                return value;
+            }
+
+            /**
+             * Number of days since 1970-01-01 for a date in the proleptic
+             * Gregorian calendar. Days outside the length of the month
+             * are counted into the next month like timegm() does.
+             */
+            inline long days_from_civil(int year, int month, int day) {
+                year -= (month <= 2);
+                const long era = (year >= 0 ? year : year - 399) / 400;
+                const long year_of_era = year - era * 400;
+                const long day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+                const long day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+                return era * 146097 + day_of_era - 719468;
+            }
+
+            /**
+             * Parse a timestamp in exactly the format yyyy-mm-ddThh:mm:ssZ
+             * without going through strptime() and timegm().
+             *
+             * @returns false if the timestamp doesn't have this format or
+             *          has fields out of the range strptime() accepts.
+             */
+            inline bool parse_iso_fixed(const char* timestamp, time_t& result) {
+                if (timestamp[4] != '-' || timestamp[7] != '-' || timestamp[10] != 'T' ||
+                    timestamp[13] != ':' || timestamp[16] != ':' || timestamp[19] != 'Z' || timestamp[20] != '\0') {
+                    return false;
+                }
+                const int year   = parse_digits(timestamp,      4);
+                const int month  = parse_digits(timestamp +  5, 2);
+                const int day    = parse_digits(timestamp +  8, 2);
+                const int hour   = parse_digits(timestamp + 11, 2);
+                const int minute = parse_digits(timestamp + 14, 2);
+                const int second = parse_digits(timestamp + 17, 2);
+                if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 ||
+                    hour < 0 || hour > 23 || minute < 0 || minute > 59 || second < 0 || second > 60) {
+                    return false;
+                }
+                result = static_cast<time_t>(days_from_civil(year, month, day)) * 86400 + hour * 3600 + minute * 60 + second;
+                return true;
+            }
         }
 
         /**
@@ -66,11 +122,54 @@ namespace Osmium {
             return s;
         }
 
+        /**
+         * Append UTC Unix time in ISO date/time format to a string.
+         * Nothing is appended for timestamp 0. This is faster than
+         * to_iso() because it doesn't go through gmtime() and strftime().
+         */
+        inline void append_iso(std::string& out, time_t timestamp) {
+            if (timestamp == 0) {
+                return;
+            }
+            // number of days since 0000-03-01 and second of the day
+            long days = static_cast<long>(timestamp / 86400) + 719468;
+            long seconds = static_cast<long>(timestamp % 86400);
+            if (seconds < 0) {
+                seconds += 86400;
+                --days;
+            }
+            const long era = (days >= 0 ? days : days - 146096) / 146097;
+            const long day_of_era = days - era * 146097;
+            const long year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+            const long day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+            const long mp = (5 * day_of_year + 2) / 153;
+            const int day = day_of_year - (153 * mp + 2) / 5 + 1;
+            const int month = mp < 10 ? mp + 3 : mp - 9;
+            const long year = year_of_era + era * 400 + (month <= 2);
+            if (year < 0 || year > 9999) {
+                out += to_iso(timestamp);
+                return;
+            }
+            char buffer[timestamp_length] = "0000-00-00T00:00:00Z";
+            const int values[6] = { static_cast<int>(year), month, day, static_cast<int>(seconds / 3600), static_cast<int>(seconds / 60 % 60), static_cast<int>(seconds % 60) };
+            const int positions[6] = { 3, 6, 9, 12, 15, 18 };
+            for (int i=0; i < 6; ++i) {
+                for (int value = values[i], pos = positions[i]; value; value /= 10, --pos) {
+                    buffer[pos] = static_cast<char>('0' + value % 10);
+                }
+            }
+            out.append(buffer, timestamp_length - 1);
+        }
+
         /**
          * Parse ISO date/time string and return UTC unix time.
          * Throws std::invalid_argument, if the timestamp can not be parsed.
          */
         inline time_t parse_iso(const char* timestamp) {
+            time_t result;
+            if (std::strlen(timestamp) == static_cast<size_t>(timestamp_length - 1) && parse_iso_fixed(timestamp, result)) {
+                return result;
+            }
 #ifndef WIN32
             struct tm tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
             if (strptime(timestamp, timestamp_format(), &tm) == NULL) {
@@ -0,0 +1,127 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <osmium/handler.hpp>
+#include <osmium/handler/debug.hpp>
+#include <osmium/handler/find_bbox.hpp>
+
+BOOST_AUTO_TEST_SUITE(Handler_ObjectTypes)
+
+class NodeHandler : public Osmium::Handler::Base {
+
+public:
+
+    void node(const shared_ptr<Osmium::OSM::Node const>&) {
+    }
+
+};
+
+class AfterRelationsHandler : public Osmium::Handler::Base {
+
+public:
+
+    void after_relations() const {
+    }
+
+};
+
+class NodeLocationHandler : public Osmium::Handler::Base {
+
+public:
+
+    void node_location(const osm_object_id_t, const Osmium::OSM::Position&) {
+    }
+
+};
+
+class RunTimeHandler : public Osmium::Handler::Base {
+
+public:
+
+    void node(const shared_ptr<Osmium::OSM::Node const>&) {
+    }
+
+    uint32_t object_types() const {
+        return WAY_MASK;
+    }
+
+};
+
+class FilteringForwardHandler : public Osmium::Handler::Forward<NodeLocationHandler> {
+
+public:
+
+    FilteringForwardHandler(NodeLocationHandler& next_handler) : Osmium::Handler::Forward<NodeLocationHandler>(next_handler) {
+    }
+
+    void node(const shared_ptr<Osmium::OSM::Node>& node) const {
+        if (node->id() > 0) {
+            next_handler().node(node);
+        }
+    }
+
+};
+
+BOOST_AUTO_TEST_CASE(from_overwritten_methods) {
+    Osmium::Handler::Base base_handler;
+    BOOST_CHECK_EQUAL(0u, Osmium::Handler::ObjectTypes<Osmium::Handler::Base>::mask(base_handler));
+
+    NodeHandler node_handler;
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(NODE_MASK), Osmium::Handler::ObjectTypes<NodeHandler>::mask(node_handler));
+
+    AfterRelationsHandler after_relations_handler;
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(RELATION_MASK), Osmium::Handler::ObjectTypes<AfterRelationsHandler>::mask(after_relations_handler));
+
+    Osmium::Handler::FindBbox find_bbox_handler;
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(NODE_MASK), Osmium::Handler::ObjectTypes<Osmium::Handler::FindBbox>::mask(find_bbox_handler));
+
+    Osmium::Handler::Debug debug_handler;
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(ALL_OBJECTS_MASK), Osmium::Handler::ObjectTypes<Osmium::Handler::Debug>::mask(debug_handler));
+}
+
+BOOST_AUTO_TEST_CASE(from_object_types_method) {
+    RunTimeHandler run_time_handler;
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(WAY_MASK), Osmium::Handler::ObjectTypes<RunTimeHandler>::mask(run_time_handler));
+}
+
+BOOST_AUTO_TEST_CASE(forward_and_sequence) {
+    NodeHandler node_handler;
+    AfterRelationsHandler after_relations_handler;
+
+    Osmium::Handler::Forward<NodeHandler> forward_handler(node_handler);
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(NODE_MASK), Osmium::Handler::ObjectTypes<Osmium::Handler::Forward<NodeHandler> >::mask(forward_handler));
+
+    Osmium::Handler::Sequence<NodeHandler, AfterRelationsHandler> sequence_handler(node_handler, after_relations_handler);
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(NODE_MASK | RELATION_MASK), (Osmium::Handler::ObjectTypes<Osmium::Handler::Sequence<NodeHandler, AfterRelationsHandler> >::mask(sequence_handler)));
+}
+
+BOOST_AUTO_TEST_CASE(node_locations_only) {
+    NodeLocationHandler node_location_handler;
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(NODE_MASK), Osmium::Handler::ObjectTypes<NodeLocationHandler>::mask(node_location_handler));
+    BOOST_CHECK(Osmium::Handler::NodeLocationsOnly<NodeLocationHandler>::value(node_location_handler));
+
+    NodeHandler node_handler;
+    BOOST_CHECK(!Osmium::Handler::NodeLocationsOnly<NodeHandler>::value(node_handler));
+
+    AfterRelationsHandler after_relations_handler;
+    Osmium::Handler::Sequence<NodeLocationHandler, AfterRelationsHandler> sequence_handler1(node_location_handler, after_relations_handler);
+    BOOST_CHECK((Osmium::Handler::NodeLocationsOnly<Osmium::Handler::Sequence<NodeLocationHandler, AfterRelationsHandler> >::value(sequence_handler1)));
+
+    Osmium::Handler::Sequence<NodeLocationHandler, NodeHandler> sequence_handler2(node_location_handler, node_handler);
+    BOOST_CHECK(!(Osmium::Handler::NodeLocationsOnly<Osmium::Handler::Sequence<NodeLocationHandler, NodeHandler> >::value(sequence_handler2)));
+
+    Osmium::Handler::Forward<NodeLocationHandler> forward_handler1(node_location_handler);
+    BOOST_CHECK(Osmium::Handler::NodeLocationsOnly<Osmium::Handler::Forward<NodeLocationHandler> >::value(forward_handler1));
+
+    Osmium::Handler::Forward<NodeHandler> forward_handler2(node_handler);
+    BOOST_CHECK(!Osmium::Handler::NodeLocationsOnly<Osmium::Handler::Forward<NodeHandler> >::value(forward_handler2));
+
+    // a subclass of Forward overwriting node() needs whole nodes
+    FilteringForwardHandler filtering_handler(node_location_handler);
+    BOOST_CHECK(!Osmium::Handler::NodeLocationsOnly<FilteringForwardHandler>::value(filtering_handler));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
@@ -0,0 +1,147 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <osmium/handler/sort.hpp>
+
+#include <test_handlers.hpp>
+
+using Osmium::Test::RecordingHandler;
+
+namespace {
+
+    /**
+     * Send 3 * num objects in mixed order. Object n gets id (n * 7919) % num
+     * (negative for every fifth one) and version num - n, so ids and versions
+     * are out of order.
+     */
+    template <class THandler>
+    void send_objects(THandler& handler, int num) {
+        Osmium::OSM::Meta meta;
+        meta.has_multiple_object_versions(true);
+        handler.init(meta);
+        for (int n=0; n < num; ++n) {
+            const osm_object_id_t id = (n % 5 ? 1 : -1) * ((n * 7919) % num + 1);
+            std::ostringstream user;
+            user << "user" << n;
+
+            shared_ptr<Osmium::OSM::Relation> relation = make_shared<Osmium::OSM::Relation>();
+            relation->id(id).version(num - n).user(user.str().c_str());
+            relation->add_member('w', n, "outer");
+            handler.relation(relation);
+
+            shared_ptr<Osmium::OSM::Node> node = make_shared<Osmium::OSM::Node>();
+            node->id(id).version(num - n).user(user.str().c_str());
+            node->position(Osmium::OSM::Position(n / 1000.0, 0.0));
+            node->tags().add("n", user.str().c_str());
+            handler.node(node);
+
+            shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+            way->id(id % 100).version(1).user(user.str().c_str());
+            way->add_node(n);
+            way->add_node(n + 1);
+            handler.way(way);
+        }
+        handler.final();
+    }
+
+    bool by_key(const shared_ptr<Osmium::OSM::Object const>& lhs, const shared_ptr<Osmium::OSM::Object const>& rhs) {
+        if (std::abs(lhs->id()) != std::abs(rhs->id())) {
+            return std::abs(lhs->id()) < std::abs(rhs->id());
+        }
+        if (lhs->id() != rhs->id()) {
+            return lhs->id() < rhs->id();
+        }
+        return lhs->version() < rhs->version();
+    }
+
+    /**
+     * The expected result: All objects from send_objects() sorted with
+     * std::stable_sort.
+     */
+    std::string expected(int num) {
+        RecordingHandler collector(RecordingHandler::keep_objects);
+        send_objects(collector, num);
+
+        std::vector<shared_ptr<Osmium::OSM::Object const> > objects[3];
+
+        for (size_t i=0; i < collector.objects.size(); ++i) {
+            objects[collector.objects[i]->type()].push_back(collector.objects[i]);
+        }
+        for (int type=NODE; type <= RELATION; ++type) {
+            std::stable_sort(objects[type].begin(), objects[type].end(), by_key);
+        }
+
+        RecordingHandler handler(RecordingHandler::with_callbacks);
+        Osmium::OSM::Meta meta;
+        meta.has_multiple_object_versions(true);
+        handler.init(meta);
+        handler.before_nodes();
+        for (size_t i=0; i < objects[NODE].size(); ++i) {
+            handler.node(static_pointer_cast<Osmium::OSM::Node const>(objects[NODE][i]));
+        }
+        handler.after_nodes();
+        handler.before_ways();
+        for (size_t i=0; i < objects[WAY].size(); ++i) {
+            handler.way(static_pointer_cast<Osmium::OSM::Way const>(objects[WAY][i]));
+        }
+        handler.after_ways();
+        handler.before_relations();
+        for (size_t i=0; i < objects[RELATION].size(); ++i) {
+            handler.relation(static_pointer_cast<Osmium::OSM::Relation const>(objects[RELATION][i]));
+        }
+        handler.after_relations();
+        handler.final();
+        return handler.out.str();
+    }
+
+}
+
+BOOST_AUTO_TEST_SUITE(Sort)
+
+BOOST_AUTO_TEST_CASE(in_memory) {
+    RecordingHandler handler(RecordingHandler::with_callbacks);
+    Osmium::Handler::Sort<RecordingHandler> sort(handler);
+    send_objects(sort, 1000);
+    BOOST_CHECK_EQUAL(0u, sort.num_runs());
+    BOOST_CHECK_EQUAL(expected(1000), handler.out.str());
+}
+
+BOOST_AUTO_TEST_CASE(runs_in_worker_threads) {
+    RecordingHandler handler(RecordingHandler::with_callbacks | RecordingHandler::keep_objects);
+    Osmium::Handler::Sort<RecordingHandler> sort(handler);
+    sort.memory_budget(30 * 1000).num_workers(2);
+    send_objects(sort, 2000);
+    BOOST_CHECK(sort.num_runs() > 20);
+    BOOST_CHECK_EQUAL(expected(2000), handler.out.str());
+
+    // the objects were kept, so they must not point into the temporary files
+    BOOST_CHECK_EQUAL(-1, handler.objects[0]->id());
+    BOOST_CHECK_EQUAL(std::string("user0"), handler.objects[0]->user());
+    BOOST_CHECK_EQUAL(std::string("user0"), handler.objects[0]->tags().get_value_by_key("n"));
+}
+
+BOOST_AUTO_TEST_CASE(runs_without_threads) {
+    RecordingHandler handler(RecordingHandler::with_callbacks);
+    Osmium::Handler::Sort<RecordingHandler> sort(handler);
+    sort.memory_budget(50 * 1000).num_workers(0);
+    send_objects(sort, 2000);
+    BOOST_CHECK(sort.num_runs() > 10);
+    BOOST_CHECK_EQUAL(expected(2000), handler.out.str());
+}
+
+BOOST_AUTO_TEST_CASE(bad_temp_directory) {
+    RecordingHandler handler(RecordingHandler::with_callbacks);
+    Osmium::Handler::Sort<RecordingHandler> sort(handler);
+    sort.memory_budget(1000).num_workers(1).temp_directory("/nonexistent/directory");
+    BOOST_CHECK_THROW(send_objects(sort, 100), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,189 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#define OSMIUM_WITH_DUMP_INPUT
+#include <osmium.hpp>
+#include <osmium/output/dump.hpp>
+
+#include <temp_file_fixture.hpp>
+#include <test_handlers.hpp>
+
+using Osmium::Test::RecordingHandler;
+
+namespace {
+
+    std::string file_content(const std::string& filename) {
+        std::ifstream file(filename.c_str(), std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    /**
+     * Send the objects to the handler. This is used to write the test file
+     * and to get the expected result.
+     */
+    template <class THandler>
+    void send_objects(THandler& handler, int num_nodes) {
+        Osmium::OSM::Meta meta;
+        meta.bounds().extend(Osmium::OSM::Position(1.0, 2.0)).extend(Osmium::OSM::Position(3.0, 4.0));
+        handler.init(meta);
+        for (int i=1; i <= num_nodes; ++i) {
+            shared_ptr<Osmium::OSM::Node> node = make_shared<Osmium::OSM::Node>();
+            node->id(i).version(i % 5 + 1).changeset(i * 3).timestamp(1300000000 + i).uid(i % 7).user(i % 7 ? "someone" : "");
+            if (i % 10) {
+                node->position(Osmium::OSM::Position(i / 10000.0, -i / 20000.0));
+            }
+            if (i % 3 == 0) {
+                node->tags().add("amenity", i % 2 ? "pub" : "bench");
+                node->tags().add("name", "");
+            }
+            handler.node(node);
+        }
+        shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+        way->id(7).version(2).visible(false).user("x");
+        way->nodes().add(Osmium::OSM::WayNode(1, Osmium::OSM::Position(1.5, 2.5)));
+        way->add_node(-2);
+        handler.way(way);
+        shared_ptr<Osmium::OSM::Way> empty_way = make_shared<Osmium::OSM::Way>();
+        empty_way->id(8).tags().add("highway", "road");
+        handler.way(empty_way);
+        shared_ptr<Osmium::OSM::Relation> relation = make_shared<Osmium::OSM::Relation>();
+        relation->id(5).version(1).tags().add("type", "multipolygon");
+        relation->add_member('w', 7, "outer");
+        relation->add_member('n', 1, "");
+        relation->add_member('r', 6, "sub area");
+        handler.relation(relation);
+        handler.final();
+    }
+
+    void write_file(const std::string& filename, int num_nodes) {
+        Osmium::Output::Dump output((Osmium::OSMFile(filename)));
+        send_objects(output, num_nodes);
+    }
+
+    std::string expected(int num_nodes) {
+        RecordingHandler handler;
+        send_objects(handler, num_nodes);
+        return handler.out.str();
+    }
+
+    void write_to_fifo(const std::string& fifo, const std::string& content) {
+        std::ofstream file(fifo.c_str(), std::ios::binary);
+        file << content;
+    }
+
+}
+
+BOOST_AUTO_TEST_SUITE(Dump)
+
+BOOST_AUTO_TEST_CASE(read_mapped) {
+    TempFileFixture test_dump("test_dump.osh.dump");
+    const std::string& filename = test_dump.to_string();
+    write_file(filename, 20000);
+
+    RecordingHandler handler;
+    Osmium::Input::read(Osmium::OSMFile(filename), handler);
+    BOOST_CHECK(handler.out.str() == expected(20000));
+    BOOST_CHECK_EQUAL(5, handler.blocks); // 8000 + 8000 + 4000 nodes, ways, relations
+}
+
+BOOST_AUTO_TEST_CASE(read_stream) {
+    // larger than the buffer, so records are split between reads
+    TempFileFixture test_dump("test_dump.osh.dump");
+    const std::string& filename = test_dump.to_string();
+    write_file(filename, 30000);
+    const std::string content = file_content(filename);
+    BOOST_CHECK(content.size() > 2 * 1024 * 1024);
+
+    TempFileFixture fifo_fixture("test_dump_fifo.osh.dump");
+    const std::string& fifo = fifo_fixture.to_string();
+    BOOST_REQUIRE_EQUAL(0, mkfifo(fifo.c_str(), 0600));
+    boost::thread writer(write_to_fifo, fifo, content);
+
+    Osmium::OSMFile file(fifo);
+    RecordingHandler handler;
+    Osmium::Input::read(file, handler);
+    writer.join();
+    BOOST_CHECK(handler.out.str() == expected(30000));
+}
+
+BOOST_AUTO_TEST_CASE(view_records) {
+    TempFileFixture test_dump("test_dump.osh.dump");
+    const std::string& filename = test_dump.to_string();
+    write_file(filename, 3);
+    const std::string content = file_content(filename);
+    std::vector<uint64_t> buffer(content.size() / sizeof(uint64_t));
+    std::memcpy(&buffer[0], content.data(), content.size());
+
+    Osmium::Dump::Reader reader(reinterpret_cast<const char*>(&buffer[0]), content.size());
+    BOOST_CHECK_EQUAL(Osmium::Dump::flag_history, reader.header().flags);
+    BOOST_CHECK_EQUAL(Osmium::OSM::Position(1.0, 2.0).x(), reader.header().min_x);
+
+    Osmium::Dump::ObjectView object;
+    BOOST_REQUIRE(reader.next(object));
+    BOOST_CHECK_EQUAL(NODE, object.type());
+    BOOST_CHECK_EQUAL(1, object.id());
+    BOOST_CHECK_EQUAL("someone", std::string(object.user()));
+    BOOST_CHECK_EQUAL(0u, object.tags_size());
+    BOOST_REQUIRE(reader.next(object));
+    BOOST_REQUIRE(reader.next(object));
+    BOOST_CHECK_EQUAL(3, object.id());
+    BOOST_REQUIRE_EQUAL(2u, object.tags_size());
+    BOOST_CHECK_EQUAL("amenity", std::string(object.tag_key(0)));
+    BOOST_CHECK_EQUAL("pub", std::string(object.tag_value(0)));
+    BOOST_CHECK_EQUAL("", std::string(object.tag_value(1)));
+    BOOST_CHECK(object.position() == Osmium::OSM::Position(0.0003, -0.00015));
+    BOOST_CHECK_EQUAL(0u, object.size() % Osmium::Dump::alignment);
+
+    BOOST_REQUIRE(reader.next(object));
+    BOOST_CHECK_EQUAL(WAY, object.type());
+    BOOST_CHECK(!object.visible());
+    BOOST_REQUIRE_EQUAL(2u, object.members_size());
+    BOOST_CHECK_EQUAL(1, object.way_node(0).ref);
+    BOOST_CHECK(!Osmium::OSM::Position(object.way_node(1).x, object.way_node(1).y).defined());
+    BOOST_REQUIRE(reader.next(object));
+    BOOST_CHECK_EQUAL(8, object.id());
+    BOOST_REQUIRE(reader.next(object));
+    BOOST_CHECK_EQUAL(RELATION, object.type());
+    BOOST_REQUIRE_EQUAL(3u, object.members_size());
+    BOOST_CHECK_EQUAL('r', object.member(2).type);
+    BOOST_CHECK_EQUAL("sub area", std::string(object.member_role(2)));
+    BOOST_CHECK(!reader.next(object));
+}
+
+BOOST_AUTO_TEST_CASE(broken_files) {
+    TempFileFixture test_dump("test_dump.osh.dump");
+    const std::string& filename = test_dump.to_string();
+    write_file(filename, 3);
+    const std::string content = file_content(filename);
+    std::vector<uint64_t> buffer(content.size() / sizeof(uint64_t));
+    std::memcpy(&buffer[0], content.data(), content.size());
+    char* data = reinterpret_cast<char*>(&buffer[0]);
+
+    BOOST_CHECK_THROW(Osmium::Dump::Reader(data, 10), Osmium::Dump::FormatError);
+
+    Osmium::Dump::ObjectView object;
+    Osmium::Dump::Reader truncated(data, content.size() - 8);
+    BOOST_CHECK_THROW(while (truncated.next(object)) {}, Osmium::Dump::FormatError);
+
+    // tag key offset pointing outside of the first record
+    Osmium::Dump::ObjectRecord* record = reinterpret_cast<Osmium::Dump::ObjectRecord*>(data + sizeof(Osmium::Dump::FileHeader));
+    record->num_tags = 1;
+    Osmium::Dump::Reader broken(data, content.size());
+    BOOST_CHECK_THROW(broken.next(object), Osmium::Dump::FormatError);
+
+    data[0] = 'X';
+    BOOST_CHECK_THROW(Osmium::Dump::Reader(data, content.size()), Osmium::Dump::FormatError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,195 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#define OSMIUM_WITH_O5M_INPUT
+#include <osmium.hpp>
+#include <osmium/output/o5m.hpp>
+
+#include <temp_file_fixture.hpp>
+
+/**
+ * Keeps all objects it gets.
+ */
+class CollectingHandler : public Osmium::Handler::Base {
+
+public:
+
+    Osmium::OSM::Bounds bounds;
+    std::vector<shared_ptr<Osmium::OSM::Node const> > nodes;
+    std::vector<shared_ptr<Osmium::OSM::Way const> > ways;
+    std::vector<shared_ptr<Osmium::OSM::Relation const> > relations;
+
+    void init(Osmium::OSM::Meta& meta) {
+        bounds = meta.bounds();
+    }
+
+    void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+        nodes.push_back(node);
+    }
+
+    void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+        ways.push_back(way);
+    }
+
+    void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+        relations.push_back(relation);
+    }
+
+};
+
+BOOST_AUTO_TEST_SUITE(O5M)
+
+BOOST_AUTO_TEST_CASE(varints) {
+    std::string data;
+    Osmium::O5M::append_varint(data, 300);
+    Osmium::O5M::append_zigzag(data, -3);
+    Osmium::O5M::append_zigzag(data, 1LL << 40);
+    BOOST_CHECK_EQUAL(std::string("\xac\x02\x05", 3), data.substr(0, 3));
+
+    const char* p = data.data();
+    const char* end = p + data.size();
+    BOOST_CHECK_EQUAL(300u, Osmium::O5M::decode_varint(p, end));
+    BOOST_CHECK_EQUAL(-3, Osmium::O5M::decode_zigzag(p, end));
+    BOOST_CHECK_EQUAL(1LL << 40, Osmium::O5M::decode_zigzag(p, end));
+    BOOST_CHECK(p == end);
+    BOOST_CHECK_THROW(Osmium::O5M::decode_varint(p, end), Osmium::O5M::ParseError);
+}
+
+BOOST_AUTO_TEST_CASE(read_example_node) {
+    // example from http://wiki.openstreetmap.org/wiki/O5m
+    const char data[] =
+        "\xff\xe0\x04o5m2"
+        "\x10\x21\xce\xad\x0f\x05\xe4\x8e\xa7\xca\x09\x94\xfe\xd2\x05"
+        "\x00\x85\xe3\x02\x00UScha\x00"
+        "\x86\x87\xe6\x53\xcc\xe2\x94\xfa\x03"
+        "\xfe";
+    TempFileFixture test_o5m("test_o5m.o5m");
+    {
+        std::ofstream file(test_o5m, std::ios::binary);
+        file.write(data, sizeof(data) - 1);
+    }
+
+    CollectingHandler handler;
+    Osmium::Input::read(Osmium::OSMFile(test_o5m.to_string()), handler);
+
+    BOOST_REQUIRE_EQUAL(1u, handler.nodes.size());
+    const Osmium::OSM::Node& node = *handler.nodes[0];
+    BOOST_CHECK_EQUAL(125799, node.id());
+    BOOST_CHECK_EQUAL(5, node.version());
+    BOOST_CHECK_EQUAL(1285874610, node.timestamp());
+    BOOST_CHECK_EQUAL(5922698, node.changeset());
+    BOOST_CHECK_EQUAL(45445, node.uid());
+    BOOST_CHECK_EQUAL(std::string("UScha"), node.user());
+    BOOST_CHECK_EQUAL(87867843, node.position().x());
+    BOOST_CHECK_EQUAL(530749606, node.position().y());
+    BOOST_CHECK(node.visible());
+}
+
+BOOST_AUTO_TEST_CASE(write_and_read) {
+    TempFileFixture test_osh_o5m("test_o5m.osh.o5m");
+    const std::string& filename = test_osh_o5m.to_string();
+
+    {
+        Osmium::OSM::Meta meta;
+        meta.bounds().extend(Osmium::OSM::Position(-1.5, 2.5)).extend(Osmium::OSM::Position(3.5, 4.5));
+        Osmium::Output::O5M output((Osmium::OSMFile(filename)));
+        output.init(meta);
+        for (int i=1; i <= 40000; ++i) {
+            shared_ptr<Osmium::OSM::Node> node = make_shared<Osmium::OSM::Node>();
+            node->id(i).version(1 + i % 3).timestamp(1300000000 + i).changeset(100 + i % 7).uid(i % 11).user(i % 11 ? "someone" : "");
+            node->visible(i % 5 != 0);
+            node->position(Osmium::OSM::Position(i / 1000.0, -i / 1000.0));
+            node->tags().add("key", i % 2 ? "value" : boost::lexical_cast<std::string>(i).c_str());
+            output.node(node);
+        }
+        shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+        way->id(17).version(2).timestamp(1300000000).changeset(5).uid(3).user("foo");
+        way->add_node(5);
+        way->add_node(3);
+        way->add_node(5);
+        output.way(way);
+        shared_ptr<Osmium::OSM::Relation> relation = make_shared<Osmium::OSM::Relation>();
+        relation->id(-4).version(1);
+        relation->add_member('w', 17, "outer");
+        relation->add_member('n', 1, "");
+        relation->add_member('w', 15, "outer");
+        relation->add_member('r', 2, "sub");
+        relation->tags().add("type", "multipolygon");
+        output.relation(relation);
+        output.final();
+    }
+
+    CollectingHandler handler;
+    Osmium::Input::read(Osmium::OSMFile(filename), handler);
+
+    BOOST_CHECK_EQUAL(-15000000, handler.bounds.bottom_left().x());
+    BOOST_CHECK_EQUAL(45000000, handler.bounds.top_right().y());
+
+    BOOST_REQUIRE_EQUAL(40000u, handler.nodes.size());
+    for (int i=1; i <= 40000; ++i) {
+        const Osmium::OSM::Node& node = *handler.nodes[i-1];
+        BOOST_REQUIRE_EQUAL(i, node.id());
+        BOOST_REQUIRE_EQUAL(1 + i % 3, node.version());
+        BOOST_REQUIRE_EQUAL(1300000000 + i, node.timestamp());
+        BOOST_REQUIRE_EQUAL(100 + i % 7, node.changeset());
+        BOOST_REQUIRE_EQUAL(i % 11, node.uid());
+        BOOST_REQUIRE_EQUAL(std::string(i % 11 ? "someone" : ""), node.user());
+        BOOST_REQUIRE_EQUAL(i % 5 != 0, node.visible());
+        if (node.visible()) {
+            BOOST_REQUIRE_EQUAL(Osmium::OSM::Position(i / 1000.0, -i / 1000.0), node.position());
+            BOOST_REQUIRE_EQUAL(1u, node.tags().size());
+            BOOST_REQUIRE_EQUAL(std::string(i % 2 ? "value" : boost::lexical_cast<std::string>(i)), node.tags().get_value_by_key("key"));
+        } else {
+            BOOST_REQUIRE_EQUAL(0u, node.tags().size());
+        }
+    }
+
+    BOOST_REQUIRE_EQUAL(1u, handler.ways.size());
+    const Osmium::OSM::Way& way = *handler.ways[0];
+    BOOST_CHECK_EQUAL(17, way.id());
+    BOOST_CHECK_EQUAL(std::string("foo"), way.user());
+    BOOST_REQUIRE_EQUAL(3u, way.nodes().size());
+    BOOST_CHECK_EQUAL(5, way.nodes()[0].ref());
+    BOOST_CHECK_EQUAL(3, way.nodes()[1].ref());
+    BOOST_CHECK_EQUAL(5, way.nodes()[2].ref());
+
+    BOOST_REQUIRE_EQUAL(1u, handler.relations.size());
+    const Osmium::OSM::Relation& relation = *handler.relations[0];
+    BOOST_CHECK_EQUAL(-4, relation.id());
+    BOOST_CHECK_EQUAL(0, relation.timestamp());
+    BOOST_REQUIRE_EQUAL(4u, relation.members().size());
+    BOOST_CHECK_EQUAL('w', relation.members()[2].type());
+    BOOST_CHECK_EQUAL(15, relation.members()[2].ref());
+    BOOST_CHECK_EQUAL(std::string("outer"), relation.members()[2].role());
+    BOOST_CHECK_EQUAL('r', relation.members()[3].type());
+    BOOST_CHECK_EQUAL(std::string("sub"), relation.members()[3].role());
+    BOOST_CHECK_EQUAL(std::string("multipolygon"), relation.tags().get_value_by_key("type"));
+}
+
+BOOST_AUTO_TEST_CASE(invalid_input) {
+    const std::string documents[] = {
+        std::string("\xff\xe0\x04o5x2", 7),                                 // unknown format
+        std::string("\xff\xe0\x04o5m2\x10\x05\x02", 10),                  // truncated dataset
+        std::string("\xff\xe0\x04o5m2\x10\x05\x02\x00\x00\x00\x00", 14), // tag not terminated
+        std::string("\xff\xe0\x04o5m2\x10\x05\x02\x00\x00\x00\x01", 14)  // invalid string reference
+    };
+    for (int i=0; i < 4; ++i) {
+        TempFileFixture test_o5m("test_o5m.o5m");
+        {
+            std::ofstream file(test_o5m, std::ios::binary);
+            file << documents[i];
+        }
+        CollectingHandler handler;
+        BOOST_CHECK_THROW(Osmium::Input::read(Osmium::OSMFile(test_o5m.to_string()), handler), Osmium::O5M::ParseError);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,165 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+#define OSMIUM_WITH_OPL_INPUT
+#include <osmium.hpp>
+#include <osmium/output/opl.hpp>
+
+#include <temp_file_fixture.hpp>
+#include <test_handlers.hpp>
+
+using Osmium::Test::RecordingHandler;
+
+namespace {
+
+    void write_file(const std::string& filename, const std::string& content) {
+        std::ofstream file(filename.c_str(), std::ios::binary);
+        file << content;
+    }
+
+    std::string parse(const std::string& filename, int num_workers, size_t chunk_size) {
+        RecordingHandler handler;
+        Osmium::Input::OPL<RecordingHandler> input(Osmium::OSMFile(filename), handler);
+        input.num_workers(num_workers).chunk_size(chunk_size);
+        input.parse();
+        return handler.out.str();
+    }
+
+}
+
+BOOST_AUTO_TEST_SUITE(OPL)
+
+BOOST_AUTO_TEST_CASE(format_numbers) {
+    std::string out;
+    Osmium::OPL::append_integer(out, -9223372036854775807LL - 1);
+    out += ' ';
+    Osmium::OPL::append_integer(out, 0);
+    out += ' ';
+    Osmium::OPL::append_coordinate(out, -1800000000);
+    out += ' ';
+    Osmium::OPL::append_coordinate(out, 12345);
+    out += ' ';
+    Osmium::OPL::append_coordinate(out, -81234567);
+    BOOST_CHECK_EQUAL(std::string("-9223372036854775808 0 -180 0.0012345 -8.1234567"), out);
+}
+
+BOOST_AUTO_TEST_CASE(read_lines) {
+    TempFileFixture test_opl("test_opl.opl");
+    const std::string& filename = test_opl.to_string();
+    write_file(filename,
+        "# comment\n"
+        "n1 v2 dV c3 t2012-01-01T12:00:00Z i4 ufoo%20%bar Tname=%2c%%3d%%40%%25%,amenity=pub x-8.5 y50.0000001\n"
+        "\n"
+        "n2 v1 dD c3 t i0 u T x y\n"
+        "w7 v1 dV c3 t2012-01-01T12:00:00Z i4 ufoo T Nn1,n2,n1\n"
+        "r9 v1 dV c3 t2012-01-01T12:00:00Z i4 ufoo Ttype=multipolygon Mw7@outer,n1@,r9@sub%20%role"
+    );
+    const std::string result = parse(filename, 0, 1);
+
+    BOOST_CHECK_EQUAL(std::string(
+        "n1 v2 dV c3 t1325419200 i4 u[foo bar] [name]=[,=@%] [amenity]=[pub] x-85000000 y500000001\n"
+        "n2 v1 dD c3 t0 i0 u[] x2147483647 y2147483647\n"
+        "w7 v1 dV c3 t1325419200 i4 u[foo] 1 2 1\n"
+        "r9 v1 dV c3 t1325419200 i4 u[foo] [type]=[multipolygon] w7:outer n1: r9:sub role\n"), result);
+}
+
+BOOST_AUTO_TEST_CASE(read_crlf_lines) {
+    TempFileFixture test_opl("test_opl.opl");
+    const std::string& filename = test_opl.to_string();
+    write_file(filename,
+        "# comment\r\n"
+        "n1 v1 dV c3 t i4 ufoo Tname=bar x1 y2\r\n"
+        "\r\n"
+        "w7 v1 dV c3 t i4 ufoo T Nn1,n2\r\n"
+        "r9 v1 dV c3 t i4 ufoo T Mw7@outer\r\n"
+    );
+    const std::string expected(
+        "n1 v1 dV c3 t0 i4 u[foo] [name]=[bar] x10000000 y20000000\n"
+        "w7 v1 dV c3 t0 i4 u[foo] 1 2\n"
+        "r9 v1 dV c3 t0 i4 u[foo] w7:outer\n");
+    BOOST_CHECK_EQUAL(expected, parse(filename, 0, 1));
+    BOOST_CHECK_EQUAL(expected, parse(filename, 2, 1));
+}
+
+BOOST_AUTO_TEST_CASE(write_and_read) {
+    TempFileFixture test_opl("test_opl.opl");
+    const std::string& filename = test_opl.to_string();
+    {
+        Osmium::OSM::Meta meta;
+        Osmium::Output::OPL output((Osmium::OSMFile(filename)));
+        output.init(meta);
+        for (int i=1; i <= 1000; ++i) {
+            shared_ptr<Osmium::OSM::Node> node = make_shared<Osmium::OSM::Node>();
+            node->id(i).version(1 + i % 3).timestamp(1300000000 + i * 1000).changeset(100 + i % 7).uid(i % 11).user(i % 11 ? "some one" : "");
+            node->visible(i % 5 != 0);
+            node->position(Osmium::OSM::Position(i / 1000.0, -i / 100.0));
+            node->tags().add("key", i % 2 ? "value" : "a,b=c@d%e\n\xc3\xa4");
+            output.node(node);
+        }
+        shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+        way->id(17).version(2).timestamp(1300000000).changeset(5).uid(3).user("foo");
+        way->add_node(5);
+        way->add_node(-3);
+        output.way(way);
+        shared_ptr<Osmium::OSM::Relation> relation = make_shared<Osmium::OSM::Relation>();
+        relation->id(-4).version(1);
+        relation->add_member('w', 17, "outer");
+        relation->add_member('n', 1, "");
+        relation->add_member('r', 2, "sub role");
+        relation->tags().add("type", "multipolygon");
+        output.relation(relation);
+        output.final();
+    }
+
+    const std::string sequential = parse(filename, 0, 1);
+    BOOST_CHECK_EQUAL(1502, std::count(sequential.begin(), sequential.end(), '\n'));
+    BOOST_CHECK(sequential.find("n1000 v2 dD c106 t1301000000 i10 u[some one] [key]=[a,b=c@d%e\n\xc3\xa4] x10000000 y-100000000\n") != std::string::npos);
+    BOOST_CHECK(sequential.find("n2 v3 dV c102 t1300002000 i2 u[some one] [key]=[a,b=c@d%e\n\xc3\xa4] x20000 y-200000\n") != std::string::npos);
+    BOOST_CHECK(sequential.find("r-4 v1 dV c0 t0 i-1 u[] [type]=[multipolygon] w17:outer n1: r2:sub role\n") != std::string::npos);
+
+    BOOST_CHECK_EQUAL(sequential, parse(filename, 2, 1));
+    BOOST_CHECK_EQUAL(sequential, parse(filename, 3, 1000));
+    BOOST_CHECK_EQUAL(sequential, parse(filename, 1, 1024 * 1024));
+}
+
+BOOST_AUTO_TEST_CASE(invalid_lines) {
+    const char* documents[] = {
+        "n1 v1\nx1 v1\n",
+        "n1 v1\n\nn2 v1 q3\n",
+        "n1 v1 x1000\n",
+        "w1 Nn1,w2\n",
+        "r1 Mn1\n",
+        "n1 uf%zz%\n",
+        "n1 t2012\n",
+        NULL
+    };
+    const char* errors[] = {
+        "in line 2: unknown object type",
+        "in line 3: unknown field 'q'",
+        "in line 1: invalid coordinate",
+        "in line 1: expected node reference",
+        "in line 1: expected '@'",
+        "in line 1: invalid escape sequence",
+        "in line 1: invalid timestamp"
+    };
+    for (int i=0; documents[i]; ++i) {
+        TempFileFixture test_opl("test_opl.opl");
+        write_file(test_opl.to_string(), documents[i]);
+        for (int num_workers=0; num_workers < 2; ++num_workers) {
+            try {
+                parse(test_opl.to_string(), num_workers, 4);
+                BOOST_ERROR("no exception for document " << i);
+            } catch (Osmium::OPL::ParseError& e) {
+                BOOST_CHECK_MESSAGE(std::string(e.what()).find(errors[i]) != std::string::npos, e.what());
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
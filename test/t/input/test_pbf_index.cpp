@@ -0,0 +1,70 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <string>
+
+#include <osmium/input/pbf_index.hpp>
+
+#include <temp_file_fixture.hpp>
+
+BOOST_AUTO_TEST_SUITE(PBFIndex)
+
+BOOST_AUTO_TEST_CASE(entry) {
+    Osmium::Input::PBFIndex::Entry entry(100, 20);
+    BOOST_CHECK(!entry.is_header());
+    BOOST_CHECK(!entry.needed_for(ALL_OBJECTS_MASK));
+
+    entry.add_object(WAY_MASK, 17);
+    entry.add_object(WAY_MASK, 3);
+    entry.add_object(WAY_MASK, 42);
+    BOOST_CHECK_EQUAL(3, entry.min_id);
+    BOOST_CHECK_EQUAL(42, entry.max_id);
+    BOOST_CHECK(entry.needed_for(WAY_MASK));
+    BOOST_CHECK(!entry.needed_for(NODE_MASK | RELATION_MASK));
+
+    Osmium::Input::PBFIndex::Entry header(0, 20, Osmium::Input::PBFIndex::header_flag);
+    BOOST_CHECK(header.is_header());
+    BOOST_CHECK(header.needed_for(RELATION_MASK));
+}
+
+BOOST_AUTO_TEST_CASE(save_and_load) {
+    TempFileFixture pbf_file_fixture("test_pbf_index.osm.pbf");
+    TempFileFixture index_file_fixture("test_pbf_index.osm.pbf.idx");
+    const std::string& pbf_filename = pbf_file_fixture.to_string();
+
+    std::ofstream pbf_file(pbf_filename.c_str(), std::ios::binary);
+    pbf_file << "not really a PBF file";
+    pbf_file.close();
+
+    Osmium::Input::PBFIndex index;
+    BOOST_CHECK(!index.load(pbf_filename));
+
+    index.add(Osmium::Input::PBFIndex::Entry(0, 10, Osmium::Input::PBFIndex::header_flag));
+    index.add(Osmium::Input::PBFIndex::Entry(10, 5, NODE_MASK, -5, 1LL << 40));
+    index.add(Osmium::Input::PBFIndex::Entry(15, 6, RELATION_MASK, 7, 9));
+    index.save(pbf_filename);
+
+    Osmium::Input::PBFIndex loaded;
+    BOOST_REQUIRE(loaded.load(pbf_filename));
+    BOOST_REQUIRE_EQUAL(3u, loaded.entries().size());
+    BOOST_CHECK(loaded.entries()[0].is_header());
+    BOOST_CHECK_EQUAL(10u, loaded.entries()[1].offset);
+    BOOST_CHECK_EQUAL(5u, loaded.entries()[1].length);
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(NODE_MASK), loaded.entries()[1].types);
+    BOOST_CHECK_EQUAL(-5, loaded.entries()[1].min_id);
+    BOOST_CHECK_EQUAL(1LL << 40, loaded.entries()[1].max_id);
+    BOOST_CHECK_EQUAL(9, loaded.entries()[2].max_id);
+
+    // index doesn't match any more if the PBF file changes
+    std::ofstream changed_pbf_file(pbf_filename.c_str(), std::ios::binary | std::ios::app);
+    changed_pbf_file << "more data";
+    changed_pbf_file.close();
+    BOOST_CHECK(!loaded.load(pbf_filename));
+    BOOST_CHECK(loaded.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
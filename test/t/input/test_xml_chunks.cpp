@@ -0,0 +1,144 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#define OSMIUM_WITH_XML_INPUT
+#include <osmium.hpp>
+
+#include <temp_file_fixture.hpp>
+#include <test_handlers.hpp>
+
+using Osmium::Test::RecordingHandler;
+
+namespace {
+
+    void write_file(const std::string& filename, const std::string& content) {
+        std::ofstream file(filename.c_str(), std::ios::binary);
+        file << content;
+    }
+
+    std::string parse(const std::string& filename, int num_workers, size_t chunk_size) {
+        RecordingHandler handler(RecordingHandler::with_callbacks);
+        Osmium::OSMFile file(filename);
+        Osmium::Input::XML<RecordingHandler> input(file, handler);
+        input.num_workers(num_workers).chunk_size(chunk_size);
+        input.parse();
+        return handler.out.str();
+    }
+
+}
+
+BOOST_AUTO_TEST_SUITE(XMLChunks)
+
+BOOST_AUTO_TEST_CASE(chunks_give_same_result) {
+    std::ostringstream doc;
+    doc << "<?xml version='1.0' encoding='UTF-8'?>\n<osm version='0.6' generator='test'>\n <bounds minlon='1' minlat='2' maxlon='3' maxlat='4'/>\n";
+    for (int i=1; i <= 300; ++i) {
+        doc << " <node id='" << i << "' lat='1." << i << "' lon='-2." << i << "'";
+        if (i % 3) {
+            doc << "/>\n";
+        } else {
+            doc << ">\n  <tag k='n' v='" << i << "'/>\n </node>\n";
+        }
+    }
+    for (int i=1; i <= 100; ++i) {
+        doc << " <way id='" << i << "'>\n  <nd ref='" << i << "'/>\n  <nd ref='" << i+1 << "'/>\n  <tag k='highway' v='road &amp; more'/>\n </way>\n";
+    }
+    for (int i=1; i <= 50; ++i) {
+        doc << " <relation id='" << i << "'>\n  <member type='way' ref='" << i << "' role='outer'/>\n </relation>\n";
+    }
+    doc << "</osm>\n";
+    TempFileFixture test_osm("test_xml_chunks.osm");
+    const std::string& filename = test_osm.to_string();
+    write_file(filename, doc.str());
+
+    const std::string expected = parse(filename, 0, 1);
+    BOOST_CHECK_EQUAL(0u, expected.find("init [test] 0\nbefore_nodes\nn1 v0 dV c0 t0 i-1 u[] x-21000000 y11000000\n"));
+    BOOST_CHECK_EQUAL(expected, parse(filename, 4, 1));
+    BOOST_CHECK_EQUAL(expected, parse(filename, 2, 1000));
+    BOOST_CHECK_EQUAL(expected, parse(filename, 1, 100000));
+}
+
+BOOST_AUTO_TEST_CASE(delete_section_across_chunks) {
+    std::ostringstream doc;
+    doc << "<osmChange version='0.6'>\n <create>\n";
+    for (int i=1; i <= 20; ++i) {
+        doc << "  <node id='" << i << "' lat='1' lon='1'/>\n";
+    }
+    doc << " </create>\n <delete>\n";
+    for (int i=21; i <= 40; ++i) {
+        doc << "  <node id='" << i << "' lat='1' lon='1'/>\n";
+    }
+    doc << " </delete>\n <modify>\n";
+    for (int i=41; i <= 60; ++i) {
+        doc << "  <node id='" << i << "' lat='1' lon='1'/>\n";
+    }
+    doc << " </modify>\n</osmChange>\n";
+    TempFileFixture test_osm("test_xml_chunks.osm");
+    const std::string& filename = test_osm.to_string();
+    write_file(filename, doc.str());
+
+    const std::string expected = parse(filename, 0, 1);
+    BOOST_CHECK(expected.find("n20 v0 dV ") != std::string::npos);
+    BOOST_CHECK(expected.find("n21 v0 dD ") != std::string::npos);
+    BOOST_CHECK(expected.find("n40 v0 dD ") != std::string::npos);
+    BOOST_CHECK(expected.find("n41 v0 dV ") != std::string::npos);
+    BOOST_CHECK_EQUAL(expected, parse(filename, 3, 1));
+    BOOST_CHECK_EQUAL(expected, parse(filename, 3, 200));
+}
+
+BOOST_AUTO_TEST_CASE(object_tags_in_comments) {
+    std::ostringstream doc;
+    doc << "<osmChange version='0.6'>\n <create>\n";
+    for (int i=1; i <= 10; ++i) {
+        doc << "  <node id='" << i << "' lat='1' lon='1'/>\n";
+    }
+    doc << " </create>\n <delete>\n  <!-- <node id='100'/> -->\n";
+    for (int i=11; i <= 20; ++i) {
+        doc << "  <node id='" << i << "' lat='1' lon='1'/>\n";
+    }
+    doc << "  <![CDATA[ <way id='100'> ]]>\n";
+    for (int i=1; i <= 10; ++i) {
+        doc << "  <way id='" << i << "'>\n   <nd ref='" << i << "'/>\n  </way>\n";
+    }
+    doc << " </delete>\n</osmChange>\n";
+    TempFileFixture test_osm("test_xml_chunks.osm");
+    const std::string& filename = test_osm.to_string();
+    write_file(filename, doc.str());
+
+    const std::string expected = parse(filename, 0, 1);
+    BOOST_CHECK(expected.find("n100 ") == std::string::npos);
+    BOOST_CHECK(expected.find("w100 ") == std::string::npos);
+    BOOST_CHECK(expected.find("n11 v0 dD ") != std::string::npos);
+    BOOST_CHECK(expected.find("w10 v0 dD ") != std::string::npos);
+    for (size_t chunk_size = 1; chunk_size < doc.str().size(); chunk_size += 7) {
+        BOOST_CHECK_EQUAL(expected, parse(filename, 2, chunk_size));
+    }
+
+    TempFileFixture broken_osm("test_xml_chunks_broken.osm");
+    const std::string& broken_filename = broken_osm.to_string();
+    write_file(broken_filename, "<osm>\n <node id='1'/>\n <!-- <node id='2'/> -->\n <node id='3'>\n</osm>\n");
+    BOOST_CHECK_THROW(parse(broken_filename, 2, 1), Osmium::Input::XMLScanner::ParseError);
+    BOOST_CHECK_THROW(parse(broken_filename, 2, 10), Osmium::Input::XMLScanner::ParseError);
+}
+
+BOOST_AUTO_TEST_CASE(chunks_not_fitting_together) {
+    const char* documents[] = {
+        "<osm>\n <node id='1'/>\n <node id='2'/>\n",
+        "<osm>\n <node id='1'/>\n <node id='2'/>\n</osm>\n</osm>\n",
+        "<osm>\n <node id='1'/>\n <node id='2'>\n</osm>\n",
+        NULL
+    };
+    for (int i=0; documents[i]; ++i) {
+        TempFileFixture test_osm("test_xml_chunks.osm");
+        write_file(test_osm.to_string(), documents[i]);
+        BOOST_CHECK_THROW(parse(test_osm.to_string(), 2, 1), Osmium::Input::XMLScanner::ParseError);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,140 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+
+#define OSMIUM_WITH_XML_INPUT
+#include <osmium.hpp>
+
+#include <temp_file_fixture.hpp>
+
+typedef Osmium::Input::XMLScanner scanner_t;
+
+BOOST_AUTO_TEST_SUITE(XMLScanner)
+
+BOOST_AUTO_TEST_CASE(elements_and_attributes) {
+    const std::string data("<?xml version='1.0' encoding='UTF-8'?>\n<!-- comment <a> -->\n<osm version=\"0.6\">\n <node id='1' user=\"a &amp; b &#228;&#x20AC;\"/>\n</osm>\n");
+    scanner_t scanner(data.data(), data.size());
+
+    BOOST_REQUIRE_EQUAL(scanner_t::start_element, scanner.next());
+    BOOST_CHECK(scanner.name_is("osm"));
+    BOOST_REQUIRE_EQUAL(1u, scanner.attribute_count());
+    BOOST_CHECK_EQUAL(std::string("version"), std::string(scanner.attribute(0).name, scanner.attribute(0).name_length));
+    BOOST_CHECK_EQUAL(std::string("0.6"), scanner.attribute(0).value);
+
+    BOOST_REQUIRE_EQUAL(scanner_t::start_element, scanner.next());
+    BOOST_CHECK(scanner.name_is("node"));
+    BOOST_REQUIRE_EQUAL(2u, scanner.attribute_count());
+    BOOST_CHECK_EQUAL(std::string("1"), scanner.attribute(0).value);
+    BOOST_CHECK_EQUAL(std::string("a & b \xc3\xa4\xe2\x82\xac"), scanner.attribute(1).value);
+    BOOST_CHECK_EQUAL(11u, scanner.attribute(1).value_length);
+
+    BOOST_REQUIRE_EQUAL(scanner_t::end_element, scanner.next());
+    BOOST_CHECK(scanner.name_is("node"));
+    BOOST_REQUIRE_EQUAL(scanner_t::end_element, scanner.next());
+    BOOST_CHECK(scanner.name_is("osm"));
+    BOOST_CHECK_EQUAL(scanner_t::end_of_document, scanner.next());
+}
+
+BOOST_AUTO_TEST_CASE(attribute_value_normalization) {
+    const std::string data("<osm a='x\ty\r\nz&#10;'/>");
+    scanner_t scanner(data.data(), data.size());
+
+    BOOST_REQUIRE_EQUAL(scanner_t::start_element, scanner.next());
+    BOOST_CHECK_EQUAL(std::string("x y z\n"), scanner.attribute(0).value);
+}
+
+BOOST_AUTO_TEST_CASE(not_well_formed) {
+    const char* documents[] = {
+        "",
+        "<osm>",
+        "<osm></node>",
+        "<osm a='b'",
+        "<osm a='&foo;'/>",
+        "<osm a='<'/>",
+        "<osm a=b/>",
+        "<osm/><osm/>",
+        NULL
+    };
+    for (int i=0; documents[i]; ++i) {
+        scanner_t scanner(documents[i], strlen(documents[i]));
+        BOOST_CHECK_THROW(while (scanner.next() != scanner_t::end_of_document) {}, scanner_t::ParseError);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(read_through_small_buffer) {
+    TempFileFixture test_osm_gz("test_xml_scanner.osm.gz");
+    const std::string& filename = test_osm_gz.to_string();
+    {
+        std::ofstream file(filename.c_str(), std::ios::binary);
+        boost::iostreams::filtering_ostream out;
+        out.push(boost::iostreams::gzip_compressor());
+        out.push(file);
+        out << "<osm>";
+        for (int i=0; i < 100; ++i) {
+            out << "<tag k='key" << i << "' v='&lt;value&gt;'/>";
+        }
+        out << "</osm>";
+    }
+
+    Osmium::OSMFile file(filename);
+    file.open_for_input();
+    scanner_t scanner(file, 16);
+    BOOST_REQUIRE_EQUAL(scanner_t::start_element, scanner.next());
+    for (int i=0; i < 100; ++i) {
+        BOOST_REQUIRE_EQUAL(scanner_t::start_element, scanner.next());
+        BOOST_CHECK_EQUAL("key" + boost::lexical_cast<std::string>(i), scanner.attribute(0).value);
+        BOOST_CHECK_EQUAL(std::string("<value>"), scanner.attribute(1).value);
+        BOOST_REQUIRE_EQUAL(scanner_t::end_element, scanner.next());
+    }
+    BOOST_CHECK_EQUAL(scanner_t::end_element, scanner.next());
+    BOOST_CHECK_EQUAL(scanner_t::end_of_document, scanner.next());
+    file.close();
+}
+
+BOOST_AUTO_TEST_CASE(parse_numbers) {
+    typedef Osmium::Input::XMLObjectParser parser_t;
+
+    BOOST_CHECK_EQUAL(12345678901LL, parser_t::parse_integer("12345678901"));
+    BOOST_CHECK_EQUAL(-17, parser_t::parse_integer("-17"));
+    BOOST_CHECK_EQUAL(3, parser_t::parse_integer(" 3"));
+
+    BOOST_CHECK_EQUAL(13942680, parser_t::parse_coordinate("1.3942680"));
+    BOOST_CHECK_EQUAL(-1799999999, parser_t::parse_coordinate("-179.9999999"));
+    BOOST_CHECK_EQUAL(15, parser_t::parse_coordinate("0.00000145"));
+    BOOST_CHECK_EQUAL(-100000000, parser_t::parse_coordinate("-10"));
+    BOOST_CHECK_EQUAL(15000000, parser_t::parse_coordinate("1.5e0"));
+}
+
+BOOST_AUTO_TEST_CASE(fragment) {
+    const std::string data("<osm>\n <node id='1'>\n  <tag k='a' v='b'/>\n </node>\n</osm>\n");
+    const char* begin = data.data() + data.find("<tag");
+    const char* end = data.data() + data.find("</osm>");
+
+    scanner_t scanner(data.data(), begin, end);
+    BOOST_REQUIRE_EQUAL(scanner_t::start_element, scanner.next());
+    BOOST_CHECK(scanner.name_is("tag"));
+    BOOST_REQUIRE_EQUAL(scanner_t::end_element, scanner.next());
+    BOOST_REQUIRE_EQUAL(scanner_t::end_element, scanner.next());
+    BOOST_CHECK(scanner.name_is("node"));
+    BOOST_CHECK_EQUAL(scanner_t::end_of_document, scanner.next());
+    BOOST_CHECK(scanner.seen_element());
+    BOOST_CHECK_EQUAL(-1, scanner.depth_change());
+
+    scanner_t broken(data.data(), begin, begin + 8);
+    try {
+        broken.next();
+        BOOST_ERROR("no exception");
+    } catch (scanner_t::ParseError& e) {
+        BOOST_CHECK_EQUAL(0, std::string(e.what()).find("XML parsing error at line 3:"));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
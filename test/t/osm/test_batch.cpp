@@ -0,0 +1,130 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <osmium/handler.hpp>
+#include <osmium/osm/batch.hpp>
+
+BOOST_AUTO_TEST_SUITE(Batch)
+
+class PerNodeHandler : public Osmium::Handler::Base {
+
+public:
+
+    int count;
+
+    PerNodeHandler() : Base(), count(0) {
+    }
+
+    void node(const shared_ptr<Osmium::OSM::Node const>&) {
+        ++count;
+    }
+
+};
+
+class NodeBatchHandler : public Osmium::Handler::Base {
+
+public:
+
+    int count;
+    int batches;
+
+    NodeBatchHandler() : Base(), count(0), batches(0) {
+    }
+
+    void nodes(const Osmium::OSM::NodeBatch& batch) {
+        count += batch.size();
+        ++batches;
+    }
+
+};
+
+class CountingForwardHandler : public Osmium::Handler::Forward<NodeBatchHandler> {
+
+public:
+
+    int count;
+
+    CountingForwardHandler(NodeBatchHandler& next_handler) : Osmium::Handler::Forward<NodeBatchHandler>(next_handler), count(0) {
+    }
+
+    void node(const shared_ptr<Osmium::OSM::Node>& node) {
+        ++count;
+        next_handler().node(node);
+    }
+
+};
+
+BOOST_AUTO_TEST_CASE(add_and_iterate) {
+    Osmium::OSM::NodeBatch batch;
+    BOOST_CHECK(batch.empty());
+
+    batch.add().id(17);
+    batch.add().id(18);
+    BOOST_CHECK_EQUAL(2u, batch.size());
+    BOOST_CHECK_EQUAL(17, batch[0].id());
+    BOOST_CHECK_EQUAL(18, batch.ptr(1)->id());
+
+    osm_object_id_t sum = 0;
+    for (Osmium::OSM::NodeBatch::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+        sum += it->id();
+    }
+    BOOST_CHECK_EQUAL(35, sum);
+}
+
+BOOST_AUTO_TEST_CASE(clear_reuses_objects) {
+    Osmium::OSM::WayBatch batch;
+    batch.add().id(1);
+    batch.add().id(2);
+    const Osmium::OSM::Way* first = batch.ptr(0).get();
+    shared_ptr<Osmium::OSM::Way> kept = batch.ptr(1);
+
+    batch.clear();
+    BOOST_CHECK(batch.empty());
+
+    Osmium::OSM::Way& way1 = batch.add();
+    BOOST_CHECK_EQUAL(&way1, first);
+    BOOST_CHECK_EQUAL(0, way1.id());
+
+    Osmium::OSM::Way& way2 = batch.add();
+    BOOST_CHECK(&way2 != kept.get());
+    BOOST_CHECK_EQUAL(2, kept->id());
+}
+
+BOOST_AUTO_TEST_CASE(callbacks) {
+    Osmium::OSM::NodeBatch batch;
+    batch.add();
+    batch.add();
+    batch.add();
+
+    PerNodeHandler per_node_handler;
+    Osmium::Handler::BatchCallbacks<PerNodeHandler>::nodes(per_node_handler, batch);
+    BOOST_CHECK_EQUAL(3, per_node_handler.count);
+
+    NodeBatchHandler node_batch_handler;
+    Osmium::Handler::BatchCallbacks<NodeBatchHandler>::nodes(node_batch_handler, batch);
+    BOOST_CHECK_EQUAL(3, node_batch_handler.count);
+    BOOST_CHECK_EQUAL(1, node_batch_handler.batches);
+
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(NODE_MASK), Osmium::Handler::ObjectTypes<NodeBatchHandler>::mask(node_batch_handler));
+}
+
+BOOST_AUTO_TEST_CASE(forward_callbacks) {
+    Osmium::OSM::NodeBatch batch;
+    batch.add();
+    batch.add();
+
+    NodeBatchHandler node_batch_handler;
+    Osmium::Handler::Forward<NodeBatchHandler> forward_handler(node_batch_handler);
+    Osmium::Handler::BatchCallbacks<Osmium::Handler::Forward<NodeBatchHandler> >::nodes(forward_handler, batch);
+    BOOST_CHECK_EQUAL(2, node_batch_handler.count);
+    BOOST_CHECK_EQUAL(1, node_batch_handler.batches);
+
+    // a subclass overwriting node() still gets every node
+    CountingForwardHandler counting_handler(node_batch_handler);
+    Osmium::Handler::BatchCallbacks<CountingForwardHandler>::nodes(counting_handler, batch);
+    BOOST_CHECK_EQUAL(2, counting_handler.count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
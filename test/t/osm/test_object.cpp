@@ -146,6 +146,33 @@ BOOST_AUTO_TEST_CASE(Object_user_setsUsername) {
     BOOST_CHECK_EQUAL(obj.user(), "L33t User");
 }
 
+BOOST_AUTO_TEST_CASE(Object_userBorrowed_copiesOwnTheirStrings) {
+    char user[] = "L33t User";
+    char key[] = "highway";
+    Osmium::OSM::Node obj;
+
+    obj.user_borrowed(user);
+    obj.tags().add_borrowed(key, "primary");
+    BOOST_CHECK(obj.user() == user);
+
+    Osmium::OSM::Node copy(obj);
+    Osmium::OSM::Node assigned;
+    assigned = obj;
+    user[0] = 'l';
+    key[0] = 'H';
+    BOOST_CHECK_EQUAL(obj.user(), "l33t User");
+    BOOST_CHECK_EQUAL(copy.user(), "L33t User");
+    BOOST_CHECK_EQUAL(copy.tags()[0].key(), "highway");
+    BOOST_CHECK_EQUAL(assigned.user(), "L33t User");
+    BOOST_CHECK_EQUAL(assigned.tags()[0].key(), "highway");
+
+    obj.materialize();
+    user[0] = 'x';
+    key[0] = 'x';
+    BOOST_CHECK_EQUAL(obj.user(), "l33t User");
+    BOOST_CHECK_EQUAL(obj.tags()[0].key(), "Highway");
+}
+
 
 BOOST_AUTO_TEST_CASE(Object_visible_setsVisible) {
     Osmium::OSM::Node obj;
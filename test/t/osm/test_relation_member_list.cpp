@@ -97,4 +97,26 @@ BOOST_AUTO_TEST_CASE(RelationMemberList_addMember_addsNewMember) {
     BOOST_CHECK_EQUAL(relationmemberlist[0].role(), "role1");
 }
 
+BOOST_AUTO_TEST_CASE(RelationMemberList_reset_keepsMembersForReuse) {
+    FilledRelationMemberListFixture fix;
+    fix.relationmemberlist.add_member('n', 4, "a rather long role that doesn't fit into a short string");
+    const char* role = fix.relationmemberlist[3].role();
+
+    fix.relationmemberlist.reset();
+    BOOST_CHECK_EQUAL(fix.relationmemberlist.size(), 0);
+    BOOST_CHECK_EQUAL(fix.relationmemberlist.begin() == fix.relationmemberlist.end(), true);
+
+    for (int n = 1; n <= 4; ++n) {
+        fix.relationmemberlist.add_member('w', 10 + n, "another role which also needs its own memory");
+    }
+    BOOST_CHECK_EQUAL(fix.relationmemberlist.size(), 4);
+    BOOST_CHECK_EQUAL(fix.relationmemberlist[0].type(), 'w');
+    BOOST_CHECK_EQUAL(fix.relationmemberlist[0].ref(), 11);
+    BOOST_CHECK(fix.relationmemberlist[3].role() == role);
+
+    const Osmium::OSM::RelationMemberList copy = fix.relationmemberlist;
+    BOOST_CHECK_EQUAL(copy.size(), 4);
+    BOOST_CHECK_EQUAL(copy[3].ref(), 14);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
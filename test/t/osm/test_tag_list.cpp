@@ -118,4 +118,63 @@ BOOST_AUTO_TEST_CASE(TagList_getValueByKey_returns0IfKeyIsNotPresent) {
     BOOST_CHECK_EQUAL((uintptr_t)taglist.get_value_by_key("something_else"), 0);
 }
 
+BOOST_AUTO_TEST_CASE(TagList_addBorrowed_doesNotCopyStrings) {
+    char key[] = "entry1";
+    char value[] = "value1";
+    Osmium::OSM::TagList taglist;
+
+    taglist.add_borrowed(key, value);
+    BOOST_CHECK(taglist[0].borrowed());
+    BOOST_CHECK(taglist[0].key() == key);
+    BOOST_CHECK(taglist[0].value() == value);
+}
+
+BOOST_AUTO_TEST_CASE(TagList_copy_materializesBorrowedTags) {
+    char key[] = "entry1";
+    char value[] = "value1";
+    Osmium::OSM::TagList taglist;
+    taglist.add_borrowed(key, value);
+
+    Osmium::OSM::TagList copy = taglist;
+    Osmium::OSM::TagList assigned;
+    assigned = taglist;
+    key[0] = 'E';
+
+    BOOST_CHECK(!copy[0].borrowed());
+    BOOST_CHECK_EQUAL(copy[0].key(), "entry1");
+    BOOST_CHECK_EQUAL(copy[0].value(), "value1");
+    BOOST_CHECK_EQUAL(assigned[0].key(), "entry1");
+    BOOST_CHECK_EQUAL(taglist[0].key(), "Entry1");
+
+    taglist.materialize();
+    key[0] = 'x';
+    BOOST_CHECK(!taglist[0].borrowed());
+    BOOST_CHECK_EQUAL(taglist[0].key(), "Entry1");
+}
+
+BOOST_AUTO_TEST_CASE(TagList_reset_keepsStringsForReuse) {
+    char key[] = "borrowed";
+    Osmium::OSM::TagList taglist;
+    taglist.add("entry1", "a rather long value that doesn't fit into a short string");
+    taglist.add("entry2", "value2");
+    const char* value = taglist[0].value();
+
+    taglist.reset();
+    BOOST_CHECK_EQUAL(taglist.empty(), true);
+    BOOST_CHECK_EQUAL(taglist.begin() == taglist.end(), true);
+
+    taglist.add("entry3", "another value which also needs its own memory");
+    taglist.add_borrowed(key, key);
+    BOOST_CHECK_EQUAL(taglist.size(), 2);
+    BOOST_CHECK(taglist[0].value() == value);
+    BOOST_CHECK_EQUAL(taglist[0].key(), "entry3");
+    BOOST_CHECK(taglist[1].borrowed());
+    BOOST_CHECK(taglist[1].key() == key);
+    BOOST_CHECK_EQUAL((uintptr_t)taglist.get_value_by_key("entry2"), 0);
+
+    Osmium::OSM::TagList copy = taglist;
+    BOOST_CHECK_EQUAL(copy.size(), 2);
+    BOOST_CHECK(!copy[1].borrowed());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
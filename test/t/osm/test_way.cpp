@@ -115,4 +115,23 @@ BOOST_AUTO_TEST_CASE(Way_comparisonOperator_comparesByIdThenByVersion) {
     BOOST_CHECK_EQUAL(way1 > way2, false);
 }
 
+BOOST_AUTO_TEST_CASE(Way_reset_keepsMemoryForReuse) {
+    FilledWayFixture fix;
+    fix.way.version(3).visible(false).user("someone");
+    fix.way.tags().add("highway", "primary");
+    const Osmium::OSM::WayNode* nodes = &fix.way.nodes()[0];
+
+    fix.way.reset();
+    BOOST_CHECK_EQUAL(fix.way.id(), 0);
+    BOOST_CHECK_EQUAL(fix.way.version(), 0u);
+    BOOST_CHECK_EQUAL(fix.way.uid(), -1);
+    BOOST_CHECK_EQUAL(fix.way.user(), "");
+    BOOST_CHECK_EQUAL(fix.way.visible(), true);
+    BOOST_CHECK_EQUAL(fix.way.tags().empty(), true);
+    BOOST_CHECK_EQUAL(fix.way.nodes().empty(), true);
+
+    fix.way.add_node(4);
+    BOOST_CHECK(&fix.way.nodes()[0] == nodes);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
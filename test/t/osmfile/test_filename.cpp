@@ -47,6 +47,48 @@ BOOST_AUTO_TEST_CASE(filename_osh_pbf) {
     BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::PBF());
 }
 
+BOOST_AUTO_TEST_CASE(filename_o5m) {
+    Osmium::OSMFile file("test.o5m");
+    BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::OSM());
+    BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::O5M());
+}
+
+BOOST_AUTO_TEST_CASE(filename_o5c) {
+    Osmium::OSMFile file("test.o5c");
+    BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::Change());
+    BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::O5M());
+}
+
+BOOST_AUTO_TEST_CASE(filename_osh_o5m) {
+    Osmium::OSMFile file("test.osh.o5m");
+    BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::History());
+    BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::O5M());
+}
+
+BOOST_AUTO_TEST_CASE(filename_opl) {
+    Osmium::OSMFile file("test.opl");
+    BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::OSM());
+    BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::OPL());
+}
+
+BOOST_AUTO_TEST_CASE(filename_osc_opl) {
+    Osmium::OSMFile file("test.osc.opl");
+    BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::Change());
+    BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::OPL());
+}
+
+BOOST_AUTO_TEST_CASE(filename_dump) {
+    Osmium::OSMFile file("test.dump");
+    BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::OSM());
+    BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::Dump());
+}
+
+BOOST_AUTO_TEST_CASE(filename_osh_dump) {
+    Osmium::OSMFile file("test.osh.dump");
+    BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::History());
+    BOOST_CHECK_EQUAL(file.encoding(), Osmium::OSMFile::FileEncoding::Dump());
+}
+
 BOOST_AUTO_TEST_CASE(filename_with_dir) {
     Osmium::OSMFile file("somedir/test.osm");
     BOOST_CHECK_EQUAL(file.type(), Osmium::OSMFile::FileType::OSM());
@@ -198,6 +240,18 @@ BOOST_AUTO_TEST_CASE(OSMFile_filenameWithDefaultSuffix_shouldReturnCorrectFilena
 
     file.encoding(Osmium::OSMFile::FileEncoding::XMLgz());
     BOOST_CHECK_EQUAL(file.filename_with_default_suffix(), "test.osm.gz");
+
+    file.encoding(Osmium::OSMFile::FileEncoding::O5M());
+    BOOST_CHECK_EQUAL(file.filename_with_default_suffix(), "test.o5m");
+
+    file.type(Osmium::OSMFile::FileType::Change());
+    BOOST_CHECK_EQUAL(file.filename_with_default_suffix(), "test.o5c");
+
+    file.type(Osmium::OSMFile::FileType::History());
+    BOOST_CHECK_EQUAL(file.filename_with_default_suffix(), "test.osh.o5m");
+
+    file.encoding(Osmium::OSMFile::FileEncoding::OPL());
+    BOOST_CHECK_EQUAL(file.filename_with_default_suffix(), "test.osh.opl");
 }
 
 BOOST_AUTO_TEST_SUITE_END()
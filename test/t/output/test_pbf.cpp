@@ -0,0 +1,340 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#define OSMIUM_WITH_PBF_INPUT
+#include <osmium.hpp>
+#include <osmium/output/pbf.hpp>
+
+#include <temp_file_fixture.hpp>
+
+/**
+ * Counts the objects and sums up their ids.
+ */
+class CountingHandler : public Osmium::Handler::Base {
+
+public:
+
+    int node_count;
+    int way_count;
+    int relation_count;
+    int64_t id_sum;
+
+    CountingHandler() :
+        node_count(0),
+        way_count(0),
+        relation_count(0),
+        id_sum(0) {
+    }
+
+    void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+        ++node_count;
+        id_sum += node->id();
+    }
+
+    void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+        ++way_count;
+        id_sum += way->id();
+    }
+
+    void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+        ++relation_count;
+        id_sum += relation->id();
+    }
+
+};
+
+/**
+ * Copies nodes with IDs in the given range and all ways and relations.
+ * Blobs that are completely in or out of the range are copied or dropped
+ * without decoding them.
+ */
+class NodeRangeHandler : public Osmium::Handler::Base {
+
+    Osmium::Output::PBF& m_output;
+    osm_object_id_t m_min_id;
+    osm_object_id_t m_max_id;
+
+public:
+
+    int raw_count;
+    int dropped_count;
+
+    NodeRangeHandler(Osmium::Output::PBF& output, osm_object_id_t min_id, osm_object_id_t max_id) :
+        m_output(output),
+        m_min_id(min_id),
+        m_max_id(max_id),
+        raw_count(0),
+        dropped_count(0) {
+    }
+
+    void init(Osmium::OSM::Meta& meta) {
+        m_output.init(meta);
+    }
+
+    bool raw_blob(const Osmium::Input::PBFBlob& blob) {
+        const Osmium::Input::PBFIndex::Entry entry = blob.summary();
+        if (entry.types == NODE_MASK && (entry.max_id < m_min_id || entry.min_id > m_max_id)) {
+            ++dropped_count;
+            return true;
+        }
+        if (!(entry.types & NODE_MASK) || (entry.min_id >= m_min_id && entry.max_id <= m_max_id)) {
+            ++raw_count;
+            m_output.write_raw_blob(blob.raw_data().first, blob.raw_data().second);
+            return true;
+        }
+        return false;
+    }
+
+    void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+        if (node->id() >= m_min_id && node->id() <= m_max_id) {
+            m_output.node(node);
+        }
+    }
+
+    void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+        m_output.way(way);
+    }
+
+    void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+        m_output.relation(relation);
+    }
+
+    void final() {
+        m_output.final();
+    }
+
+};
+
+/**
+ * Remembers the way nodes of the first way and whether the file has
+ * locations on ways.
+ */
+class WayNodesHandler : public Osmium::Handler::Base {
+
+public:
+
+    bool locations_on_ways;
+    std::vector<Osmium::OSM::WayNode> way_nodes;
+
+    WayNodesHandler() :
+        locations_on_ways(false),
+        way_nodes() {
+    }
+
+    void init(Osmium::OSM::Meta& meta) {
+        locations_on_ways = meta.has_locations_on_ways();
+    }
+
+    void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+        if (way_nodes.empty()) {
+            way_nodes.assign(way->nodes().begin(), way->nodes().end());
+        }
+    }
+
+};
+
+static void write_way_file(const std::string& filename, bool locations_on_ways, int location_granularity=100) {
+    Osmium::OSM::Meta meta;
+    Osmium::Output::PBF output((Osmium::OSMFile(filename)));
+    output.locations_on_ways(locations_on_ways).location_granularity(location_granularity);
+    output.init(meta);
+    shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+    way->id(1).version(1);
+    way->nodes().add(Osmium::OSM::WayNode(10, Osmium::OSM::Position(1.5, -2.25)));
+    way->nodes().add(Osmium::OSM::WayNode(-3, Osmium::OSM::Position(-179.9999999, 89.9999999)));
+    way->nodes().add(Osmium::OSM::WayNode(12));
+    way->nodes().add(Osmium::OSM::WayNode(10, Osmium::OSM::Position(1.5, -2.25)));
+    output.way(way);
+    output.final();
+}
+
+static void write_file(const std::string& filename, int num_workers, int max_blocks_in_flight, const Osmium::Compression::BlobCodec& codec=Osmium::Compression::BlobCodec()) {
+    Osmium::OSM::Meta meta;
+    Osmium::Output::PBF output((Osmium::OSMFile(filename)));
+    output.num_workers(num_workers).max_blocks_in_flight(max_blocks_in_flight).compression(codec);
+    output.init(meta);
+    for (int i=1; i <= 30000; ++i) {
+        shared_ptr<Osmium::OSM::Node> node = make_shared<Osmium::OSM::Node>();
+        node->id(i).version(1).timestamp(1300000000 + i).changeset(i / 10).uid(i % 7).user(i % 7 ? "someone" : "");
+        node->position(Osmium::OSM::Position(i / 10000.0, i / 20000.0));
+        if (i % 3 == 0) {
+            node->tags().add("amenity", i % 2 ? "pub" : "bench");
+        }
+        output.node(node);
+    }
+    for (int i=1; i <= 100; ++i) {
+        shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+        way->id(i).version(2);
+        way->add_node(i);
+        way->add_node(i + 1);
+        way->tags().add("highway", "road");
+        output.way(way);
+    }
+    shared_ptr<Osmium::OSM::Relation> relation = make_shared<Osmium::OSM::Relation>();
+    relation->id(5).version(1);
+    relation->add_member('w', 1, "outer");
+    output.relation(relation);
+    output.final();
+}
+
+static std::string file_content(const std::string& filename) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/**
+ * Get the Blob message of the OSMHeader at the start of a PBF file.
+ */
+static OSMPBF::Blob header_blob(const std::string& content) {
+    const unsigned char* size_bytes = reinterpret_cast<const unsigned char*>(content.data());
+    const uint32_t size = (size_bytes[0] << 24) | (size_bytes[1] << 16) | (size_bytes[2] << 8) | size_bytes[3];
+    OSMPBF::BlobHeader blob_header;
+    blob_header.ParseFromArray(content.data() + 4, size);
+    BOOST_CHECK_EQUAL("OSMHeader", blob_header.type());
+    OSMPBF::Blob blob;
+    blob.ParseFromArray(content.data() + 4 + size, blob_header.datasize());
+    return blob;
+}
+
+BOOST_AUTO_TEST_SUITE(PBFOutput)
+
+BOOST_AUTO_TEST_CASE(workers_give_same_file) {
+    TempFileFixture serial("test_pbf_serial.osm.pbf");
+    TempFileFixture parallel("test_pbf_parallel.osm.pbf");
+    TempFileFixture parallel_many_blocks("test_pbf_parallel_many_blocks.osm.pbf");
+    write_file(serial.to_string(), 0, 1);
+    write_file(parallel.to_string(), 3, 1);
+    write_file(parallel_many_blocks.to_string(), 2, 16);
+
+    CountingHandler handler;
+    Osmium::Input::read(Osmium::OSMFile(parallel.to_string()), handler);
+    BOOST_CHECK_EQUAL(30000, handler.node_count);
+    BOOST_CHECK_EQUAL(100, handler.way_count);
+    BOOST_CHECK_EQUAL(1, handler.relation_count);
+    BOOST_CHECK_EQUAL(30000LL * 30001 / 2 + 5050 + 5, handler.id_sum);
+
+    const std::string content = file_content(serial.to_string());
+    BOOST_CHECK(content.size() > 1000);
+    BOOST_CHECK(content == file_content(parallel.to_string()));
+    BOOST_CHECK(content == file_content(parallel_many_blocks.to_string()));
+}
+
+BOOST_AUTO_TEST_CASE(compression) {
+    const char* codecs[] = { "none", "zlib:1", "zlib:9", "lzma", "zstd:1", "lz4", NULL };
+    for (int i=0; codecs[i]; ++i) {
+        Osmium::Compression::BlobCodec codec;
+        try {
+            codec = Osmium::Compression::BlobCodec::parse(codecs[i]);
+        } catch (std::invalid_argument&) {
+            // not compiled in
+            continue;
+        }
+
+        TempFileFixture test_pbf("test_pbf.osm.pbf");
+        const std::string& filename = test_pbf.to_string();
+        write_file(filename, 1, 4, codec);
+        CountingHandler handler;
+        Osmium::Input::read(Osmium::OSMFile(filename), handler);
+        BOOST_CHECK_EQUAL(30000, handler.node_count);
+        BOOST_CHECK_EQUAL(30000LL * 30001 / 2 + 5050 + 5, handler.id_sum);
+
+        // the header is readable without the codec
+        const OSMPBF::Blob blob = header_blob(file_content(filename));
+        if (codec.type() == Osmium::Compression::BlobCodec::none) {
+            BOOST_CHECK(blob.has_raw());
+        } else {
+            BOOST_CHECK(blob.has_zlib_data());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(invalid_compression) {
+    BOOST_CHECK_THROW(Osmium::Compression::BlobCodec::parse("foo"), std::invalid_argument);
+    BOOST_CHECK_THROW(Osmium::Compression::BlobCodec::parse("zlib:10"), std::invalid_argument);
+    BOOST_CHECK_THROW(Osmium::Compression::BlobCodec::parse("zlib:"), std::invalid_argument);
+    BOOST_CHECK_THROW(Osmium::Compression::BlobCodec::parse("none:1"), std::invalid_argument);
+    BOOST_CHECK_EQUAL(9, Osmium::Compression::BlobCodec::parse("zlib:9").level());
+    BOOST_CHECK_EQUAL(Osmium::Compression::BlobCodec::none, Osmium::Compression::BlobCodec::parse("none").type());
+}
+
+BOOST_AUTO_TEST_CASE(raw_blobs) {
+    TempFileFixture input_pbf("test_pbf.osm.pbf");
+    const std::string& input_filename = input_pbf.to_string();
+    write_file(input_filename, 0, 1);
+
+    for (int num_workers=0; num_workers < 3; num_workers += 2) {
+        // everything is copied, so the file doesn't change
+        TempFileFixture copy_pbf("test_pbf_copy.osm.pbf");
+        const std::string& copy_filename = copy_pbf.to_string();
+        {
+            Osmium::Output::PBF output((Osmium::OSMFile(copy_filename)));
+            output.num_workers(num_workers);
+            NodeRangeHandler handler(output, 1, 1000000);
+            Osmium::Input::read(Osmium::OSMFile(input_filename), handler);
+            BOOST_CHECK_EQUAL(4, handler.raw_count);
+            BOOST_CHECK_EQUAL(0, handler.dropped_count);
+        }
+        BOOST_CHECK(file_content(input_filename) == file_content(copy_filename));
+
+        // nodes are in blocks 1-8000, 8001-16000, 16001-24000, and 24001-30000
+        // (together with the ways and the relation)
+        TempFileFixture range_pbf("test_pbf_range.osm.pbf");
+        const std::string& range_filename = range_pbf.to_string();
+        {
+            Osmium::Output::PBF output((Osmium::OSMFile(range_filename)));
+            output.num_workers(num_workers);
+            NodeRangeHandler handler(output, 8001, 20000);
+            Osmium::Input::read(Osmium::OSMFile(input_filename), handler);
+            BOOST_CHECK_EQUAL(1, handler.raw_count);
+            BOOST_CHECK_EQUAL(1, handler.dropped_count);
+        }
+        CountingHandler counter;
+        Osmium::Input::read(Osmium::OSMFile(range_filename), counter);
+        BOOST_CHECK_EQUAL(12000, counter.node_count);
+        BOOST_CHECK_EQUAL(100, counter.way_count);
+        BOOST_CHECK_EQUAL(1, counter.relation_count);
+        BOOST_CHECK_EQUAL((8001LL + 20000) * 12000 / 2 + 5050 + 5, counter.id_sum);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(locations_on_ways) {
+    TempFileFixture test_pbf("test_pbf_ways.osm.pbf");
+    write_way_file(test_pbf.to_string(), true);
+    WayNodesHandler handler;
+    Osmium::Input::read(Osmium::OSMFile(test_pbf.to_string()), handler);
+    BOOST_CHECK(handler.locations_on_ways);
+    BOOST_REQUIRE_EQUAL(4u, handler.way_nodes.size());
+    BOOST_CHECK_EQUAL(-3, handler.way_nodes[1].ref());
+    BOOST_CHECK(handler.way_nodes[0].position() == Osmium::OSM::Position(1.5, -2.25));
+    BOOST_CHECK(handler.way_nodes[1].position() == Osmium::OSM::Position(-179.9999999, 89.9999999));
+    BOOST_CHECK(!handler.way_nodes[2].position().defined());
+    BOOST_CHECK(handler.way_nodes[3].position() == Osmium::OSM::Position(1.5, -2.25));
+
+    // way nodes without position stay undefined with other granularities
+    TempFileFixture coarse_pbf("test_pbf_ways_coarse.osm.pbf");
+    write_way_file(coarse_pbf.to_string(), true, 1000);
+    WayNodesHandler coarse_handler;
+    Osmium::Input::read(Osmium::OSMFile(coarse_pbf.to_string()), coarse_handler);
+    BOOST_REQUIRE_EQUAL(4u, coarse_handler.way_nodes.size());
+    BOOST_CHECK(coarse_handler.way_nodes[0].position() == Osmium::OSM::Position(1.5, -2.25));
+    BOOST_CHECK(!coarse_handler.way_nodes[2].position().defined());
+    BOOST_CHECK(coarse_handler.way_nodes[3].position() == Osmium::OSM::Position(1.5, -2.25));
+
+    TempFileFixture without_pbf("test_pbf_ways_without.osm.pbf");
+    write_way_file(without_pbf.to_string(), false);
+    WayNodesHandler without_handler;
+    Osmium::Input::read(Osmium::OSMFile(without_pbf.to_string()), without_handler);
+    BOOST_CHECK(!without_handler.locations_on_ways);
+    BOOST_REQUIRE_EQUAL(4u, without_handler.way_nodes.size());
+    BOOST_CHECK_EQUAL(10, without_handler.way_nodes[3].ref());
+    BOOST_CHECK(!without_handler.way_nodes[0].position().defined());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
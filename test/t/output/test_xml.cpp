@@ -0,0 +1,115 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <osmium.hpp>
+#include <osmium/output/xml.hpp>
+
+#include <temp_file_fixture.hpp>
+
+static std::string file_content(const std::string& filename) {
+    std::ifstream file(filename.c_str(), std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static shared_ptr<Osmium::OSM::Node> make_node(osm_object_id_t id, osm_version_t version, bool visible) {
+    shared_ptr<Osmium::OSM::Node> node = make_shared<Osmium::OSM::Node>();
+    node->id(id).version(version).timestamp(1351415520).uid(5).user("foo").changeset(7);
+    node->visible(visible);
+    return node;
+}
+
+BOOST_AUTO_TEST_SUITE(XMLOutput)
+
+BOOST_AUTO_TEST_CASE(empty_file) {
+    TempFileFixture test_file("test_xml.osm");
+    const std::string& filename = test_file.to_string();
+    Osmium::Output::XML output((Osmium::OSMFile(filename)));
+    output.set_generator("test");
+    Osmium::OSM::Meta meta;
+    output.init(meta);
+    output.final();
+
+    BOOST_CHECK_EQUAL(std::string("<?xml version=\"1.0\"?>\n<osm version=\"0.6\" generator=\"test\"/>\n"), file_content(filename));
+}
+
+BOOST_AUTO_TEST_CASE(objects) {
+    TempFileFixture test_file("test_xml.osm");
+    const std::string& filename = test_file.to_string();
+    Osmium::Output::XML output((Osmium::OSMFile(filename)));
+    output.set_generator("test");
+    Osmium::OSM::Meta meta;
+    meta.bounds().extend(Osmium::OSM::Position(-1.5, -0.25)).extend(Osmium::OSM::Position(179.9999999, 89.0000001));
+    output.init(meta);
+
+    shared_ptr<Osmium::OSM::Node> node = make_node(-1, 2, true);
+    node->position(Osmium::OSM::Position(-0.0000001, 50.1234567));
+    node->tags().add("name", "<a & \"b\">\tc\n\xc3\xa4\xe2\x82\xac\xf0\x9f\x98\x80");
+    node->tags().add("broken", "\x80\xed\xa0\x80\xc3");
+    output.node(node);
+
+    shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+    way->id(3);
+    way->add_node(1);
+    way->add_node(-9223372036854775807LL);
+    output.way(way);
+
+    shared_ptr<Osmium::OSM::Relation> relation = make_shared<Osmium::OSM::Relation>();
+    relation->id(4).version(1);
+    relation->add_member('w', 3, "out'er");
+    output.relation(relation);
+    output.final();
+
+    BOOST_CHECK_EQUAL(std::string(
+        "<?xml version=\"1.0\"?>\n"
+        "<osm version=\"0.6\" generator=\"test\">\n"
+        "  <bounds minlon=\"-1.5000000\" minlat=\"-0.2500000\" maxlon=\"179.9999999\" maxlat=\"89.0000001\"/>\n"
+        "  <node id=\"-1\" version=\"2\" timestamp=\"2012-10-28T09:12:00Z\" uid=\"5\" user=\"foo\" changeset=\"7\" lat=\"50.1234567\" lon=\"-0.0000001\">\n"
+        "    <tag k=\"name\" v=\"&lt;a &amp; &quot;b&quot;&gt;&#9;c&#10;&#xE4;&#x20AC;&#x1F600;\"/>\n"
+        "    <tag k=\"broken\" v=\"&#x80;&#xED;&#xA0;&#x80;\xc3\"/>\n"
+        "  </node>\n"
+        "  <way id=\"3\">\n"
+        "    <nd ref=\"1\"/>\n"
+        "    <nd ref=\"-9223372036854775807\"/>\n"
+        "  </way>\n"
+        "  <relation id=\"4\" version=\"1\">\n"
+        "    <member type=\"way\" ref=\"3\" role=\"out'er\"/>\n"
+        "  </relation>\n"
+        "</osm>\n"), file_content(filename));
+}
+
+BOOST_AUTO_TEST_CASE(change_file) {
+    TempFileFixture test_file("test_xml.osc");
+    const std::string& filename = test_file.to_string();
+    Osmium::Output::XML output((Osmium::OSMFile(filename)));
+    output.set_generator("test");
+    Osmium::OSM::Meta meta;
+    output.init(meta);
+    output.node(make_node(1, 1, true));
+    output.node(make_node(2, 1, true));
+    output.node(make_node(3, 2, true));
+    output.node(make_node(4, 3, false));
+    output.final();
+
+    BOOST_CHECK_EQUAL(std::string(
+        "<?xml version=\"1.0\"?>\n"
+        "<osmChange version=\"0.6\" generator=\"test\">\n"
+        "  <create>\n"
+        "    <node id=\"1\" version=\"1\" timestamp=\"2012-10-28T09:12:00Z\" uid=\"5\" user=\"foo\" changeset=\"7\"/>\n"
+        "    <node id=\"2\" version=\"1\" timestamp=\"2012-10-28T09:12:00Z\" uid=\"5\" user=\"foo\" changeset=\"7\"/>\n"
+        "  </create>\n"
+        "  <modify>\n"
+        "    <node id=\"3\" version=\"2\" timestamp=\"2012-10-28T09:12:00Z\" uid=\"5\" user=\"foo\" changeset=\"7\"/>\n"
+        "  </modify>\n"
+        "  <delete>\n"
+        "    <node id=\"4\" version=\"3\" timestamp=\"2012-10-28T09:12:00Z\" uid=\"5\" user=\"foo\" changeset=\"7\"/>\n"
+        "  </delete>\n"
+        "</osmChange>\n"), file_content(filename));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
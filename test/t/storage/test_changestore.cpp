@@ -0,0 +1,103 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <osmium/storage/changestore.hpp>
+
+#include <test_handlers.hpp>
+
+using Osmium::Test::RecordingHandler;
+using Osmium::Test::make_node;
+using Osmium::Test::make_way;
+using Osmium::Test::make_relation;
+
+BOOST_AUTO_TEST_SUITE(ChangeStore)
+
+BOOST_AUTO_TEST_CASE(sort_keeps_newest_version) {
+    Osmium::Storage::ChangeStore changes;
+    changes.way(make_way(3, 2));
+    changes.node(make_node(5, 3));
+    changes.node(make_node(-5, 1));
+    changes.node(make_node(5, 4));
+    changes.node(make_node(2, 1));
+    changes.node(make_node(5, 2));
+    BOOST_CHECK_EQUAL(6u, changes.size());
+
+    changes.sort();
+    BOOST_REQUIRE_EQUAL(4u, changes.size());
+    Osmium::Storage::ChangeStore::const_iterator it = changes.begin();
+    BOOST_CHECK_EQUAL(2, it->id);
+    ++it;
+    BOOST_CHECK_EQUAL(-5, it->id);
+    ++it;
+    BOOST_CHECK_EQUAL(5, it->id);
+    BOOST_CHECK_EQUAL(4u, it->version);
+    BOOST_CHECK_EQUAL(4u, changes.object(*it).version());
+    ++it;
+    BOOST_CHECK_EQUAL(WAY, it->type);
+}
+
+BOOST_AUTO_TEST_CASE(apply) {
+    Osmium::Storage::ChangeStore changes;
+    changes.node(make_node(1, 2));         // modified
+    changes.node(make_node(3, 2, false));  // deleted
+    changes.node(make_node(4, 1));         // created between existing nodes
+    changes.node(make_node(9, 1));         // created after the last node
+    changes.way(make_way(1, 1));           // older than the existing way
+    changes.relation(make_relation(7, 1)); // created, there are no relations yet
+
+    RecordingHandler handler(RecordingHandler::with_callbacks);
+    Osmium::Storage::ChangeStore::ApplyHandler<RecordingHandler> apply(changes, handler);
+
+    Osmium::OSM::Meta meta;
+    apply.init(meta);
+    apply.before_nodes();
+    apply.node(make_node(1, 1));
+    apply.node(make_node(2, 1));
+    apply.node(make_node(3, 1));
+    apply.node(make_node(5, 1));
+    apply.after_nodes();
+    apply.before_ways();
+    apply.way(make_way(1, 2));
+    apply.after_ways();
+    apply.final();
+
+    BOOST_CHECK_EQUAL(std::string(
+        "init [] 0\n"
+        "before_nodes\n"
+        "n1 v2 dV c0 t0 i-1 u[someone] x15000000 y-25000000\n"
+        "n2 v1 dV c0 t0 i-1 u[someone] x15000000 y-25000000\n"
+        "n4 v1 dV c0 t0 i-1 u[someone] x15000000 y-25000000\n"
+        "n5 v1 dV c0 t0 i-1 u[someone] x15000000 y-25000000\n"
+        "n9 v1 dV c0 t0 i-1 u[someone] x15000000 y-25000000\n"
+        "after_nodes\n"
+        "before_ways\n"
+        "w1 v2 dV c0 t0 i-1 u[someone] 10@30000000,40000000 11\n"
+        "after_ways\n"
+        "before_relations\n"
+        "r7 v1 dV c0 t0 i-1 u[someone]\n"
+        "after_relations\n"
+        "final\n"), handler.out.str());
+}
+
+BOOST_AUTO_TEST_CASE(delete_all_ways) {
+    Osmium::Storage::ChangeStore changes;
+    changes.way(make_way(1, 3, false));
+
+    RecordingHandler handler(RecordingHandler::with_callbacks);
+    Osmium::Storage::ChangeStore::ApplyHandler<RecordingHandler> apply(changes, handler);
+
+    Osmium::OSM::Meta meta;
+    apply.init(meta);
+    apply.before_ways();
+    apply.way(make_way(1, 2));
+    apply.after_ways();
+    apply.final();
+
+    BOOST_CHECK_EQUAL(std::string("init [] 0\nfinal\n"), handler.out.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,143 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <osmium/storage/objectbuffer.hpp>
+
+#include <test_handlers.hpp>
+
+using Osmium::Test::RecordingHandler;
+using Osmium::Test::make_node;
+using Osmium::Test::make_way;
+using Osmium::Test::make_relation;
+
+BOOST_AUTO_TEST_SUITE(ObjectBuffer)
+
+BOOST_AUTO_TEST_CASE(empty) {
+    Osmium::Storage::ObjectBuffer buffer;
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK(buffer.begin() == buffer.end());
+    BOOST_CHECK_EQUAL(0u, buffer.memory());
+}
+
+BOOST_AUTO_TEST_CASE(iterate_over_blocks) {
+    Osmium::Storage::ObjectBuffer buffer(1000);
+    for (int id=1; id <= 100; ++id) {
+        shared_ptr<Osmium::OSM::Node> node = make_node(id);
+        node->tags().add("name", id % 2 ? "odd" : "even");
+        buffer.node(node);
+    }
+    // larger than a block
+    buffer.way(make_way(7, 1, true, 100));
+    buffer.way(make_way(8));
+    BOOST_CHECK_EQUAL(102u, buffer.size());
+    BOOST_CHECK(buffer.memory() > 10 * 1000);
+
+    osm_object_id_t id = 1;
+    Osmium::Storage::ObjectBuffer::const_iterator it = buffer.begin();
+    for (; id <= 100; ++it, ++id) {
+        BOOST_REQUIRE(it != buffer.end());
+        BOOST_CHECK_EQUAL(NODE, it->type());
+        BOOST_CHECK_EQUAL(id, it->id());
+        BOOST_CHECK_EQUAL(std::string("someone"), it->user());
+        BOOST_CHECK(Osmium::OSM::Position(1.5, -2.5) == it->position());
+        BOOST_CHECK_EQUAL(std::string(id % 2 ? "odd" : "even"), it->tags().get_value_by_key("name"));
+    }
+    BOOST_REQUIRE(it != buffer.end());
+    BOOST_CHECK_EQUAL(7, it->id());
+    BOOST_CHECK_EQUAL(100u, it->nodes().size());
+    ++it;
+    BOOST_REQUIRE(it != buffer.end());
+    BOOST_CHECK_EQUAL(8, it->id());
+    ++it;
+    BOOST_CHECK(it == buffer.end());
+
+    buffer.clear();
+    BOOST_CHECK(buffer.begin() == buffer.end());
+    BOOST_CHECK_EQUAL(0u, buffer.memory());
+}
+
+BOOST_AUTO_TEST_CASE(views_stay_valid) {
+    Osmium::Storage::ObjectBuffer buffer(100);
+    Osmium::Storage::ObjectBuffer other;
+    other.node(make_node(3));
+    const Osmium::Dump::ObjectView node = buffer.add(*other.begin());
+    for (int id=1; id <= 100; ++id) {
+        buffer.node(make_node(id));
+    }
+    BOOST_CHECK_EQUAL(3, node.id());
+    BOOST_CHECK(node.data() == buffer.begin()->data());
+}
+
+BOOST_AUTO_TEST_CASE(list_views) {
+    Osmium::Storage::ObjectBuffer buffer;
+    shared_ptr<Osmium::OSM::Node> node = make_node(1);
+    node->tags().add("amenity", "pub");
+    node->tags().add("name", "odd");
+    buffer.node(node);
+    buffer.way(make_way(2, 1, true, 3));
+    shared_ptr<Osmium::OSM::Relation> relation = make_relation(3);
+    relation->add_member('w', 2, "outer");
+    relation->add_member('n', 1, "");
+    buffer.relation(relation);
+
+    Osmium::Storage::ObjectBuffer::const_iterator it = buffer.begin();
+    Osmium::Dump::TagListView tags = it->tags();
+    BOOST_REQUIRE_EQUAL(2u, tags.size());
+    Osmium::Dump::TagListView::const_iterator tag = tags.begin();
+    BOOST_CHECK_EQUAL(std::string("amenity"), tag->key());
+    BOOST_CHECK_EQUAL(std::string("pub"), (*tag).value());
+    ++tag;
+    BOOST_CHECK_EQUAL(std::string("name"), tag->key());
+    ++tag;
+    BOOST_CHECK(tag == tags.end());
+    BOOST_CHECK(!tags.get_value_by_key("highway"));
+
+    ++it;
+    Osmium::Dump::WayNodeListView nodes = it->nodes();
+    BOOST_REQUIRE_EQUAL(3u, nodes.size());
+    BOOST_CHECK(!nodes.is_closed());
+    BOOST_CHECK_EQUAL(10, nodes.front().ref());
+    BOOST_CHECK(Osmium::OSM::Position(3.0, 4.0) == nodes.front().position());
+    BOOST_CHECK_EQUAL(12, nodes.back().ref());
+    osm_object_id_t ref = 10;
+    for (Osmium::Dump::WayNodeListView::const_iterator node = nodes.begin(); node != nodes.end(); ++node) {
+        BOOST_CHECK_EQUAL(ref++, node->ref());
+    }
+    BOOST_CHECK(it->tags().empty());
+
+    ++it;
+    Osmium::Dump::MemberListView members = it->members();
+    BOOST_REQUIRE_EQUAL(2u, members.size());
+    BOOST_CHECK_EQUAL('w', members.begin()->type());
+    BOOST_CHECK_EQUAL(2, members.begin()->ref());
+    BOOST_CHECK_EQUAL(std::string("outer"), members.begin()->role());
+    BOOST_CHECK_EQUAL('n', members[1].type());
+    BOOST_CHECK_EQUAL(std::string(""), members[1].role());
+}
+
+BOOST_AUTO_TEST_CASE(feed_to) {
+    Osmium::Storage::ObjectBuffer buffer;
+    buffer.node(make_node(1));
+    buffer.node(make_node(2));
+    buffer.way(make_way(3, 1, true, 5));
+
+    RecordingHandler handler(RecordingHandler::with_callbacks);
+    Osmium::OSM::Meta meta;
+    buffer.feed_to(handler, meta);
+    BOOST_CHECK_EQUAL(std::string(
+        "init [] 0\n"
+        "before_nodes\n"
+        "n1 v1 dV c0 t0 i-1 u[someone] x15000000 y-25000000\n"
+        "n2 v1 dV c0 t0 i-1 u[someone] x15000000 y-25000000\n"
+        "after_nodes\n"
+        "before_ways\n"
+        "w3 v1 dV c0 t0 i-1 u[someone] 10@30000000,40000000 11 12 13 14\n"
+        "after_ways\n"
+        "final\n"), handler.out.str());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
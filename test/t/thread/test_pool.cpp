@@ -0,0 +1,44 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <osmium/thread/pool.hpp>
+
+BOOST_AUTO_TEST_SUITE(ThreadPool)
+
+namespace {
+
+    boost::mutex counter_mutex;
+    boost::condition_variable counter_changed;
+    int counter = 0;
+
+    void increment() {
+        boost::lock_guard<boost::mutex> lock(counter_mutex);
+        ++counter;
+        counter_changed.notify_all();
+    }
+
+}
+
+BOOST_AUTO_TEST_CASE(runs_all_tasks) {
+    Osmium::Thread::Pool pool(3);
+    BOOST_CHECK_EQUAL(3, pool.num_threads());
+
+    for (int i=0; i < 100; ++i) {
+        pool.submit(increment);
+    }
+
+    boost::unique_lock<boost::mutex> lock(counter_mutex);
+    while (counter < 100) {
+        counter_changed.wait(lock);
+    }
+    BOOST_CHECK_EQUAL(100, counter);
+}
+
+BOOST_AUTO_TEST_CASE(default_num_threads) {
+    BOOST_CHECK(Osmium::Thread::Pool::default_num_threads() >= 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
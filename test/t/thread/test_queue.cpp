@@ -0,0 +1,36 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <osmium/thread/queue.hpp>
+
+BOOST_AUTO_TEST_SUITE(ThreadQueue)
+
+BOOST_AUTO_TEST_CASE(fifo_order) {
+    Osmium::Thread::Queue<int> queue;
+    BOOST_CHECK(queue.push(1));
+    BOOST_CHECK(queue.push(2));
+    BOOST_CHECK_EQUAL(2u, queue.size());
+
+    int value = 0;
+    BOOST_CHECK(queue.pop(value));
+    BOOST_CHECK_EQUAL(1, value);
+    BOOST_CHECK(queue.pop(value));
+    BOOST_CHECK_EQUAL(2, value);
+    BOOST_CHECK_EQUAL(0u, queue.size());
+}
+
+BOOST_AUTO_TEST_CASE(shutdown) {
+    Osmium::Thread::Queue<int> queue(1);
+    BOOST_CHECK(queue.push(1));
+    queue.shutdown();
+    BOOST_CHECK_EQUAL(0u, queue.size());
+
+    int value = 0;
+    BOOST_CHECK(!queue.pop(value));
+    BOOST_CHECK(!queue.push(2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
@@ -0,0 +1,130 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+#include <osmium/utils/protobuf.hpp>
+#include <osmium/input/pbf_primitive_block.hpp>
+
+BOOST_AUTO_TEST_SUITE(Protobuf)
+
+BOOST_AUTO_TEST_CASE(varint) {
+    const char data[] = "\x01\xac\x02\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01";
+    const char* p = data;
+    const char* end = data + sizeof(data) - 1;
+    BOOST_CHECK_EQUAL(1u, Osmium::Protobuf::decode_varint(p, end));
+    BOOST_CHECK_EQUAL(300u, Osmium::Protobuf::decode_varint(p, end));
+    BOOST_CHECK_EQUAL(static_cast<uint64_t>(-1), Osmium::Protobuf::decode_varint(p, end));
+    BOOST_CHECK(p == end);
+
+    p = data + 1;
+    BOOST_CHECK_THROW(Osmium::Protobuf::decode_varint(p, data + 2), Osmium::Protobuf::ParseError);
+}
+
+BOOST_AUTO_TEST_CASE(zigzag) {
+    BOOST_CHECK_EQUAL(0, Osmium::Protobuf::decode_zigzag64(0));
+    BOOST_CHECK_EQUAL(-1, Osmium::Protobuf::decode_zigzag64(1));
+    BOOST_CHECK_EQUAL(1, Osmium::Protobuf::decode_zigzag64(2));
+    BOOST_CHECK_EQUAL(-2, Osmium::Protobuf::decode_zigzag32(3));
+    BOOST_CHECK_EQUAL(2147483647, Osmium::Protobuf::decode_zigzag32(4294967294u));
+}
+
+BOOST_AUTO_TEST_CASE(message) {
+    // field 1: varint 150, field 2: string "abc", field 3: packed sint64 (-1, 2), field 4: fixed32
+    const std::string data("\x08\x96\x01\x12\x03" "abc" "\x1a\x02\x01\x04" "\x25\x01\x02\x03\x04", 17);
+    Osmium::Protobuf::Message message(data.data(), data.size());
+
+    BOOST_REQUIRE(message.next());
+    BOOST_CHECK_EQUAL(1u, message.tag());
+    BOOST_CHECK_EQUAL(Osmium::Protobuf::wire_varint, message.wire_type());
+    BOOST_CHECK_EQUAL(150, message.get_int32());
+
+    BOOST_REQUIRE(message.next());
+    BOOST_CHECK_EQUAL(2u, message.tag());
+    BOOST_CHECK_EQUAL("abc", message.get_string());
+
+    BOOST_REQUIRE(message.next());
+    BOOST_CHECK_EQUAL(3u, message.tag());
+    Osmium::Protobuf::PackedVarints packed = message.get_packed();
+    BOOST_CHECK_EQUAL(2u, packed.count());
+    BOOST_CHECK_EQUAL(-1, packed.next_sint64());
+    BOOST_CHECK_EQUAL(2, packed.next_sint64());
+    BOOST_CHECK(packed.empty());
+    BOOST_CHECK_THROW(packed.next_sint64(), Osmium::Protobuf::ParseError);
+
+    BOOST_REQUIRE(message.next());
+    BOOST_CHECK_EQUAL(4u, message.tag());
+    BOOST_CHECK_THROW(message.get_int32(), Osmium::Protobuf::ParseError);
+    message.skip();
+
+    BOOST_CHECK(!message.next());
+}
+
+void append_sint64(std::string& data, int64_t value) {
+    uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    while (zigzag >= 0x80) {
+        data += static_cast<char>((zigzag & 0x7f) | 0x80);
+        zigzag >>= 7;
+    }
+    data += static_cast<char>(zigzag);
+}
+
+BOOST_AUTO_TEST_CASE(decode_delta_sint64) {
+    // long runs of one byte deltas with some longer ones in between
+    std::vector<int64_t> values;
+    std::string data;
+    int64_t last = 0;
+    for (int i=0; i < 100; ++i) {
+        const int64_t value = last + ((i % 23 == 0) ? -1000000 * i : (i % 7) - 3);
+        append_sint64(data, value - last);
+        values.push_back(value);
+        last = value;
+    }
+
+    Osmium::Protobuf::PackedVarints packed(data.data(), data.size());
+    std::vector<int64_t> out(packed.max_count());
+    BOOST_REQUIRE_EQUAL(values.size(), packed.decode_delta_sint64(&out[0]));
+    BOOST_CHECK(packed.empty());
+    for (size_t i=0; i < values.size(); ++i) {
+        BOOST_CHECK_EQUAL(values[i], out[i]);
+    }
+
+    data.resize(data.size() - 1);
+    data[data.size() - 1] = '\x80';
+    Osmium::Protobuf::PackedVarints truncated(data.data(), data.size());
+    BOOST_CHECK_THROW(truncated.decode_delta_sint64(&out[0]), Osmium::Protobuf::ParseError);
+}
+
+BOOST_AUTO_TEST_CASE(truncated_message) {
+    const std::string data("\x12\x05" "abc", 5);
+    Osmium::Protobuf::Message message(data.data(), data.size());
+    BOOST_REQUIRE(message.next());
+    BOOST_CHECK_THROW(message.get_data(), Osmium::Protobuf::ParseError);
+}
+
+BOOST_AUTO_TEST_CASE(primitive_block) {
+    // stringtable ("", "foo", "bar"), a group with a way, granularity 1000
+    std::string data("\x0a\x0c\x0a\x00\x0a\x03" "foo" "\x0a\x03" "bar" "\x12\x02\x1a\x00" "\x88\x01\xe8\x07", 22);
+    data += '\xff'; // one byte of space needed after the data
+
+    Osmium::Input::PBFPrimitiveBlock block;
+    block.decode(&data[0], data.size() - 1);
+    BOOST_CHECK_EQUAL(1000, block.granularity());
+    BOOST_CHECK_EQUAL(1000, block.date_granularity());
+    BOOST_REQUIRE_EQUAL(1u, block.groups().size());
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(WAY_MASK), Osmium::Input::PBFPrimitiveBlock::group_type(block.groups()[0]));
+    BOOST_CHECK_EQUAL(static_cast<uint32_t>(WAY_MASK), block.group_types());
+
+    block.decode_stringtable();
+    BOOST_REQUIRE_EQUAL(3u, block.stringtable_size());
+    BOOST_CHECK_EQUAL(std::string(""), block.s(0));
+    BOOST_CHECK_EQUAL(std::string("foo"), block.s(1));
+    BOOST_CHECK_EQUAL(std::string("bar"), block.s(2));
+    BOOST_CHECK_EQUAL(3u, block.string(2).second);
+    BOOST_CHECK_THROW(block.s(3), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,63 @@
+#ifdef STAND_ALONE
+# define BOOST_TEST_MODULE Main
+#endif
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+
+#include <osmium/utils/stringtable.hpp>
+
+BOOST_AUTO_TEST_SUITE(StringTable)
+
+BOOST_AUTO_TEST_CASE(sorted_by_count) {
+    Osmium::StringTable table;
+    const Osmium::StringTable::string_id_t foo = table.record_string("foo");
+    const Osmium::StringTable::string_id_t bar = table.record_string(std::string("bar"));
+    const Osmium::StringTable::string_id_t empty = table.record_string("");
+    BOOST_CHECK_EQUAL(bar, table.record_string("bar", 3));
+    BOOST_CHECK_EQUAL(foo, table.record_string("foobar", 3));
+    BOOST_CHECK_EQUAL(empty, table.record_string(""));
+    table.record_string("bar");
+    BOOST_CHECK_EQUAL(3u, table.size());
+
+    OSMPBF::StringTable st;
+    table.store_stringtable(&st);
+    BOOST_REQUIRE_EQUAL(4, st.s_size());
+    BOOST_CHECK_EQUAL(std::string(""), st.s(0));
+    BOOST_CHECK_EQUAL(std::string("bar"), st.s(1));
+    BOOST_CHECK_EQUAL(std::string("foo"), st.s(2));
+    BOOST_CHECK_EQUAL(std::string(""), st.s(3));
+    BOOST_CHECK_EQUAL(1u, table.map_string_id(bar));
+    BOOST_CHECK_EQUAL(2u, table.map_string_id(foo));
+    BOOST_CHECK_EQUAL(3u, table.map_string_id(empty));
+}
+
+BOOST_AUTO_TEST_CASE(grow_and_reuse) {
+    Osmium::StringTable table;
+    for (int round=0; round < 2; ++round) {
+        for (int i=0; i < 5000; ++i) {
+            const std::string s = boost::lexical_cast<std::string>(i);
+            BOOST_CHECK_EQUAL(static_cast<Osmium::StringTable::string_id_t>(i + 1), table.record_string(s));
+        }
+        for (int i=0; i < 5000; i += 7) {
+            table.record_string(boost::lexical_cast<std::string>(i));
+        }
+        BOOST_CHECK_EQUAL(5000u, table.size());
+
+        OSMPBF::StringTable st;
+        table.store_stringtable(&st);
+        BOOST_REQUIRE_EQUAL(5001, st.s_size());
+        BOOST_CHECK_EQUAL(std::string("0"), st.s(1));
+        BOOST_CHECK_EQUAL(std::string("7"), st.s(2));
+        BOOST_CHECK_EQUAL(std::string("1"), st.s(716));
+        for (int i=0; i < 5000; ++i) {
+            BOOST_CHECK_EQUAL(boost::lexical_cast<std::string>(i), st.s(table.map_string_id(i + 1)));
+        }
+        table.clear();
+        BOOST_CHECK_EQUAL(0u, table.size());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -21,5 +21,36 @@ BOOST_AUTO_TEST_CASE(sometime) {
     BOOST_CHECK_EQUAL(std::string(ts), Osmium::Timestamp::to_iso(t));
 }
 
+BOOST_AUTO_TEST_CASE(append_matches_to_iso) {
+    const time_t timestamps[] = { 0, 1, -1, 951825600, 1351415520, 4107542399LL, -2208988800LL, 253402300799LL };
+    for (size_t i=0; i < sizeof(timestamps) / sizeof(time_t); ++i) {
+        std::string out("x");
+        Osmium::Timestamp::append_iso(out, timestamps[i]);
+        BOOST_CHECK_EQUAL("x" + Osmium::Timestamp::to_iso(timestamps[i]), out);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parse_matches_timegm) {
+    const char* timestamps[] = {
+        "1970-01-01T00:00:00Z",
+        "1969-12-31T23:59:59Z",
+        "2000-02-29T12:00:00Z",
+        "2100-03-01T00:00:00Z",
+        "2012-12-31T23:59:60Z",
+        "2011-02-30T01:02:03Z",
+        NULL
+    };
+    for (int i=0; timestamps[i]; ++i) {
+        struct tm tm = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+        strptime(timestamps[i], "%Y-%m-%dT%H:%M:%SZ", &tm);
+        BOOST_CHECK_EQUAL(timegm(&tm), Osmium::Timestamp::parse_iso(timestamps[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(parse_invalid) {
+    BOOST_CHECK_THROW(Osmium::Timestamp::parse_iso("2011-13-28T09:12:00Z"), std::invalid_argument);
+    BOOST_CHECK_THROW(Osmium::Timestamp::parse_iso("foo"), std::invalid_argument);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
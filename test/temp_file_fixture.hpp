@@ -1,27 +1,41 @@
 #ifndef TEMP_FILE_FIXTURE
 #define TEMP_FILE_FIXTURE
 
+#include <string>
+
 #include <boost/test/unit_test.hpp>
 #include <boost/filesystem.hpp>
 
-boost::filesystem::path tempdir_path;
-
-/* TempDirFixture:  Prepare a temp directory and clean up afterwards
+/* TempBaseDir:  A temp directory for all temp files of the test program. It
+ * is created on first use and removed with all its contents on exit.
  */
-struct TempBaseDirFixture {
-    TempBaseDirFixture() {
-        tempdir_path = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
-        boost::filesystem::create_directory(tempdir_path);
+struct TempBaseDir {
+    TempBaseDir() :
+        path(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()) {
+        boost::filesystem::create_directory(path);
     }
 
-    ~TempBaseDirFixture() {
-        boost::filesystem::remove_all(tempdir_path);
+    ~TempBaseDir() {
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(path, ec);
     }
+
+    boost::filesystem::path path;
 };
 
+/* tempdir_path:  Path of the temp directory. Defined in a function so this
+ * header can be included in several test files linked into one program.
+ */
+inline const boost::filesystem::path& tempdir_path() {
+    static TempBaseDir tempdir;
+    return tempdir.path;
+}
+
+/* TempDirFixture:  Prepare a temp directory and clean up afterwards
+ */
 struct TempDirFixture {
     TempDirFixture(const std::string& name) {
-        path = tempdir_path / name;
+        path = tempdir_path() / name;
     }
 
     ~TempDirFixture() {
@@ -46,13 +60,17 @@ struct TempDirFixture {
     boost::filesystem::path path;
 };
 
+/* TempFileFixture:  Name of a file in the temp directory, the file is removed
+ * when the fixture goes out of scope.
+ */
 struct TempFileFixture {
     TempFileFixture(const std::string& name) {
-        path = tempdir_path / name;
+        path = tempdir_path() / name;
     }
 
     ~TempFileFixture() {
-        boost::filesystem::remove(path);
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
     }
 
     operator const char*() const {
@@ -66,7 +84,4 @@ struct TempFileFixture {
     boost::filesystem::path path;
 };
 
-
-BOOST_GLOBAL_FIXTURE(TempBaseDirFixture);
-
 #endif
@@ -0,0 +1,186 @@
+#ifndef OSMIUM_TEST_HANDLERS_HPP
+#define OSMIUM_TEST_HANDLERS_HPP
+
+#include <sstream>
+#include <vector>
+
+#include <osmium/handler.hpp>
+
+namespace Osmium {
+
+    namespace Test {
+
+        /**
+         * Handler that writes a line for each object it gets into out.
+         * Tests compare this output with the expected one.
+         *
+         * Each line has the object type and id followed by the fields
+         * version (v), visible (d), changeset (c), timestamp (t),
+         * uid (i), and user (u), the tags as [key]=[value], and then the
+         * coordinates of a node, the node refs of a way (with @x,y if the
+         * way node has a position), or the members of a relation:
+         *
+         *   n1 v2 dV c3 t1300000000 i4 u[foo] [amenity]=[pub] x15000000 y-25000000
+         */
+        class RecordingHandler : public Osmium::Handler::Base {
+
+        public:
+
+            enum options {
+                /// only write the objects
+                objects_only   = 0,
+                /// write a line for each other callback, too
+                with_callbacks = 1,
+                /// keep all objects in the objects vector
+                keep_objects   = 2
+            };
+
+            std::ostringstream out;
+
+            /// All objects, only filled with keep_objects.
+            std::vector<shared_ptr<Osmium::OSM::Object const> > objects;
+
+            /// Number of after_block() calls.
+            int blocks;
+
+            explicit RecordingHandler(int options=objects_only) :
+                out(),
+                objects(),
+                blocks(0),
+                m_options(options) {
+            }
+
+            void init(Osmium::OSM::Meta& meta) {
+                if (m_options & with_callbacks) {
+                    out << "init [" << meta.generator() << "] " << meta.has_multiple_object_versions() << "\n";
+                }
+            }
+
+            void before_nodes() {
+                callback("before_nodes");
+            }
+
+            void node(const shared_ptr<Osmium::OSM::Node const>& node) {
+                meta('n', *node);
+                out << " x" << node->position().x() << " y" << node->position().y() << "\n";
+                keep(node);
+            }
+
+            void after_nodes() {
+                callback("after_nodes");
+            }
+
+            void before_ways() {
+                callback("before_ways");
+            }
+
+            void way(const shared_ptr<Osmium::OSM::Way const>& way) {
+                meta('w', *way);
+                for (Osmium::OSM::WayNodeList::const_iterator it = way->nodes().begin(); it != way->nodes().end(); ++it) {
+                    out << " " << it->ref();
+                    if (it->has_position()) {
+                        out << "@" << it->position().x() << "," << it->position().y();
+                    }
+                }
+                out << "\n";
+                keep(way);
+            }
+
+            void after_ways() {
+                callback("after_ways");
+            }
+
+            void before_relations() {
+                callback("before_relations");
+            }
+
+            void relation(const shared_ptr<Osmium::OSM::Relation const>& relation) {
+                meta('r', *relation);
+                for (Osmium::OSM::RelationMemberList::const_iterator it = relation->members().begin(); it != relation->members().end(); ++it) {
+                    out << " " << it->type() << it->ref() << ":" << it->role();
+                }
+                out << "\n";
+                keep(relation);
+            }
+
+            void after_relations() {
+                callback("after_relations");
+            }
+
+            void after_block() {
+                ++blocks;
+            }
+
+            void final() {
+                callback("final");
+            }
+
+        private:
+
+            int m_options;
+
+            void callback(const char* name) {
+                if (m_options & with_callbacks) {
+                    out << name << "\n";
+                }
+            }
+
+            void meta(char type, const Osmium::OSM::Object& object) {
+                out << type << object.id()
+                    << " v" << object.version()
+                    << " d" << (object.visible() ? 'V' : 'D')
+                    << " c" << object.changeset()
+                    << " t" << object.timestamp()
+                    << " i" << object.uid()
+                    << " u[" << object.user() << "]";
+                for (Osmium::OSM::TagList::const_iterator it = object.tags().begin(); it != object.tags().end(); ++it) {
+                    out << " [" << it->key() << "]=[" << it->value() << "]";
+                }
+            }
+
+            void keep(const shared_ptr<Osmium::OSM::Object const>& object) {
+                if (m_options & keep_objects) {
+                    objects.push_back(object);
+                }
+            }
+
+        }; // class RecordingHandler
+
+        /**
+         * Create a node at 1.5/-2.5 from user "someone" without tags.
+         */
+        inline shared_ptr<Osmium::OSM::Node> make_node(osm_object_id_t id, osm_version_t version=1, bool visible=true) {
+            shared_ptr<Osmium::OSM::Node> node = make_shared<Osmium::OSM::Node>();
+            node->id(id).version(version).visible(visible).user("someone");
+            node->position(Osmium::OSM::Position(1.5, -2.5));
+            return node;
+        }
+
+        /**
+         * Create a way from user "someone" without tags. It has num_nodes
+         * nodes with refs 10, 11, ..., the first one has the position 3/4.
+         */
+        inline shared_ptr<Osmium::OSM::Way> make_way(osm_object_id_t id, osm_version_t version=1, bool visible=true, int num_nodes=2) {
+            shared_ptr<Osmium::OSM::Way> way = make_shared<Osmium::OSM::Way>();
+            way->id(id).version(version).visible(visible).user("someone");
+            way->nodes().add(Osmium::OSM::WayNode(10, Osmium::OSM::Position(3.0, 4.0)));
+            for (int n=1; n < num_nodes; ++n) {
+                way->add_node(10 + n);
+            }
+            return way;
+        }
+
+        /**
+         * Create a relation from user "someone" without tags and members.
+         */
+        inline shared_ptr<Osmium::OSM::Relation> make_relation(osm_object_id_t id, osm_version_t version=1, bool visible=true) {
+            shared_ptr<Osmium::OSM::Relation> relation = make_shared<Osmium::OSM::Relation>();
+            relation->id(id).version(version).visible(visible).user("someone");
+            return relation;
+        }
+
+    } // namespace Test
+
+} // namespace Osmium
+
+#endif // OSMIUM_TEST_HANDLERS_HPP